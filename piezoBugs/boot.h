@@ -0,0 +1,140 @@
+/*
+ * boot.h - Cronología del arranque por etapas
+ *
+ * setup() se divide en etapas cortas (bootStageBegin/bootStageEnd) y lo
+ * lento (textos de ayuda, autopruebas, WiFi) pasa a etapas de fondo que
+ * terminan más tarde, desde el loop. Se anotan también la primera luz y
+ * el primer sonido, que es lo que ve quien enciende el centinela.
+ *
+ * bootReportWhenSettled() imprime una línea por etapa con un formato fijo,
+ *   boot,<etapa>,<inicio ms>,<duración ms>[,fondo]
+ * para poder comparar el arranque entre versiones con un grep.
+ */
+
+#ifndef PIEZOBUGS_BOOT_H
+#define PIEZOBUGS_BOOT_H
+
+#include "hal.h"
+
+const uint8_t BOOT_MAX_STAGES = 12;
+const uint32_t BOOT_TARGET_MS = 300;           // Luz y sonido antes de esto
+const uint32_t BOOT_REPORT_TIMEOUT_MS = 15000; // Informe aunque quede algo en marcha
+
+enum BootEvent {
+  BOOT_FIRST_LIGHT,
+  BOOT_FIRST_SOUND,
+  BOOT_EVENT_COUNT
+};
+
+const char* const BOOT_EVENT_NAMES[BOOT_EVENT_COUNT] = {"primera_luz", "primer_sonido"};
+
+struct BootStage {
+  const char* name;
+  uint32_t startUs;      // Desde bootBegin()
+  uint32_t durationUs;
+  bool background;
+  bool done;
+};
+
+struct BootTimeline {
+  uint32_t originUs;
+  BootStage stages[BOOT_MAX_STAGES];
+  uint8_t count;
+  uint32_t eventUs[BOOT_EVENT_COUNT];
+  uint8_t eventMask;
+  bool reported;
+};
+
+BootTimeline bootTimeline;
+
+inline uint32_t bootElapsedUs() {
+  return hal::micros() - bootTimeline.originUs;
+}
+
+// Primera línea de setup()
+void bootBegin() {
+  bootTimeline = BootTimeline();
+  bootTimeline.originUs = hal::micros();
+}
+
+// Abre una etapa; devuelve su identificador (-1 si no caben más)
+int8_t bootStageBegin(const char* name, bool background = false) {
+  if (bootTimeline.count >= BOOT_MAX_STAGES) return -1;
+  BootStage &stage = bootTimeline.stages[bootTimeline.count];
+  stage.name = name;
+  stage.startUs = bootElapsedUs();
+  stage.durationUs = 0;
+  stage.background = background;
+  stage.done = false;
+  return bootTimeline.count++;
+}
+
+void bootStageEnd(int8_t id) {
+  if (id < 0 || id >= bootTimeline.count || bootTimeline.stages[id].done) return;
+  BootStage &stage = bootTimeline.stages[id];
+  stage.durationUs = bootElapsedUs() - stage.startUs;
+  stage.done = true;
+}
+
+// Solo cuenta la primera vez; el coste en la ruta caliente es una comparación
+inline void bootMark(BootEvent event) {
+  if (bootTimeline.eventMask & (1u << event)) return;
+  bootTimeline.eventMask |= 1u << event;
+  bootTimeline.eventUs[event] = bootElapsedUs();
+}
+
+inline bool bootEventSeen(BootEvent event) {
+  return bootTimeline.eventMask & (1u << event);
+}
+
+// Luz y sonido vistos y ninguna etapa en marcha
+bool bootSettled() {
+  if (bootTimeline.eventMask != (1u << BOOT_EVENT_COUNT) - 1) return false;
+  for (uint8_t i = 0; i < bootTimeline.count; i++) {
+    if (!bootTimeline.stages[i].done) return false;
+  }
+  return true;
+}
+
+// Si el arranque ya terminó (o pasó BOOT_REPORT_TIMEOUT_MS), imprime la
+// cronología una sola vez. Devuelve true cuando ya está impresa
+bool bootReportWhenSettled() {
+  if (bootTimeline.reported) return true;
+  if (!bootSettled() && bootElapsedUs() < BOOT_REPORT_TIMEOUT_MS * 1000) return false;
+  bootTimeline.reported = true;
+
+  Serial.println("\n=== Cronología del arranque (ms) ===");
+  for (uint8_t i = 0; i < bootTimeline.count; i++) {
+    const BootStage &stage = bootTimeline.stages[i];
+    Serial.print("boot,");
+    Serial.print(stage.name);
+    Serial.print(",");
+    Serial.print(stage.startUs / 1000.0, 1);
+    Serial.print(",");
+    if (stage.done) {
+      Serial.print(stage.durationUs / 1000.0, 1);
+    } else {
+      Serial.print("en_curso");
+    }
+    Serial.println(stage.background ? ",fondo" : "");
+  }
+  uint32_t slowest = 0;
+  for (uint8_t e = 0; e < BOOT_EVENT_COUNT; e++) {
+    Serial.print("boot,");
+    Serial.print(BOOT_EVENT_NAMES[e]);
+    Serial.print(",");
+    if (bootEventSeen((BootEvent)e)) {
+      Serial.println(bootTimeline.eventUs[e] / 1000.0, 1);
+      if (bootTimeline.eventUs[e] > slowest) slowest = bootTimeline.eventUs[e];
+    } else {
+      Serial.println("nunca");
+      slowest = 0xFFFFFFFF;
+    }
+  }
+  Serial.print("boot,objetivo,");
+  Serial.print(BOOT_TARGET_MS);
+  Serial.println(slowest <= BOOT_TARGET_MS * 1000 ? ",ok" : ",lento");
+  return true;
+}
+
+#endif // PIEZOBUGS_BOOT_H
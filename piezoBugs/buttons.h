@@ -0,0 +1,307 @@
+/*
+ * buttons.h - Botones del ESP32 AudioKit v2.2 para PiezoBugs
+ *
+ * Un solo subsistema de entrada con la máquina de estados de ButtonHandler
+ * (tests/wav_player/button_handler.h): antirrebote y pulsaciones corta,
+ * larga (al cumplirse LONG_PRESS_TIME, sin esperar a soltar) y doble.
+ *
+ * Los botones digitales avisan con una interrupción de cambio de nivel que
+ * despierta el loop; el botón 1 (GPIO36) se lee por el ADC cada
+ * BUTTON_ADC_POLL_MS, porque en GPIO36/39 las interrupciones dan falsos
+ * disparos con el ADC y el WiFi activos. Los pines que comparten uso con
+ * una salida (el botón 4 con el Neopixel) se leen junto al ADC. Las
+ * pulsaciones van a una cola de eventos, y la tarea "botones" solo corre
+ * cuando hay algo que atender: un aviso, el muestreo del ADC, el final de
+ * un rebote o una pulsación que puede llegar a larga.
+ */
+
+#ifndef PIEZOBUGS_BUTTONS_H
+#define PIEZOBUGS_BUTTONS_H
+
+#include <atomic>
+#include "hal.h"
+#include "config.h"
+#include "insects.h"
+#include "voices.h"
+#include "profile.h"
+#include "scheduler.h"
+
+// Tipos de pulsación (los de ButtonHandler)
+enum ButtonPressType {
+  PRESS_NONE,
+  PRESS_SHORT,
+  PRESS_LONG,
+  PRESS_DOUBLE
+};
+
+const uint8_t BUTTON_COUNT = 6;
+const uint8_t BUTTON_PINS[BUTTON_COUNT] = {
+  BUTTON_1_PIN, BUTTON_2_PIN, BUTTON_3_PIN, BUTTON_4_PIN, BUTTON_5_PIN, BUTTON_6_PIN
+};
+const uint8_t BUTTON_ADC = 0;   // Índice del botón que se lee por el ADC
+
+static_assert(BUTTON_ADC_POLL_MS % NEOPIXEL_FRAME_MS == 0, "El muestreo del ADC debe coincidir con un frame del aro");
+static_assert((BUTTON_QUEUE_SIZE & (BUTTON_QUEUE_SIZE - 1)) == 0, "La cola debe ser potencia de 2");
+
+struct ButtonEvent {
+  uint8_t button;          // 0..5 = botón 1..6
+  uint8_t type;            // ButtonPressType
+  uint32_t ms;
+};
+
+// Estado de un botón (ButtonState de ButtonHandler)
+struct ButtonState {
+  bool isPressed;              // Estado estable, tras el antirrebote
+  bool longPressTriggered;
+  bool settling;               // Ignorando rebotes hasta settleUntil
+  uint8_t consecutivePresses;
+  uint32_t pressStartTime;
+  uint32_t lastPressTime;
+  uint32_t settleUntil;
+};
+
+struct ButtonInput {
+  ButtonState buttons[BUTTON_COUNT];
+  bool interrupt[BUTTON_COUNT];    // false: se lee en cada vuelta de la tarea
+  uint32_t nextAdcSample;
+  ButtonEvent queue[BUTTON_QUEUE_SIZE];
+  uint8_t head;                    // Próximo a escribir
+  uint8_t tail;                    // Próximo a leer
+  uint32_t events;
+  uint32_t dropped;                // Eventos perdidos con la cola llena
+};
+
+ButtonInput buttonInput;
+
+// Lo activa la interrupción; lo consume el loop (buttonsTakeWake)
+std::atomic<bool> buttonWake(false);
+
+// ===============================================
+// INTERRUPCIÓN
+// ===============================================
+
+// Solo avisa: la lectura y el antirrebote se hacen en la tarea
+void IRAM_ATTR buttonIsr() {
+  buttonWake.store(true);
+  hal::wakeFromIsr();
+}
+
+bool buttonsTakeWake() {
+  return buttonWake.exchange(false);
+}
+
+// Para cuando el loop despierta por una entrada sin pasar por buttonIsr
+// (el sueño ligero puede tragarse el flanco)
+void buttonsNotify() {
+  buttonWake.store(true);
+}
+
+// ===============================================
+// COLA DE EVENTOS
+// ===============================================
+
+void buttonPost(uint8_t button, ButtonPressType type, uint32_t now) {
+  if ((uint8_t)(buttonInput.head - buttonInput.tail) >= BUTTON_QUEUE_SIZE) {
+    buttonInput.dropped++;
+    return;
+  }
+  ButtonEvent &e = buttonInput.queue[buttonInput.head % BUTTON_QUEUE_SIZE];
+  e.button = button;
+  e.type = type;
+  e.ms = now;
+  buttonInput.head++;
+  buttonInput.events++;
+}
+
+bool buttonPop(ButtonEvent &event) {
+  if (buttonInput.head == buttonInput.tail) return false;
+  event = buttonInput.queue[buttonInput.tail % BUTTON_QUEUE_SIZE];
+  buttonInput.tail++;
+  return true;
+}
+
+// ===============================================
+// LECTURA Y MÁQUINA DE ESTADOS
+// ===============================================
+
+// Los botones no pueden avisar por interrupción si su pin también es una
+// salida: cada bit enviado al aro sería una interrupción
+bool buttonPinIsOutput(uint8_t pin) {
+  for (uint8_t i = 0; i < NEOPIXEL_RING_COUNT; i++) {
+    if (NEOPIXEL_PINS[i] == pin) return true;
+  }
+  for (uint8_t i = 0; i < PIEZO_PIN_COUNT; i++) {
+    if (PIEZO_PINS[i] == pin) return true;
+  }
+  return false;
+}
+
+bool buttonReadRaw(uint8_t button) {
+  if (button == BUTTON_ADC) {
+    PROFILE_SCOPE(PROF_BUTTON_ADC);
+    return hal::analogRead(BUTTON_PINS[button]) < BUTTON_ADC_THRESHOLD;
+  }
+  return !hal::digitalRead(BUTTON_PINS[button]);   // Invertido por el pull-up
+}
+
+// Cambio estable de un botón (ButtonHandler::updateButtonState)
+void buttonChange(uint8_t button, bool pressed, uint32_t now) {
+  ButtonState &b = buttonInput.buttons[button];
+  b.isPressed = pressed;
+
+  if (pressed) {
+    b.pressStartTime = now;
+    b.longPressTriggered = false;
+    if (b.consecutivePresses > 0 && now - b.lastPressTime < DOUBLE_PRESS_WINDOW_MS) {
+      b.consecutivePresses++;
+    } else {
+      b.consecutivePresses = 1;
+    }
+    b.lastPressTime = now;
+  } else if (!b.longPressTriggered) {
+    // Al soltar: corta, o doble si la anterior fue hace poco
+    if (b.consecutivePresses >= 2) {
+      b.consecutivePresses = 0;
+      buttonPost(button, PRESS_DOUBLE, now);
+    } else {
+      buttonPost(button, PRESS_SHORT, now);
+    }
+  }
+
+  if (button != BUTTON_ADC) {
+    b.settling = true;
+    b.settleUntil = now + BUTTON_DEBOUNCE_MS;
+    if (buttonInput.interrupt[button]) hal::wakeOnPinLevel(BUTTON_PINS[button], pressed ? HIGH : LOW);
+  }
+}
+
+inline uint32_t buttonEarliest(uint32_t a, uint32_t b) {
+  return deadlineBefore(a, b) ? a : b;
+}
+
+// Configura pines e interrupciones. Un botón pulsado al arrancar cuenta
+// como estado inicial, sin evento
+void buttonsBegin(uint32_t now) {
+  buttonInput = ButtonInput();
+  buttonWake.store(false);
+
+  hal::pinMode(BUTTON_PINS[BUTTON_ADC], INPUT);   // ADC, no necesita pull-up
+  for (uint8_t i = 0; i < BUTTON_COUNT; i++) {
+    if (i != BUTTON_ADC) {
+      hal::pinMode(BUTTON_PINS[i], INPUT_PULLUP);
+      buttonInput.interrupt[i] = !buttonPinIsOutput(BUTTON_PINS[i]);
+    }
+    buttonInput.buttons[i].isPressed = buttonReadRaw(i);
+    if (buttonInput.interrupt[i]) {
+      hal::attachPinChange(BUTTON_PINS[i], buttonIsr);
+      hal::wakeOnPinLevel(BUTTON_PINS[i], buttonInput.buttons[i].isPressed ? HIGH : LOW);
+    }
+  }
+  buttonInput.nextAdcSample = now;
+}
+
+// Lee lo que toca, pasa los cambios a eventos y devuelve cuándo hay que
+// volver a mirar
+uint32_t buttonsUpdate(uint32_t now) {
+  PROFILE_SCOPE(PROF_BUTTONS);
+  uint32_t next = now + SCHEDULER_PARKED_MS;
+
+  // Digitales: leer un GPIO es barato, así que se miran todos; así tampoco
+  // se pierde un cambio si una interrupción no llegó
+  for (uint8_t i = 0; i < BUTTON_COUNT; i++) {
+    if (i == BUTTON_ADC) continue;
+    ButtonState &b = buttonInput.buttons[i];
+    if (b.settling) {
+      if (!deadlineReached(b.settleUntil, now)) {
+        next = buttonEarliest(next, b.settleUntil);
+        continue;
+      }
+      b.settling = false;
+    }
+    bool pressed = buttonReadRaw(i);
+    if (pressed != b.isPressed) {
+      buttonChange(i, pressed, now);
+      next = buttonEarliest(next, b.settleUntil);
+    }
+  }
+
+  // Botón 1 por el ADC, a menor ritmo; el periodo ya filtra los rebotes
+  if (deadlineReached(buttonInput.nextAdcSample, now)) {
+    bool pressed = buttonReadRaw(BUTTON_ADC);
+    if (pressed != buttonInput.buttons[BUTTON_ADC].isPressed) buttonChange(BUTTON_ADC, pressed, now);
+    buttonInput.nextAdcSample = now + BUTTON_ADC_POLL_MS;
+  }
+  next = buttonEarliest(next, buttonInput.nextAdcSample);
+
+  // Pulsaciones largas: en cuanto se cumple el tiempo
+  for (uint8_t i = 0; i < BUTTON_COUNT; i++) {
+    ButtonState &b = buttonInput.buttons[i];
+    if (!b.isPressed || b.longPressTriggered) continue;
+    uint32_t longAt = b.pressStartTime + LONG_PRESS_TIME;
+    if (deadlineReached(longAt, now)) {
+      b.longPressTriggered = true;
+      b.consecutivePresses = 0;
+      buttonPost(i, PRESS_LONG, now);
+    } else {
+      next = buttonEarliest(next, longAt);
+    }
+  }
+  return next;
+}
+
+// ===============================================
+// ACCIONES
+// ===============================================
+
+// Qué hace cada botón. Una doble cuenta como otra corta (la primera
+// pulsación ya llegó como corta), igual que antes de detectarlas
+void buttonAction(const ButtonEvent &e) {
+  bool isLong = (e.type == PRESS_LONG);
+  switch (e.button) {
+    case 0:
+      if (isLong) {
+        // Pulsación larga (1s): resetear a valores por defecto
+        LOG(LOG_DEFAULTS_RESET);
+        voicesResetDefaults();
+        LOG(LOG_DEFAULTS_DONE);
+      } else {
+        changeFrequency();
+      }
+      break;
+    case 1:
+      // Insecto 1: larga = mute/unmute, corta = cambiar tipo
+      if (isLong) voiceToggleMute(0);
+      else voiceNextType(0);
+      break;
+    case 3:
+      // Insecto 2
+      if (voices.count <= 1) break;
+      if (isLong) voiceToggleMute(1);
+      else voiceNextType(1);
+      break;
+    case 5:
+      if (isLong) {
+        // Pulsación larga: resetear nota raíz a Do
+        rootNoteOffset = 0;
+        LOG(LOG_ROOT_RESET, rootNoteOffset);
+        voicesRegenerateSequences();
+      } else {
+        // Pulsación corta: cambiar nota raíz (cada pulsación sube un semitono)
+        changeRootNote();
+      }
+      break;
+    default:
+      // Botones 3 y 5 reservados para futuras funcionalidades
+      break;
+  }
+}
+
+// Tarea de botones: lectura, eventos y acciones; devuelve su próximo vencimiento
+uint32_t handleButtons(uint32_t now) {
+  uint32_t next = buttonsUpdate(now);
+  ButtonEvent e;
+  while (buttonPop(e)) buttonAction(e);
+  return next;
+}
+
+#endif // PIEZOBUGS_BUTTONS_H
@@ -0,0 +1,235 @@
+/*
+ * config.h - Pines y parámetros de PiezoBugs
+ * ESP32 AudioKit v2.2
+ */
+
+#ifndef PIEZOBUGS_CONFIG_H
+#define PIEZOBUGS_CONFIG_H
+
+#include <stdint.h>
+
+// Pines para piezoeléctricos
+#define PIEZO_1_PIN 21  // Insecto 1 (Araña por defecto)
+#define PIEZO_2_PIN 22  // Insecto 2 (Grillo por defecto)
+
+// Piezos disponibles: las voces se reparten entre ellos (voz v -> piezo v % N)
+const uint8_t PIEZO_PINS[] = {PIEZO_1_PIN, PIEZO_2_PIN};
+const uint8_t PIEZO_PIN_COUNT = sizeof(PIEZO_PINS) / sizeof(PIEZO_PINS[0]);
+
+// Número de voces de insecto (máximo 16, ver voices.h)
+#ifndef VOICE_COUNT
+#define VOICE_COUNT 2
+#endif
+
+// Pin para aro LED Neopixel (24 LEDs)
+#define NEOPIXEL_PIN 23  // GPIO23 - Pin de datos para Neopixel
+#define NEOPIXEL_COUNT 8 // Número de LEDs en el aro
+
+// Un aro por pin, cada uno en su canal RMT (hasta 4). Añadir pines aquí
+// para instalaciones con varios aros; la ola se reparte entre ellos
+const uint8_t NEOPIXEL_PINS[] = {NEOPIXEL_PIN};
+const uint8_t NEOPIXEL_RING_COUNT = sizeof(NEOPIXEL_PINS) / sizeof(NEOPIXEL_PINS[0]);
+
+// ============================================
+// CONFIGURACIÓN NEO pixel - Efecto "ola verde"
+// ============================================
+
+// Parámetros de temporización para efecto ola
+const unsigned long LED_DURATION = 3000;      // Tiempo que cada LED permanece encendido (ms)
+const unsigned long LED_INTERVAL = 600;      // Intervalo entre inicio de LEDs consecutivos (ms)
+
+// Parámetros de fade (transiciones suaves)
+const unsigned long FADE_IN_TIME = LED_INTERVAL;   // Tiempo de aparición (fade in) = intervalo
+const unsigned long FADE_OUT_TIME = LED_INTERVAL;  // Tiempo de desaparición (fade out) = intervalo
+
+// Parámetros de apariencia
+const uint8_t NEO_BRIGHTNESS = 30;                // Brillo 0-255
+const uint8_t NEO_COLOR_R = 0;                    // Componente rojo (para verde = 0)
+const uint8_t NEO_COLOR_G = 255;                  // Componente verde (para verde = 255)
+const uint8_t NEO_COLOR_B = 0;                    // Componente azul (para verde = 0)
+
+// Dithering temporal: reparte la parte fraccionaria del brillo entre frames
+// para que el fade no vaya a saltos con un brillo global bajo
+const bool NEO_DITHER = true;
+
+// Color del tinte de datos (capa "tinte"): multiplica la ola con la
+// intensidad de PARAM_LED_TINT. Azul apagado: el árbol en reposo
+const uint8_t NEO_TINT_R = 60;
+const uint8_t NEO_TINT_G = 90;
+const uint8_t NEO_TINT_B = 255;
+
+// Compositor de capas (led_compositor.h): límite de frames por segundo y
+// tiempo máximo por frame; si se agota, las capas opcionales se saltan.
+// El límite admite un frame que llega hasta NEO_FRAME_JITTER_US antes de
+// tiempo: el planificador va en ms y con 50 fps el periodo del límite es
+// el mismo que el de la tarea, así que sin margen se perderían frames
+const uint16_t NEO_MAX_FPS = 50;
+const uint32_t NEO_FRAME_BUDGET_US = 2000;
+const uint32_t NEO_FRAME_JITTER_US = 1000;
+
+// Debug (cambiar a true para ver valores de fade en monitor serial)
+const bool DEBUG_FADE = false;                // Activar debug del fade
+
+// Pines de botones del ESP32 AudioKit v2.2 (según documentación oficial)
+#define BUTTON_1_PIN 36  // Botón 1 (GPIO36 - KEY1) - FUNCIONA
+#define BUTTON_2_PIN 13  // Botón 2 (GPIO13 - KEY2) - Comparte con SD DATA3
+#define BUTTON_3_PIN 4    // Botón 3 (GPIO4 - DATA1 SDCard)
+#define BUTTON_4_PIN 23  // Botón 4 (GPIO23 - KEY4) - FUNCIONA
+#define BUTTON_5_PIN 0   // Botón 5 (GPIO0 - BOOT Button)
+#define BUTTON_6_PIN 5   // Botón 6 (GPIO5 - KEY6) - FUNCIONA
+
+// Pines de LEDs del ESP32 AudioKit v2.2 (verificar en documentación)
+// Posibles pines alternativos si los actuales no funcionan
+#define LED_D1_PIN 2     // LED D1 (GPIO2) - Verde - Sistema encendido
+#define LED_D3_PIN 14    // LED D3 (GPIO14) - Verde/Rojo - Actividad de audio
+#define LED_D4_PIN 15    // LED D4 (GPIO15) - Rojo - Estado de error/mute
+
+// LEDs alternativos disponibles (GPIOs libres)
+#define LED_ALT1_PIN 16  // GPIO16 - LED alternativo 1
+#define LED_ALT2_PIN 17  // GPIO17 - LED alternativo 2
+#define LED_ALT3_PIN 18  // GPIO18 - LED alternativo 3
+// LED_ALT4_PIN eliminado para evitar conflictos
+
+const unsigned long LONG_PRESS_TIME = 1000; // 1 segundo para pulsación larga
+
+// ============================================
+// BOTONES (buttons.h)
+// ============================================
+
+// Muestreo del botón 1 (ADC); el resto avisa por interrupción. Múltiplo de
+// NEOPIXEL_FRAME_MS para despertar a la vez que el aro y no en otro momento
+const uint32_t BUTTON_ADC_POLL_MS = 60;
+const uint32_t BUTTON_DEBOUNCE_MS = 50;      // Tras un cambio, los rebotes se ignoran este tiempo
+const uint32_t DOUBLE_PRESS_WINDOW_MS = 400; // Máximo entre dos pulsaciones de una doble
+const int BUTTON_ADC_THRESHOLD = 100;        // Lectura del ADC por debajo = pulsado
+const uint8_t BUTTON_QUEUE_SIZE = 8;         // Eventos pendientes (potencia de 2)
+
+// ============================================
+// SECUENCIAS (sequences.h)
+// ============================================
+
+// Semilla de los flujos de cada voz: 0 = una distinta en cada arranque;
+// otro valor = las mismas secuencias siempre
+#ifndef SEQUENCE_SEED
+#define SEQUENCE_SEED 0
+#endif
+
+const uint8_t SEQUENCE_POOL_SIZE = 4;      // Secuencias preparadas por voz
+const uint8_t SEQUENCE_REFILL_MAX = 2;     // Generadas como mucho por vuelta del loop
+
+// ============================================
+// PLANIFICADOR (scheduler.h)
+// ============================================
+
+const uint32_t NEOPIXEL_FRAME_MS = 20;     // Periodo de refresco del aro (50 fps)
+const uint32_t MAX_SLEEP_MS = 1000;        // Pausa máxima del loop (ms)
+const uint32_t LIGHT_SLEEP_MIN_MS = 5;     // Pausas menores usan delay() normal
+const uint32_t LIGHT_SLEEP_GUARD_MS = 1;   // Despertar antes para compensar la salida del sueño
+const uint32_t BOOT_INFO_LINE_MS = 10;     // Ayuda al arrancar: una línea por paso, sin llenar la UART
+
+// ============================================
+// BUS DE PARÁMETROS (param_bus.h)
+// ============================================
+
+const uint32_t PARAM_CONTROL_MS = 20;         // Ritmo de control: suavizado de parámetros
+const uint32_t PARAM_MAX_STEP_MS = 200;       // Tras una pausa larga no se salta de golpe
+const float PARAM_SETTLE_FRACTION = 1e-4f;    // Fracción del rango a la que se fija el objetivo
+
+// ============================================
+// SINTETIZADOR I2S (synth.h)
+// ============================================
+
+// 1 = las voces suenan por el codec del AudioKit (jack) mezcladas por
+// software; 0 = un tone() por piezo, como siempre
+#ifndef USE_I2S_SYNTH
+#define USE_I2S_SYNTH 0
+#endif
+
+// Pines I2S del AudioKit (igual que tests/wav_player/audio_config.h)
+#define SYNTH_I2S_BCLK 27
+#define SYNTH_I2S_LRC  26
+#define SYNTH_I2S_DOUT 25
+
+const uint32_t SYNTH_SAMPLE_RATE = 22050;
+const uint16_t SYNTH_BLOCK_FRAMES = 128;   // 5,8 ms por bloque = tamaño de un buffer DMA
+const uint8_t SYNTH_DMA_BUFFERS = 4;
+
+// ============================================
+// MUESTRAS (sample_bank.h, samples.h)
+// ============================================
+
+// Banco de muestras en la partición de datos, detrás de la caché del árbol
+// (32 KB). La MMU proyecta la flash por páginas de 64 KB: empezar en una
+// frontera de página no malgasta ninguna
+const uint32_t SAMPLE_BANK_OFFSET = 0x10000;
+
+// 1 = muestras largas desde la SD, cacheadas en la PSRAM. La SD va por SPI
+// como en tests/wav_player (CS GPIO5, SCK 18, MISO 19, MOSI 23): el botón 6
+// y el aro Neopixel tienen que ir en otros pines
+#ifndef USE_SD_SAMPLES
+#define USE_SD_SAMPLES 0
+#endif
+
+#define SD_CS_PIN   5
+#define SD_SCK_PIN  18
+#define SD_MISO_PIN 19
+#define SD_MOSI_PIN 23
+
+// Caché LRU en la PSRAM: huecos fijos de hasta 5 s (215 KB), 1,7 MB en total
+const uint8_t SAMPLE_CACHE_SLOTS = 8;
+const uint32_t SAMPLE_CACHE_SLOT_FRAMES = 5 * SYNTH_SAMPLE_RATE;
+const uint32_t SAMPLE_LOAD_CHUNK = 4096;      // Bytes leídos de la SD por paso de la tarea (~3 ms)
+const uint32_t SAMPLE_LATE_MS = 250;          // Un disparo que espera a la SD más que esto ya no suena
+const uint32_t SAMPLE_REPORT_MS = 60000;      // Informe de aciertos de la caché
+
+// Remuestreo (resampler.h) de las muestras que no están a SYNTH_SAMPLE_RATE:
+// una tabla por frecuencia del banco, calculadas en samplesBegin(). 12 KB
+// de coeficientes dan, p. ej., para 8, 16 y 44,1 kHz
+const uint8_t RESAMPLER_MAX_RATIO = 3;        // Bajada máxima: 66,15 kHz a 22,05 kHz
+const uint8_t SAMPLE_RATE_TABLES = 4;
+const uint32_t SAMPLE_RATE_COEFFS = 6144;
+
+// ============================================
+// REGISTRO (log.h)
+// ============================================
+
+// Niveles: los mensajes por encima de LOG_LEVEL no se compilan
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+// 1 = el ESP32 formatea los mensajes al vaciar el anillo (texto legible en
+// cualquier monitor); 0 = registros binarios para tools/log_decode.py
+#ifndef LOG_DRAIN_TEXT
+#define LOG_DRAIN_TEXT 0
+#endif
+
+const uint8_t LOG_DRAIN_MAX = 8;           // Registros por vuelta del loop como mucho
+
+const uint32_t HEAP_REPORT_MS = 60000;     // Informe de memoria (heap_monitor.h)
+
+// ============================================
+// PERFILADOR (profile.h)
+// ============================================
+
+// 1 = histogramas de ciclos por subsistema y volcado por la consola serie
+// ('p'); 0 = las macros PROFILE_SCOPE no generan código
+#ifndef ENABLE_PROFILER
+#define ENABLE_PROFILER 0
+#endif
+
+const uint32_t PROFILE_POLL_MS = 100;      // Lectura de órdenes por la consola serie
+
+// Sueño ligero entre vencimientos. Desactivar si se usa el USB-CDC nativo
+// (el ESP32-S3 pierde la conexión USB al dormir)
+#ifndef ENABLE_LIGHT_SLEEP
+#define ENABLE_LIGHT_SLEEP 1
+#endif
+
+#endif // PIEZOBUGS_CONFIG_H
@@ -0,0 +1,46 @@
+/*
+ * hal.h - Capa de abstracción de hardware (HAL) para PiezoBugs
+ *
+ * Centraliza todo el acceso al hardware que usa el motor de insectos:
+ * - Reloj (millis, delay), contador de ciclos y sueño ligero
+ * - Salida de piezoeléctricos (tone, noTone, piezosIdle)
+ * - Salida de audio I2S (audioBegin, audioWrite) y tareas en segundo plano
+ * - Entradas GPIO/ADC (digitalRead, analogRead), interrupciones de cambio
+ *   de nivel con espera interrumpible, y salidas GPIO
+ * - Salida de píxeles (aro Neopixel)
+ * - Estado del WiFi y conexión TLS persistente con reanudación de sesión (forestData)
+ * - Partición de datos en flash (caché de TreeData), también proyectada
+ *   en memoria para leerla sin copiar (banco de muestras)
+ * - PSRAM externa y archivos de la tarjeta SD (muestras largas)
+ * - Estadísticas del heap (libre, bloque mayor, mínimo)
+ * - Números aleatorios
+ *
+ * En el ESP32 son envoltorios inline sobre el core de Arduino.
+ * En el build nativo (PIEZOBUGS_NATIVE) se usa un reloj virtual y
+ * salidas simuladas, ver hal_native.h.
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+
+#if defined(PIEZOBUGS_NATIVE)
+#include "hal_native.h"
+#else
+#include "hal_esp32.h"
+#endif
+
+// ===============================================
+// VENCIMIENTOS (seguros ante el desbordamiento de millis)
+// ===============================================
+
+inline bool deadlineReached(uint32_t deadline, uint32_t now) {
+  return (int32_t)(now - deadline) >= 0;
+}
+
+inline bool deadlineBefore(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) < 0;
+}
+
+#endif // HAL_H
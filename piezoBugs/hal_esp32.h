@@ -0,0 +1,825 @@
+/*
+ * hal_esp32.h - Implementación de la HAL sobre el core Arduino-ESP32
+ *
+ * Solo envoltorios inline: el coste en el dispositivo es el mismo que
+ * llamar directamente a las funciones de Arduino.
+ */
+
+#ifndef HAL_ESP32_H
+#define HAL_ESP32_H
+
+#include <Arduino.h>
+#include <esp_arduino_version.h>
+#include <esp_timer.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <driver/i2s.h>
+#include <driver/rmt.h>
+#include <WiFi.h>
+#include <esp_partition.h>
+#include <esp_heap_caps.h>
+#include <SD.h>
+#include <SPI.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/version.h>
+#include <mbedtls/x509_crt.h>
+
+namespace hal {
+
+// ===============================================
+// RELOJ
+// ===============================================
+
+inline uint32_t millis() { return ::millis(); }
+inline uint32_t micros() { return ::micros(); }
+inline void delay(uint32_t ms) { ::delay(ms); }
+
+// Contador de ciclos de la CPU (CCOUNT); da la vuelta en ~18 s a 240 MHz
+inline uint32_t cycleCount() { return ESP.getCycleCount(); }
+inline uint32_t cyclesPerMicro() { return ESP.getCpuFreqMHz(); }
+
+// Nivel que despierta a cada pin del sueño ligero: 0 = ninguno, 1 = bajo,
+// 2 = alto (lo apunta wakeOnPinLevel())
+inline uint8_t *wakeLevels() {
+  static uint8_t levels[GPIO_NUM_MAX];
+  return levels;
+}
+
+// Sueño ligero: la CPU se detiene y el reloj sigue contando (esp_timer
+// compensa el tiempo dormido). El LEDC se para durante el sueño, así que
+// solo se debe llamar con los piezos en silencio (ver piezosIdle()).
+// Devuelve true si despertó por una entrada y no por el temporizador.
+//
+// gpio_wakeup_enable() cambia la interrupción del pin a una por nivel, que
+// con el botón pulsado saltaría sin parar: el despertar por GPIO se arma
+// solo aquí y al volver se deja otra vez la de cada flanco (CHANGE)
+inline bool lightSleep(uint32_t ms) {
+  Serial.flush();  // Lo que quede en la UART se perdería al dormir
+  const uint8_t *levels = wakeLevels();
+  bool gpioWake = false;
+  for (uint8_t pin = 0; pin < GPIO_NUM_MAX; pin++) {
+    if (!levels[pin]) continue;
+    gpio_wakeup_enable((gpio_num_t)pin, levels[pin] == 2 ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL);
+    gpioWake = true;
+  }
+  if (gpioWake) esp_sleep_enable_gpio_wakeup();
+  esp_sleep_enable_timer_wakeup((uint64_t)ms * 1000);
+  esp_light_sleep_start();
+
+  for (uint8_t pin = 0; pin < GPIO_NUM_MAX; pin++) {
+    if (!levels[pin]) continue;
+    gpio_wakeup_disable((gpio_num_t)pin);
+    gpio_set_intr_type((gpio_num_t)pin, GPIO_INTR_ANYEDGE);
+  }
+  if (gpioWake) esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_GPIO);
+  return esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER;
+}
+
+// Tarea que espera en idleWait(); la despierta wakeFromIsr()
+inline TaskHandle_t &idleWaiter() {
+  static TaskHandle_t waiter = nullptr;
+  return waiter;
+}
+
+// Como delay(), pero una interrupción la corta con wakeFromIsr().
+// Devuelve true si terminó antes de tiempo.
+inline bool idleWait(uint32_t ms) {
+  idleWaiter() = xTaskGetCurrentTaskHandle();
+  return ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ms)) > 0;
+}
+
+inline void IRAM_ATTR wakeFromIsr() {
+  TaskHandle_t waiter = idleWaiter();
+  if (!waiter) return;
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(waiter, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+// ===============================================
+// PIEZOELÉCTRICOS
+// ===============================================
+
+// Cada piezo tiene su propio canal LEDC para que varias voces suenen a la
+// vez (tone() de Arduino solo atiende un pin). La duración la corta un
+// esp_timer de un solo disparo, sin bloquear el loop.
+//
+// El proyecto usa el core 2.x de Arduino (platformio.ini), con los drivers
+// antiguos de RMT e I2S: ahí el LEDC va por canales (ledcSetup y
+// ledcAttachPin). El core 3.x los asigna por pin; se admite también para
+// el LEDC, pero RMT e I2S seguirían necesitando el core 2.x.
+const uint8_t MAX_PIEZO_CHANNELS = 8;
+const uint8_t PIEZO_LEDC_RESOLUTION = 10;
+
+struct PiezoChannel {
+  uint8_t pin;
+  uint8_t ledc;            // Lo que piden las funciones ledc*: el canal (core 2.x) o el pin (3.x)
+  bool sustained;          // Nota sin duración: suena hasta noTone()
+  uint32_t busyUntil;      // millis() en que termina la nota actual
+  esp_timer_handle_t stopTimer;
+};
+
+// Canales creados hasta ahora (compartido con piezosIdle())
+inline PiezoChannel *piezoChannels() {
+  static PiezoChannel channels[MAX_PIEZO_CHANNELS];
+  return channels;
+}
+
+inline uint8_t &piezoChannelCount() {
+  static uint8_t channelCount = 0;
+  return channelCount;
+}
+
+inline void piezoStopCallback(void *arg) {
+  ledcWriteTone((uint8_t)(uintptr_t)arg, 0);
+}
+
+// Canal asociado al pin; lo crea la primera vez. nullptr si no quedan canales
+inline PiezoChannel *piezoChannel(uint8_t pin) {
+  PiezoChannel *channels = piezoChannels();
+  uint8_t &channelCount = piezoChannelCount();
+
+  for (uint8_t i = 0; i < channelCount; i++) {
+    if (channels[i].pin == pin) return &channels[i];
+  }
+  if (channelCount >= MAX_PIEZO_CHANNELS) return nullptr;
+
+  PiezoChannel &ch = channels[channelCount];
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  if (!ledcAttach(pin, 1000, PIEZO_LEDC_RESOLUTION)) return nullptr;
+  ch.ledc = pin;
+#else
+  if (ledcSetup(channelCount, 1000, PIEZO_LEDC_RESOLUTION) == 0) return nullptr;
+  ledcAttachPin(pin, channelCount);
+  ch.ledc = channelCount;
+#endif
+  esp_timer_create_args_t args = {};
+  args.callback = piezoStopCallback;
+  args.arg = (void *)(uintptr_t)ch.ledc;
+  args.name = "piezo";
+  if (esp_timer_create(&args, &ch.stopTimer) != ESP_OK) return nullptr;
+  ch.pin = pin;
+  ch.sustained = false;
+  ch.busyUntil = ::millis();
+  ledcWriteTone(ch.ledc, 0);
+  channelCount++;
+  return &ch;
+}
+
+inline void tone(uint8_t pin, uint32_t frequency, uint32_t duration) {
+  PiezoChannel *ch = piezoChannel(pin);
+  if (!ch) {
+    ::tone(pin, frequency, duration);
+    return;
+  }
+  esp_timer_stop(ch->stopTimer);
+  ledcWriteTone(ch->ledc, frequency);
+  ch->sustained = (duration == 0);
+  ch->busyUntil = ::millis() + duration;
+  if (duration > 0) {
+    esp_timer_start_once(ch->stopTimer, (uint64_t)duration * 1000);
+  }
+}
+
+inline void noTone(uint8_t pin) {
+  PiezoChannel *ch = piezoChannel(pin);
+  if (!ch) {
+    ::noTone(pin);
+    return;
+  }
+  esp_timer_stop(ch->stopTimer);
+  ledcWriteTone(ch->ledc, 0);
+  ch->sustained = false;
+  ch->busyUntil = ::millis();
+}
+
+// true si ningún piezo está sonando (se puede entrar en sueño ligero)
+inline bool piezosIdle() {
+  PiezoChannel *channels = piezoChannels();
+  uint32_t now = ::millis();
+  for (uint8_t i = 0; i < piezoChannelCount(); i++) {
+    if (channels[i].sustained) return false;
+    if ((int32_t)(now - channels[i].busyUntil) < 0) return false;
+  }
+  return true;
+}
+
+// ===============================================
+// AUDIO I2S
+// ===============================================
+
+// Salida estéreo de 16 bits por el I2S0 hacia el codec del AudioKit
+inline bool audioBegin(uint32_t sampleRate, uint16_t blockFrames, uint8_t bufferCount,
+                       uint8_t bclkPin, uint8_t lrcPin, uint8_t doutPin) {
+  i2s_config_t config = {};
+  config.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX);
+  config.sample_rate = sampleRate;
+  config.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT;
+  config.channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT;
+  config.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+  config.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
+  config.dma_buf_count = bufferCount;
+  config.dma_buf_len = blockFrames;
+  config.use_apll = false;
+  config.tx_desc_auto_clear = true;  // Silencio si la tarea de audio se retrasa
+
+  i2s_pin_config_t pins = {};
+  pins.bck_io_num = bclkPin;
+  pins.ws_io_num = lrcPin;
+  pins.data_out_num = doutPin;
+  pins.data_in_num = I2S_PIN_NO_CHANGE;
+
+  if (i2s_driver_install(I2S_NUM_0, &config, 0, NULL) != ESP_OK) return false;
+  return i2s_set_pin(I2S_NUM_0, &pins) == ESP_OK;
+}
+
+// Escribe frames muestras estéreo intercaladas; bloquea hasta que hay DMA libre
+inline void audioWrite(const int16_t *frames, uint16_t frameCount) {
+  size_t written = 0;
+  i2s_write(I2S_NUM_0, frames, (size_t)frameCount * 2 * sizeof(int16_t), &written, portMAX_DELAY);
+}
+
+// ===============================================
+// TAREAS
+// ===============================================
+
+// Tarea de FreeRTOS fijada a un núcleo
+inline bool startTask(const char *name, void (*function)(void *), uint32_t stackBytes,
+                      uint8_t priority, uint8_t core) {
+  return xTaskCreatePinnedToCore(function, name, stackBytes, nullptr, priority, nullptr, core) == pdPASS;
+}
+
+// ===============================================
+// WIFI
+// ===============================================
+
+inline bool wifiConnected() { return WiFi.status() == WL_CONNECTED; }
+
+// Solo arranca el intento con las credenciales guardadas: no espera
+inline void wifiReconnect() { WiFi.reconnect(); }
+
+// ===============================================
+// MEMORIA DINÁMICA
+// ===============================================
+
+// Heap interno de 8 bits (el que usan malloc y new)
+inline uint32_t heapFree() { return heap_caps_get_free_size(MALLOC_CAP_8BIT); }
+inline uint32_t heapLargestFreeBlock() { return heap_caps_get_largest_free_block(MALLOC_CAP_8BIT); }
+// Mínimo de memoria libre desde el arranque (lo lleva el propio IDF)
+inline uint32_t heapMinFree() { return heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT); }
+
+// ===============================================
+// FLASH DE DATOS
+// ===============================================
+
+// Partición de datos cruda: la "spiffs" de huge_app.csv, que no monta
+// ningún sistema de archivos. Las direcciones son relativas a ella
+const uint32_t FLASH_SECTOR_SIZE = 4096;
+const char *const FLASH_DATA_PARTITION = "spiffs";
+
+inline const esp_partition_t *&flashPartition() {
+  static const esp_partition_t *partition = nullptr;
+  return partition;
+}
+
+inline bool flashBegin() {
+  if (!flashPartition()) {
+    flashPartition() = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                FLASH_DATA_PARTITION);
+  }
+  return flashPartition() != nullptr;
+}
+
+inline uint32_t flashSize() { return flashPartition() ? flashPartition()->size : 0; }
+
+inline bool flashRead(uint32_t address, void *data, uint32_t length) {
+  return flashPartition() && esp_partition_read(flashPartition(), address, data, length) == ESP_OK;
+}
+
+// Como toda flash NOR, escribir solo pasa bits de 1 a 0
+inline bool flashWrite(uint32_t address, const void *data, uint32_t length) {
+  return flashPartition() && esp_partition_write(flashPartition(), address, data, length) == ESP_OK;
+}
+
+// Borra (todo a 0xFF) el sector que empieza en address. Detiene la caché
+// de ambos núcleos unos 40 ms: llamar solo desde la tarea de red
+inline bool flashErase(uint32_t address) {
+  return flashPartition() && esp_partition_erase_range(flashPartition(), address, FLASH_SECTOR_SIZE) == ESP_OK;
+}
+
+// Proyecta length bytes desde address en el espacio de datos de la CPU: se
+// leen como memoria, a través de la caché de la flash, sin copiarlos. La
+// proyección no se deshace (el banco de muestras vive todo el programa).
+// nullptr si no hay partición o no quedan páginas de la MMU
+inline const uint8_t *flashMap(uint32_t address, uint32_t length) {
+  if (!flashPartition()) return nullptr;
+  const void *data = nullptr;
+  spi_flash_mmap_handle_t handle;
+  if (esp_partition_mmap(flashPartition(), address, length, ESP_PARTITION_MMAP_DATA, &data, &handle) != ESP_OK) {
+    return nullptr;
+  }
+  return (const uint8_t *)data;
+}
+
+// ===============================================
+// PSRAM
+// ===============================================
+
+// Reserva en la PSRAM externa, solo desde setup(): no se libera. nullptr
+// si la placa no tiene PSRAM o no queda sitio
+inline void *psramAlloc(uint32_t bytes) {
+  return heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+}
+
+inline uint32_t psramFree() { return heap_caps_get_free_size(MALLOC_CAP_SPIRAM); }
+
+// ===============================================
+// TARJETA SD
+// ===============================================
+
+// La SD por SPI, montada en SD_MOUNT por el VFS del IDF. Los archivos se
+// abren con open()/read() de POSIX: la tabla de archivos de FatFs se
+// reserva al montar, así que abrir y leer no reservan memoria (File de
+// Arduino sí, con cada open)
+const char *const SD_MOUNT = "/sd";
+const uint8_t SD_MAX_FILES = 4;
+const uint8_t SD_PATH_MAX = 64;
+
+inline bool sdBegin(uint8_t csPin, uint8_t sckPin, uint8_t misoPin, uint8_t mosiPin) {
+  SPI.begin(sckPin, misoPin, mosiPin, csPin);
+  return SD.begin(csPin, SPI, 20000000, SD_MOUNT, SD_MAX_FILES);
+}
+
+// Archivo de la SD de solo lectura; path es relativo a la raíz de la tarjeta
+class SdFile {
+private:
+  int fd;
+  uint32_t length;
+
+public:
+  SdFile() : fd(-1), length(0) {}
+
+  bool open(const char *path) {
+    close();
+    char full[SD_PATH_MAX + 8];
+    size_t mountLength = strlen(SD_MOUNT);
+    size_t pathLength = strlen(path);
+    if (pathLength >= SD_PATH_MAX) return false;
+    memcpy(full, SD_MOUNT, mountLength);
+    memcpy(full + mountLength, path, pathLength + 1);
+    fd = ::open(full, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    length = fstat(fd, &st) == 0 ? (uint32_t)st.st_size : 0;
+    return true;
+  }
+
+  void close() {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    length = 0;
+  }
+
+  bool isOpen() const { return fd >= 0; }
+  uint32_t size() const { return length; }
+  bool seek(uint32_t position) { return fd >= 0 && lseek(fd, position, SEEK_SET) == (off_t)position; }
+
+  // Bytes leídos (0 al final del archivo), -1 si falla
+  int32_t read(void *data, uint32_t bytes) {
+    if (fd < 0) return -1;
+    return (int32_t)::read(fd, data, bytes);
+  }
+};
+
+// ===============================================
+// GPIO / ADC
+// ===============================================
+
+inline void pinMode(uint8_t pin, uint8_t mode) { ::pinMode(pin, mode); }
+inline void digitalWrite(uint8_t pin, uint8_t value) { ::digitalWrite(pin, value); }
+inline int digitalRead(uint8_t pin) { return ::digitalRead(pin); }
+inline int analogRead(uint8_t pin) { return ::analogRead(pin); }
+
+// Interrupción en cada cambio de nivel; handler debe ir en IRAM (IRAM_ATTR)
+inline void attachPinChange(uint8_t pin, void (*handler)()) {
+  ::attachInterrupt(digitalPinToInterrupt(pin), handler, CHANGE);
+}
+
+// El pin a level despierta del sueño ligero. Se pide el nivel contrario
+// al actual: con el de siempre despertaría sin parar mientras dure. Solo
+// se apunta; lightSleep() lo arma al dormir. Es para pines con
+// attachPinChange(): al despertar recuperan la interrupción por flanco
+inline void wakeOnPinLevel(uint8_t pin, uint8_t level) {
+  if (pin < GPIO_NUM_MAX) wakeLevels()[pin] = level ? 2 : 1;
+}
+
+// ===============================================
+// ALEATORIOS
+// ===============================================
+
+// Entero en [minValue, maxValue), igual que random() de Arduino
+inline long random(long minValue, long maxValue) { return ::random(minValue, maxValue); }
+
+// ===============================================
+// SALIDA DE PÍXELES
+// ===============================================
+
+// Los WS2812 se transmiten por el periférico RMT con DMA: show() copia el
+// buffer trasero (donde se dibuja) al delantero, arranca la transmisión y
+// vuelve enseguida; el buffer delantero no se toca hasta que la
+// interrupción de fin de transmisión lo libera. Cada aro usa su propio
+// canal RMT, así que varios aros transmiten en paralelo. Un show() con la
+// transmisión anterior en curso se descarta y devuelve false.
+const uint8_t PIXEL_CHANNELS = 4;          // Canales TX del RMT del ESP32-S3
+const uint16_t PIXEL_MAX_COUNT = 256;
+
+// Reloj del RMT a 40 MHz (APB / 2): 25 ns por tick
+const uint16_t WS2812_T0H = 16;   // 0,40 us
+const uint16_t WS2812_T0L = 34;   // 0,85 us
+const uint16_t WS2812_T1H = 32;   // 0,80 us
+const uint16_t WS2812_T1L = 18;   // 0,45 us
+
+// Transmisiones terminadas por canal, escritas desde la interrupción
+inline volatile uint32_t *pixelCompleted() {
+  static volatile uint32_t completed[PIXEL_CHANNELS];
+  return completed;
+}
+
+// Transmisiones arrancadas por canal (las cuenta show())
+inline uint32_t *pixelStarted() {
+  static uint32_t started[PIXEL_CHANNELS];
+  return started;
+}
+
+// LEDs de la última transmisión de cada canal: fija cuánto puede durar
+inline uint16_t *pixelLength() {
+  static uint16_t length[PIXEL_CHANNELS];
+  return length;
+}
+
+static void IRAM_ATTR pixelTxDone(rmt_channel_t channel, void *arg) {
+  if (channel < PIXEL_CHANNELS) pixelCompleted()[channel]++;
+}
+
+// Algún aro con una transmisión en curso: el RMT no debe dormirse a medias
+inline bool pixelsBusy() {
+  for (uint8_t c = 0; c < PIXEL_CHANNELS; c++) {
+    if (pixelStarted()[c] != pixelCompleted()[c]) return true;
+  }
+  return false;
+}
+
+// Espera a que terminen las transmisiones en curso, cada una como mucho lo
+// que dura el protocolo (30 us por LED + 50 us de reset) más un tick. false
+// si alguna no acaba a tiempo
+inline bool pixelsWaitDone() {
+  for (uint8_t c = 0; c < PIXEL_CHANNELS; c++) {
+    if (pixelStarted()[c] == pixelCompleted()[c]) continue;
+    uint32_t us = (uint32_t)pixelLength()[c] * 30 + 50;
+    TickType_t timeout = pdMS_TO_TICKS((us + 999) / 1000) + 1;
+    if (rmt_wait_tx_done((rmt_channel_t)c, timeout) != ESP_OK) return false;
+  }
+  return true;
+}
+
+// Traduce bytes GRB a pulsos del RMT; se llama desde la interrupción
+// cada vez que la memoria del canal necesita más datos
+static void IRAM_ATTR ws2812Translate(const void *src, rmt_item32_t *dest, size_t srcSize,
+                                      size_t wantedItems, size_t *translatedSize, size_t *itemCount) {
+  const rmt_item32_t bit0 = {{{WS2812_T0H, 1, WS2812_T0L, 0}}};
+  const rmt_item32_t bit1 = {{{WS2812_T1H, 1, WS2812_T1L, 0}}};
+  const uint8_t *bytes = (const uint8_t *)src;
+  size_t size = 0;
+  size_t items = 0;
+  while (size < srcSize && items + 8 <= wantedItems) {
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      dest[items++] = (bytes[size] & (0x80 >> bit)) ? bit1 : bit0;
+    }
+    size++;
+  }
+  *translatedSize = size;
+  *itemCount = items;
+}
+
+class PixelStrip {
+private:
+  uint16_t count;
+  uint8_t pin;
+  uint8_t channel;
+  uint8_t brightness;
+  uint8_t back[PIXEL_MAX_COUNT * 3];    // GRB
+  uint8_t front[PIXEL_MAX_COUNT * 3];   // GRB con el brillo aplicado
+  uint32_t shows;
+  uint32_t dropped;
+
+public:
+  PixelStrip() : PixelStrip(0, 0) {}
+  PixelStrip(uint16_t count, uint8_t pin, uint8_t channel = 0)
+    : count(count > PIXEL_MAX_COUNT ? PIXEL_MAX_COUNT : count), pin(pin), channel(channel),
+      brightness(255), shows(0), dropped(0) {
+    clear();
+  }
+
+  void begin() {
+    static bool callbackInstalled = false;
+    rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)pin, (rmt_channel_t)channel);
+    config.clk_div = 2;
+    rmt_config(&config);
+    rmt_driver_install((rmt_channel_t)channel, 0, 0);
+    rmt_translator_init((rmt_channel_t)channel, ws2812Translate);
+    if (!callbackInstalled) {
+      rmt_register_tx_end_callback(pixelTxDone, nullptr);
+      callbackInstalled = true;
+    }
+  }
+  void begin(uint16_t pixelCount, uint8_t pixelPin, uint8_t rmtChannel) {
+    count = pixelCount > PIXEL_MAX_COUNT ? PIXEL_MAX_COUNT : pixelCount;
+    pin = pixelPin;
+    channel = rmtChannel;
+    begin();
+  }
+  void setBrightness(uint8_t value) { brightness = value; }
+  void setPixelColor(uint16_t index, uint32_t color) {
+    if (index >= count) return;
+    back[index * 3] = (uint8_t)(color >> 8);
+    back[index * 3 + 1] = (uint8_t)(color >> 16);
+    back[index * 3 + 2] = (uint8_t)color;
+  }
+  uint32_t getPixelColor(uint16_t index) const {
+    if (index >= count) return 0;
+    return Color(back[index * 3 + 1], back[index * 3], back[index * 3 + 2]);
+  }
+  void clear() { memset(back, 0, sizeof(back)); }
+  uint16_t numPixels() const { return count; }
+
+  bool busy() const { return shows != pixelCompleted()[channel]; }
+
+  // No bloquea: el RMT lee el buffer delantero en segundo plano
+  bool show() {
+    if (busy()) {
+      dropped++;
+      return false;
+    }
+    for (uint16_t i = 0; i < count * 3; i++) {
+      front[i] = brightness == 255 ? back[i] : (uint8_t)((back[i] * (brightness + 1)) >> 8);
+    }
+    shows++;
+    pixelStarted()[channel]++;
+    pixelLength()[channel] = count;
+    if (rmt_write_sample((rmt_channel_t)channel, front, count * 3, false) != ESP_OK) {
+      shows--;
+      pixelStarted()[channel]--;
+      dropped++;
+      return false;
+    }
+    return true;
+  }
+
+  uint32_t showCount() const { return shows; }
+  uint32_t completedCount() const { return pixelCompleted()[channel]; }
+  uint32_t droppedCount() const { return dropped; }
+
+  static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {
+    return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+  }
+};
+
+// ===============================================
+// CONEXIÓN TLS
+// ===============================================
+
+// TLS de mbedtls sobre un WiFiClient, para conexiones persistentes:
+// - stop() cierra el socket pero guarda la sesión; el siguiente connect()
+//   la reanuda (ticket o id de sesión) y se ahorra el intercambio de
+//   claves y la verificación de la cadena, que es lo caro en el ESP32
+// - La cadena se verifica contra caPem y, si hay pines, algún
+//   certificado de la cadena debe tener una clave pública (SPKI) cuyo
+//   SHA-256 esté en la lista
+// El objeto no se debe copiar ni mover tras begin().
+const uint8_t TLS_PIN_SIZE = 32;
+
+class TlsLink {
+private:
+  WiFiClient tcp;
+  mbedtls_ssl_context ssl;
+  mbedtls_ssl_config conf;
+  mbedtls_ctr_drbg_context drbg;
+  mbedtls_entropy_context entropy;
+  mbedtls_x509_crt ca;
+  mbedtls_ssl_session session;
+  const char *host;
+  uint16_t port;
+  const uint8_t (*pins)[TLS_PIN_SIZE];
+  uint8_t pinCount;
+  bool hasCa;
+  bool configured;
+  bool open;
+  bool hasSession;
+  bool lastResumed;
+  bool pinMatched;
+  uint8_t certsSeen;          // Certificados verificados en el handshake
+  uint32_t timeoutMs;
+  uint32_t handshakes;
+  uint32_t resumedHandshakes;
+  uint32_t verifyFailures;
+  uint32_t lastHandshakeUs;
+
+  static int bioSend(void *ctx, const unsigned char *buf, size_t len) {
+    WiFiClient *tcp = (WiFiClient *)ctx;
+    if (!tcp->connected()) return MBEDTLS_ERR_SSL_CONN_EOF;
+    size_t n = tcp->write(buf, len);
+    return n ? (int)n : MBEDTLS_ERR_SSL_WANT_WRITE;
+  }
+
+  // Sin bloquear: WANT_READ si aún no hay datos, 0 si el servidor cerró
+  static int bioRecv(void *ctx, unsigned char *buf, size_t len) {
+    WiFiClient *tcp = (WiFiClient *)ctx;
+    int available = tcp->available();
+    if (available <= 0) return tcp->connected() ? MBEDTLS_ERR_SSL_WANT_READ : 0;
+    int n = tcp->read(buf, len < (size_t)available ? len : (size_t)available);
+    return n > 0 ? n : MBEDTLS_ERR_SSL_WANT_READ;
+  }
+
+  // Se llama por cada certificado de la cadena, de la raíz a la hoja
+  // (depth 0). Un handshake reanudado no envía certificados.
+  static int verifyCertificate(void *ctx, mbedtls_x509_crt *crt, int depth, uint32_t *flags) {
+    TlsLink *link = (TlsLink *)ctx;
+    link->certsSeen++;
+    if (!link->pinCount) return 0;
+    uint8_t hash[TLS_PIN_SIZE];
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+    mbedtls_sha256(crt->pk_raw.p, crt->pk_raw.len, hash, 0);
+#else
+    mbedtls_sha256_ret(crt->pk_raw.p, crt->pk_raw.len, hash, 0);
+#endif
+    for (uint8_t i = 0; i < link->pinCount; i++) {
+      if (memcmp(hash, link->pins[i], TLS_PIN_SIZE) == 0) link->pinMatched = true;
+    }
+    // Sin CA, el pin es la única raíz de confianza
+    if (!link->hasCa) *flags &= ~MBEDTLS_X509_BADCERT_NOT_TRUSTED;
+    if (depth == 0 && !link->pinMatched) *flags |= MBEDTLS_X509_BADCERT_NOT_TRUSTED;
+    return 0;
+  }
+
+  void closeSocket() {
+    if (open) mbedtls_ssl_free(&ssl);
+    open = false;
+    tcp.stop();
+  }
+
+public:
+  TlsLink()
+    : host(nullptr), port(0), pins(nullptr), pinCount(0), hasCa(false), configured(false), open(false),
+      hasSession(false), lastResumed(false), pinMatched(false), certsSeen(0), timeoutMs(10000),
+      handshakes(0), resumedHandshakes(0), verifyFailures(0), lastHandshakeUs(0) {}
+
+  // caPem y pins deben seguir existiendo mientras se use la conexión
+  bool begin(const char *serverHost, uint16_t serverPort, const char *caPem,
+             const uint8_t (*pinList)[TLS_PIN_SIZE], uint8_t pinListCount) {
+    host = serverHost;
+    port = serverPort;
+    pins = pinList;
+    pinCount = pinListCount;
+    mbedtls_ssl_config_init(&conf);
+    mbedtls_ctr_drbg_init(&drbg);
+    mbedtls_entropy_init(&entropy);
+    mbedtls_x509_crt_init(&ca);
+    mbedtls_ssl_session_init(&session);
+    if (mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy, nullptr, 0) != 0) return false;
+    if (mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                    MBEDTLS_SSL_PRESET_DEFAULT) != 0) return false;
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+    // En TLS 1.3 el ticket llega después del handshake; con 1.2 la sesión
+    // se puede guardar en cuanto termina
+    mbedtls_ssl_conf_max_tls_version(&conf, MBEDTLS_SSL_VERSION_TLS1_2);
+#endif
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+    mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &drbg);
+    hasCa = caPem && mbedtls_x509_crt_parse(&ca, (const unsigned char *)caPem, strlen(caPem) + 1) == 0;
+    if (hasCa) mbedtls_ssl_conf_ca_chain(&conf, &ca, nullptr);
+    if (!hasCa && !pinCount) return false;   // Nada con qué verificar al servidor
+    mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_verify(&conf, verifyCertificate, this);
+    configured = true;
+    return true;
+  }
+
+  void setTimeout(uint32_t ms) { timeoutMs = ms; }
+
+  // TCP + handshake; reanuda la sesión guardada si la hay
+  bool connect() {
+    closeSocket();
+    if (!configured) return false;
+    uint32_t start = ::micros();
+    if (!tcp.connect(host, port, timeoutMs)) return false;
+    tcp.setNoDelay(true);
+    mbedtls_ssl_init(&ssl);
+    open = true;
+    if (mbedtls_ssl_setup(&ssl, &conf) != 0 || mbedtls_ssl_set_hostname(&ssl, host) != 0) {
+      closeSocket();
+      return false;
+    }
+    mbedtls_ssl_set_bio(&ssl, &tcp, bioSend, bioRecv, nullptr);
+    if (hasSession) mbedtls_ssl_set_session(&ssl, &session);
+    certsSeen = 0;
+    pinMatched = false;
+
+    uint32_t startMs = ::millis();
+    int ret;
+    while ((ret = mbedtls_ssl_handshake(&ssl)) != 0) {
+      bool pending = ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE;
+      if (!pending || ::millis() - startMs > timeoutMs) {
+        if (ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED) {
+          verifyFailures++;
+          forgetSession();
+        }
+        closeSocket();
+        return false;
+      }
+      ::delay(1);
+    }
+
+    lastResumed = certsSeen == 0;
+    handshakes++;
+    if (lastResumed) resumedHandshakes++;
+    mbedtls_ssl_session_free(&session);
+    mbedtls_ssl_session_init(&session);
+    hasSession = mbedtls_ssl_get_session(&ssl, &session) == 0;
+    lastHandshakeUs = ::micros() - start;
+    return true;
+  }
+
+  bool connected() {
+    return open && (tcp.connected() || mbedtls_ssl_get_bytes_avail(&ssl) > 0);
+  }
+
+  int write(const uint8_t *data, size_t len) {
+    size_t sent = 0;
+    uint32_t startMs = ::millis();
+    while (open && sent < len) {
+      int ret = mbedtls_ssl_write(&ssl, data + sent, len - sent);
+      if (ret > 0) {
+        sent += ret;
+      } else if ((ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) ||
+                 ::millis() - startMs > timeoutMs) {
+        closeSocket();
+        return -1;
+      }
+    }
+    return (int)sent;
+  }
+
+  // Bytes descifrados listos; procesa el siguiente registro sin bloquear
+  int available() {
+    if (!open) return 0;
+    int n = (int)mbedtls_ssl_get_bytes_avail(&ssl);
+    if (n == 0) {
+      int ret = mbedtls_ssl_read(&ssl, nullptr, 0);
+      if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        closeSocket();   // close_notify, cierre o error
+        return 0;
+      }
+      n = (int)mbedtls_ssl_get_bytes_avail(&ssl);
+    }
+    return n;
+  }
+
+  int read(uint8_t *buf, size_t len) {
+    if (!open) return -1;
+    int ret = mbedtls_ssl_read(&ssl, buf, len);
+    if (ret > 0) return ret;
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) return 0;
+    closeSocket();
+    return -1;
+  }
+
+  // Cierra la conexión; la sesión se conserva para reanudarla
+  void stop() {
+    if (open) mbedtls_ssl_close_notify(&ssl);
+    closeSocket();
+  }
+
+  void forgetSession() {
+    mbedtls_ssl_session_free(&session);
+    mbedtls_ssl_session_init(&session);
+    hasSession = false;
+  }
+
+  bool resumed() const { return lastResumed; }
+  uint32_t handshakeCount() const { return handshakes; }
+  uint32_t resumedCount() const { return resumedHandshakes; }
+  uint32_t verifyFailureCount() const { return verifyFailures; }
+  uint32_t handshakeMicros() const { return lastHandshakeUs; }
+};
+
+} // namespace hal
+
+#endif // HAL_ESP32_H
@@ -0,0 +1,865 @@
+/*
+ * hal_native.h - Implementación de la HAL para el build nativo (Linux)
+ *
+ * Sustituye el hardware por un entorno simulado:
+ * - Reloj virtual que solo avanza con delay() o hal::sim::advance()
+ * - Contador de ciclos sobre el reloj real del host (o manual, para los tests)
+ * - Registro de las llamadas a tone()/noTone() por pin
+ * - Salida I2S que solo cuenta muestras y pico
+ * - Niveles de entrada GPIO/ADC inyectables desde los tests, con
+ *   interrupciones de cambio de nivel que se disparan al cambiarlos
+ * - Framebuffer de píxeles con doble buffer y transmisión temporizada
+ * - WiFi que se puede caer y recuperar desde los tests
+ * - Flash NOR en RAM con cortes de alimentación a mitad de escritura o
+ *   borrado, o sobre un archivo del host proyectado con mmap
+ * - PSRAM como una zona fija de memoria del host
+ * - Tarjeta SD sobre un directorio del host, con latencias modeladas
+ * - Estadísticas del heap fijadas desde los tests
+ * - Servidor TLS sustituto con latencias de red y de handshake modeladas
+ * - Generador aleatorio determinista con semilla
+ * - Objeto Serial mínimo que escribe en stdout y lee órdenes inyectadas
+ */
+
+#ifndef HAL_NATIVE_H
+#define HAL_NATIVE_H
+
+#include <chrono>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef HIGH
+#define HIGH 1
+#define LOW 0
+#endif
+
+#ifndef INPUT
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#endif
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+namespace hal {
+
+// ===============================================
+// ESTADO SIMULADO
+// ===============================================
+
+namespace sim {
+
+const int PIN_COUNT = 64;
+const int MAX_PIXELS = 64;
+const int TLS_PIN_SIZE = 32;
+const uint32_t FLASH_SIZE = 64 * 1024;
+const uint32_t FLASH_SECTORS = FLASH_SIZE / 4096;
+const uint32_t PSRAM_SIZE = 4 * 1024 * 1024;
+const uint8_t SD_PATH_MAX = 64;
+const uint8_t PIXEL_CHANNELS = 4;
+
+// Última llamada a tone()/noTone() en un pin
+struct PiezoState {
+  uint32_t frequency;     // 0 = silencio
+  uint32_t duration;      // Duración pedida en ms
+  uint32_t startedAt;     // Instante virtual de la última nota (ms)
+  uint32_t toneCount;     // Número de llamadas a tone()
+  uint32_t noToneCount;   // Número de llamadas a noTone()
+};
+
+// Servidor HTTPS sustituto: responde a cada petición con response, o con
+// lo que devuelva handler si lo hay (un InfluxDB simulado). Los
+// tiempos son un modelo del ESP32-S3 en una WiFi doméstica: TCP y TLS 1.2
+// completo suman 3 viajes de ida y vuelta más el intercambio de claves y
+// la verificación de la cadena; uno reanudado, 2 viajes y un cifrado
+// simétrico.
+struct TlsServer {
+  uint32_t rttUs;                // Ida y vuelta de red
+  uint32_t fullHandshakeUs;      // Cálculo del cliente en un handshake completo
+  uint32_t resumedHandshakeUs;   // Cálculo del cliente al reanudar
+  uint32_t queryUs;              // Tiempo de la consulta en el servidor
+  uint32_t idleTimeoutMs;        // Cierra la conexión inactiva (0 = nunca)
+  bool tickets;                  // Acepta reanudar sesiones
+  bool closeAfterResponse;       // Cierra tras cada respuesta
+  bool dropNextRequest;          // Cierra en vez de responder (una vez)
+  uint32_t sessionEpoch;         // Cambia al rotar la clave de los tickets
+  uint8_t spki[TLS_PIN_SIZE];    // SHA-256 de la clave pública del servidor
+  const char *response;          // Respuesta HTTP completa
+  uint32_t responseLength;
+  // Genera la respuesta a partir de la petición; debe seguir siendo válida
+  // hasta la siguiente petición
+  const char *(*handler)(const char *request, uint32_t length, uint32_t *responseLength);
+  // Contadores
+  uint32_t accepts;
+  uint32_t fullHandshakes;
+  uint32_t resumedHandshakes;
+  uint32_t requests;
+  uint32_t idleCloses;
+};
+
+struct State {
+  uint64_t nowMicros;
+  uint32_t randomState;
+  bool serialEnabled;
+  uint16_t serialTxRoom;      // Lo que devuelve Serial.availableForWrite()
+  uint64_t serialWritten;     // Bytes pasados a Serial.write()
+  char serialInput[64];       // Órdenes pendientes de leer por Serial.read()
+  uint8_t serialInputLength;
+  uint8_t serialInputPos;
+  uint32_t heapFree;          // Lo que devolverían las funciones del heap del IDF
+  uint32_t heapLargestBlock;
+  uint32_t heapMinFree;
+  bool manualCycles;          // Contador de ciclos manual en vez del reloj del host
+  uint32_t cycles;
+  uint8_t pinModes[PIN_COUNT];
+  uint8_t digitalOut[PIN_COUNT];
+  uint8_t digitalIn[PIN_COUNT];
+  int analogIn[PIN_COUNT];
+  void (*pinChange[PIN_COUNT])();   // Interrupción de cambio de nivel
+  uint8_t wakeLevel[PIN_COUNT];     // Nivel que despierta del sueño ligero
+  uint32_t pinInterrupts;           // Interrupciones disparadas
+  uint32_t isrWakes;                // Llamadas a wakeFromIsr()
+  PiezoState piezo[PIN_COUNT];
+  uint32_t lightSleepCount;   // Llamadas a lightSleep()
+  uint64_t lightSleepMs;      // Tiempo total en sueño ligero
+  uint64_t pixelDoneAt[PIXEL_CHANNELS];   // Fin de la transmisión de cada canal RMT (us)
+  uint32_t audioSampleRate;   // 0 = I2S sin configurar
+  uint64_t audioFrames;       // Muestras estéreo escritas
+  int16_t audioPeak;          // Valor absoluto máximo escrito
+  bool wifiDown;              // false = asociado al punto de acceso
+  uint32_t wifiReconnects;    // Llamadas a wifiReconnect()
+  uint8_t flash[FLASH_SIZE];
+  uint8_t *flashFile;         // Flash sobre un archivo (flashAttachFile), o nullptr
+  uint32_t flashFileSize;
+  bool flashCut;              // Hay un corte de alimentación programado
+  bool flashOff;              // Sin alimentación: la flash ignora escrituras y borrados
+  uint32_t flashBudget;       // Bytes que aún se escriben o borran antes del corte
+  uint32_t flashErases[FLASH_SECTORS];
+  uint64_t flashBytesWritten;
+  uint32_t psramSize;         // PSRAM de la placa simulada (0 = sin PSRAM)
+  uint32_t psramUsed;
+  char sdRoot[128];           // Directorio del host que hace de tarjeta ("" = sin SD)
+  uint32_t sdOpenUs;          // Abrir un archivo: buscar en el directorio FAT
+  uint32_t sdReadUsPerKb;     // Lectura por SPI, por KB
+  uint32_t sdOpens;
+  uint32_t sdReads;
+  uint64_t sdBytesRead;
+  TlsServer tls;
+};
+
+inline State &state() {
+  static State s;
+  return s;
+}
+
+inline void flashDetachFile() {
+  State &s = state();
+  if (s.flashFile) munmap(s.flashFile, s.flashFileSize);
+  s.flashFile = nullptr;
+  s.flashFileSize = 0;
+}
+
+// Restablece todo el hardware simulado: reloj a 0, botones liberados, la
+// flash otra vez en RAM
+inline void reset(uint32_t seed = 1) {
+  State &s = state();
+  flashDetachFile();
+  memset(&s, 0, sizeof(s));
+  s.randomState = seed ? seed : 1;
+  s.serialEnabled = false;
+  s.serialTxRoom = 4096;
+  for (int i = 0; i < PIN_COUNT; i++) {
+    s.digitalIn[i] = HIGH;   // Pull-up: liberado
+    s.analogIn[i] = 4095;    // ADC en reposo
+  }
+  s.tls.rttUs = 40000;
+  s.tls.fullHandshakeUs = 450000;
+  s.tls.resumedHandshakeUs = 15000;
+  s.tls.queryUs = 20000;
+  s.tls.idleTimeoutMs = 60000;
+  s.tls.tickets = true;
+  memset(s.flash, 0xFF, sizeof(s.flash));
+  s.heapFree = 240000;         // Un ESP32 con WiFi ya arrancado
+  s.heapLargestBlock = 110000;
+  s.heapMinFree = 240000;
+  s.psramSize = PSRAM_SIZE;
+  s.sdOpenUs = 3000;           // Una tarjeta de clase 10 por SPI a 20 MHz
+  s.sdReadUsPerKb = 700;
+}
+
+inline void advance(uint32_t ms) { state().nowMicros += (uint64_t)ms * 1000; }
+inline void advanceMicros(uint32_t us) { state().nowMicros += us; }
+inline void setMillis(uint32_t ms) { state().nowMicros = (uint64_t)ms * 1000; }
+
+// Un cambio de nivel dispara la interrupción del pin, si la tiene
+inline void setDigital(uint8_t pin, uint8_t level) {
+  State &s = state();
+  uint8_t &current = s.digitalIn[pin % PIN_COUNT];
+  if (current == level) return;
+  current = level;
+  if (s.pinChange[pin % PIN_COUNT]) {
+    s.pinInterrupts++;
+    s.pinChange[pin % PIN_COUNT]();
+  }
+}
+inline void setAnalog(uint8_t pin, int value) { state().analogIn[pin % PIN_COUNT] = value; }
+inline uint8_t digitalOutput(uint8_t pin) { return state().digitalOut[pin % PIN_COUNT]; }
+inline const PiezoState &piezo(uint8_t pin) { return state().piezo[pin % PIN_COUNT]; }
+
+inline void setSerialEnabled(bool enabled) { state().serialEnabled = enabled; }
+
+// Texto que leerá el firmware por Serial.read(), como si llegara por la UART
+inline void serialInput(const char *text) {
+  State &s = state();
+  s.serialInputLength = 0;
+  s.serialInputPos = 0;
+  while (*text && s.serialInputLength < sizeof(s.serialInput)) s.serialInput[s.serialInputLength++] = *text++;
+}
+
+inline void setHeap(uint32_t freeBytes, uint32_t largestBlock) {
+  State &s = state();
+  s.heapFree = freeBytes;
+  s.heapLargestBlock = largestBlock;
+  if (freeBytes < s.heapMinFree) s.heapMinFree = freeBytes;
+}
+
+// Con ciclos manuales, hal::cycleCount() solo avanza con advanceCycles()
+inline void setManualCycles(bool manual) { state().manualCycles = manual; }
+inline void advanceCycles(uint32_t cycles) { state().cycles += cycles; }
+
+inline void setWifi(bool connected) { state().wifiDown = !connected; }
+
+inline TlsServer &tlsServer() { return state().tls; }
+
+// Corta la alimentación tras escribir o borrar bytes más bytes: la
+// operación en curso queda a medias y las siguientes no hacen nada
+inline void flashPowerCut(uint32_t bytes) {
+  state().flashCut = true;
+  state().flashBudget = bytes;
+}
+
+// Reinicio tras el corte: la flash conserva lo que llegó a escribirse
+inline void flashPowerOn() {
+  state().flashCut = false;
+  state().flashOff = false;
+}
+
+inline bool flashPowered() { return !state().flashOff; }
+
+// La partición de datos pasa a ser el archivo path (su tamaño, redondeado
+// a sectores): lo que se escriba queda en él, como en la flash real
+inline bool flashAttachFile(const char *path) {
+  flashDetachFile();
+  int fd = open(path, O_RDWR);
+  if (fd < 0) return false;
+  struct stat st;
+  uint32_t size = fstat(fd, &st) == 0 ? (uint32_t)st.st_size / 4096 * 4096 : 0;
+  void *data = size ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (data == MAP_FAILED) return false;
+  state().flashFile = (uint8_t *)data;
+  state().flashFileSize = size;
+  return true;
+}
+
+inline uint8_t *flashData() { return state().flashFile ? state().flashFile : state().flash; }
+inline uint32_t flashBytes() { return state().flashFile ? state().flashFileSize : FLASH_SIZE; }
+
+inline void setPsram(uint32_t bytes) { state().psramSize = bytes < PSRAM_SIZE ? bytes : PSRAM_SIZE; }
+
+// Directorio del host que hace de raíz de la tarjeta SD
+inline void setSdRoot(const char *dir) {
+  snprintf(state().sdRoot, sizeof(state().sdRoot), "%s", dir ? dir : "");
+}
+inline void tlsSetResponse(const char *response, uint32_t length) {
+  state().tls.response = response;
+  state().tls.responseLength = length;
+}
+inline void tlsRotateTickets() { state().tls.sessionEpoch++; }
+
+} // namespace sim
+
+// ===============================================
+// RELOJ
+// ===============================================
+
+inline uint32_t millis() { return (uint32_t)(sim::state().nowMicros / 1000); }
+inline uint32_t micros() { return (uint32_t)sim::state().nowMicros; }
+inline void delay(uint32_t ms) { sim::advance(ms); }
+
+// En el host un "ciclo" es un nanosegundo de reloj real: el reloj virtual
+// no avanza mientras se ejecuta el código
+inline uint32_t cycleCount() {
+  if (sim::state().manualCycles) return sim::state().cycles;
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+}
+inline uint32_t cyclesPerMicro() { return 1000; }
+
+// Sueño ligero simulado: avanza el reloj y lo contabiliza. En el host no
+// hay entradas que despierten antes de tiempo.
+inline bool lightSleep(uint32_t ms) {
+  sim::state().lightSleepCount++;
+  sim::state().lightSleepMs += ms;
+  sim::advance(ms);
+  return false;
+}
+
+// Espera interrumpible: en el host las interrupciones solo llegan entre
+// vueltas del loop, desde los tests, así que es un delay()
+inline bool idleWait(uint32_t ms) {
+  sim::advance(ms);
+  return false;
+}
+
+inline void wakeFromIsr() { sim::state().isrWakes++; }
+
+// ===============================================
+// PIEZOELÉCTRICOS
+// ===============================================
+
+inline void tone(uint8_t pin, uint32_t frequency, uint32_t duration) {
+  sim::PiezoState &p = sim::state().piezo[pin % sim::PIN_COUNT];
+  p.frequency = frequency;
+  p.duration = duration;
+  p.startedAt = millis();
+  p.toneCount++;
+}
+
+inline void noTone(uint8_t pin) {
+  sim::PiezoState &p = sim::state().piezo[pin % sim::PIN_COUNT];
+  p.frequency = 0;
+  p.noToneCount++;
+}
+
+// true si ningún piezo está sonando (se puede entrar en sueño ligero)
+inline bool piezosIdle() {
+  uint32_t now = millis();
+  for (int i = 0; i < sim::PIN_COUNT; i++) {
+    const sim::PiezoState &p = sim::state().piezo[i];
+    if (p.frequency == 0) continue;
+    if (p.duration == 0) return false;
+    if ((int32_t)(now - (p.startedAt + p.duration)) < 0) return false;
+  }
+  return true;
+}
+
+// ===============================================
+// AUDIO I2S
+// ===============================================
+
+inline bool audioBegin(uint32_t sampleRate, uint16_t blockFrames, uint8_t bufferCount,
+                       uint8_t bclkPin, uint8_t lrcPin, uint8_t doutPin) {
+  sim::state().audioSampleRate = sampleRate;
+  return true;
+}
+
+// Solo contabiliza: el reloj virtual no avanza con el audio
+inline void audioWrite(const int16_t *frames, uint16_t frameCount) {
+  sim::State &s = sim::state();
+  for (uint32_t i = 0; i < (uint32_t)frameCount * 2; i++) {
+    int16_t a = frames[i] < 0 ? (int16_t)(frames[i] == -32768 ? 32767 : -frames[i]) : frames[i];
+    if (a > s.audioPeak) s.audioPeak = a;
+  }
+  s.audioFrames += frameCount;
+}
+
+// ===============================================
+// TAREAS
+// ===============================================
+
+// La simulación es de un solo hilo: no hay tareas en segundo plano
+inline bool startTask(const char *name, void (*function)(void *), uint32_t stackBytes,
+                      uint8_t priority, uint8_t core) {
+  return false;
+}
+
+// ===============================================
+// WIFI
+// ===============================================
+
+inline bool wifiConnected() { return !sim::state().wifiDown; }
+inline void wifiReconnect() { sim::state().wifiReconnects++; }
+
+// ===============================================
+// MEMORIA DINÁMICA
+// ===============================================
+
+inline uint32_t heapFree() { return sim::state().heapFree; }
+inline uint32_t heapLargestFreeBlock() { return sim::state().heapLargestBlock; }
+inline uint32_t heapMinFree() { return sim::state().heapMinFree; }
+
+// ===============================================
+// FLASH DE DATOS
+// ===============================================
+
+const uint32_t FLASH_SECTOR_SIZE = 4096;
+
+inline bool flashBegin() { return true; }
+inline uint32_t flashSize() { return sim::flashBytes(); }
+
+inline bool flashRead(uint32_t address, void *data, uint32_t length) {
+  if (address + length > sim::flashBytes()) return false;
+  memcpy(data, sim::flashData() + address, length);
+  return true;
+}
+
+// Consume un byte del margen hasta el corte programado
+inline bool flashSpend() {
+  sim::State &s = sim::state();
+  if (s.flashOff) return false;
+  if (s.flashCut && s.flashBudget-- == 0) {
+    s.flashOff = true;
+    return false;
+  }
+  return true;
+}
+
+// Semántica NOR: solo pasa bits de 1 a 0, byte a byte
+inline bool flashWrite(uint32_t address, const void *data, uint32_t length) {
+  if (address + length > sim::flashBytes()) return false;
+  const uint8_t *bytes = (const uint8_t *)data;
+  for (uint32_t i = 0; i < length; i++) {
+    if (!flashSpend()) return false;
+    sim::flashData()[address + i] &= bytes[i];
+    sim::state().flashBytesWritten++;
+  }
+  return true;
+}
+
+inline bool flashErase(uint32_t address) {
+  if (address % FLASH_SECTOR_SIZE || address >= sim::flashBytes()) return false;
+  if (sim::state().flashOff) return false;
+  if (address / FLASH_SECTOR_SIZE < sim::FLASH_SECTORS) sim::state().flashErases[address / FLASH_SECTOR_SIZE]++;
+  for (uint32_t i = 0; i < FLASH_SECTOR_SIZE; i++) {
+    if (!flashSpend()) return false;
+    sim::flashData()[address + i] = 0xFF;
+  }
+  return true;
+}
+
+// En el host la "flash" ya es memoria: la proyección es un puntero a ella
+inline const uint8_t *flashMap(uint32_t address, uint32_t length) {
+  if (address + length > sim::flashBytes()) return nullptr;
+  return sim::flashData() + address;
+}
+
+// ===============================================
+// PSRAM
+// ===============================================
+
+// Reservas consecutivas en una zona fija; sim::reset() la vacía
+inline uint8_t *psramArena() {
+  static uint8_t arena[sim::PSRAM_SIZE];
+  return arena;
+}
+
+inline void *psramAlloc(uint32_t bytes) {
+  sim::State &s = sim::state();
+  bytes = (bytes + 15) & ~15u;
+  if (bytes > s.psramSize - s.psramUsed) return nullptr;
+  void *p = psramArena() + s.psramUsed;
+  s.psramUsed += bytes;
+  return p;
+}
+
+inline uint32_t psramFree() { return sim::state().psramSize - sim::state().psramUsed; }
+
+// ===============================================
+// TARJETA SD
+// ===============================================
+
+// Los archivos se leen del directorio sim::setSdRoot() con open()/read().
+// Abrir y leer avanzan el reloj virtual según sdOpenUs y sdReadUsPerKb
+const uint8_t SD_PATH_MAX = sim::SD_PATH_MAX;
+
+inline bool sdBegin(uint8_t csPin, uint8_t sckPin, uint8_t misoPin, uint8_t mosiPin) {
+  return sim::state().sdRoot[0] != 0;
+}
+
+class SdFile {
+private:
+  int fd;
+  uint32_t length;
+
+public:
+  SdFile() : fd(-1), length(0) {}
+
+  bool open(const char *path) {
+    close();
+    sim::State &s = sim::state();
+    if (!s.sdRoot[0]) return false;
+    char full[sizeof(s.sdRoot) + SD_PATH_MAX];
+    size_t rootLength = strlen(s.sdRoot);
+    size_t pathLength = strlen(path);
+    if (pathLength >= SD_PATH_MAX) return false;
+    memcpy(full, s.sdRoot, rootLength);
+    memcpy(full + rootLength, path, pathLength + 1);
+    s.sdOpens++;
+    s.nowMicros += s.sdOpenUs;
+    fd = ::open(full, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    length = fstat(fd, &st) == 0 ? (uint32_t)st.st_size : 0;
+    return true;
+  }
+
+  void close() {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    length = 0;
+  }
+
+  bool isOpen() const { return fd >= 0; }
+  uint32_t size() const { return length; }
+  bool seek(uint32_t position) { return fd >= 0 && lseek(fd, position, SEEK_SET) == (off_t)position; }
+
+  int32_t read(void *data, uint32_t bytes) {
+    if (fd < 0) return -1;
+    int32_t n = (int32_t)::read(fd, data, bytes);
+    if (n > 0) {
+      sim::State &s = sim::state();
+      s.sdReads++;
+      s.sdBytesRead += n;
+      s.nowMicros += (uint64_t)n * s.sdReadUsPerKb / 1024;
+    }
+    return n;
+  }
+};
+
+// ===============================================
+// GPIO / ADC
+// ===============================================
+
+inline void pinMode(uint8_t pin, uint8_t mode) { sim::state().pinModes[pin % sim::PIN_COUNT] = mode; }
+inline void digitalWrite(uint8_t pin, uint8_t value) { sim::state().digitalOut[pin % sim::PIN_COUNT] = value; }
+inline int digitalRead(uint8_t pin) { return sim::state().digitalIn[pin % sim::PIN_COUNT]; }
+inline int analogRead(uint8_t pin) { return sim::state().analogIn[pin % sim::PIN_COUNT]; }
+
+inline void attachPinChange(uint8_t pin, void (*handler)()) {
+  sim::state().pinChange[pin % sim::PIN_COUNT] = handler;
+}
+
+inline void wakeOnPinLevel(uint8_t pin, uint8_t level) {
+  sim::state().wakeLevel[pin % sim::PIN_COUNT] = level;
+}
+
+// ===============================================
+// ALEATORIOS
+// ===============================================
+
+// xorshift32: reproducible entre ejecuciones para la misma semilla
+inline long random(long minValue, long maxValue) {
+  if (maxValue <= minValue) return minValue;
+  uint32_t &x = sim::state().randomState;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return minValue + (long)(x % (uint32_t)(maxValue - minValue));
+}
+
+// ===============================================
+// SALIDA DE PÍXELES
+// ===============================================
+
+// Doble buffer como en el ESP32: setPixelColor() dibuja en el buffer
+// trasero y show() lo publica en el delantero, que "transmite" durante el
+// tiempo real del protocolo (30 us por LED + 50 us de reset) medido en el
+// reloj virtual. Un show() con la transmisión anterior en curso se
+// descarta y devuelve false.
+const uint8_t PIXEL_CHANNELS = sim::PIXEL_CHANNELS;
+
+// Algún aro con una transmisión en curso
+inline bool pixelsBusy() {
+  for (uint8_t c = 0; c < PIXEL_CHANNELS; c++) {
+    if (sim::state().pixelDoneAt[c] > sim::state().nowMicros) return true;
+  }
+  return false;
+}
+
+// Espera a que terminen las transmisiones en curso: avanza el reloj virtual
+// hasta el final de la última. Siempre terminan (true)
+inline bool pixelsWaitDone() {
+  uint64_t last = sim::state().nowMicros;
+  for (uint8_t c = 0; c < PIXEL_CHANNELS; c++) {
+    if (sim::state().pixelDoneAt[c] > last) last = sim::state().pixelDoneAt[c];
+  }
+  sim::advanceMicros((uint32_t)(last - sim::state().nowMicros));
+  return true;
+}
+
+class PixelStrip {
+private:
+  uint16_t count;
+  uint8_t channel;
+  uint8_t brightness;
+  uint32_t back[sim::MAX_PIXELS];
+  uint32_t front[sim::MAX_PIXELS];
+  bool transmitting;
+  uint64_t doneAtMicros;
+  uint32_t shows;
+  uint32_t completed;
+  uint32_t dropped;
+
+  // Cierra la transmisión en curso si el reloj virtual ya pasó su final
+  void poll() {
+    if (transmitting && sim::state().nowMicros >= doneAtMicros) {
+      transmitting = false;
+      completed++;
+    }
+  }
+
+public:
+  PixelStrip() : PixelStrip(0, 0) {}
+  PixelStrip(uint16_t count, uint8_t pin, uint8_t channel = 0)
+    : count(count > sim::MAX_PIXELS ? sim::MAX_PIXELS : count), channel(channel), brightness(255),
+      transmitting(false), doneAtMicros(0), shows(0), completed(0), dropped(0) {
+    (void)pin;
+    clear();
+    memset(front, 0, sizeof(front));
+  }
+
+  void begin() {}
+  void begin(uint16_t pixelCount, uint8_t pin, uint8_t rmtChannel) {
+    *this = PixelStrip(pixelCount, pin, rmtChannel);
+  }
+  void setBrightness(uint8_t value) { brightness = value; }
+  void setPixelColor(uint16_t index, uint32_t color) {
+    if (index < count) back[index] = color;
+  }
+  uint32_t getPixelColor(uint16_t index) const { return index < count ? back[index] : 0; }
+  void clear() { memset(back, 0, sizeof(back)); }
+  uint16_t numPixels() const { return count; }
+
+  // No bloquea: copia el frame al buffer delantero y arranca la transmisión
+  bool show() {
+    poll();
+    if (transmitting) {
+      dropped++;
+      return false;
+    }
+    memcpy(front, back, sizeof(front));
+    transmitting = true;
+    doneAtMicros = sim::state().nowMicros + (uint64_t)count * 30 + 50;
+    if (channel < sim::PIXEL_CHANNELS) sim::state().pixelDoneAt[channel] = doneAtMicros;
+    shows++;
+    return true;
+  }
+
+  bool busy() {
+    poll();
+    return transmitting;
+  }
+
+  // Solo en el build nativo
+  uint8_t getBrightness() const { return brightness; }
+  uint8_t rmtChannel() const { return channel; }
+  uint32_t showCount() const { return shows; }
+  uint32_t completedCount() { poll(); return completed; }
+  uint32_t droppedCount() const { return dropped; }
+  uint32_t frontPixelColor(uint16_t index) const { return index < count ? front[index] : 0; }
+
+  static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {
+    return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+  }
+};
+
+// ===============================================
+// CONEXIÓN TLS
+// ===============================================
+
+// Misma interfaz que en el ESP32, contra el servidor sustituto de
+// sim::tlsServer(). connect() y la respuesta avanzan el reloj virtual
+// según el modelo de latencias; el pin se compara con su spki (la CA no
+// se simula).
+const uint8_t TLS_PIN_SIZE = sim::TLS_PIN_SIZE;
+
+class TlsLink {
+private:
+  const uint8_t (*pins)[TLS_PIN_SIZE];
+  uint8_t pinCount;
+  bool configured;
+  bool open;
+  bool hasSession;
+  bool lastResumed;
+  bool responding;
+  uint32_t sessionEpoch;
+  uint64_t lastActivityUs;
+  uint64_t responseAtUs;
+  uint32_t responsePos;
+  uint32_t handshakes;
+  uint32_t resumedHandshakes;
+  uint32_t verifyFailures;
+  uint32_t lastHandshakeUs;
+
+  // El servidor cierra las conexiones que pasan idleTimeoutMs sin uso; sin
+  // WiFi se pierden todas
+  void poll() {
+    sim::TlsServer &server = sim::tlsServer();
+    if (sim::state().wifiDown) open = false;
+    if (open && !responding && server.idleTimeoutMs &&
+        sim::state().nowMicros - lastActivityUs >= (uint64_t)server.idleTimeoutMs * 1000) {
+      open = false;
+      server.idleCloses++;
+    }
+  }
+
+  bool pinned(const uint8_t *spki) const {
+    for (uint8_t i = 0; i < pinCount; i++) {
+      if (memcmp(spki, pins[i], TLS_PIN_SIZE) == 0) return true;
+    }
+    return pinCount == 0;
+  }
+
+public:
+  TlsLink()
+    : pins(nullptr), pinCount(0), configured(false), open(false), hasSession(false), lastResumed(false),
+      responding(false), sessionEpoch(0), lastActivityUs(0), responseAtUs(0), responsePos(0),
+      handshakes(0), resumedHandshakes(0), verifyFailures(0), lastHandshakeUs(0) {}
+
+  bool begin(const char *serverHost, uint16_t serverPort, const char *caPem,
+             const uint8_t (*pinList)[TLS_PIN_SIZE], uint8_t pinListCount) {
+    (void)serverHost;
+    (void)serverPort;
+    pins = pinList;
+    pinCount = pinListCount;
+    configured = caPem || pinCount;
+    return configured;
+  }
+
+  void setTimeout(uint32_t ms) { (void)ms; }
+
+  bool connect() {
+    stop();
+    if (!configured || sim::state().wifiDown) return false;
+    sim::TlsServer &server = sim::tlsServer();
+    uint64_t start = sim::state().nowMicros;
+    server.accepts++;
+    lastResumed = hasSession && server.tickets && sessionEpoch == server.sessionEpoch;
+    if (lastResumed) {
+      sim::state().nowMicros += 2 * (uint64_t)server.rttUs + server.resumedHandshakeUs;
+      server.resumedHandshakes++;
+      resumedHandshakes++;
+    } else {
+      sim::state().nowMicros += 3 * (uint64_t)server.rttUs + server.fullHandshakeUs;
+      if (!pinned(server.spki)) {
+        verifyFailures++;
+        forgetSession();
+        return false;
+      }
+      server.fullHandshakes++;
+    }
+    handshakes++;
+    hasSession = true;
+    sessionEpoch = server.sessionEpoch;
+    open = true;
+    responding = false;
+    lastActivityUs = sim::state().nowMicros;
+    lastHandshakeUs = (uint32_t)(sim::state().nowMicros - start);
+    return true;
+  }
+
+  bool connected() {
+    poll();
+    return open;
+  }
+
+  // Cada escritura es una petición completa
+  int write(const uint8_t *data, size_t len) {
+    if (!connected()) return -1;
+    sim::TlsServer &server = sim::tlsServer();
+    server.requests++;
+    if (server.dropNextRequest) {
+      // El servidor cerró justo cuando salía la petición
+      server.dropNextRequest = false;
+      open = false;
+      return (int)len;
+    }
+    if (server.handler) {
+      server.response = server.handler((const char *)data, (uint32_t)len, &server.responseLength);
+    }
+    responding = true;
+    responsePos = 0;
+    responseAtUs = sim::state().nowMicros + server.rttUs + server.queryUs;
+    return (int)len;
+  }
+
+  int available() {
+    if (!connected() || !responding || sim::state().nowMicros < responseAtUs) return 0;
+    return (int)(sim::tlsServer().responseLength - responsePos);
+  }
+
+  int read(uint8_t *buf, size_t len) {
+    int n = available();
+    if (n <= 0) return open ? 0 : -1;
+    if ((size_t)n > len) n = (int)len;
+    memcpy(buf, sim::tlsServer().response + responsePos, n);
+    responsePos += n;
+    if (responsePos >= sim::tlsServer().responseLength) {
+      responding = false;
+      lastActivityUs = sim::state().nowMicros;
+      if (sim::tlsServer().closeAfterResponse) open = false;
+    }
+    return n;
+  }
+
+  void stop() {
+    open = false;
+    responding = false;
+  }
+
+  void forgetSession() { hasSession = false; }
+
+  bool resumed() const { return lastResumed; }
+  uint32_t handshakeCount() const { return handshakes; }
+  uint32_t resumedCount() const { return resumedHandshakes; }
+  uint32_t verifyFailureCount() const { return verifyFailures; }
+  uint32_t handshakeMicros() const { return lastHandshakeUs; }
+};
+
+} // namespace hal
+
+// ===============================================
+// SERIAL MÍNIMO
+// ===============================================
+
+// Mismas sobrecargas que usa el firmware; silencioso por defecto para
+// que los benchmarks midan el motor y no la consola
+class HostSerial {
+private:
+  bool enabled() const { return hal::sim::state().serialEnabled; }
+
+public:
+  void begin(unsigned long) {}
+  int availableForWrite() const { return hal::sim::state().serialTxRoom; }
+  size_t write(const uint8_t *data, size_t length) {
+    hal::sim::state().serialWritten += length;
+    if (enabled()) fwrite(data, 1, length, stdout);
+    return length;
+  }
+  int available() const { return hal::sim::state().serialInputLength - hal::sim::state().serialInputPos; }
+  int read() {
+    hal::sim::State &s = hal::sim::state();
+    return s.serialInputPos < s.serialInputLength ? s.serialInput[s.serialInputPos++] : -1;
+  }
+  void print(const char *text) { if (enabled()) fputs(text, stdout); }
+  void print(char c) { if (enabled()) fputc(c, stdout); }
+  void print(int value) { if (enabled()) printf("%d", value); }
+  void print(unsigned int value) { if (enabled()) printf("%u", value); }
+  void print(long value) { if (enabled()) printf("%ld", value); }
+  void print(unsigned long value) { if (enabled()) printf("%lu", value); }
+  void print(double value, int digits = 2) { if (enabled()) printf("%.*f", digits, value); }
+  void println() { if (enabled()) fputc('\n', stdout); }
+  void println(double value, int digits) { print(value, digits); println(); }
+  template <typename T> void println(T value) { print(value); println(); }
+};
+
+inline HostSerial Serial;
+
+#endif // HAL_NATIVE_H
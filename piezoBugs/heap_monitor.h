@@ -0,0 +1,69 @@
+/*
+ * heap_monitor.h - Telemetría del heap
+ *
+ * Tras setup() el loop no reserva memoria dinámica: todo vive en tablas
+ * fijas. Para comprobarlo en las unidades que pasan semanas encendidas se
+ * informa cada HEAP_REPORT_MS de la memoria libre, el bloque libre mayor
+ * (si baja mucho respecto a la libre, el heap está fragmentado), el mínimo
+ * desde el arranque y cuánto ha cambiado la libre desde el final de setup().
+ * En el build nativo, test_heap falla si algo llama a malloc después.
+ */
+
+#ifndef PIEZOBUGS_HEAP_MONITOR_H
+#define PIEZOBUGS_HEAP_MONITOR_H
+
+#include "hal.h"
+#include "config.h"
+#include "log.h"
+
+struct HeapMonitor {
+  uint32_t baselineFree;    // Libre al terminar setup()
+  uint32_t freeBytes;       // Última muestra
+  uint32_t largestBlock;
+  uint32_t minFree;
+  uint32_t samples;
+};
+
+HeapMonitor heapMonitor;
+
+void heapMonitorSample() {
+  heapMonitor.freeBytes = hal::heapFree();
+  heapMonitor.largestBlock = hal::heapLargestFreeBlock();
+  heapMonitor.minFree = hal::heapMinFree();
+  heapMonitor.samples++;
+}
+
+// Al final de setup(): lo que falte después respecto a esto es del loop
+void heapMonitorBegin() {
+  heapMonitor = HeapMonitor();
+  heapMonitorSample();
+  heapMonitor.baselineFree = heapMonitor.freeBytes;
+}
+
+// Porcentaje de la memoria libre que no está en el bloque mayor
+uint8_t heapFragmentation() {
+  if (heapMonitor.freeBytes == 0) return 0;
+  return 100 - (uint8_t)((uint64_t)heapMonitor.largestBlock * 100 / heapMonitor.freeBytes);
+}
+
+// Bytes libres ganados (+) o perdidos (-) desde el final de setup()
+int32_t heapDriftBytes() {
+  return (int32_t)(heapMonitor.freeBytes - heapMonitor.baselineFree);
+}
+
+void heapMonitorReport() {
+  int32_t drift = heapDriftBytes();
+  if (drift > 32767) drift = 32767;
+  if (drift < -32767) drift = -32767;
+  LOG(LOG_HEAP, heapMonitor.freeBytes / 1024, heapMonitor.largestBlock / 1024, heapFragmentation(),
+      heapMonitor.minFree / 1024, drift);
+}
+
+// Tarea del planificador
+uint32_t heapMonitorTask(uint32_t now) {
+  heapMonitorSample();
+  heapMonitorReport();
+  return now + HEAP_REPORT_MS;
+}
+
+#endif // PIEZOBUGS_HEAP_MONITOR_H
@@ -0,0 +1,156 @@
+/*
+ * influx_client.h - Consultas a InfluxDB por una conexión HTTPS persistente
+ *
+ * Una sola conexión HTTP/1.1 keep-alive con el servidor, que solo se
+ * rehace cuando falla o el servidor la cierra. Al rehacerla, hal::TlsLink
+ * reanuda la sesión TLS guardada: un viaje de ida y vuelta menos y sin
+ * intercambio de claves ni verificación de la cadena, que es lo que
+ * domina la latencia y el consumo de cada consulta en el ESP32.
+ *
+ * La cabecera de la petición se construye una vez en influxClientBegin;
+ * influxClientSetQuery solo escribe Content-Length y el cuerpo detrás, y
+ * la petición sale en una única escritura. La respuesta se procesa según
+ * llega con influx_csv.h.
+ */
+
+#ifndef PIEZOBUGS_INFLUX_CLIENT_H
+#define PIEZOBUGS_INFLUX_CLIENT_H
+
+#include <stdio.h>
+#include <string.h>
+#include "hal.h"
+#include "influx_csv.h"
+
+// ===============================================
+// CONFIGURACIÓN
+// ===============================================
+
+const uint16_t INFLUX_REQUEST_MAX = 768;    // Cabecera + consulta Flux
+const uint16_t INFLUX_RX_BUFFER = 512;      // Lecturas del socket
+const uint32_t INFLUX_TIMEOUT_MS = 10000;
+
+// ===============================================
+// ESTADO
+// ===============================================
+
+struct InfluxClient {
+  hal::TlsLink link;
+  char request[INFLUX_REQUEST_MAX];
+  uint16_t headerLength;         // Parte fija, hasta "Content-Length: "
+  uint16_t requestLength;        // 0 = sin consulta
+  InfluxCsvParser parser;
+  uint8_t rx[INFLUX_RX_BUFFER];
+
+  // Estadísticas
+  uint32_t queries;
+  uint32_t failures;
+  uint32_t reused;               // Consultas sobre una conexión ya abierta
+  uint32_t retries;              // Conexión caducada: reintento en una nueva
+  uint64_t bytesSent;            // Peticiones HTTP (sin la capa TLS)
+  uint64_t bytesReceived;        // Respuestas HTTP, cabeceras incluidas
+  uint32_t lastTtfbUs;           // Del inicio de la consulta al primer byte
+  uint32_t maxTtfbUs;
+  uint64_t totalTtfbUs;
+  uint32_t ttfbCount;
+};
+
+// Prepara la conexión y la cabecera fija de la petición
+bool influxClientBegin(InfluxClient &c, const char *host, uint16_t port, const char *org,
+                       const char *token, const char *caPem,
+                       const uint8_t (*pins)[hal::TLS_PIN_SIZE], uint8_t pinCount) {
+  c.headerLength = 0;
+  c.requestLength = 0;
+  c.queries = c.failures = c.reused = c.retries = 0;
+  c.bytesSent = c.bytesReceived = 0;
+  c.lastTtfbUs = c.maxTtfbUs = 0;
+  c.totalTtfbUs = 0;
+  c.ttfbCount = 0;
+  int n = snprintf(c.request, sizeof(c.request),
+                   "POST /api/v2/query?org=%s HTTP/1.1\r\n"
+                   "Host: %s\r\n"
+                   "Authorization: Token %s\r\n"
+                   "Content-Type: application/vnd.flux\r\n"
+                   "Connection: keep-alive\r\n"
+                   "Content-Length: ",
+                   org, host, token);
+  if (n <= 0 || n >= (int)sizeof(c.request)) return false;
+  c.headerLength = (uint16_t)n;
+  c.link.setTimeout(INFLUX_TIMEOUT_MS);
+  return c.link.begin(host, port, caPem, pins, pinCount);
+}
+
+// Completa la petición con la consulta Flux, sin tocar la cabecera
+bool influxClientSetQuery(InfluxClient &c, const char *query) {
+  c.requestLength = 0;
+  if (!c.headerLength) return false;
+  size_t length = strlen(query);
+  size_t room = sizeof(c.request) - c.headerLength;
+  int n = snprintf(c.request + c.headerLength, room, "%u\r\n\r\n%s", (unsigned)length, query);
+  if (n <= 0 || (size_t)n >= room) return false;
+  c.requestLength = (uint16_t)(c.headerLength + n);
+  return true;
+}
+
+// ===============================================
+// CONSULTA
+// ===============================================
+
+// Envía la petición por la conexión abierta (o una nueva) y procesa la
+// respuesta. Devuelve el número de bytes recibidos (-1 sin conexión)
+int influxClientExchange(InfluxClient &c, uint32_t startUs) {
+  influxParserBegin(c.parser);
+  if (!c.link.connected() && !c.link.connect()) return -1;
+  if (c.link.write((const uint8_t *)c.request, c.requestLength) != c.requestLength) return 0;
+  c.bytesSent += c.requestLength;
+
+  uint32_t startMs = hal::millis();
+  while (!influxParserDone(c.parser)) {
+    int available = c.link.available();
+    if (available <= 0) {
+      if (!c.link.connected() || hal::millis() - startMs >= INFLUX_TIMEOUT_MS) break;
+      hal::delay(1);
+      continue;
+    }
+    int n = c.link.read(c.rx, (size_t)available < sizeof(c.rx) ? (size_t)available : sizeof(c.rx));
+    if (n <= 0) continue;
+    if (c.parser.bytes == 0) {
+      c.lastTtfbUs = hal::micros() - startUs;
+      if (c.lastTtfbUs > c.maxTtfbUs) c.maxTtfbUs = c.lastTtfbUs;
+      c.totalTtfbUs += c.lastTtfbUs;
+      c.ttfbCount++;
+    }
+    c.bytesReceived += n;
+    if (!influxParserFeed(c.parser, c.rx, n)) break;
+  }
+  return (int)c.parser.bytes;
+}
+
+// Una consulta completa. Si la conexión reutilizada resulta estar cerrada
+// (el servidor la cerró mientras salía la petición) se repite una vez en
+// una conexión nueva. Devuelve true si data recibió valores nuevos; una
+// respuesta completa sin filas no es un fallo (influxParserComplete)
+bool influxClientQuery(InfluxClient &c, TreeData &data) {
+  if (!c.requestLength) return false;
+  c.queries++;
+  uint32_t startUs = hal::micros();
+  bool wasOpen = c.link.connected();
+  if (wasOpen) c.reused++;
+  int received = influxClientExchange(c, startUs);
+  if (received == 0 && wasOpen) {
+    c.link.stop();
+    c.retries++;
+    received = influxClientExchange(c, startUs);
+  }
+  // Solo se reutiliza una conexión que terminó limpia su respuesta
+  if (received <= 0 || !influxParserKeepAlive(c.parser)) c.link.stop();
+
+  bool updated = received > 0 && influxParserFinish(c.parser, data, hal::millis());
+  if (!updated && !influxParserComplete(c.parser)) c.failures++;
+  return updated;
+}
+
+inline uint32_t influxClientMeanTtfbUs(const InfluxClient &c) {
+  return c.ttfbCount ? (uint32_t)(c.totalTtfbUs / c.ttfbCount) : 0;
+}
+
+#endif // PIEZOBUGS_INFLUX_CLIENT_H
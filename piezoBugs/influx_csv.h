@@ -0,0 +1,687 @@
+/*
+ * influx_csv.h - Parser incremental de respuestas CSV de InfluxDB
+ *
+ * Consume la respuesta HTTP tal como llega del socket, en trozos de
+ * cualquier tamaño, con una máquina de estados byte a byte:
+ * - Línea de estado y cabeceras HTTP (Content-Length, chunked,
+ *   Connection: close)
+ * - Transfer-Encoding: chunked, o cuerpo hasta Content-Length o cierre
+ * - CSV anotado de Flux: anotaciones (#), varias tablas separadas por
+ *   línea en blanco, cada una con su fila de cabecera, y celdas entre
+ *   comillas
+ *
+ * Las columnas _value, _field y _time se localizan por nombre en cada
+ * cabecera. Nada se copia: los nombres se reconocen carácter a carácter
+ * frente a las listas de candidatos, y _value y _time (RFC3339) se
+ * convierten a número a la vez que llegan. Además del último valor de
+ * cada campo se guardan el _time más reciente (marca de agua para pedir
+ * solo lo nuevo) y cuánto varió cada campo dentro de la respuesta. El
+ * estado ocupa unos cientos de bytes, no hay memoria dinámica y la
+ * respuesta no tiene límite de tamaño.
+ */
+
+#ifndef PIEZOBUGS_INFLUX_CSV_H
+#define PIEZOBUGS_INFLUX_CSV_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "tree_data.h"
+
+// ===============================================
+// RECONOCIMIENTO DE NOMBRES SIN COPIA
+// ===============================================
+
+// Candidatos que siguen coincidiendo con lo leído hasta ahora (máximo 8)
+struct TokenMatcher {
+  uint8_t mask;
+  uint8_t pos;
+};
+
+inline void tokenBegin(TokenMatcher &m, uint8_t count) {
+  m.mask = (uint8_t)((1u << count) - 1);
+  m.pos = 0;
+}
+
+inline char asciiLower(char c) {
+  return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+}
+
+inline void tokenFeed(TokenMatcher &m, const char* const *names, uint8_t count, char c, bool ignoreCase) {
+  if (!m.mask) return;
+  if (ignoreCase) c = asciiLower(c);
+  for (uint8_t i = 0; i < count; i++) {
+    if ((m.mask & (1u << i)) && names[i][m.pos] != c) m.mask &= ~(1u << i);
+  }
+  m.pos++;
+}
+
+// Índice del candidato que coincide entero, o -1
+inline int tokenResult(const TokenMatcher &m, const char* const *names, uint8_t count) {
+  for (uint8_t i = 0; i < count; i++) {
+    if ((m.mask & (1u << i)) && names[i][m.pos] == '\0') return i;
+  }
+  return -1;
+}
+
+// ===============================================
+// NÚMEROS INCREMENTALES
+// ===============================================
+
+// Decimal con signo, fracción y exponente ("-12.5", "3e-2"), sin strtod
+struct NumberParser {
+  int64_t mantissa;
+  int16_t exponent;        // Potencia de 10 que falta aplicar a mantissa
+  int16_t expValue;
+  uint8_t digits;          // Dígitos significativos guardados (máx. 18)
+  bool negative;
+  bool expNegative;
+  bool seenDigit;
+  bool seenExpDigit;
+  bool inFraction;
+  bool inExponent;
+  bool invalid;
+};
+
+inline void numberBegin(NumberParser &n) {
+  memset(&n, 0, sizeof(n));
+}
+
+inline void numberFeed(NumberParser &n, char c) {
+  if (n.invalid) return;
+  bool digit = c >= '0' && c <= '9';
+  if (n.inExponent) {
+    if (digit) {
+      if (n.expValue < 400) n.expValue = n.expValue * 10 + (c - '0');
+      n.seenExpDigit = true;
+    } else if ((c == '-' || c == '+') && !n.seenExpDigit && !n.expNegative) {
+      n.expNegative = c == '-';
+    } else {
+      n.invalid = true;
+    }
+  } else if (digit) {
+    n.seenDigit = true;
+    if (n.digits < 18) {
+      n.mantissa = n.mantissa * 10 + (c - '0');
+      if (n.mantissa) n.digits++;
+      if (n.inFraction) n.exponent--;
+    } else if (!n.inFraction) {
+      n.exponent++;
+    }
+  } else if (c == '.' && !n.inFraction) {
+    n.inFraction = true;
+  } else if ((c == '-' || c == '+') && !n.seenDigit && !n.inFraction && !n.negative) {
+    n.negative = c == '-';
+  } else if ((c == 'e' || c == 'E') && n.seenDigit) {
+    n.inExponent = true;
+  } else {
+    n.invalid = true;
+  }
+}
+
+inline bool numberValid(const NumberParser &n) {
+  return !n.invalid && n.seenDigit && (!n.inExponent || n.seenExpDigit);
+}
+
+inline double numberValue(const NumberParser &n) {
+  int e = n.exponent + (n.expNegative ? -n.expValue : n.expValue);
+  if (e > 308) e = 308;
+  if (e < -308) e = -308;
+  double scale = 1.0;
+  for (int i = 0; i < (e < 0 ? -e : e); i++) scale *= 10.0;
+  double v = (double)n.mantissa;
+  v = e < 0 ? v / scale : v * scale;
+  return n.negative ? -v : v;
+}
+
+// ===============================================
+// FECHAS RFC3339 INCREMENTALES
+// ===============================================
+
+// "2025-06-01T10:59:50.123456789Z" o con desfase "+02:00", a
+// nanosegundos desde 1970 (UTC)
+enum TimePart {
+  TIME_YEAR, TIME_MONTH, TIME_DAY, TIME_HOUR, TIME_MINUTE, TIME_SECOND,
+  TIME_FRACTION, TIME_OFFSET_HOUR, TIME_OFFSET_MINUTE, TIME_END
+};
+
+struct TimeParser {
+  uint16_t value[TIME_FRACTION];   // Año .. segundo
+  uint32_t nanos;
+  uint8_t fractionDigits;
+  uint8_t offsetHour;
+  uint8_t offsetMinute;
+  int8_t offsetSign;
+  uint8_t part;
+  uint8_t digits;                  // Dígitos de la parte actual
+  bool invalid;
+};
+
+inline void timeBegin(TimeParser &t) {
+  memset(&t, 0, sizeof(t));
+}
+
+inline void timeFeed(TimeParser &t, char c) {
+  if (t.invalid) return;
+  static const char SEPARATORS[TIME_SECOND] = {'-', '-', 'T', ':', ':'};
+  static const uint8_t DIGITS[TIME_FRACTION] = {4, 2, 2, 2, 2, 2};
+  if (c >= '0' && c <= '9') {
+    uint8_t d = (uint8_t)(c - '0');
+    if (t.part < TIME_FRACTION && t.digits < DIGITS[t.part]) {
+      t.value[t.part] = t.value[t.part] * 10 + d;
+    } else if (t.part == TIME_FRACTION) {
+      if (t.fractionDigits < 9) {
+        t.nanos = t.nanos * 10 + d;
+        t.fractionDigits++;
+      }
+    } else if (t.part == TIME_OFFSET_HOUR && t.digits < 2) {
+      t.offsetHour = t.offsetHour * 10 + d;
+    } else if (t.part == TIME_OFFSET_MINUTE && t.digits < 2) {
+      t.offsetMinute = t.offsetMinute * 10 + d;
+    } else {
+      t.invalid = true;
+    }
+    t.digits++;
+    return;
+  }
+  bool complete = t.part == TIME_FRACTION ? t.digits > 0 : (t.part < TIME_FRACTION && t.digits == DIGITS[t.part]);
+  if (t.part < TIME_SECOND && complete && (c == SEPARATORS[t.part] || (t.part == TIME_DAY && c == 't'))) {
+    t.part++;
+  } else if (t.part == TIME_SECOND && complete && c == '.') {
+    t.part = TIME_FRACTION;
+  } else if ((t.part == TIME_SECOND || t.part == TIME_FRACTION) && complete && (c == 'Z' || c == 'z')) {
+    t.part = TIME_END;
+  } else if ((t.part == TIME_SECOND || t.part == TIME_FRACTION) && complete && (c == '+' || c == '-')) {
+    t.offsetSign = c == '-' ? -1 : 1;
+    t.part = TIME_OFFSET_HOUR;
+  } else if (t.part == TIME_OFFSET_HOUR && t.digits == 2 && c == ':') {
+    t.part = TIME_OFFSET_MINUTE;
+  } else {
+    t.invalid = true;
+  }
+  t.digits = 0;
+}
+
+inline bool timeValid(const TimeParser &t) {
+  if (t.invalid) return false;
+  bool ended = t.part == TIME_END || (t.part == TIME_OFFSET_MINUTE && t.digits == 2);
+  return ended && t.value[TIME_MONTH] >= 1 && t.value[TIME_MONTH] <= 12 && t.value[TIME_DAY] >= 1 &&
+         t.value[TIME_DAY] <= 31 && t.value[TIME_HOUR] < 24 && t.value[TIME_MINUTE] < 60 &&
+         t.value[TIME_SECOND] <= 60;
+}
+
+// Días desde 1970-01-01 del calendario gregoriano proléptico
+inline int64_t daysFromCivil(int32_t y, uint32_t m, uint32_t d) {
+  y -= m <= 2;
+  int32_t era = (y >= 0 ? y : y - 399) / 400;
+  uint32_t yoe = (uint32_t)(y - era * 400);
+  uint32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return (int64_t)era * 146097 + (int64_t)doe - 719468;
+}
+
+inline int64_t timeValueNs(const TimeParser &t) {
+  int64_t seconds = daysFromCivil(t.value[TIME_YEAR], t.value[TIME_MONTH], t.value[TIME_DAY]) * 86400 +
+                    t.value[TIME_HOUR] * 3600 + t.value[TIME_MINUTE] * 60 + t.value[TIME_SECOND];
+  seconds -= (int64_t)t.offsetSign * (t.offsetHour * 3600 + t.offsetMinute * 60);
+  uint32_t nanos = t.nanos;
+  for (uint8_t i = t.fractionDigits; i < 9; i++) nanos *= 10;
+  return seconds * 1000000000LL + nanos;
+}
+
+// ===============================================
+// PARSER
+// ===============================================
+
+enum InfluxParserState {
+  INFLUX_STATUS,          // Línea de estado HTTP
+  INFLUX_HEADER_NAME,
+  INFLUX_HEADER_VALUE,
+  INFLUX_CHUNK_SIZE,      // Tamaño del trozo (hexadecimal)
+  INFLUX_CHUNK_EXT,       // Resto de la línea de tamaño
+  INFLUX_CHUNK_DATA,
+  INFLUX_CHUNK_END,       // CRLF tras los datos del trozo
+  INFLUX_TRAILER,         // Cabeceras tras el trozo de tamaño 0
+  INFLUX_BODY,            // Cuerpo sin trozos
+  INFLUX_DONE,
+  INFLUX_ERROR
+};
+
+enum InfluxCsvLine {
+  CSV_LINE_START,
+  CSV_LINE_ANNOTATION,
+  CSV_LINE_HEADER,
+  CSV_LINE_ROW
+};
+
+enum InfluxColumn {
+  INFLUX_COL_VALUE,
+  INFLUX_COL_FIELD,
+  INFLUX_COL_TIME,
+  INFLUX_COL_COUNT
+};
+
+const char* const INFLUX_COLUMN_NAMES[INFLUX_COL_COUNT] = {"_value", "_field", "_time"};
+
+enum InfluxHeader {
+  HEADER_CONTENT_LENGTH,
+  HEADER_TRANSFER_ENCODING,
+  HEADER_CONNECTION,
+  HEADER_COUNT
+};
+
+const char* const INFLUX_HEADER_NAMES[HEADER_COUNT] = {"content-length", "transfer-encoding", "connection"};
+
+struct InfluxCsvParser {
+  InfluxParserState state;
+
+  // HTTP
+  uint16_t status;               // Código de la línea de estado
+  uint8_t statusSpaces;
+  bool lineEmpty;                // Nada leído aún en la línea actual
+  TokenMatcher header;
+  int8_t headerId;
+  bool chunked;
+  bool hasLength;
+  bool closeConnection;          // Connection: close
+  uint8_t valuePos;              // Coincidencia parcial de "chunked" o "close"
+  uint32_t remaining;            // Bytes del trozo o del cuerpo por leer
+  bool sizeDigits;
+
+  // CSV
+  InfluxCsvLine line;
+  bool expectHeader;             // La próxima línea es la cabecera de una tabla
+  bool inQuotes;
+  bool quoteClosed;
+  uint16_t column;
+  int16_t columnIndex[INFLUX_COL_COUNT];
+  TokenMatcher cell;
+  NumberParser number;
+  TimeParser time;
+  int8_t rowField;
+  bool rowValueValid;
+  bool rowTimeValid;
+  double rowValue;
+  int64_t rowTimeNs;
+
+  // Resultado
+  float value[TREE_FIELD_COUNT];       // Último valor de cada campo
+  float firstValue[TREE_FIELD_COUNT];
+  float variation[TREE_FIELD_COUNT];   // Suma de |diferencias| entre puntos seguidos
+  uint16_t points[TREE_FIELD_COUNT];
+  uint8_t fieldMask;
+  int64_t latestTimeNs;                // _time más reciente (0 = ninguno)
+
+  // Estadísticas
+  uint32_t bytes;                // Bytes consumidos (cabeceras incluidas)
+  uint32_t bodyBytes;            // Bytes de CSV
+  uint32_t rows;
+  uint32_t tables;
+  uint32_t values;               // Filas con un _field conocido y _value numérico
+};
+
+void influxParserBegin(InfluxCsvParser &p) {
+  memset(&p, 0, sizeof(p));
+  p.state = INFLUX_STATUS;
+  p.lineEmpty = true;
+  p.expectHeader = true;
+  p.line = CSV_LINE_START;
+  for (uint8_t c = 0; c < INFLUX_COL_COUNT; c++) p.columnIndex[c] = -1;
+}
+
+inline bool influxParserDone(const InfluxCsvParser &p) {
+  return p.state == INFLUX_DONE || p.state == INFLUX_ERROR;
+}
+
+// La conexión sirve para otra petición: respuesta completa con longitud
+// conocida (chunked o Content-Length) y sin Connection: close
+inline bool influxParserKeepAlive(const InfluxCsvParser &p) {
+  return p.state == INFLUX_DONE && !p.closeConnection && (p.chunked || p.hasLength);
+}
+
+// ===============================================
+// CSV
+// ===============================================
+
+inline void influxCellBegin(InfluxCsvParser &p) {
+  if (p.line == CSV_LINE_HEADER) {
+    tokenBegin(p.cell, INFLUX_COL_COUNT);
+  } else if (p.column == p.columnIndex[INFLUX_COL_VALUE]) {
+    numberBegin(p.number);
+  } else if (p.column == p.columnIndex[INFLUX_COL_FIELD]) {
+    tokenBegin(p.cell, TREE_FIELD_COUNT);
+  } else if (p.column == p.columnIndex[INFLUX_COL_TIME]) {
+    timeBegin(p.time);
+  }
+}
+
+inline void influxCellFeed(InfluxCsvParser &p, char c) {
+  if (p.line == CSV_LINE_HEADER) {
+    tokenFeed(p.cell, INFLUX_COLUMN_NAMES, INFLUX_COL_COUNT, c, false);
+  } else if (p.column == p.columnIndex[INFLUX_COL_VALUE]) {
+    numberFeed(p.number, c);
+  } else if (p.column == p.columnIndex[INFLUX_COL_FIELD]) {
+    tokenFeed(p.cell, TREE_FIELD_NAMES, TREE_FIELD_COUNT, c, false);
+  } else if (p.column == p.columnIndex[INFLUX_COL_TIME]) {
+    timeFeed(p.time, c);
+  }
+}
+
+inline void influxCellEnd(InfluxCsvParser &p) {
+  if (p.line == CSV_LINE_HEADER) {
+    int id = tokenResult(p.cell, INFLUX_COLUMN_NAMES, INFLUX_COL_COUNT);
+    if (id >= 0) p.columnIndex[id] = p.column;
+  } else if (p.column == p.columnIndex[INFLUX_COL_VALUE]) {
+    p.rowValueValid = numberValid(p.number);
+    if (p.rowValueValid) p.rowValue = numberValue(p.number);
+  } else if (p.column == p.columnIndex[INFLUX_COL_FIELD]) {
+    p.rowField = (int8_t)tokenResult(p.cell, TREE_FIELD_NAMES, TREE_FIELD_COUNT);
+  } else if (p.column == p.columnIndex[INFLUX_COL_TIME]) {
+    p.rowTimeValid = timeValid(p.time);
+    if (p.rowTimeValid) p.rowTimeNs = timeValueNs(p.time);
+  }
+}
+
+inline void influxLineEnd(InfluxCsvParser &p) {
+  if (p.line == CSV_LINE_ROW) {
+    p.rows++;
+    if (p.rowField >= 0 && p.rowValueValid) {
+      float v = (float)p.rowValue;
+      uint8_t f = (uint8_t)p.rowField;
+      if (p.fieldMask & (1u << f)) {
+        p.variation[f] += v > p.value[f] ? v - p.value[f] : p.value[f] - v;
+      } else {
+        p.firstValue[f] = v;
+      }
+      p.value[f] = v;
+      if (p.points[f] < 0xFFFF) p.points[f]++;
+      p.fieldMask |= 1u << f;
+      p.values++;
+      if (p.rowTimeValid && p.rowTimeNs > p.latestTimeNs) p.latestTimeNs = p.rowTimeNs;
+    }
+  }
+  p.line = CSV_LINE_START;
+}
+
+void influxCsvByte(InfluxCsvParser &p, char c) {
+  p.bodyBytes++;
+  if (p.line == CSV_LINE_ANNOTATION) {
+    if (c == '\n') p.line = CSV_LINE_START;
+    return;
+  }
+  if (c == '\r' && !p.inQuotes) return;
+
+  if (p.line == CSV_LINE_START) {
+    if (c == '\n') {
+      // Línea en blanco: empieza otra tabla con su propia cabecera
+      p.expectHeader = true;
+      return;
+    }
+    if (c == '#') {
+      p.line = CSV_LINE_ANNOTATION;
+      return;
+    }
+    if (p.expectHeader) {
+      p.line = CSV_LINE_HEADER;
+      p.expectHeader = false;
+      p.tables++;
+      for (uint8_t col = 0; col < INFLUX_COL_COUNT; col++) p.columnIndex[col] = -1;
+    } else {
+      p.line = CSV_LINE_ROW;
+      p.rowField = -1;
+      p.rowValueValid = false;
+      p.rowTimeValid = false;
+    }
+    p.column = 0;
+    p.inQuotes = false;
+    p.quoteClosed = false;
+    influxCellBegin(p);
+  }
+
+  // Celdas entre comillas: "" dentro de ellas es una comilla literal
+  if (p.inQuotes) {
+    if (c == '"') {
+      p.inQuotes = false;
+      p.quoteClosed = true;
+    } else {
+      influxCellFeed(p, c);
+    }
+    return;
+  }
+  if (c == '"') {
+    if (p.quoteClosed) {
+      influxCellFeed(p, '"');
+      p.inQuotes = true;
+      p.quoteClosed = false;
+      return;
+    }
+    p.inQuotes = true;
+    return;
+  }
+  p.quoteClosed = false;
+
+  if (c == ',') {
+    influxCellEnd(p);
+    if (p.column < 0xFFFF) p.column++;
+    influxCellBegin(p);
+  } else if (c == '\n') {
+    influxCellEnd(p);
+    influxLineEnd(p);
+  } else {
+    influxCellFeed(p, c);
+  }
+}
+
+// Tramo de CSV: las anotaciones y las celdas que no interesan se saltan
+// buscando solo el siguiente separador
+void influxCsvRun(InfluxCsvParser &p, const char *data, size_t len) {
+  size_t i = 0;
+  while (i < len) {
+    size_t k = i;
+    if (p.line == CSV_LINE_ANNOTATION) {
+      while (k < len && data[k] != '\n') k++;
+    } else if (p.line == CSV_LINE_ROW && !p.inQuotes && !p.quoteClosed &&
+               p.column != p.columnIndex[INFLUX_COL_VALUE] && p.column != p.columnIndex[INFLUX_COL_FIELD] &&
+               p.column != p.columnIndex[INFLUX_COL_TIME]) {
+      while (k < len && data[k] != ',' && data[k] != '\n' && data[k] != '"') k++;
+    }
+    p.bodyBytes += k - i;
+    i = k;
+    if (i < len) influxCsvByte(p, data[i++]);
+  }
+}
+
+// ===============================================
+// HTTP
+// ===============================================
+
+inline int hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  c = asciiLower(c);
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+// Fin de las cabeceras: decide cómo viene el cuerpo
+inline void influxHeadersEnd(InfluxCsvParser &p) {
+  if (p.chunked) {
+    p.state = INFLUX_CHUNK_SIZE;
+    p.remaining = 0;
+    p.sizeDigits = false;
+  } else if (p.hasLength && p.remaining == 0) {
+    p.state = INFLUX_DONE;
+  } else {
+    p.state = INFLUX_BODY;
+  }
+}
+
+void influxHttpByte(InfluxCsvParser &p, char c) {
+  switch (p.state) {
+    case INFLUX_STATUS:
+      // "HTTP/1.1 200 OK": el código va tras el primer espacio
+      if (c == '\n') {
+        p.state = p.status ? INFLUX_HEADER_NAME : INFLUX_ERROR;
+        p.lineEmpty = true;
+        tokenBegin(p.header, HEADER_COUNT);
+      } else if (c == ' ') {
+        p.statusSpaces++;
+      } else if (p.statusSpaces == 1 && c >= '0' && c <= '9' && p.status < 1000) {
+        p.status = p.status * 10 + (c - '0');
+      }
+      break;
+
+    case INFLUX_HEADER_NAME:
+      if (c == '\r') break;
+      if (c == '\n') {
+        if (p.lineEmpty) {
+          influxHeadersEnd(p);
+        } else {
+          tokenBegin(p.header, HEADER_COUNT);
+          p.lineEmpty = true;
+        }
+      } else if (c == ':') {
+        p.headerId = (int8_t)tokenResult(p.header, INFLUX_HEADER_NAMES, HEADER_COUNT);
+        p.valuePos = 0;
+        if (p.headerId == HEADER_CONTENT_LENGTH) {
+          p.hasLength = true;
+          p.remaining = 0;
+        }
+        p.state = INFLUX_HEADER_VALUE;
+      } else {
+        tokenFeed(p.header, INFLUX_HEADER_NAMES, HEADER_COUNT, c, true);
+        p.lineEmpty = false;
+      }
+      break;
+
+    case INFLUX_HEADER_VALUE:
+      if (c == '\n') {
+        p.state = INFLUX_HEADER_NAME;
+        p.lineEmpty = true;
+        tokenBegin(p.header, HEADER_COUNT);
+      } else if (p.headerId == HEADER_CONTENT_LENGTH && c >= '0' && c <= '9') {
+        p.remaining = p.remaining * 10 + (c - '0');
+      } else if ((p.headerId == HEADER_TRANSFER_ENCODING && !p.chunked) ||
+                 (p.headerId == HEADER_CONNECTION && !p.closeConnection)) {
+        const char *token = p.headerId == HEADER_CONNECTION ? "close" : "chunked";
+        c = asciiLower(c);
+        if (c == token[p.valuePos]) {
+          p.valuePos++;
+        } else {
+          p.valuePos = c == token[0] ? 1 : 0;
+        }
+        if (token[p.valuePos] == '\0') {
+          if (p.headerId == HEADER_CONNECTION) {
+            p.closeConnection = true;
+          } else {
+            p.chunked = true;
+          }
+        }
+      }
+      break;
+
+    case INFLUX_CHUNK_SIZE: {
+      int d = hexDigit(c);
+      if (d >= 0) {
+        if (p.remaining > 0x0FFFFFFF) {
+          p.state = INFLUX_ERROR;
+        } else {
+          p.remaining = (p.remaining << 4) | d;
+          p.sizeDigits = true;
+        }
+      } else if (!p.sizeDigits) {
+        p.state = INFLUX_ERROR;
+      } else if (c == '\n') {
+        p.state = p.remaining ? INFLUX_CHUNK_DATA : INFLUX_TRAILER;
+        p.lineEmpty = true;
+      } else {
+        p.state = INFLUX_CHUNK_EXT;
+      }
+      break;
+    }
+
+    case INFLUX_CHUNK_EXT:
+      if (c == '\n') {
+        p.state = p.remaining ? INFLUX_CHUNK_DATA : INFLUX_TRAILER;
+        p.lineEmpty = true;
+      }
+      break;
+
+    case INFLUX_CHUNK_END:
+      if (c == '\n') {
+        p.state = INFLUX_CHUNK_SIZE;
+        p.remaining = 0;
+        p.sizeDigits = false;
+      } else if (c != '\r') {
+        p.state = INFLUX_ERROR;
+      }
+      break;
+
+    case INFLUX_TRAILER:
+      if (c == '\r') break;
+      if (c == '\n') {
+        if (p.lineEmpty) p.state = INFLUX_DONE;
+        p.lineEmpty = true;
+      } else {
+        p.lineEmpty = false;
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+// Consume len bytes de la respuesta. Se puede llamar con trozos de
+// cualquier tamaño; devuelve false si la respuesta está mal formada
+bool influxParserFeed(InfluxCsvParser &p, const uint8_t *data, size_t len) {
+  size_t i = 0;
+  while (i < len && !influxParserDone(p)) {
+    if (p.state == INFLUX_CHUNK_DATA || (p.state == INFLUX_BODY && p.hasLength)) {
+      // Tramo de cuerpo con longitud conocida: bucle directo sobre el CSV
+      size_t run = len - i;
+      if (run > p.remaining) run = p.remaining;
+      if (p.status == 200) influxCsvRun(p, (const char *)data + i, run);
+      i += run;
+      p.remaining -= run;
+      if (p.remaining == 0) {
+        p.state = p.state == INFLUX_CHUNK_DATA ? INFLUX_CHUNK_END : INFLUX_DONE;
+      }
+    } else if (p.state == INFLUX_BODY) {
+      // Sin longitud: el cuerpo acaba al cerrar la conexión
+      if (p.status == 200) influxCsvRun(p, (const char *)data + i, len - i);
+      i = len;
+    } else {
+      influxHttpByte(p, (char)data[i++]);
+    }
+  }
+  p.bytes += i;
+  return p.state != INFLUX_ERROR;
+}
+
+// Respuesta completa y con estado 200, tenga o no filas
+inline bool influxParserComplete(const InfluxCsvParser &p) {
+  return p.state == INFLUX_DONE && p.status == 200;
+}
+
+// Cierra la respuesta (conexión terminada o cuerpo completo) y copia los
+// campos leídos en data. Devuelve true si la respuesta estaba completa,
+// con estado 200 y al menos un valor; si no, data no cambia
+bool influxParserFinish(InfluxCsvParser &p, TreeData &data, unsigned long now) {
+  // Sin longitud, el cuerpo termina al cerrar la conexión
+  if (p.state == INFLUX_BODY && !p.hasLength) p.state = INFLUX_DONE;
+  if (p.state == INFLUX_DONE && (p.line == CSV_LINE_HEADER || p.line == CSV_LINE_ROW)) {
+    // Última fila sin salto de línea final
+    influxCellEnd(p);
+    influxLineEnd(p);
+  }
+  if (!influxParserComplete(p) || !p.fieldMask) return false;
+
+  for (uint8_t f = 0; f < TREE_FIELD_COUNT; f++) {
+    if (p.fieldMask & (1u << f)) treeDataSet(data, (TreeField)f, p.value[f]);
+  }
+  data.timestamp = now;
+  data.data_valid = true;
+  return true;
+}
+
+#endif // PIEZOBUGS_INFLUX_CSV_H
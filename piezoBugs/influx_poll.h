@@ -0,0 +1,136 @@
+/*
+ * influx_poll.h - Consultas incrementales a InfluxDB con intervalo adaptativo
+ *
+ * En vez de pedir cada 10 s la última hora con last(), se recuerda el
+ * _time más reciente recibido (marca de agua) y cada consulta pide solo
+ * los puntos posteriores. La primera, sin marca de agua, sigue siendo
+ * last() de la última hora. keep() deja solo las columnas que se leen.
+ *
+ * El intervalo entre consultas sigue a bioelectrical_activity: su
+ * variación por minuto (suma de |diferencias| entre puntos seguidos,
+ * enlazando con el último punto de la consulta anterior):
+ * - Sin puntos nuevos o por debajo de POLL_FLAT_RATE: x1,5 hasta POLL_MAX_MS
+ * - Por encima de POLL_VOLATILE_RATE: a la mitad hasta POLL_MIN_MS
+ * - Entre ambos umbrales se mantiene
+ */
+
+#ifndef PIEZOBUGS_INFLUX_POLL_H
+#define PIEZOBUGS_INFLUX_POLL_H
+
+#include <stdio.h>
+#include "influx_client.h"
+
+// ===============================================
+// CONFIGURACIÓN
+// ===============================================
+
+const uint32_t POLL_MIN_MS = 5000;
+const uint32_t POLL_START_MS = 10000;      // El QUERY_INTERVAL de antes
+const uint32_t POLL_MAX_MS = 120000;
+const uint16_t POLL_TAIL_POINTS = 60;      // Puntos máximos por campo y consulta
+const uint16_t INFLUX_QUERY_MAX = 256;
+
+// Variación de bioelectrical_activity por minuto, en sus unidades
+const float POLL_FLAT_RATE = 0.0002f;
+const float POLL_VOLATILE_RATE = 0.001f;
+const TreeField POLL_FIELD = TREE_BIOELECTRICAL_ACTIVITY;
+
+// ===============================================
+// ESTADO
+// ===============================================
+
+struct InfluxPoller {
+  const char *bucket;
+  char query[INFLUX_QUERY_MAX];
+  int64_t watermarkNs;           // _time más reciente recibido (0 = ninguno)
+  uint32_t intervalMs;
+  uint32_t lastPollMs;
+  uint32_t lastDataMs;           // Última consulta con puntos de POLL_FIELD
+  bool hasData;
+  float lastValue;               // Último punto de POLL_FIELD
+  float lastRate;                // Variación por minuto medida en la última consulta
+
+  // Estadísticas
+  uint32_t polls;
+  uint32_t emptyPolls;           // Respuestas completas sin puntos nuevos
+  uint32_t backoffs;
+  uint32_t speedups;
+};
+
+void influxPollerBegin(InfluxPoller &p, const char *bucket) {
+  memset(&p, 0, sizeof(p));
+  p.bucket = bucket;
+  p.intervalMs = POLL_START_MS;
+}
+
+inline bool influxPollerDue(const InfluxPoller &p, uint32_t now) {
+  return p.polls == 0 || now - p.lastPollMs >= p.intervalMs;
+}
+
+// Consulta Flux para la próxima petición
+const char *influxPollerQuery(InfluxPoller &p) {
+  if (p.watermarkNs == 0) {
+    snprintf(p.query, sizeof(p.query),
+             "from(bucket: \"%s\") |> range(start: -1h) |> last()"
+             " |> keep(columns: [\"_time\", \"_value\", \"_field\"])",
+             p.bucket);
+  } else {
+    // range() incluye su inicio: 1 ns después del último punto recibido
+    snprintf(p.query, sizeof(p.query),
+             "from(bucket: \"%s\") |> range(start: time(v: %lld)) |> tail(n: %u)"
+             " |> keep(columns: [\"_time\", \"_value\", \"_field\"])",
+             p.bucket, (long long)(p.watermarkNs + 1), (unsigned)POLL_TAIL_POINTS);
+  }
+  return p.query;
+}
+
+inline void pollerSlowDown(InfluxPoller &p) {
+  uint32_t next = p.intervalMs + p.intervalMs / 2;
+  p.intervalMs = next > POLL_MAX_MS ? POLL_MAX_MS : next;
+  p.backoffs++;
+}
+
+inline void pollerSpeedUp(InfluxPoller &p) {
+  uint32_t next = p.intervalMs / 2;
+  p.intervalMs = next < POLL_MIN_MS ? POLL_MIN_MS : next;
+  p.speedups++;
+}
+
+// Tras cada consulta: avanza la marca de agua y ajusta el intervalo. Una
+// consulta fallida no cambia ni la marca ni el intervalo
+void influxPollerUpdate(InfluxPoller &p, const InfluxCsvParser &parser, uint32_t now) {
+  p.polls++;
+  p.lastPollMs = now;
+  if (!influxParserComplete(parser)) return;
+  if (parser.latestTimeNs > p.watermarkNs) p.watermarkNs = parser.latestTimeNs;
+
+  if (!parser.points[POLL_FIELD]) {
+    p.emptyPolls++;
+    pollerSlowDown(p);
+    return;
+  }
+  if (p.hasData && now != p.lastDataMs) {
+    float change = parser.variation[POLL_FIELD];
+    float step = parser.firstValue[POLL_FIELD] - p.lastValue;
+    change += step < 0 ? -step : step;
+    p.lastRate = change * 60000.0f / (float)(now - p.lastDataMs);
+    if (p.lastRate >= POLL_VOLATILE_RATE) {
+      pollerSpeedUp(p);
+    } else if (p.lastRate <= POLL_FLAT_RATE) {
+      pollerSlowDown(p);
+    }
+  }
+  p.hasData = true;
+  p.lastValue = parser.value[POLL_FIELD];
+  p.lastDataMs = now;
+}
+
+// Consulta incremental completa; devuelve true si data recibió valores
+bool influxPollerFetch(InfluxPoller &p, InfluxClient &client, TreeData &data) {
+  if (!influxClientSetQuery(client, influxPollerQuery(p))) return false;
+  bool updated = influxClientQuery(client, data);
+  influxPollerUpdate(p, client.parser, hal::millis());
+  return updated;
+}
+
+#endif // PIEZOBUGS_INFLUX_POLL_H
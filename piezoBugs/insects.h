@@ -0,0 +1,149 @@
+/*
+ * insects.h - Comportamiento de los tipos de insecto de PiezoBugs
+ *
+ * Tipos de insecto, intervalos y duraciones. Las secuencias se generan en
+ * sequences.h y la escala y las notas están en tuning.h. Funciones puras
+ * por tipo: el estado de cada voz vive en voices.h. Todo el acceso al
+ * hardware pasa por hal.h, así que este módulo compila igual en el ESP32 y
+ * en el build nativo.
+ */
+
+#ifndef PIEZOBUGS_INSECTS_H
+#define PIEZOBUGS_INSECTS_H
+
+#include <stdlib.h>
+#include "hal.h"
+#include "config.h"
+#include "tuning.h"
+#include "param_bus.h"
+#include "log.h"
+
+// Tipos de insectos disponibles
+enum InsectType {
+  SPIDER = 0,    // Araña (octavas 5, 6, 7, 8)
+  CRICKET = 1,   // Grillo (octavas 2, 3, 4)
+  BEETLE = 2     // Escarabajo (octavas 2, 3, 4 - solo Si)
+  // BUMBLEBEE = 3  // Abejorro (octavas 2, 3 - melodías largas) - DESACTIVADO
+};
+
+const uint8_t INSECT_TYPE_COUNT = 3;
+static_assert(INSECT_TYPE_NAME_COUNT == INSECT_TYPE_COUNT, "Un nombre por tipo de insecto (log.h)");
+
+// Longitud máxima de secuencia por tipo (la araña usa hasta 16 notas)
+const uint8_t MAX_SEQUENCE_LENGTH = 16;
+
+// Estados del sistema
+enum SystemState {
+  SOUND_OFF = 0,    // Sonido desactivado
+  FREQ_NORMAL = 1,  // Frecuencia normal (parámetros por defecto)
+  FREQ_SLOW = 2,    // Frecuencia lenta (tiempos x3)
+  FREQ_VERY_SLOW = 3, // Frecuencia muy lenta (tiempos x5)
+  FREQ_EXTREMELY_SLOW = 4 // Frecuencia extremadamente lenta (tiempos x7)
+};
+
+SystemState currentState = FREQ_NORMAL;
+
+// Variables para cambio de nota raíz
+int rootNoteOffset = 0; // Offset en semitonos desde Do (0 = Do, 1 = Do#, 2 = Re, etc.)
+
+// Escala de las secuencias (ver tuning.h)
+ScaleId currentScale = SCALE_INSECT_PENTATONIC;
+
+// Prototipos
+const char* getInsectTypeName(InsectType type);
+
+// Longitud máxima de secuencia según el tipo
+inline uint8_t getMaxSequenceLength(InsectType type) {
+  return (type == SPIDER) ? 16 : 8;
+}
+
+int getFrequencyMultiplier() {
+  switch (currentState) {
+    case FREQ_NORMAL:
+      return 1;
+    case FREQ_SLOW:
+      return 3;
+    case FREQ_VERY_SLOW:
+      return 5;
+    case FREQ_EXTREMELY_SLOW:
+      return 7;
+    default:
+      return 1;
+  }
+}
+
+const char* getInsectTypeName(InsectType type) {
+  // Nombres en INSECT_TYPE_NAMES (log.h), también para los registros
+  if (type >= 0 && type < INSECT_TYPE_COUNT) return INSECT_TYPE_NAMES[type];
+  LOG(LOG_UNKNOWN_TYPE, (int)type);
+  return "Desconocido";
+}
+
+// Funciones para intervalos según el tipo de insecto
+unsigned long getInsectNoteInterval(InsectType type) {
+  unsigned long interval;
+  switch (type) {
+    case SPIDER:
+      interval = hal::random(20, 210); // Entre 20ms y 260ms
+      break;
+    case CRICKET:
+      interval = hal::random(80, 250); // Entre 80ms y 200ms
+      break;
+    case BEETLE:
+      interval = hal::random(60, 300); // Entre 60ms y 300ms
+      break;
+    // case BUMBLEBEE:
+    //   interval = hal::random(200, 500); // Entre 200ms y 500ms (más lento)
+    //   break;
+    default:
+      interval = 100;
+  }
+  // Ritmo de los datos del árbol (1 = sin cambios)
+  return paramScaleInterval(interval, PARAM_NOTE_RATE);
+}
+
+unsigned long getInsectSequenceInterval(InsectType type) {
+  int multiplier = getFrequencyMultiplier();
+  unsigned long interval;
+  switch (type) {
+    case SPIDER:
+      interval = hal::random(2000, 8000) * multiplier; // Entre 2-8 segundos
+      break;
+    case CRICKET:
+      interval = hal::random(1500, 2000) * multiplier; // Entre 1.5-2 segundos
+      break;
+    case BEETLE:
+      interval = hal::random(5000, 12000) * multiplier; // Entre 5-30 segundos (reducido)
+      break;
+    // case BUMBLEBEE:
+    //   interval = hal::random(5000, 18000) * multiplier; // Entre 3-22 segundos
+    //   break;
+    default:
+      interval = 5000 * multiplier;
+  }
+  // Densidad de los datos del árbol: más densidad, pausas más cortas
+  return paramScaleInterval(interval, PARAM_DENSITY);
+}
+
+int getInsectDuration(InsectType type) {
+  switch (type) {
+    case SPIDER:
+      return hal::random(50, 150); // Entre 50ms y 150ms
+    case CRICKET:
+      return hal::random(60, 180); // Entre 60ms y 180ms
+    case BEETLE:
+      return hal::random(18, 40);  // Entre 18ms y 40ms
+    // case BUMBLEBEE:
+    //   return hal::random(4000, 7000); // Entre 4-7 segundos (melodías largas)
+    default:
+      return 100;
+  }
+}
+
+// Intervalo hasta el próximo cambio de secuencia (30-58 s por el multiplicador)
+unsigned long getSequenceChangeInterval() {
+  unsigned long baseInterval = hal::random(30000, 58000);
+  return baseInterval * getFrequencyMultiplier();
+}
+
+#endif // PIEZOBUGS_INSECTS_H
@@ -0,0 +1,200 @@
+/*
+ * led_compositor.h - Compositor de capas para los aros Neopixel
+ *
+ * Cada efecto es una capa independiente que pinta un aro en píxeles 8.8
+ * con alfa; el compositor las apila en orden con su modo de mezcla. Solo
+ * se evalúan las capas activas. Además limita los frames por segundo y
+ * el tiempo por frame: cuando el presupuesto en us se agota, las capas
+ * opcionales que quedan se saltan ese frame (la capa 0, la base, siempre
+ * se pinta). El coste de cada capa se mide con hal::micros().
+ */
+
+#ifndef PIEZOBUGS_LED_COMPOSITOR_H
+#define PIEZOBUGS_LED_COMPOSITOR_H
+
+#include <string.h>
+#include "hal.h"
+#include "config.h"
+
+const uint8_t LED_MAX_LAYERS = 8;
+
+// Canales en 8.8 (0..65535 = 0..255,996) y alfa en Q16 (65535 = opaco)
+struct LedPixel {
+  uint16_t r;
+  uint16_t g;
+  uint16_t b;
+  uint16_t a;
+};
+
+enum LedBlendMode {
+  BLEND_NORMAL,     // Cubre la capa de abajo según el alfa
+  BLEND_ADD,        // Suma con saturación (destellos)
+  BLEND_MAX,        // Se queda con el canal más brillante
+  BLEND_MULTIPLY    // Tiñe: multiplica la capa de abajo por el color
+};
+
+// Pinta un aro en out[NEOPIXEL_COUNT] (llega transparente). ringTime es
+// el tiempo del efecto con el desfase del aro ya aplicado
+typedef void (*LedLayerFunction)(uint8_t ring, unsigned long ringTime, LedPixel *out);
+
+struct LedCompositor {
+  // Capas (índice = orden de apilado, 0 = base)
+  LedLayerFunction render[LED_MAX_LAYERS];
+  const char* name[LED_MAX_LAYERS];
+  LedBlendMode blend[LED_MAX_LAYERS];
+  uint8_t opacity[LED_MAX_LAYERS];      // 0-255
+  bool active[LED_MAX_LAYERS];
+  uint8_t layerCount;
+
+  // Límites
+  uint32_t minFrameUs;                  // 0 = sin límite de fps (ya descontado el margen)
+  uint32_t budgetUs;                    // Tiempo máximo de capas por frame
+  uint32_t lastFrameAt;                 // micros() del último frame compuesto
+  bool started;
+
+  // Coste por capa (us)
+  uint32_t lastUs[LED_MAX_LAYERS];
+  uint32_t maxUs[LED_MAX_LAYERS];
+  uint64_t totalUs[LED_MAX_LAYERS];
+  uint32_t runs[LED_MAX_LAYERS];
+  uint32_t budgetSkips[LED_MAX_LAYERS]; // Veces saltada por falta de presupuesto
+
+  // Estadísticas
+  uint32_t frames;                      // Frames compuestos
+  uint32_t rateSkips;                   // Llamadas antes de tiempo (límite de fps)
+  uint32_t overBudgetFrames;            // Frames que agotaron el presupuesto
+  uint32_t overBudgetMark;              // Último frame contado en overBudgetFrames
+};
+
+LedCompositor ledCompositor;
+
+// ===============================================
+// CONFIGURACIÓN
+// ===============================================
+
+void ledCompositorSetMaxFps(uint16_t fps) {
+  uint32_t periodUs = fps ? 1000000UL / fps : 0;
+  ledCompositor.minFrameUs = periodUs > NEO_FRAME_JITTER_US ? periodUs - NEO_FRAME_JITTER_US : periodUs;
+}
+
+void ledCompositorClear() {
+  memset(&ledCompositor, 0, sizeof(ledCompositor));
+  ledCompositorSetMaxFps(NEO_MAX_FPS);
+  ledCompositor.budgetUs = NEO_FRAME_BUDGET_US;
+}
+
+// Añade una capa encima de las existentes; devuelve su índice o -1
+int ledLayerAdd(const char* name, LedLayerFunction render, LedBlendMode blend, uint8_t opacity = 255) {
+  if (ledCompositor.layerCount >= LED_MAX_LAYERS) return -1;
+  uint8_t id = ledCompositor.layerCount++;
+  ledCompositor.render[id] = render;
+  ledCompositor.name[id] = name;
+  ledCompositor.blend[id] = blend;
+  ledCompositor.opacity[id] = opacity;
+  ledCompositor.active[id] = true;
+  return id;
+}
+
+void ledLayerSetActive(int id, bool active) {
+  if (id >= 0 && id < ledCompositor.layerCount) ledCompositor.active[id] = active;
+}
+
+void ledLayerSetOpacity(int id, uint8_t opacity) {
+  if (id >= 0 && id < ledCompositor.layerCount) ledCompositor.opacity[id] = opacity;
+}
+
+// ===============================================
+// MEZCLA
+// ===============================================
+
+// a * b / 65535 con redondeo, para valores Q16
+inline uint16_t mulQ16(uint16_t a, uint16_t b) {
+  uint32_t p = (uint32_t)a * b + 32768;
+  return (uint16_t)((p + (p >> 16)) >> 16);
+}
+
+inline uint16_t blendChannel(LedBlendMode mode, uint16_t dst, uint16_t src, uint16_t alpha) {
+  switch (mode) {
+    case BLEND_ADD: {
+      uint32_t sum = (uint32_t)dst + mulQ16(src, alpha);
+      return sum > 65535 ? 65535 : (uint16_t)sum;
+    }
+    case BLEND_MAX: {
+      uint16_t lit = dst > src ? dst : src;
+      return dst + (int32_t)(lit - dst) * alpha / 65535;
+    }
+    case BLEND_MULTIPLY: {
+      uint16_t tinted = mulQ16(dst, src);
+      return dst - (int32_t)(dst - tinted) * alpha / 65535;
+    }
+    case BLEND_NORMAL:
+    default:
+      return (uint16_t)(dst + ((int32_t)src - dst) * alpha / 65535);
+  }
+}
+
+// Mezcla una capa sobre el resultado acumulado
+void ledBlendLayer(LedPixel *dst, const LedPixel *src, uint16_t count, LedBlendMode mode, uint8_t opacity) {
+  uint16_t layerAlpha = opacity * 257;
+  for (uint16_t i = 0; i < count; i++) {
+    uint16_t alpha = mulQ16(src[i].a, layerAlpha);
+    if (alpha == 0) continue;
+    dst[i].r = blendChannel(mode, dst[i].r, src[i].r, alpha);
+    dst[i].g = blendChannel(mode, dst[i].g, src[i].g, alpha);
+    dst[i].b = blendChannel(mode, dst[i].b, src[i].b, alpha);
+  }
+}
+
+// ===============================================
+// FRAME
+// ===============================================
+
+// true si ya toca otro frame según el límite de fps, con el margen de
+// NEO_FRAME_JITTER_US (y lo contabiliza)
+bool ledCompositorFrameDue(uint32_t nowUs) {
+  if (ledCompositor.started && ledCompositor.minFrameUs &&
+      (uint32_t)(nowUs - ledCompositor.lastFrameAt) < ledCompositor.minFrameUs) {
+    ledCompositor.rateSkips++;
+    return false;
+  }
+  ledCompositor.started = true;
+  ledCompositor.lastFrameAt = nowUs;
+  ledCompositor.frames++;
+  return true;
+}
+
+// Compone las capas activas de un aro en out[]. frameStartUs es el inicio
+// del frame: el presupuesto se comparte entre todos los aros
+void ledCompose(uint8_t ring, unsigned long ringTime, LedPixel *out, uint32_t frameStartUs) {
+  LedPixel layer[NEOPIXEL_COUNT];
+  memset(out, 0, sizeof(LedPixel) * NEOPIXEL_COUNT);
+  bool overBudget = false;
+
+  for (uint8_t id = 0; id < ledCompositor.layerCount; id++) {
+    if (!ledCompositor.active[id] || ledCompositor.opacity[id] == 0) continue;
+
+    uint32_t start = hal::micros();
+    if (id > 0 && (uint32_t)(start - frameStartUs) >= ledCompositor.budgetUs) {
+      ledCompositor.budgetSkips[id]++;
+      overBudget = true;
+      continue;
+    }
+
+    memset(layer, 0, sizeof(layer));
+    ledCompositor.render[id](ring, ringTime, layer);
+    ledBlendLayer(out, layer, NEOPIXEL_COUNT, ledCompositor.blend[id], ledCompositor.opacity[id]);
+
+    uint32_t cost = hal::micros() - start;
+    ledCompositor.lastUs[id] = cost;
+    if (cost > ledCompositor.maxUs[id]) ledCompositor.maxUs[id] = cost;
+    ledCompositor.totalUs[id] += cost;
+    ledCompositor.runs[id]++;
+  }
+
+  if (overBudget && ledCompositor.overBudgetMark != ledCompositor.frames) {
+    ledCompositor.overBudgetFrames++;
+    ledCompositor.overBudgetMark = ledCompositor.frames;
+  }
+}
+
+#endif // PIEZOBUGS_LED_COMPOSITOR_H
@@ -0,0 +1,269 @@
+/*
+ * log.h - Registro diferido en binario
+ *
+ * El código caliente (voces, botones) no formatea nada: LOG(id, args...)
+ * copia un registro de 16 bytes (ms, id del mensaje y hasta 5 argumentos
+ * enteros) en un anillo y vuelve. logDrain() lo vacía cuando el loop va a
+ * esperar, y solo lo que cabe en el buffer de la UART sin bloquear.
+ *
+ * Los textos viven en LOG_CATALOG con su nivel; los mensajes por encima de
+ * LOG_LEVEL (config.h) desaparecen al compilar. Por la consola sale cada
+ * registro tras un byte LOG_FRAME_START, mezclado con el texto normal, y
+ * tools/log_decode.py lo vuelve a convertir en los mensajes de siempre.
+ * Con LOG_DRAIN_TEXT el propio ESP32 formatea al vaciar (sigue fuera del
+ * código caliente) para leerlo en un monitor serie cualquiera.
+ *
+ * Formatos de los argumentos: %d entero, %t tipo de insecto, %r nota raíz
+ * (0-11), %n nota con octava (NoteIndex); %% es un % sin argumento.
+ */
+
+#ifndef PIEZOBUGS_LOG_H
+#define PIEZOBUGS_LOG_H
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include "hal.h"
+#include "config.h"
+#include "tuning.h"
+
+// ===============================================
+// CATÁLOGO DE MENSAJES
+// ===============================================
+
+// X(id, nivel, texto). Solo se añade al final: el id viaja en los registros
+#define LOG_CATALOG(X) \
+  X(LOG_DROPPED,            LOG_LEVEL_WARN,  "Log: %d mensajes perdidos") \
+  X(LOG_SEQUENCE_START,     LOG_LEVEL_DEBUG, "Insecto%d %t %r - %n (%d Hz)") \
+  X(LOG_BAD_SEQUENCE_INDEX, LOG_LEVEL_ERROR, "Error: Índice de secuencia %d inválido: %d (longitud: %d)") \
+  X(LOG_BAD_FREQUENCY,      LOG_LEVEL_ERROR, "Error: Frecuencia %d inválida: %d Hz, usando 440 Hz") \
+  X(LOG_CORRUPT_TYPE,       LOG_LEVEL_ERROR, "CRÍTICO: Tipo insecto%d corrupto: %d, reseteando sistema") \
+  X(LOG_CORRUPT_LENGTH,     LOG_LEVEL_ERROR, "CRÍTICO: Longitud secuencia%d corrupta: %d, reseteando") \
+  X(LOG_CORRUPT_INDEX,      LOG_LEVEL_ERROR, "CRÍTICO: Índice secuencia%d corrupto: %d, reseteando") \
+  X(LOG_TYPE_RESET,         LOG_LEVEL_ERROR, "Error: Tipo de insecto %d corrupto: %d, reseteando") \
+  X(LOG_TYPE_CHANGED,       LOG_LEVEL_INFO,  "Insecto %d cambió a %t") \
+  X(LOG_MUTED,              LOG_LEVEL_INFO,  "=== INSECTO %d MUTEADO ===") \
+  X(LOG_UNMUTED,            LOG_LEVEL_INFO,  "=== INSECTO %d ACTIVADO ===") \
+  X(LOG_FREQ_SLOW,          LOG_LEVEL_INFO,  "Estado: Frecuencia LENTA (x3)") \
+  X(LOG_FREQ_VERY_SLOW,     LOG_LEVEL_INFO,  "Estado: Frecuencia MUY LENTA (x5)") \
+  X(LOG_FREQ_EXTREMELY_SLOW, LOG_LEVEL_INFO, "Estado: Frecuencia EXTREMADAMENTE LENTA (x7)") \
+  X(LOG_FREQ_NORMAL,        LOG_LEVEL_INFO,  "Estado: Frecuencia NORMAL (x1)") \
+  X(LOG_ROOT_CHANGED,       LOG_LEVEL_INFO,  "Nota raíz cambiada a: %r") \
+  X(LOG_ROOT_RESET,         LOG_LEVEL_INFO,  "Nota raíz reseteada a: %r") \
+  X(LOG_DEFAULTS_RESET,     LOG_LEVEL_INFO,  "=== RESETEO A VALORES POR DEFECTO ===") \
+  X(LOG_DEFAULTS_DONE,      LOG_LEVEL_INFO,  "Sistema reseteado a valores por defecto") \
+  X(LOG_UNKNOWN_TYPE,       LOG_LEVEL_ERROR, "ERROR: Tipo de insecto desconocido: %d") \
+  X(LOG_BAD_GENERATE_TYPE,  LOG_LEVEL_ERROR, "Error: Tipo de insecto inválido al generar una secuencia: %d") \
+  X(LOG_BAD_LENGTH,         LOG_LEVEL_ERROR, "Error: Longitud de secuencia inválida para %t: %d (máximo %d), ajustando a 3") \
+  X(LOG_HEAP,               LOG_LEVEL_INFO,  "Memoria: %d KB libres, bloque mayor %d KB (%d%% fragmentado), mínimo %d KB, %d B desde el arranque") \
+  X(LOG_SAMPLE_BANK,        LOG_LEVEL_INFO,  "Banco de muestras: %d en flash (%d KB), %d en la SD") \
+  X(LOG_SAMPLE_BANK_INVALID, LOG_LEVEL_ERROR, "Error: Banco de muestras inválido (motivo %d, entrada %d)") \
+  X(LOG_SAMPLE_UNPLAYABLE,  LOG_LEVEL_ERROR, "Error: Muestra %d no reproducible: %d Hz, %d muestras") \
+  X(LOG_SAMPLE_LOAD_FAILED, LOG_LEVEL_ERROR, "Error: No se pudo cargar la muestra %d de la SD (motivo %d)") \
+  X(LOG_SAMPLE_CACHE,       LOG_LEVEL_INFO,  "Muestras: %d aciertos, %d fallos (%d%% aciertos), %d expulsiones, %d tarde")
+
+#define LOG_CATALOG_ID(id, level, text) id,
+#define LOG_CATALOG_LEVEL(id, level, text) level,
+#define LOG_CATALOG_TEXT(id, level, text) text,
+
+enum LogId : uint8_t {
+  LOG_CATALOG(LOG_CATALOG_ID)
+  LOG_ID_COUNT
+};
+
+const uint8_t LOG_LEVELS[LOG_ID_COUNT] = {LOG_CATALOG(LOG_CATALOG_LEVEL)};
+const char* const LOG_TEXTS[LOG_ID_COUNT] = {LOG_CATALOG(LOG_CATALOG_TEXT)};
+
+// Nombres de los tipos de insecto para %t (mismo orden que InsectType)
+const char* const INSECT_TYPE_NAMES[] = {"Araña", "Grillo", "Escarabajo"};
+const uint8_t INSECT_TYPE_NAME_COUNT = sizeof(INSECT_TYPE_NAMES) / sizeof(INSECT_TYPE_NAMES[0]);
+
+// ===============================================
+// REGISTROS Y ANILLO
+// ===============================================
+
+const uint8_t LOG_MAX_ARGS = 5;
+const uint8_t LOG_RING_SIZE = 64;          // Potencia de 2: 1 KB
+const uint8_t LOG_FRAME_START = 0x1E;      // Separador de registro (nunca aparece en el texto)
+
+struct LogRecord {
+  uint32_t ms;
+  uint8_t id;
+  uint8_t level;
+  int16_t args[LOG_MAX_ARGS];    // Los que no usa el mensaje van a 0
+};
+
+static_assert(sizeof(LogRecord) == 16, "Registro de 16 bytes");
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "El anillo debe ser potencia de 2");
+
+// Un productor (el loop) y un consumidor (logDrain, en el loop u otra tarea)
+struct LogRing {
+  LogRecord records[LOG_RING_SIZE];
+  std::atomic<uint32_t> head;    // Próximo a escribir; solo lo avanza el productor
+  std::atomic<uint32_t> tail;    // Próximo a vaciar; solo lo avanza el consumidor
+  uint16_t tailSent;             // Bytes ya enviados del registro tail (texto)
+  uint32_t pendingDrops;         // Perdidos aún sin avisar (productor)
+  uint32_t written;
+  uint32_t dropped;
+  uint32_t drained;
+};
+
+LogRing logRing;
+
+void logClear() {
+  logRing.head.store(0);
+  logRing.tail.store(0);
+  logRing.tailSent = 0;
+  logRing.pendingDrops = 0;
+  logRing.written = 0;
+  logRing.dropped = 0;
+  logRing.drained = 0;
+}
+
+inline uint32_t logPending() {
+  return logRing.head.load(std::memory_order_acquire) - logRing.tail.load(std::memory_order_acquire);
+}
+
+inline bool logPush(LogId id, const int16_t *args) {
+  uint32_t head = logRing.head.load(std::memory_order_relaxed);
+  if (head - logRing.tail.load(std::memory_order_acquire) >= LOG_RING_SIZE) return false;
+  LogRecord &r = logRing.records[head % LOG_RING_SIZE];
+  r.ms = hal::millis();
+  r.id = id;
+  r.level = LOG_LEVELS[id];
+  memcpy(r.args, args, sizeof(r.args));
+  logRing.head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+// Sin formatear ni esperar; si el anillo está lleno el mensaje se pierde y
+// se avisa con LOG_DROPPED en cuanto vuelve a haber sitio
+void logWrite(LogId id, int16_t a = 0, int16_t b = 0, int16_t c = 0, int16_t d = 0, int16_t e = 0) {
+  if (logRing.pendingDrops > 0 && LOG_LEVELS[LOG_DROPPED] <= LOG_LEVEL) {
+    if (LOG_RING_SIZE - logPending() < 2) {
+      logRing.pendingDrops++;
+      logRing.dropped++;
+      return;
+    }
+    const int16_t drops[LOG_MAX_ARGS] = {logRing.pendingDrops > 0x7FFF ? (int16_t)0x7FFF : (int16_t)logRing.pendingDrops};
+    logPush(LOG_DROPPED, drops);
+    logRing.pendingDrops = 0;
+  }
+  const int16_t args[LOG_MAX_ARGS] = {a, b, c, d, e};
+  if (logPush(id, args)) {
+    logRing.written++;
+  } else {
+    logRing.pendingDrops++;
+    logRing.dropped++;
+  }
+}
+
+// El nivel es una constante: lo que no se registra no llega a compilarse
+#define LOG(id, ...) \
+  do { \
+    if (LOG_LEVELS[id] <= LOG_LEVEL) logWrite(id, ##__VA_ARGS__); \
+  } while (0)
+
+// ===============================================
+// TEXTO
+// ===============================================
+
+// Escribe en out el mensaje del registro, como lo imprimía el firmware
+uint16_t logFormat(const LogRecord &r, char *out, uint16_t size) {
+  if (size == 0) return 0;
+  if (r.id >= LOG_ID_COUNT) {
+    int n = snprintf(out, size, "Log: mensaje %u desconocido", r.id);
+    return n < 0 ? 0 : (n < size ? n : size - 1);
+  }
+  const char *text = LOG_TEXTS[r.id];
+  uint16_t length = 0;
+  uint8_t arg = 0;
+  out[0] = '\0';
+  for (const char *p = text; *p && length + 1 < size; p++) {
+    if (*p != '%' || !p[1]) {
+      out[length++] = *p;
+      continue;
+    }
+    char kind = *++p;
+    if (kind == '%') {
+      out[length++] = '%';
+      continue;
+    }
+    int value = arg < LOG_MAX_ARGS ? r.args[arg] : 0;
+    arg++;
+    int n = 0;
+    if (kind == 't') {
+      n = snprintf(out + length, size - length, "%s",
+                   value >= 0 && value < INSECT_TYPE_NAME_COUNT ? INSECT_TYPE_NAMES[value] : "Desconocido");
+    } else if (kind == 'r') {
+      n = snprintf(out + length, size - length, "%s", NOTE_NAMES[(unsigned)value % SEMITONES]);
+    } else if (kind == 'n') {
+      n = snprintf(out + length, size - length, "%s%u", noteName((NoteIndex)value), noteOctave((NoteIndex)value));
+    } else {
+      n = snprintf(out + length, size - length, "%d", value);
+    }
+    if (n < 0) break;
+    length = length + n < size ? length + n : size - 1;
+  }
+  out[length] = '\0';
+  return length;
+}
+
+// ===============================================
+// VACIADO
+// ===============================================
+
+const uint8_t LOG_LINE_MAX = 128;
+
+// Envía lo que quepa en la UART de la línea del registro r, a partir de lo
+// ya enviado. Una línea más larga que el hueco libre sale en trozos en
+// varias vueltas, en vez de esperar un hueco que quizá no llega nunca.
+// true si ya ha salido entera
+bool logWriteText(const LogRecord &r) {
+  char line[LOG_LINE_MAX + 2];
+  uint16_t length = logFormat(r, line, LOG_LINE_MAX);
+  line[length++] = '\r';
+  line[length++] = '\n';
+  int room = Serial.availableForWrite();
+  if (room <= 0) return false;
+  uint16_t chunk = length - logRing.tailSent;
+  if (chunk > room) chunk = room;
+  Serial.write((const uint8_t *)line + logRing.tailSent, chunk);
+  logRing.tailSent += chunk;
+  if (logRing.tailSent < length) return false;
+  logRing.tailSent = 0;
+  return true;
+}
+
+// La trama binaria sale entera o no sale: log_decode.py no admite cortes.
+// Son 17 bytes, siempre menos que el buffer de la UART
+bool logWriteFrame(const LogRecord &r) {
+  if (Serial.availableForWrite() < (int)sizeof(LogRecord) + 1) return false;
+  uint8_t frame[sizeof(LogRecord) + 1];
+  frame[0] = LOG_FRAME_START;
+  memcpy(frame + 1, &r, sizeof(LogRecord));
+  Serial.write(frame, sizeof(frame));
+  return true;
+}
+
+// Envía hasta maxRecords registros, solo mientras caben en el buffer de la
+// UART (no bloquea nunca). Devuelve los enviados
+uint8_t logDrain(uint8_t maxRecords) {
+  uint8_t sent = 0;
+  while (sent < maxRecords) {
+    uint32_t tail = logRing.tail.load(std::memory_order_relaxed);
+    if (tail == logRing.head.load(std::memory_order_acquire)) break;
+    const LogRecord &r = logRing.records[tail % LOG_RING_SIZE];
+#if LOG_DRAIN_TEXT
+    if (!logWriteText(r)) break;
+#else
+    if (!logWriteFrame(r)) break;
+#endif
+    logRing.tail.store(tail + 1, std::memory_order_release);
+    logRing.drained++;
+    sent++;
+  }
+  return sent;
+}
+
+#endif // PIEZOBUGS_LOG_H
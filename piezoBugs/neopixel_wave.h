@@ -0,0 +1,413 @@
+/*
+ * neopixel_wave.h - Efecto "ola verde" con fade para el aro Neopixel
+ *
+ * La salida de píxeles pasa por hal::PixelStrip; el estado de la araña
+ * se lee de la tabla de voces para el resaltado en blanco.
+ *
+ * Todo en enteros: fade lineal en Q16, tabla de gamma constexpr y
+ * dithering temporal para el brillo bajo. Solo se llama a show() cuando
+ * el frame cambia, y show() no bloquea: cada aro transmite por su canal
+ * RMT mientras el loop sigue.
+ *
+ * Con varios aros (NEOPIXEL_PINS) cada uno dibuja la misma ola desfasada
+ * una fracción del ciclo, de modo que la ola recorre los aros por turno.
+ *
+ * Los efectos son capas del compositor (led_compositor.h): la ola verde
+ * de base, el resaltado blanco de la araña y un tinte según los datos del
+ * árbol. El tono de la ola gira con PARAM_LED_HUE y el tinte sigue a
+ * PARAM_LED_TINT, los dos del bus de parámetros; sin datos es el color de
+ * config.h sin tinte.
+ */
+
+#ifndef PIEZOBUGS_NEOPIXEL_WAVE_H
+#define PIEZOBUGS_NEOPIXEL_WAVE_H
+
+#include <string.h>
+#include "hal.h"
+#include "config.h"
+#include "insects.h"
+#include "voices.h"
+#include "led_compositor.h"
+#include "param_bus.h"
+#include "profile.h"
+
+static_assert(NEOPIXEL_RING_COUNT <= hal::PIXEL_CHANNELS, "Un canal RMT por aro");
+
+// Aros Neopixel (se configuran en initNeopixel)
+hal::PixelStrip neoRings[NEOPIXEL_RING_COUNT];
+hal::PixelStrip &pixels = neoRings[0];
+
+// Array para rastrear qué LEDs se pusieron blancos durante la secuencia de la araña
+bool ledWasWhite[NEOPIXEL_RING_COUNT][NEOPIXEL_COUNT] = {};
+
+// ===============================================
+// TABLA DE GAMMA (constexpr, en flash)
+// ===============================================
+
+// Raíz quinta por Newton: x^2.2 = x^2 * x^0.2 sin pow() en constexpr
+constexpr double gammaFifthRoot(double x) {
+  if (x <= 0.0) return 0.0;
+  double y = x < 1.0 ? 1.0 : x;
+  for (int i = 0; i < 40; i++) {
+    double y4 = y * y * y * y;
+    y = y - (y4 * y - x) / (5.0 * y4);
+  }
+  return y;
+}
+
+struct GammaTable {
+  uint16_t level[257];   // Entrada lineal /256 -> salida Q16 con gamma 2.2
+};
+
+constexpr GammaTable buildGammaTable() {
+  GammaTable table = {};
+  for (int i = 0; i <= 256; i++) {
+    double x = i / 256.0;
+    double y = x * x * gammaFifthRoot(x);
+    table.level[i] = (uint16_t)(y * 65535.0 + 0.5);
+  }
+  return table;
+}
+
+constexpr GammaTable NEO_GAMMA = buildGammaTable();
+
+static_assert(NEO_GAMMA.level[0] == 0 && NEO_GAMMA.level[256] == 65535, "Gamma de 0 a fondo de escala");
+
+// Interpola linealmente entre entradas de la tabla (level en Q16). La
+// fracción va de 0 a 256 para que 65535 dé exactamente el fondo de escala
+inline uint16_t gammaLevel(uint16_t level) {
+  uint16_t index = level >> 8;
+  uint16_t frac = (level & 0xFF) + ((level & 0xFF) >> 7);
+  uint32_t a = NEO_GAMMA.level[index];
+  uint32_t b = NEO_GAMMA.level[index + 1];
+  return (uint16_t)(a + (((b - a) * frac) >> 8));
+}
+
+// ===============================================
+// FADE EN ENTEROS
+// ===============================================
+
+/**
+ * Calcula el nivel de brillo con fade in/out
+ * @param timeInState: Tiempo transcurrido desde que el LED comenzó a encenderse (ms)
+ * @param totalDuration: Duración total del encendido (ms)
+ * @return: Nivel lineal entre 0 y 65535
+ */
+uint16_t calculateFadeLevel(unsigned long timeInState, unsigned long totalDuration) {
+  // Fase 1: Fade in (primeros FADE_IN_TIME ms)
+  if (timeInState <= FADE_IN_TIME) {
+    return (uint16_t)(timeInState * 65535UL / FADE_IN_TIME);
+  }
+  
+  // Fase 3: Fade out (últimos FADE_OUT_TIME ms)
+  if (timeInState >= (totalDuration - FADE_OUT_TIME)) {
+    unsigned long timeUntilEnd = totalDuration - timeInState;
+    if (timeUntilEnd > FADE_OUT_TIME) timeUntilEnd = FADE_OUT_TIME;
+    return (uint16_t)(timeUntilEnd * 65535UL / FADE_OUT_TIME);
+  }
+  
+  // Fase 2: Estado completo (entre fade in y fade out)
+  return 65535;
+}
+
+// ===============================================
+// FRAMEBUFFER CON DITHERING TEMPORAL
+// ===============================================
+
+// Con NEO_BRIGHTNESS = 30 un canal solo tiene 31 pasos: el resto de cada
+// canal (parte fraccionaria 8.8) se acumula de un frame al siguiente y
+// aparece como un LSB de más en algunos frames (sigma-delta). El aro
+// recibe los bytes finales con brillo 255, sin el escalado de la librería.
+struct NeopixelFrame {
+  uint8_t shown[NEOPIXEL_RING_COUNT][NEOPIXEL_COUNT][3];   // Último frame dibujado
+  uint8_t error[NEOPIXEL_RING_COUNT][NEOPIXEL_COUNT][3];   // Resto acumulado del dithering
+  bool valid[NEOPIXEL_RING_COUNT];      // El aro recibió el último frame dibujado
+
+  // Estadísticas
+  uint32_t frames;                      // Llamadas a updateNeopixel()
+  uint32_t shows;                       // Frames enviados (con cambios), sumando aros
+  uint32_t busySkips;                   // show() descartados con el aro transmitiendo
+};
+
+NeopixelFrame neoFrame;
+
+// Canal de 0-255 con un nivel Q16 -> 8.8. Nivel 65535 cuenta como 1.0
+// exacto para que un LED encendido no tenga resto
+inline uint16_t levelChannel(uint8_t channel, uint16_t level) {
+  return (uint16_t)(((uint32_t)channel * level + channel) >> 8);
+}
+
+// Valor 8.8 escalado por el brillo global (0-255), con redondeo
+inline uint16_t brightnessChannel(uint16_t value, uint8_t brightness) {
+  return (uint16_t)(((uint32_t)value * brightness * 257 + 32768) >> 16);
+}
+
+// Canal de 0-255 escalado por el brillo global y el nivel (Q16) -> 8.8
+inline uint16_t scaleChannel(uint8_t channel, uint8_t brightness, uint16_t level) {
+  return brightnessChannel(levelChannel(channel, level), brightness);
+}
+
+inline uint8_t ditherChannel(uint16_t value, uint8_t &error) {
+  if (!NEO_DITHER) return (uint8_t)((value + 128) >> 8);
+  uint32_t sum = (uint32_t)value + error;
+  error = sum & 0xFF;
+  return (uint8_t)(sum >> 8);
+}
+
+// ===============================================
+// CAPAS
+// ===============================================
+
+// Estado de la ola en el frame actual, compartido con las capas de encima
+struct NeopixelWave {
+  bool on[NEOPIXEL_RING_COUNT][NEOPIXEL_COUNT];
+  bool fadingIn[NEOPIXEL_RING_COUNT][NEOPIXEL_COUNT];
+  uint16_t level[NEOPIXEL_RING_COUNT][NEOPIXEL_COUNT];    // Fade con gamma (Q16)
+};
+
+NeopixelWave neoWave;
+
+// Tinte de la capa de datos (color que multiplica la ola)
+uint8_t neoTint[3] = {255, 255, 255};
+uint8_t neoTintAmount = 0;
+
+// Color de la ola: NEO_COLOR_* con el giro de tono aplicado
+uint8_t neoWaveColor[3] = {NEO_COLOR_R, NEO_COLOR_G, NEO_COLOR_B};
+float neoWaveHue = 0.0f;
+
+int neoWaveLayer = -1;
+int neoSpiderLayer = -1;
+int neoTintLayer = -1;
+
+// Base: ola verde con fade in/out
+void neopixelWaveLayer(uint8_t ring, unsigned long ringTime, LedPixel *out) {
+  const unsigned long cycleTime = NEOPIXEL_COUNT * LED_INTERVAL;
+  
+  // Posición en el ciclo de la ola (una sola división por frame)
+  unsigned long currentCycle = ringTime / cycleTime;
+  unsigned long timeInCycle = ringTime - currentCycle * cycleTime;
+  
+  for(int i = 0; i < NEOPIXEL_COUNT; i++) {
+    unsigned long ledStartTimeInCycle = i * LED_INTERVAL;
+    
+    // Variables para gestionar el estado del LED
+    bool shouldBeOn = false;
+    unsigned long timeInState = 0;
+    
+    if (timeInCycle >= ledStartTimeInCycle) {
+      // LED encendido en el ciclo actual
+      timeInState = timeInCycle - ledStartTimeInCycle;
+      shouldBeOn = timeInState < LED_DURATION;
+    } else if (currentCycle > 0) {
+      // LED todavía activo del ciclo anterior (completa su fade out)
+      timeInState = timeInCycle + cycleTime - ledStartTimeInCycle;
+      shouldBeOn = timeInState < LED_DURATION;
+    }
+    
+    neoWave.on[ring][i] = shouldBeOn;
+    neoWave.fadingIn[ring][i] = shouldBeOn && timeInState <= FADE_IN_TIME;
+    neoWave.level[ring][i] = 0;
+    if (!shouldBeOn) continue;
+    
+    // Nivel con fade (lineal) corregido con gamma
+    uint16_t level = gammaLevel(calculateFadeLevel(timeInState, LED_DURATION));
+    neoWave.level[ring][i] = level;
+    
+    // Debug: Imprimir valores de fade (solo para LED 0 y durante fade in)
+    if (DEBUG_FADE && ring == 0 && i == 0 && timeInState <= FADE_IN_TIME) {
+      Serial.println((unsigned int)(level >> 8));
+    }
+    
+    out[i].r = levelChannel(neoWaveColor[0], level);
+    out[i].g = levelChannel(neoWaveColor[1], level);
+    out[i].b = levelChannel(neoWaveColor[2], level);
+    out[i].a = 65535;
+  }
+}
+
+// Araña: los LEDs que se encienden mientras suena se quedan blancos hasta
+// apagarse. Solo está activa mientras alguna voz araña suena
+void neopixelSpiderLayer(uint8_t ring, unsigned long ringTime, LedPixel *out) {
+  for (int i = 0; i < NEOPIXEL_COUNT; i++) {
+    if (!neoWave.on[ring][i]) {
+      ledWasWhite[ring][i] = false;
+      continue;
+    }
+    if (neoWave.fadingIn[ring][i]) ledWasWhite[ring][i] = true;
+    if (!ledWasWhite[ring][i]) continue;
+    
+    uint16_t white = levelChannel(255, neoWave.level[ring][i]);
+    out[i].r = white;
+    out[i].g = white;
+    out[i].b = white;
+    out[i].a = 65535;
+  }
+}
+
+// Tinte: multiplica los LEDs encendidos por neoTint
+void neopixelTintLayer(uint8_t ring, unsigned long ringTime, LedPixel *out) {
+  for (int i = 0; i < NEOPIXEL_COUNT; i++) {
+    out[i].r = neoTint[0] * 257;
+    out[i].g = neoTint[1] * 257;
+    out[i].b = neoTint[2] * 257;
+    out[i].a = 65535;
+  }
+}
+
+// Tiñe la ola con un color; amount 0 desactiva la capa
+void neopixelSetTint(uint8_t r, uint8_t g, uint8_t b, uint8_t amount) {
+  neoTint[0] = r;
+  neoTint[1] = g;
+  neoTint[2] = b;
+  neoTintAmount = amount;
+  ledLayerSetOpacity(neoTintLayer, amount);
+  ledLayerSetActive(neoTintLayer, amount > 0);
+}
+
+// Tinte de datos con el color de config.h; amount de 0 a 1
+// (PARAM_LED_TINT). Solo toca el compositor cuando cambia
+void neopixelSetDataTint(float amount) {
+  uint8_t opacity = amount <= 0.0f ? 0 : amount >= 1.0f ? 255 : (uint8_t)(amount * 255.0f + 0.5f);
+  if (opacity == neoTintAmount) return;
+  neopixelSetTint(NEO_TINT_R, NEO_TINT_G, NEO_TINT_B, opacity);
+}
+
+// Gira el tono del color de la ola (matriz hue-rotate de CSS, conserva
+// la luminancia). Solo se recalcula cuando el giro cambia
+void neopixelSetHueShift(float degrees) {
+  if (degrees == neoWaveHue) return;
+  neoWaveHue = degrees;
+  const float base[3] = {NEO_COLOR_R, NEO_COLOR_G, NEO_COLOR_B};
+  if (degrees == 0.0f) {
+    for (uint8_t c = 0; c < 3; c++) neoWaveColor[c] = (uint8_t)base[c];
+    return;
+  }
+  float radians = degrees * (float)M_PI / 180.0f;
+  float co = cosf(radians);
+  float si = sinf(radians);
+  const float m[3][3] = {
+    {0.213f + 0.787f * co - 0.213f * si, 0.715f - 0.715f * co - 0.715f * si, 0.072f - 0.072f * co + 0.928f * si},
+    {0.213f - 0.213f * co + 0.143f * si, 0.715f + 0.285f * co + 0.140f * si, 0.072f - 0.072f * co - 0.283f * si},
+    {0.213f - 0.213f * co - 0.787f * si, 0.715f - 0.715f * co + 0.715f * si, 0.072f + 0.928f * co + 0.072f * si},
+  };
+  for (uint8_t c = 0; c < 3; c++) {
+    float v = m[c][0] * base[0] + m[c][1] * base[1] + m[c][2] * base[2];
+    neoWaveColor[c] = v <= 0.0f ? 0 : v >= 255.0f ? 255 : (uint8_t)(v + 0.5f);
+  }
+}
+
+// ===============================================
+// INICIALIZACIÓN Y FRAME
+// ===============================================
+
+void initNeopixel() {
+  // Inicializar el aro de Neopixels
+  Serial.println("Neopixel inicializado en GPIO23 (24 LEDs)");
+  Serial.println("Efecto: Ola verde con fade suave");
+  
+  // Inicializar NeoPixel (el brillo se aplica en updateNeopixel)
+  memset(&neoFrame, 0, sizeof(neoFrame));
+  memset(&neoWave, 0, sizeof(neoWave));
+  memset(ledWasWhite, 0, sizeof(ledWasWhite));
+  neoWaveHue = 1.0f;
+  neopixelSetHueShift(0.0f);
+  for (uint8_t r = 0; r < NEOPIXEL_RING_COUNT; r++) {
+    neoRings[r].begin(NEOPIXEL_COUNT, NEOPIXEL_PINS[r], r);
+    neoRings[r].setBrightness(255);
+    neoRings[r].clear();
+    neoFrame.valid[r] = neoRings[r].show();
+  }
+  
+  // Capas de abajo arriba
+  ledCompositorClear();
+  neoWaveLayer = ledLayerAdd("ola", neopixelWaveLayer, BLEND_NORMAL);
+  neoSpiderLayer = ledLayerAdd("araña", neopixelSpiderLayer, BLEND_NORMAL);
+  neoTintLayer = ledLayerAdd("tinte", neopixelTintLayer, BLEND_MULTIPLY);
+  neopixelSetTint(255, 255, 255, 0);
+  
+  Serial.println("NeoPixel listo para efecto ola verde");
+}
+
+// Pasa el frame compuesto de un aro a bytes con dithering; devuelve true
+// si algún píxel cambió respecto al último frame
+bool neopixelOutputRing(uint8_t ring, const LedPixel *composed, uint8_t brightness) {
+  hal::PixelStrip &strip = neoRings[ring];
+  bool changed = false;
+  
+  for (int i = 0; i < NEOPIXEL_COUNT; i++) {
+    uint8_t *error = neoFrame.error[ring][i];
+    uint8_t *shown = neoFrame.shown[ring][i];
+    uint8_t out[3] = {0, 0, 0};
+    
+    if (composed[i].r | composed[i].g | composed[i].b) {
+      out[0] = ditherChannel(brightnessChannel(composed[i].r, brightness), error[0]);
+      out[1] = ditherChannel(brightnessChannel(composed[i].g, brightness), error[1]);
+      out[2] = ditherChannel(brightnessChannel(composed[i].b, brightness), error[2]);
+    } else {
+      // Resetear el resto del dithering cuando el LED se apaga
+      memset(error, 0, 3);
+    }
+    
+    if (out[0] != shown[0] || out[1] != shown[1] || out[2] != shown[2]) {
+      strip.setPixelColor(i, strip.Color(out[0], out[1], out[2]));
+      shown[0] = out[0];
+      shown[1] = out[1];
+      shown[2] = out[2];
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+void updateNeopixel(unsigned long currentTime) {
+  PROFILE_SCOPE(PROF_NEOPIXEL);
+  
+  // Límite de frames por segundo del compositor
+  uint32_t frameStart = hal::micros();
+  if (!ledCompositorFrameDue(frameStart)) return;
+  
+  // Actualizar efecto de ola verde en los aros de NeoPixels
+  const unsigned long cycleTime = NEOPIXEL_COUNT * LED_INTERVAL;
+  neoFrame.frames++;
+  
+  // Detectar si alguna voz araña está sonando
+  bool spiderIsPlaying = voicesTypePlaying(SPIDER);
+  
+  // Brillo global según si la araña está sonando
+  uint8_t brightness = spiderIsPlaying ? 50 : NEO_BRIGHTNESS;
+  
+  // Resetear el array de LEDs blancos cuando la araña no está sonando
+  if (!spiderIsPlaying) {
+    memset(ledWasWhite, 0, sizeof(ledWasWhite));
+  }
+  ledLayerSetActive(neoSpiderLayer, spiderIsPlaying);
+  
+  // Tono según los datos del árbol (ya suavizado por el bus)
+  neopixelSetHueShift(paramValue(PARAM_LED_HUE));
+  
+  LedPixel composed[NEOPIXEL_COUNT];
+  for (uint8_t r = 0; r < NEOPIXEL_RING_COUNT; r++) {
+    unsigned long ringTime = currentTime + r * cycleTime / NEOPIXEL_RING_COUNT;
+    ledCompose(r, ringTime, composed, frameStart);
+    bool changed = neopixelOutputRing(r, composed, brightness);
+    
+    // Enviar solo si algo cambió o el último envío no entró. show() no
+    // bloquea; si el aro aún transmite el frame anterior, se reintenta
+    // en el siguiente frame
+    if (changed || !neoFrame.valid[r]) {
+      {
+        PROFILE_SCOPE(PROF_NEOPIXEL_SHOW);
+        neoFrame.valid[r] = neoRings[r].show();
+      }
+      if (neoFrame.valid[r]) {
+        // Partiendo del aro apagado, el primer cambio ya enciende algo
+        if (changed) bootMark(BOOT_FIRST_LIGHT);
+        neoFrame.shows++;
+      } else {
+        neoFrame.busySkips++;
+      }
+    }
+  }
+}
+
+#endif // PIEZOBUGS_NEOPIXEL_WAVE_H
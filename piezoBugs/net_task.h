@@ -0,0 +1,143 @@
+/*
+ * net_task.h - WiFi y consultas a InfluxDB en una tarea propia
+ *
+ * Todo lo que puede bloquear (reconexión del WiFi, handshake TLS, esperar
+ * la respuesta hasta INFLUX_TIMEOUT_MS) corre en una tarea de FreeRTOS
+ * fijada al núcleo 0, junto a la pila WiFi y por debajo de la tarea de
+ * audio. El loop de Arduino (núcleo 1), donde viven insectos y LEDs, solo
+ * recoge la última instantánea con treeSlotRead(netTask.slot, ...), que
+ * nunca espera.
+ *
+ * Cada lectura nueva se guarda también en la caché de flash
+ * (tree_cache.h, como mucho una por minuto) si está abierta; al arrancar,
+ * netTaskBegin() publica la última guardada antes de la primera consulta
+ * y las consultas incrementales la completan campo a campo.
+ *
+ * netTaskStep() es un paso de la tarea y devuelve cuánto dormir; la
+ * tarea solo lo repite. En el build nativo no hay tareas y los tests lo
+ * llaman directamente (o desde un std::thread).
+ */
+
+#ifndef PIEZOBUGS_NET_TASK_H
+#define PIEZOBUGS_NET_TASK_H
+
+#include <atomic>
+#include "hal.h"
+#include "influx_poll.h"
+#include "tree_slot.h"
+#include "tree_cache.h"
+
+// ===============================================
+// CONFIGURACIÓN
+// ===============================================
+
+const uint8_t NET_TASK_CORE = 0;
+const uint8_t NET_TASK_PRIORITY = 1;         // Por debajo de la tarea de audio (5)
+const uint32_t NET_TASK_STACK = 8192;        // El handshake de mbedtls usa la pila
+const uint32_t NET_CHECK_MS = 250;           // Sueño máximo: detectar caídas del WiFi
+const uint32_t NET_WIFI_RETRY_MIN_MS = 1000;
+const uint32_t NET_WIFI_RETRY_MAX_MS = 30000;
+
+// ===============================================
+// ESTADO
+// ===============================================
+
+struct NetTask {
+  InfluxClient client;
+  InfluxPoller poller;
+  TreeDataSlot slot;             // Instantáneas para el loop
+  TreeData data;                 // Copia de trabajo: las consultas incrementales solo traen algunos campos
+  void (*onFetch)(bool updated); // Opcional; se llama desde la tarea tras cada consulta
+  bool online;
+  uint32_t wifiRetryMs;
+  uint32_t lastWifiAttemptMs;
+  // Lo pone el loop: mientras esté a true no se reconecta (p. ej. con el
+  // portal de WiFiManager abierto, que usa la radio para su punto de acceso)
+  std::atomic<bool> wifiHold;
+
+  // Estadísticas: las escribe la tarea, se pueden leer desde el loop
+  std::atomic<uint32_t> fetches;
+  std::atomic<uint32_t> wifiDrops;
+  std::atomic<uint32_t> lastFetchMs;
+  std::atomic<uint32_t> maxFetchMs;
+};
+
+NetTask netTask;
+
+// Después de influxClientBegin(netTask.client, ...) y treeCacheBegin(treeCache),
+// y antes de arrancar la tarea
+void netTaskBegin(const char *bucket, void (*onFetch)(bool updated) = nullptr) {
+  influxPollerBegin(netTask.poller, bucket);
+  treeSlotInit(netTask.slot);
+  netTask.data = TreeData();
+  // Últimos datos guardados: el loop los recibe ya, sin esperar a la red
+  if (treeCacheLatest(treeCache, netTask.data)) treeSlotPublish(netTask.slot, netTask.data);
+  netTask.onFetch = onFetch;
+  netTask.online = false;
+  netTask.wifiRetryMs = NET_WIFI_RETRY_MIN_MS;
+  netTask.lastWifiAttemptMs = hal::millis();
+  netTask.wifiHold.store(false);
+  netTask.fetches.store(0);
+  netTask.wifiDrops.store(0);
+  netTask.lastFetchMs.store(0);
+  netTask.maxFetchMs.store(0);
+}
+
+// ===============================================
+// TAREA
+// ===============================================
+
+// Un paso: vigila el WiFi y consulta cuando toca. Devuelve los ms a dormir
+uint32_t netTaskStep(uint32_t now) {
+  NetTask &t = netTask;
+  if (!hal::wifiConnected()) {
+    if (t.online) {
+      // Recién caído: el driver suele reasociarse solo, se le da un margen
+      t.online = false;
+      t.wifiDrops.fetch_add(1, std::memory_order_relaxed);
+      t.client.link.stop();
+      t.wifiRetryMs = NET_WIFI_RETRY_MIN_MS;
+      t.lastWifiAttemptMs = now;
+    } else if (!t.wifiHold.load(std::memory_order_relaxed) && now - t.lastWifiAttemptMs >= t.wifiRetryMs) {
+      hal::wifiReconnect();
+      t.lastWifiAttemptMs = now;
+      t.wifiRetryMs = t.wifiRetryMs * 2 > NET_WIFI_RETRY_MAX_MS ? NET_WIFI_RETRY_MAX_MS : t.wifiRetryMs * 2;
+    }
+    return NET_CHECK_MS;
+  }
+  t.online = true;
+
+  if (influxPollerDue(t.poller, now)) {
+    bool updated = influxPollerFetch(t.poller, t.client, t.data);
+    uint32_t took = hal::millis() - now;
+    t.fetches.fetch_add(1, std::memory_order_relaxed);
+    t.lastFetchMs.store(took, std::memory_order_relaxed);
+    if (took > t.maxFetchMs.load(std::memory_order_relaxed)) t.maxFetchMs.store(took, std::memory_order_relaxed);
+    if (updated) {
+      treeSlotPublish(t.slot, t.data);
+      treeCacheStore(treeCache, t.data, now);
+    }
+    if (t.onFetch) t.onFetch(updated);
+    now = hal::millis();
+  }
+  uint32_t wait = t.poller.lastPollMs + t.poller.intervalMs - now;
+  if ((int32_t)wait <= 0) return 1;
+  return wait < NET_CHECK_MS ? wait : NET_CHECK_MS;
+}
+
+void netTaskMain(void *arg) {
+  for (;;) {
+    hal::delay(netTaskStep(hal::millis()));
+  }
+}
+
+// Arranca la tarea en el núcleo 0 (el loop de Arduino corre en el 1)
+bool netTaskStart() {
+  if (!hal::startTask("net", netTaskMain, NET_TASK_STACK, NET_TASK_PRIORITY, NET_TASK_CORE)) {
+    Serial.println("Error: no se pudo crear la tarea de red");
+    return false;
+  }
+  return true;
+}
+
+#endif // PIEZOBUGS_NET_TASK_H
@@ -0,0 +1,248 @@
+/*
+ * param_bus.h - Bus de parámetros de control: datos del árbol -> sonido y luz
+ *
+ * Cada parámetro del motor (densidad de insectos, ritmo de notas,
+ * transposición, tono y tinte de los LEDs, actividad del árbol) tiene un objetivo
+ * y un valor actual.
+ * paramBusApplyTree() pasa cada campo de TreeData por su curva
+ * (PARAM_DEFAULT_MAPPINGS) y escribe los objetivos: unas pocas escrituras
+ * atómicas, sin regenerar secuencias ni replanificar voces, y se puede
+ * llamar desde cualquier tarea. paramBusTick() corre a ritmo de control
+ * (PARAM_CONTROL_MS) en el loop y acerca cada valor a su objetivo con un
+ * filtro de un polo, así los datos nunca llegan a saltos.
+ *
+ * Las rutas calientes leen el valor actual con paramValue(), una carga
+ * relajada, una vez por evento: al planificar una secuencia o una nota,
+ * al tocarla y en cada frame de LEDs. Sin datos, todos los parámetros
+ * valen su valor neutro y el motor suena como siempre.
+ */
+
+#ifndef PIEZOBUGS_PARAM_BUS_H
+#define PIEZOBUGS_PARAM_BUS_H
+
+#include <atomic>
+#include <math.h>
+#include "config.h"
+#include "tree_data.h"
+
+static_assert(std::atomic<float>::is_always_lock_free, "Los parámetros se leen sin bloqueos");
+
+// ===============================================
+// PARÁMETROS
+// ===============================================
+
+enum ParamId {
+  PARAM_DENSITY,      // Secuencias más frecuentes (x2 = pausas a la mitad)
+  PARAM_NOTE_RATE,    // Notas más rápidas dentro de una secuencia
+  PARAM_TRANSPOSE,    // Semitonos sobre la nota raíz (se redondea al tocar)
+  PARAM_LED_HUE,      // Giro del tono de la ola en grados
+  PARAM_LED_TINT,     // Intensidad del tinte de la ola (0 = sin tinte)
+  PARAM_ACTIVITY,     // Actividad bioeléctrica llevada a 0-1 (src/main.cpp)
+  PARAM_COUNT
+};
+
+struct ParamSpec {
+  const char* name;
+  float neutral;      // Valor sin datos: el motor suena como siempre
+  float minValue;
+  float maxValue;
+  uint32_t smoothMs;  // Constante de tiempo del suavizado
+};
+
+const ParamSpec PARAM_SPECS[PARAM_COUNT] = {
+  {"densidad",      1.0f,  0.25f,   4.0f, 8000},
+  {"ritmo",         1.0f,  0.5f,    2.0f, 4000},
+  {"transposición", 0.0f, -12.0f,  12.0f, 3000},
+  {"tono LED",      0.0f, -180.0f, 180.0f, 5000},
+  {"tinte LED",     0.0f,  0.0f,    1.0f, 5000},
+  {"actividad",     0.5f,  0.0f,    1.0f, 2000},
+};
+
+// ===============================================
+// CURVAS
+// ===============================================
+
+enum ParamCurve {
+  CURVE_LINEAR,
+  CURVE_EASE_IN,       // x^2: cambia poco al principio del rango
+  CURVE_EASE_OUT,      // 1-(1-x)^2: cambia poco al final
+  CURVE_SMOOTH,        // smoothstep: suave en ambos extremos
+  CURVE_EXPONENTIAL    // Proporciones iguales por paso (tiempos, frecuencias)
+};
+
+// Un campo del árbol sobre un parámetro. Fuera de [inMin, inMax] se
+// satura; outMin > outMax invierte el sentido
+struct ParamMapping {
+  TreeField source;
+  ParamId target;
+  ParamCurve curve;
+  float inMin;
+  float inMax;
+  float outMin;
+  float outMax;
+};
+
+const uint8_t PARAM_MAX_MAPPINGS = 8;
+
+// Correspondencia por defecto, en las unidades de InfluxDB (biodata)
+const ParamMapping PARAM_DEFAULT_MAPPINGS[] = {
+  // Más actividad bioeléctrica, más insectos
+  {TREE_BIOELECTRICAL_ACTIVITY, PARAM_DENSITY,   CURVE_EXPONENTIAL, 0.002f, 0.008f, 0.5f,   2.5f},
+  // Con calor los insectos cantan más deprisa
+  {TREE_TEMPERATURE,            PARAM_NOTE_RATE, CURVE_SMOOTH,      5.0f,   30.0f,  0.7f,   1.4f},
+  // Más humedad, más grave
+  {TREE_HUMIDITY,               PARAM_TRANSPOSE, CURVE_LINEAR,      30.0f,  90.0f,  5.0f,  -5.0f},
+  // De noche la ola tira a azul, a pleno sol a amarillo
+  {TREE_LIGHT_LEVEL,            PARAM_LED_HUE,   CURVE_EASE_OUT,    0.0f,   2000.0f, 100.0f, -40.0f},
+  // Con el árbol en reposo la ola se enfría y se apaga un poco
+  {TREE_BIOELECTRICAL_ACTIVITY, PARAM_LED_TINT,  CURVE_EASE_IN,     0.002f, 0.008f, 0.6f,   0.0f},
+  // La actividad tal cual, para quien la convierte a su manera
+  {TREE_BIOELECTRICAL_ACTIVITY, PARAM_ACTIVITY,  CURVE_LINEAR,      0.002f, 0.008f, 0.0f,   1.0f},
+};
+
+float paramCurve(ParamCurve curve, float x) {
+  switch (curve) {
+    case CURVE_EASE_IN: return x * x;
+    case CURVE_EASE_OUT: return 1.0f - (1.0f - x) * (1.0f - x);
+    case CURVE_SMOOTH: return x * x * (3.0f - 2.0f * x);
+    case CURVE_LINEAR:
+    case CURVE_EXPONENTIAL:
+    default: return x;
+  }
+}
+
+// Valor del parámetro para un dato según la correspondencia
+float paramMap(const ParamMapping &m, float input) {
+  float x = m.inMax != m.inMin ? (input - m.inMin) / (m.inMax - m.inMin) : 0.0f;
+  if (!(x > 0.0f)) x = 0.0f;   // También NaN
+  if (x > 1.0f) x = 1.0f;
+  if (m.curve == CURVE_EXPONENTIAL && m.outMin > 0.0f && m.outMax > 0.0f) {
+    return m.outMin * powf(m.outMax / m.outMin, x);
+  }
+  return m.outMin + (m.outMax - m.outMin) * paramCurve(m.curve, x);
+}
+
+// ===============================================
+// ESTADO
+// ===============================================
+
+struct ParamBus {
+  std::atomic<float> target[PARAM_COUNT];    // Escriben los datos (cualquier tarea)
+  std::atomic<float> current[PARAM_COUNT];   // Escribe solo paramBusTick (loop)
+  ParamMapping mappings[PARAM_MAX_MAPPINGS];
+  uint8_t mappingCount;
+  uint32_t lastTick;
+  bool started;
+
+  // Estadísticas
+  uint32_t updates;                          // Llamadas a paramBusApplyTree
+  uint32_t ticks;
+  uint32_t settledMask;                      // Bit p = parámetro en su objetivo
+};
+
+ParamBus paramBus;
+
+inline float paramValue(ParamId id) {
+  return paramBus.current[id].load(std::memory_order_relaxed);
+}
+
+inline float paramTarget(ParamId id) {
+  return paramBus.target[id].load(std::memory_order_relaxed);
+}
+
+inline float paramClamp(ParamId id, float value) {
+  const ParamSpec &spec = PARAM_SPECS[id];
+  if (!(value >= spec.minValue)) return spec.minValue;   // También NaN
+  return value > spec.maxValue ? spec.maxValue : value;
+}
+
+// Intervalo dividido por un parámetro de velocidad (densidad, ritmo)
+inline unsigned long paramScaleInterval(unsigned long ms, ParamId id) {
+  float speed = paramValue(id);
+  if (!(speed > 0.0f)) return ms;   // Bus sin iniciar
+  return (unsigned long)((float)ms / speed + 0.5f);
+}
+
+// Transposición actual en semitonos enteros
+inline int paramSemitones() {
+  return (int)lroundf(paramValue(PARAM_TRANSPOSE));
+}
+
+void paramSetTarget(ParamId id, float value) {
+  paramBus.target[id].store(paramClamp(id, value), std::memory_order_relaxed);
+}
+
+// Fija un parámetro sin suavizado (arranque, pruebas)
+void paramSetNow(ParamId id, float value) {
+  value = paramClamp(id, value);
+  paramBus.target[id].store(value, std::memory_order_relaxed);
+  paramBus.current[id].store(value, std::memory_order_relaxed);
+}
+
+// Todos los parámetros a su valor neutro y correspondencias por defecto
+void paramBusBegin() {
+  for (uint8_t p = 0; p < PARAM_COUNT; p++) paramSetNow((ParamId)p, PARAM_SPECS[p].neutral);
+  paramBus.mappingCount = 0;
+  for (const ParamMapping &m : PARAM_DEFAULT_MAPPINGS) paramBus.mappings[paramBus.mappingCount++] = m;
+  paramBus.started = false;
+  paramBus.updates = 0;
+  paramBus.ticks = 0;
+  paramBus.settledMask = (1u << PARAM_COUNT) - 1;
+}
+
+// Sustituye las correspondencias (antes de recibir datos)
+void paramBusSetMappings(const ParamMapping *mappings, uint8_t count) {
+  paramBus.mappingCount = count < PARAM_MAX_MAPPINGS ? count : PARAM_MAX_MAPPINGS;
+  for (uint8_t i = 0; i < paramBus.mappingCount; i++) paramBus.mappings[i] = mappings[i];
+}
+
+// ===============================================
+// DATOS Y CONTROL
+// ===============================================
+
+// Nuevos datos del árbol: solo escribe objetivos
+void paramBusApplyTree(const TreeData &data) {
+  if (!data.data_valid) return;
+  const float fields[TREE_FIELD_COUNT] = {data.humidity, data.temperature, data.bioelectrical_activity,
+                                          data.light_level};
+  for (uint8_t i = 0; i < paramBus.mappingCount; i++) {
+    const ParamMapping &m = paramBus.mappings[i];
+    paramSetTarget(m.target, paramMap(m, fields[m.source]));
+  }
+  paramBus.updates++;
+}
+
+// Todos los valores a su objetivo sin suavizado (datos guardados al arrancar)
+void paramBusSettle() {
+  for (uint8_t p = 0; p < PARAM_COUNT; p++) {
+    paramBus.current[p].store(paramBus.target[p].load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+}
+
+// Paso de control: cada valor recorre 1 - e^(-dt/tau) de lo que le falta.
+// Depende del tiempo real transcurrido, no del número de pasos
+void paramBusTick(uint32_t now) {
+  uint32_t dt = paramBus.started ? now - paramBus.lastTick : 0;
+  paramBus.started = true;
+  paramBus.lastTick = now;
+  paramBus.ticks++;
+  if (dt > PARAM_MAX_STEP_MS) dt = PARAM_MAX_STEP_MS;
+
+  uint32_t settled = 0;
+  for (uint8_t p = 0; p < PARAM_COUNT; p++) {
+    const ParamSpec &spec = PARAM_SPECS[p];
+    float target = paramBus.target[p].load(std::memory_order_relaxed);
+    float value = paramBus.current[p].load(std::memory_order_relaxed);
+    if (value == target) {
+      settled |= 1u << p;
+      continue;
+    }
+    value += (target - value) * (1.0f - expf(-(float)dt / spec.smoothMs));
+    // Cerca del objetivo se fija exacto, para que los lectores vean un valor estable
+    if (fabsf(target - value) <= (spec.maxValue - spec.minValue) * PARAM_SETTLE_FRACTION) value = target;
+    paramBus.current[p].store(value, std::memory_order_relaxed);
+  }
+  paramBus.settledMask = settled;
+}
+
+#endif // PIEZOBUGS_PARAM_BUS_H
@@ -0,0 +1,329 @@
+/*
+ * piezo_bugs.h - Aplicación PiezoBugs completa (setup + loop)
+ *
+ * Reúne la tabla de voces de insectos, los botones y el Neopixel como
+ * tareas del planificador (scheduler.h). El sketch
+ * piezoBugs.ino y el ejecutable nativo (src/native) llaman a
+ * piezoBugsSetup()/piezoBugsLoop(), así que ambos ejecutan la misma lógica.
+ */
+
+#ifndef PIEZO_BUGS_H
+#define PIEZO_BUGS_H
+
+#include "hal.h"
+#include "config.h"
+#include "tuning.h"
+#include "insects.h"
+#include "voices.h"
+#include "neopixel_wave.h"
+#include "buttons.h"
+#include "scheduler.h"
+#include "param_bus.h"
+#include "tree_cache.h"
+#include "boot.h"
+#include "profile.h"
+#include "heap_monitor.h"
+#if USE_I2S_SYNTH
+#include "samples.h"
+#endif
+
+// Identificadores de las tareas del planificador
+int voicesTaskId = -1;
+int buttonsTaskId = -1;
+int neopixelTaskId = -1;
+int controlTaskId = -1;
+int bootTaskId = -1;
+int profileTaskId = -1;
+int heapTaskId = -1;
+int samplesTaskId = -1;
+
+uint32_t voicesTask(uint32_t now) {
+  voicesUpdate(now);
+  return voicesNextDeadline(now, MAX_SLEEP_MS);
+}
+
+uint32_t buttonsTask(uint32_t now) {
+  uint32_t next = handleButtons(now);
+  // Los botones pueden mutear voces o cambiar su planificación
+  schedulerSetDeadline(voicesTaskId, voicesNextDeadline(now, MAX_SLEEP_MS));
+  return next;
+}
+
+uint32_t neopixelTask(uint32_t now) {
+  updateNeopixel(now);
+  return now + NEOPIXEL_FRAME_MS;
+}
+
+uint32_t controlTask(uint32_t now) {
+  PROFILE_SCOPE(PROF_CONTROL);
+  paramBusTick(now);
+  // El tinte cambia la opacidad de una capa: mejor aquí que en cada frame
+  neopixelSetDataTint(paramValue(PARAM_LED_TINT));
+  return now + PARAM_CONTROL_MS;
+}
+
+#if ENABLE_PROFILER
+uint32_t profileTask(uint32_t now) {
+  profilePollSerial();
+  return now + PROFILE_POLL_MS;
+}
+#endif
+
+// Nuevos datos del árbol (p. ej. de treeSlotRead en forestData): solo
+// mueve los objetivos del bus, el suavizado lo hace controlTask
+void piezoBugsSetTreeData(const TreeData &data) {
+  paramBusApplyTree(data);
+}
+
+#if USE_I2S_SYNTH
+// Dispara una muestra del banco (gain en Q15). Si hay que traerla de la
+// SD, la tarea de muestras empieza a cargarla en esta misma vuelta
+bool piezoBugsPlaySample(uint16_t id, uint16_t gain) {
+  uint32_t now = hal::millis();
+  bool playing = samplePlay(id, gain, now);
+  if (samplesLoading()) schedulerSetDeadline(samplesTaskId, now);
+  return playing;
+}
+#endif
+
+// Textos de ayuda: los imprime bootTask línea a línea después de arrancar,
+// para que la UART (unos 2,5 KB a 115200 baudios) no retrase luz y sonido
+const char* const PIEZO_BUGS_HELP[] = {
+  "Piezo 1: Insecto 1 (Araña por defecto) - Botón 2 para cambiar tipo",
+  "Piezo 2: Insecto 2 (Grillo por defecto) - Botón 4 para cambiar tipo",
+  "Tipos: Araña(octavas 5-8, 3-16 notas), Grillo(octavas 2-4, 3-4 notas), Escarabajo(octavas 2-4, solo Si, 4-7 notas)",
+  "Botón 1: Pulsación corta = Cambiar frecuencia, Larga (1s) = Reset a valores por defecto",
+  "NOTA: No se guardan preferencias - valores por defecto al reiniciar",
+  "Botón 2: Pulsación larga (1s) = Mute/Unmute Insecto 1, Pulsación corta = Cambiar tipo",
+  "Botón 4: Pulsación larga (1s) = Mute/Unmute Insecto 2, Pulsación corta = Cambiar tipo",
+  "Botón 6: Pulsación corta = Cambiar nota raíz, Larga (1s) = Reset a Si",
+  "Estados: Normal(x1) -> Lento(x3) -> Muy Lento(x5) -> Extremo(x7) -> Normal",
+  "Neopixel: Aro de 24 LEDs en GPIO23",
+  "LEDs: D1=Sistema, D3=Audio, D4=Mute + Alternativos GPIO16-19",
+  "LEDs configurados - Prueba visual:",
+  "D1 (GPIO2), D3 (GPIO14), D4 (GPIO15) - Originales",
+  "ALT1 (GPIO16), ALT2 (GPIO17), ALT3 (GPIO18) - Alternativos",
+  "NOTA: Botón 2 comparte GPIO13 con SD DATA3",
+  "NOTA: Botón 5 usa GPIO0 (BOOT Button)",
+};
+
+const char* const PIEZO_BUGS_DETAILS[] = {
+  "\nDetalles de secuencias:",
+  "Araña: 3-16 notas aleatorias en octavas 5-8 (frecuencias agudas)",
+  "Grillo: 3-4 notas en octavas 2-4 (índices 0-14 de la escala)",
+  "Escarabajo: 4-7 notas solo Do en octavas 2-4",
+  "Cambio de secuencia cada 30-58 segundos",
+};
+
+const uint16_t PIEZO_BUGS_HELP_LINES = sizeof(PIEZO_BUGS_HELP) / sizeof(PIEZO_BUGS_HELP[0]);
+const uint16_t PIEZO_BUGS_DETAIL_LINES = sizeof(PIEZO_BUGS_DETAILS) / sizeof(PIEZO_BUGS_DETAILS[0]);
+
+// Imprime la línea line de la ayuda (textos, tabla de la escala, detalles);
+// devuelve false cuando ya no quedan
+bool piezoBugsPrintInfo(uint16_t line) {
+  if (line < PIEZO_BUGS_HELP_LINES) {
+    Serial.println(PIEZO_BUGS_HELP[line]);
+    return true;
+  }
+  line -= PIEZO_BUGS_HELP_LINES;
+  
+  // Frecuencias de la escala
+  if (line == 0) {
+    Serial.print("\nFrecuencias de la escala ");
+    Serial.print(SCALES[currentScale].name);
+    Serial.println(" en Do (octavas 2-8):");
+    return true;
+  }
+  line--;
+  if (line < scalePositions(currentScale)) {
+    NoteIndex note = scaleNote(currentScale, 0, line);
+    Serial.print("Nota ");
+    Serial.print(line + 1);
+    Serial.print(" (");
+    Serial.print(noteName(note));
+    Serial.print(noteOctave(note));
+    Serial.print("): ");
+    Serial.print(noteFrequency(note));
+    Serial.println(" Hz");
+    return true;
+  }
+  line -= scalePositions(currentScale);
+  
+  if (line < PIEZO_BUGS_DETAIL_LINES) {
+    Serial.println(PIEZO_BUGS_DETAILS[line]);
+    return true;
+  }
+  line -= PIEZO_BUGS_DETAIL_LINES;
+  if (line == 0) {
+    Serial.print("Nota raíz actual: ");
+    Serial.println(NOTE_NAMES[rootNoteOffset]);
+    return true;
+  }
+  return false;
+}
+
+// Etapa de fondo del arranque: la ayuda línea a línea y, cuando ya hubo
+// luz y sonido, la cronología. Después queda aparcada
+int8_t bootInfoStage = -1;
+uint16_t bootInfoLine = 0;
+
+uint32_t bootTask(uint32_t now) {
+  if (bootInfoStage >= 0) {
+    if (piezoBugsPrintInfo(bootInfoLine)) {
+      bootInfoLine++;
+      return now + BOOT_INFO_LINE_MS;
+    }
+    bootStageEnd(bootInfoStage);
+    bootInfoStage = -1;
+  }
+  if (bootReportWhenSettled()) return now + SCHEDULER_PARKED_MS;
+  return now + BOOT_INFO_LINE_MS;
+}
+
+// Arranque por etapas: luz y sonido en cuanto están listos (objetivo
+// BOOT_TARGET_MS) y lo que no hace falta para empezar, de fondo
+void piezoBugsSetup() {
+  bootBegin();
+  logClear();
+  int8_t stage = bootStageBegin("serie");
+  Serial.begin(115200);
+  Serial.println("=== PiezoBugs v0.9 - Sistema Modular de Insectos ===");
+  
+  // Valores por defecto (sin EEPROM)
+  rootNoteOffset = 0;
+  currentState = FREQ_NORMAL;
+  bootStageEnd(stage);
+  
+  stage = bootStageBegin("pines");
+  // Configurar pines
+  hal::pinMode(PIEZO_1_PIN, OUTPUT);
+  hal::pinMode(PIEZO_2_PIN, OUTPUT);
+  hal::pinMode(NEOPIXEL_PIN, OUTPUT);
+  
+  // Botones: ADC (GPIO36) y digitales con pull-up e interrupción
+  // (GPIO13 comparte con SD, GPIO23 con el Neopixel: ese se sondea)
+  buttonsBegin(hal::millis());
+  
+  // Configurar LEDs originales
+  hal::pinMode(LED_D1_PIN, OUTPUT);
+  hal::pinMode(LED_D3_PIN, OUTPUT);
+  hal::pinMode(LED_D4_PIN, OUTPUT);
+  
+  // Configurar LEDs alternativos
+  hal::pinMode(LED_ALT1_PIN, OUTPUT);
+  hal::pinMode(LED_ALT2_PIN, OUTPUT);
+  hal::pinMode(LED_ALT3_PIN, OUTPUT);
+  
+  // Inicializar LEDs originales
+  hal::digitalWrite(LED_D1_PIN, HIGH);  // D1 encendido (sistema activo)
+  hal::digitalWrite(LED_D3_PIN, LOW);   // D3 apagado (sin actividad de audio)
+  hal::digitalWrite(LED_D4_PIN, LOW);   // D4 apagado (sin mute)
+  
+  // Inicializar LEDs alternativos (para prueba)
+  hal::digitalWrite(LED_ALT1_PIN, HIGH); // LED alternativo 1 encendido
+  hal::digitalWrite(LED_ALT2_PIN, LOW);  // LED alternativo 2 apagado
+  hal::digitalWrite(LED_ALT3_PIN, LOW);  // LED alternativo 3 apagado
+  
+  bootStageEnd(stage);
+  
+  /* Debug de botones al inicio
+  Serial.println("\n=== DEBUG DE BOTONES ===");
+  Serial.print("Botón 1 (GPIO36): ");
+  Serial.println(hal::analogRead(BUTTON_1_PIN));
+  Serial.print("Botón 2 (GPIO13): ");
+  Serial.println(hal::digitalRead(BUTTON_2_PIN) ? "HIGH" : "LOW");
+  Serial.print("Botón 3 (GPIO4): ");
+  Serial.println(hal::digitalRead(BUTTON_3_PIN) ? "HIGH" : "LOW");
+  Serial.print("Botón 4 (GPIO23): ");
+  Serial.println(hal::digitalRead(BUTTON_4_PIN) ? "HIGH" : "LOW");
+  Serial.print("Botón 5 (GPIO0): ");
+  Serial.println(hal::digitalRead(BUTTON_5_PIN) ? "HIGH" : "LOW");
+  Serial.print("Botón 6 (GPIO5): ");
+  Serial.println(hal::digitalRead(BUTTON_6_PIN) ? "HIGH" : "LOW");
+  Serial.println("ADC: < 100, Digital: LOW = presionado (pull-up invertido)");
+  Serial.println("========================");
+  */
+  
+  // Inicializar Neopixel
+  stage = bootStageBegin("neopixel");
+  initNeopixel();
+  bootStageEnd(stage);
+  
+#if USE_I2S_SYNTH
+  // Voces por el codec del AudioKit en lugar de los piezos
+  stage = bootStageBegin("sintetizador");
+  if (synthBegin()) {
+    Serial.println("Sintetizador I2S activo (22,05 kHz, salida jack)");
+  }
+  bootStageEnd(stage);
+  
+  // Banco de muestras proyectado desde la flash y, con SD, caché en PSRAM
+  stage = bootStageBegin("muestras");
+  bool sdReady = USE_SD_SAMPLES && hal::sdBegin(SD_CS_PIN, SD_SCK_PIN, SD_MISO_PIN, SD_MOSI_PIN);
+  samplesBegin(hal::millis(), sdReady);
+  bootStageEnd(stage);
+#endif
+  
+  // Parámetros neutros, o los de los últimos datos guardados en flash:
+  // sin WiFi el motor ya suena como el árbol desde el primer insecto
+  stage = bootStageBegin("cache");
+  paramBusBegin();
+  TreeData cached;
+  if (treeCacheBegin(treeCache) && treeCacheLatest(treeCache, cached)) {
+    paramBusApplyTree(cached);
+    paramBusSettle();
+    Serial.println("Datos del árbol guardados en flash: aplicados");
+  }
+  bootStageEnd(stage);
+  
+  // Crear voces: primeros intervalos y secuencias. El primer insecto
+  // canta ya, como señal de vida; los demás esperan su pausa
+  stage = bootStageBegin("voces");
+  sequencePoolsBegin(SEQUENCE_SEED ? SEQUENCE_SEED : (uint32_t)hal::random(1, 0x7FFFFFFF));
+  voicesInitDefaults();
+  uint32_t now = hal::millis();
+  if (voices.count > 0) voiceStartSequence(0, now);
+  bootStageEnd(stage);
+  
+  // Planificar los subsistemas a partir de ahora
+  schedulerClear();
+  voicesTaskId = schedulerAdd("voces", voicesTask, now);
+  buttonsTaskId = schedulerAdd("botones", buttonsTask, now);
+  neopixelTaskId = schedulerAdd("neopixel", neopixelTask, now);
+  controlTaskId = schedulerAdd("control", controlTask, now);
+  bootInfoStage = bootStageBegin("ayuda", true);
+  bootInfoLine = 0;
+  bootTaskId = schedulerAdd("arranque", bootTask, now + BOOT_INFO_LINE_MS);
+  // Desde aquí el loop no reserva memoria: la referencia para la telemetría
+  heapMonitorBegin();
+  heapTaskId = schedulerAdd("memoria", heapMonitorTask, now + HEAP_REPORT_MS);
+#if USE_I2S_SYNTH
+  samplesTaskId = schedulerAdd("muestras", samplesTask, samples.reportDeadline);
+#endif
+#if ENABLE_PROFILER
+  profileReset();
+  profileTaskId = schedulerAdd("perfil", profileTask, now + PROFILE_POLL_MS);
+#endif
+  Serial.println("Iniciando simulación...");
+}
+
+void piezoBugsLoop() {
+  // Una interrupción de botón adelanta su tarea
+  if (buttonsTakeWake()) schedulerSetDeadline(buttonsTaskId, hal::millis());
+  
+  // Ejecutar las tareas vencidas (voces, botones, Neopixel, control, arranque)
+  {
+    PROFILE_SCOPE(PROF_TASKS);
+    schedulerRunDue(hal::millis());
+  }
+  
+  // Antes de esperar: secuencias para las reservas y mensajes pendientes
+  voicesRefillSequences(SEQUENCE_REFILL_MAX);
+  logDrain(LOG_DRAIN_MAX);
+  
+  // Dormir hasta el próximo vencimiento; si una entrada despierta antes,
+  // la siguiente vuelta mira los botones
+  if (schedulerSleep(hal::millis())) buttonsNotify();
+}
+
+#endif // PIEZO_BUGS_H
@@ -0,0 +1,47 @@
+/*
+ * prng.h - Generador pseudoaleatorio pequeño y rápido (PCG32)
+ *
+ * 16 bytes de estado, una multiplicación de 64 bits por número y flujos
+ * independientes: con la misma semilla, cada flujo (p. ej. uno por voz)
+ * da siempre la misma serie, sin que lo que consuma un flujo mueva a los
+ * demás. No sirve para criptografía.
+ */
+
+#ifndef PIEZOBUGS_PRNG_H
+#define PIEZOBUGS_PRNG_H
+
+#include <stdint.h>
+
+struct Prng {
+  uint64_t state;
+  uint64_t inc;      // Siempre impar: elige el flujo
+};
+
+inline uint32_t prngNext(Prng &r) {
+  uint64_t old = r.state;
+  r.state = old * 6364136223846793005ULL + r.inc;
+  uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+  uint32_t rot = (uint32_t)(old >> 59);
+  return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+void prngSeed(Prng &r, uint32_t seed, uint32_t stream) {
+  r.state = 0;
+  r.inc = ((uint64_t)stream << 1) | 1u;
+  prngNext(r);
+  r.state += seed;
+  prngNext(r);
+}
+
+// Entero en [0, bound) sin división (multiplicar y desplazar)
+inline uint32_t prngBelow(Prng &r, uint32_t bound) {
+  return (uint32_t)(((uint64_t)prngNext(r) * bound) >> 32);
+}
+
+// Entero en [minValue, maxValue), como random() de Arduino
+inline int32_t prngRange(Prng &r, int32_t minValue, int32_t maxValue) {
+  if (maxValue <= minValue) return minValue;
+  return minValue + (int32_t)prngBelow(r, (uint32_t)(maxValue - minValue));
+}
+
+#endif // PIEZOBUGS_PRNG_H
@@ -0,0 +1,170 @@
+/*
+ * profile.h - Perfilador por subsistema con histogramas de ciclos
+ *
+ * PROFILE_SCOPE(zona) mide en ciclos de CPU (hal::cycleCount(): el
+ * contador CCOUNT del ESP32, un reloj del host en el build nativo) lo que
+ * tarda el bloque en el que está. Cada zona guarda mínimo, suma, máximo y
+ * un histograma log-lineal (4 cubetas por octava, error < 25 %) en memoria
+ * fija, sin heap, para sacar la media y el p99.
+ *
+ * Con ENABLE_PROFILER a 0 (por defecto) las macros no generan nada.
+ *
+ * Volcado por la consola serie: 'p' imprime, 'r' pone a cero. Formato
+ * compacto, una línea por zona:
+ *   prof,mhz,<ciclos por us>
+ *   prof,<zona>,<n>,<mín>,<media>,<p99>,<máx>,<cubeta>:<n>;<cubeta>:<n>...
+ * en ciclos; tools/profile_decode.py lo pasa a una tabla en us.
+ */
+
+#ifndef PIEZOBUGS_PROFILE_H
+#define PIEZOBUGS_PROFILE_H
+
+#include <string.h>
+#include "hal.h"
+#include "config.h"
+
+// Zonas medidas
+enum ProfileZone {
+  PROF_TASKS,          // Todas las tareas vencidas de una vuelta del loop
+  PROF_VOICES,         // voicesUpdate (antes los handlers de cada insecto)
+  PROF_VALIDATE,       // voiceValidate (antes validateSystemState)
+  PROF_BUTTONS,        // handleButtons
+  PROF_BUTTON_ADC,     // analogRead del botón 1
+  PROF_NEOPIXEL,       // updateNeopixel
+  PROF_NEOPIXEL_SHOW,  // show() de los aros
+  PROF_CONTROL,        // paramBusTick
+  PROF_SEQUENCES,      // sequencePoolsRefill
+  PROF_SAMPLES,        // Carga de muestras de la SD (samplesService)
+  PROF_ZONE_COUNT
+};
+
+const char* const PROFILE_ZONE_NAMES[PROF_ZONE_COUNT] = {
+  "tareas", "voces", "validar", "botones", "adc", "neopixel", "show", "control", "secuencias", "muestras"
+};
+
+#if ENABLE_PROFILER
+
+// 0..7 exactos; a partir de 8, 4 cubetas por octava hasta 2^32
+const uint8_t PROFILE_BUCKETS = 124;
+
+struct ProfileHistogram {
+  uint32_t count;
+  uint64_t sum;
+  uint32_t minCycles;
+  uint32_t maxCycles;
+  uint32_t buckets[PROFILE_BUCKETS];
+};
+
+struct Profiler {
+  ProfileHistogram zones[PROF_ZONE_COUNT];
+};
+
+Profiler profiler;
+
+inline uint8_t profileBucket(uint32_t cycles) {
+  if (cycles < 8) return cycles;
+  uint8_t octave = 31 - __builtin_clz(cycles);
+  return 4 * (octave - 1) + ((cycles >> (octave - 2)) & 3);
+}
+
+// Mayor valor que cae en la cubeta
+inline uint32_t profileBucketTop(uint8_t bucket) {
+  if (bucket < 8) return bucket;
+  uint8_t octave = bucket / 4 + 1;
+  uint32_t width = 1u << (octave - 2);
+  return (uint32_t)(4 + bucket % 4) * width + (width - 1);
+}
+
+inline void profileRecord(ProfileZone zone, uint32_t cycles) {
+  ProfileHistogram &h = profiler.zones[zone];
+  if (h.count == 0 || cycles < h.minCycles) h.minCycles = cycles;
+  if (cycles > h.maxCycles) h.maxCycles = cycles;
+  h.count++;
+  h.sum += cycles;
+  h.buckets[profileBucket(cycles)]++;
+}
+
+void profileReset() {
+  memset(&profiler, 0, sizeof(profiler));
+}
+
+// Percentil (0..1) con la resolución de las cubetas, dentro de [mín, máx]
+uint32_t profilePercentile(const ProfileHistogram &h, float fraction) {
+  if (h.count == 0) return 0;
+  uint32_t rank = (uint32_t)(fraction * h.count + 0.5f);
+  if (rank < 1) rank = 1;
+  uint32_t seen = 0;
+  for (uint8_t b = 0; b < PROFILE_BUCKETS; b++) {
+    seen += h.buckets[b];
+    if (seen >= rank) {
+      uint32_t top = profileBucketTop(b);
+      if (top < h.minCycles) return h.minCycles;
+      return top < h.maxCycles ? top : h.maxCycles;
+    }
+  }
+  return h.maxCycles;
+}
+
+uint32_t profileMean(const ProfileHistogram &h) {
+  return h.count ? (uint32_t)(h.sum / h.count) : 0;
+}
+
+// Mide desde su construcción hasta el final del bloque
+struct ProfileScope {
+  ProfileZone zone;
+  uint32_t start;
+  explicit ProfileScope(ProfileZone z) : zone(z), start(hal::cycleCount()) {}
+  ~ProfileScope() { profileRecord(zone, hal::cycleCount() - start); }
+};
+
+void profileDump() {
+  Serial.print("prof,mhz,");
+  Serial.println(hal::cyclesPerMicro());
+  for (uint8_t z = 0; z < PROF_ZONE_COUNT; z++) {
+    const ProfileHistogram &h = profiler.zones[z];
+    Serial.print("prof,");
+    Serial.print(PROFILE_ZONE_NAMES[z]);
+    Serial.print(",");
+    Serial.print(h.count);
+    Serial.print(",");
+    Serial.print(h.minCycles);
+    Serial.print(",");
+    Serial.print(profileMean(h));
+    Serial.print(",");
+    Serial.print(profilePercentile(h, 0.99f));
+    Serial.print(",");
+    Serial.print(h.maxCycles);
+    Serial.print(",");
+    bool first = true;
+    for (uint8_t b = 0; b < PROFILE_BUCKETS; b++) {
+      if (h.buckets[b] == 0) continue;
+      if (!first) Serial.print(";");
+      Serial.print(b);
+      Serial.print(":");
+      Serial.print(h.buckets[b]);
+      first = false;
+    }
+    Serial.println();
+  }
+}
+
+// Órdenes por la consola serie; la llama la tarea "perfil"
+void profilePollSerial() {
+  while (Serial.available() > 0) {
+    int command = Serial.read();
+    if (command == 'p') profileDump();
+    if (command == 'r') profileReset();
+  }
+}
+
+#define PROFILE_JOIN2(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b)
+#define PROFILE_SCOPE(zone) ProfileScope PROFILE_JOIN(profileScope, __LINE__)(zone)
+
+#else
+
+#define PROFILE_SCOPE(zone)
+
+#endif // ENABLE_PROFILER
+
+#endif // PIEZOBUGS_PROFILE_H
@@ -0,0 +1,186 @@
+/*
+ * resampler.h - Conversión de frecuencia de muestreo polifásica en enteros
+ *
+ * Pasa PCM mono de 16 bits de cualquier frecuencia a la de salida (la del
+ * sintetizador), para que muestras grabadas a 8, 16, 44,1 o 48 kHz suenen
+ * por el mismo flujo I2S sin cambiar su reloj.
+ *
+ * Filtro FIR paso bajo (sinc con ventana de Kaiser) partido en
+ * RESAMPLER_PHASES fases. Cada salida cae entre dos fases de la tabla: se
+ * calculan las dos sumas y se interpola entre ellas, así la tabla es pequeña
+ * y el error de fase no se oye. Al bajar de frecuencia el filtro se
+ * estrecha y se alarga en proporción (más coeficientes por salida) para que
+ * lo que no cabe en la salida no vuelva como alias.
+ *
+ * - resamplerTableBuild(): en setup, en coma flotante; los coeficientes
+ *   (Q15, cada fase suma exactamente 1) van en memoria que da quien llama
+ * - resamplerProcess(): por bloques, solo enteros; guarda el historial entre
+ *   llamadas, así que da igual cómo se corte la entrada
+ *
+ * La primera salida corresponde a la primera entrada (el retardo del filtro
+ * ya está descontado); para sacar la cola al final se pasan taps / 2
+ * entradas a nullptr, que cuentan como ceros.
+ */
+
+#ifndef PIEZOBUGS_RESAMPLER_H
+#define PIEZOBUGS_RESAMPLER_H
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "config.h"
+
+const uint8_t RESAMPLER_PHASE_BITS = 5;
+const uint16_t RESAMPLER_PHASES = 1 << RESAMPLER_PHASE_BITS;
+const uint8_t RESAMPLER_TAPS = 32;               // Coeficientes por salida sin bajar de frecuencia
+const uint8_t RESAMPLER_MAX_TAPS = RESAMPLER_TAPS * RESAMPLER_MAX_RATIO;
+const float RESAMPLER_KAISER_BETA = 7.0f;        // ~70 dB de atenuación fuera de banda
+
+struct ResamplerTable {
+  uint32_t inRate;
+  uint32_t outRate;
+  uint8_t taps;          // Par
+  uint32_t stepInt;      // Entradas por salida: parte entera
+  uint32_t stepFrac;     // y fracción (Q32)
+  const int16_t *coeffs; // (RESAMPLER_PHASES + 1) fases de taps coeficientes
+};
+
+struct Resampler {
+  const ResamplerTable *table;
+  uint32_t frac;         // Posición de la próxima salida entre dos entradas (Q32)
+  uint32_t pending;      // Entradas que faltan para la próxima salida
+  uint8_t write;
+  int16_t history[2 * RESAMPLER_MAX_TAPS];   // Últimas taps entradas, duplicadas
+};
+
+// ===============================================
+// TABLAS (en setup)
+// ===============================================
+
+// Coeficientes por salida para pasar de inRate a outRate; 0 si la bajada
+// es mayor que RESAMPLER_MAX_RATIO
+uint8_t resamplerTaps(uint32_t inRate, uint32_t outRate) {
+  if (inRate == 0 || outRate == 0 || inRate > outRate * RESAMPLER_MAX_RATIO) return 0;
+  if (inRate <= outRate) return RESAMPLER_TAPS;
+  uint32_t taps = ((uint64_t)RESAMPLER_TAPS * inRate + outRate - 1) / outRate;
+  return (taps + 1) & ~1u;
+}
+
+inline uint32_t resamplerTableSize(uint8_t taps) { return (RESAMPLER_PHASES + 1) * (uint32_t)taps; }
+
+// Bessel I0 por su serie: basta para la ventana de Kaiser
+static float resamplerBesselI0(float x) {
+  float sum = 1.0f, term = 1.0f;
+  for (uint8_t k = 1; k < 32; k++) {
+    term *= (x / (2.0f * k)) * (x / (2.0f * k));
+    sum += term;
+    if (term < sum * 1e-9f) break;
+  }
+  return sum;
+}
+
+// Calcula la tabla en storage (capacity coeficientes). false si la
+// conversión no se admite o no cabe
+bool resamplerTableBuild(ResamplerTable &t, uint32_t inRate, uint32_t outRate, int16_t *storage,
+                         uint32_t capacity) {
+  uint8_t taps = resamplerTaps(inRate, outRate);
+  if (taps == 0 || resamplerTableSize(taps) > capacity) return false;
+
+  // Corte: la banda de transición de la ventana acaba en el Nyquist menor
+  const float half = taps / 2;
+  const float attenuation = RESAMPLER_KAISER_BETA / 0.1102f + 8.7f;
+  const float transition = (attenuation - 8.0f) / (2.285f * 2.0f * (float)M_PI * taps);
+  const float nyquist = inRate <= outRate ? 0.5f : 0.5f * outRate / inRate;
+  const float cutoff = nyquist - transition / 2;
+  const float windowNorm = resamplerBesselI0(RESAMPLER_KAISER_BETA);
+
+  for (uint16_t p = 0; p <= RESAMPLER_PHASES; p++) {
+    int16_t *c = storage + (uint32_t)p * taps;
+    float h[2 * RESAMPLER_MAX_TAPS];
+    float sum = 0;
+    for (uint8_t j = 0; j < taps; j++) {
+      // Distancia de la entrada j (la más antigua primero) a la salida
+      float x = (float)p / RESAMPLER_PHASES + half - 1 - j;
+      float r = x / half;
+      float window = r * r < 1 ? resamplerBesselI0(RESAMPLER_KAISER_BETA * sqrtf(1 - r * r)) / windowNorm : 0;
+      float arg = 2.0f * (float)M_PI * cutoff * x;
+      h[j] = 2.0f * cutoff * (x == 0 ? 1.0f : sinf(arg) / arg) * window;
+      sum += h[j];
+    }
+    // Cada fase suma 32768: la continua no cambia de una salida a otra
+    int32_t total = 0;
+    uint8_t center = 0;
+    for (uint8_t j = 0; j < taps; j++) {
+      c[j] = (int16_t)lroundf(h[j] / sum * 32768.0f);
+      total += c[j];
+      if (c[j] > c[center]) center = j;
+    }
+    c[center] += 32768 - total;
+  }
+
+  uint64_t step = ((uint64_t)inRate << 32) / outRate;
+  t.inRate = inRate;
+  t.outRate = outRate;
+  t.taps = taps;
+  t.stepInt = (uint32_t)(step >> 32);
+  t.stepFrac = (uint32_t)step;
+  t.coeffs = storage;
+  return true;
+}
+
+// ===============================================
+// FLUJO
+// ===============================================
+
+void resamplerReset(Resampler &r, const ResamplerTable *table) {
+  r.table = table;
+  r.frac = 0;
+  r.pending = table ? table->taps / 2 + 1 : 0;
+  r.write = 0;
+  memset(r.history, 0, sizeof(r.history));
+}
+
+// Convierte hasta inFrames entradas (nullptr = ceros) en hasta outFrames
+// salidas. Devuelve las salidas escritas; consumed, las entradas usadas.
+// Para cuando se acaba una de las dos
+uint32_t resamplerProcess(Resampler &r, const int16_t *in, uint32_t inFrames, int16_t *out, uint32_t outFrames,
+                          uint32_t &consumed) {
+  const ResamplerTable &t = *r.table;
+  const uint8_t taps = t.taps;
+  uint32_t i = 0, o = 0;
+
+  while (o < outFrames) {
+    // Historial hasta la entrada que sigue a la salida
+    while (r.pending > 0 && i < inFrames) {
+      int16_t s = in ? in[i] : 0;
+      r.history[r.write] = s;
+      r.history[r.write + taps] = s;
+      if (++r.write == taps) r.write = 0;
+      r.pending--;
+      i++;
+    }
+    if (r.pending > 0) break;
+
+    // Dos fases vecinas sobre las últimas taps entradas, interpoladas
+    const int16_t *x = r.history + r.write;
+    const int16_t *c0 = t.coeffs + (r.frac >> (32 - RESAMPLER_PHASE_BITS)) * taps;
+    const int16_t *c1 = c0 + taps;
+    int32_t a0 = 0, a1 = 0;
+    for (uint8_t j = 0; j < taps; j++) {
+      a0 += (int32_t)x[j] * c0[j];
+      a1 += (int32_t)x[j] * c1[j];
+    }
+    int32_t weight = (r.frac >> (32 - RESAMPLER_PHASE_BITS - 15)) & 0x7FFF;
+    int64_t y = a0 + ((((int64_t)a1 - a0) * weight) >> 15);
+    y = (y + (1 << 14)) >> 15;
+    out[o++] = (int16_t)(y > 32767 ? 32767 : (y < -32768 ? -32768 : y));
+
+    uint64_t next = (uint64_t)r.frac + t.stepFrac;
+    r.frac = (uint32_t)next;
+    r.pending = t.stepInt + (uint32_t)(next >> 32);
+  }
+  consumed = i;
+  return o;
+}
+
+#endif // PIEZOBUGS_RESAMPLER_H
@@ -0,0 +1,175 @@
+/*
+ * sample_bank.h - Banco de muestras en la partición de datos de la flash
+ *
+ * Las muestras cortas (golpes, gotas, crujidos) van en un banco que
+ * tools/sample_bank.py genera a partir de archivos WAV y que se graba en la
+ * partición de datos a partir de SAMPLE_BANK_OFFSET. Al arrancar se proyecta
+ * entero en memoria (hal::flashMap): el directorio y el PCM se leen en su
+ * sitio, a través de la caché de la flash, sin copiarlos a RAM. Disparar
+ * una muestra del banco es pasar un puntero al sintetizador.
+ *
+ * Las muestras largas se quedan en la SD; el banco solo guarda dónde están
+ * (ruta, posición del PCM dentro del WAV, longitud), así que al arrancar no
+ * hay que recorrer la tarjeta ni leer cabeceras. samples.h las carga en la
+ * caché de la PSRAM.
+ *
+ * Formato (little endian):
+ *   cabecera (16 B): magic "PBSB", versión, número de entradas, tamaño
+ *                    total y CRC-32 del directorio
+ *   directorio: una entrada de 64 B por muestra
+ *   datos: PCM mono de 16 bits de las muestras de la flash, alineado a 4
+ */
+
+#ifndef PIEZOBUGS_SAMPLE_BANK_H
+#define PIEZOBUGS_SAMPLE_BANK_H
+
+#include <string.h>
+#include "hal.h"
+#include "config.h"
+#include "log.h"
+#include "tree_cache.h"
+
+// ===============================================
+// FORMATO
+// ===============================================
+
+const uint32_t SAMPLE_BANK_MAGIC = 0x42534250;   // "PBSB"
+const uint16_t SAMPLE_BANK_VERSION = 1;
+const uint8_t SAMPLE_NAME_SIZE = 16;
+const uint8_t SAMPLE_PATH_SIZE = 32;
+const uint8_t SAMPLE_MAX = 64;                   // Entradas del banco como mucho
+
+enum SampleSource : uint32_t {
+  SAMPLE_IN_FLASH,     // PCM dentro del banco
+  SAMPLE_ON_SD         // PCM en un WAV de la SD
+};
+
+struct SampleBankHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;
+  uint32_t size;       // Bytes del banco: cabecera, directorio y datos
+  uint32_t crc;        // CRC-32 del directorio
+};
+
+struct SampleBankEntry {
+  char name[SAMPLE_NAME_SIZE];
+  char path[SAMPLE_PATH_SIZE];   // SD: ruta del WAV desde la raíz; flash: vacío
+  uint32_t offset;               // Flash: desde el inicio del banco; SD: del PCM dentro del WAV
+  uint32_t frames;               // Muestras mono de 16 bits
+  uint32_t sampleRate;
+  uint32_t source;               // SampleSource
+};
+
+static_assert(sizeof(SampleBankHeader) == 16, "Cabecera de 16 bytes");
+static_assert(sizeof(SampleBankEntry) == 64, "Entrada de 64 bytes");
+static_assert(SAMPLE_BANK_OFFSET % hal::FLASH_SECTOR_SIZE == 0, "El banco empieza en un sector");
+static_assert(TREE_CACHE_SECTORS * hal::FLASH_SECTOR_SIZE <= SAMPLE_BANK_OFFSET,
+              "El banco no puede pisar la caché del árbol");
+
+// Motivos de rechazo del banco (LOG_SAMPLE_BANK_INVALID)
+enum SampleBankError : uint8_t {
+  SAMPLE_BANK_OK,
+  SAMPLE_BANK_EMPTY,          // No hay banco grabado (flash borrada)
+  SAMPLE_BANK_BAD_HEADER,     // Versión, número de entradas o tamaño imposibles
+  SAMPLE_BANK_BAD_CRC,
+  SAMPLE_BANK_BAD_ENTRY,      // Datos fuera del banco, sin alinear o ruta sin terminar
+  SAMPLE_BANK_NO_MAP          // No se pudo proyectar
+};
+
+// ===============================================
+// ESTADO
+// ===============================================
+
+struct SampleBank {
+  const uint8_t *base;                 // Banco proyectado; nullptr = no hay banco
+  const SampleBankEntry *entries;      // Directorio, en la flash
+  uint16_t count;
+  uint32_t size;
+  uint16_t flashCount;
+  uint16_t sdCount;
+  uint32_t flashBytes;                 // PCM dentro del banco
+  uint8_t error;                       // SampleBankError del último sampleBankBegin
+};
+
+SampleBank sampleBank;
+
+// ===============================================
+// LECTURA
+// ===============================================
+
+bool sampleBankEntryValid(const SampleBankEntry &e, uint32_t bankSize, uint32_t dataStart) {
+  if (e.name[SAMPLE_NAME_SIZE - 1] != 0 || e.path[SAMPLE_PATH_SIZE - 1] != 0) return false;
+  if (e.source == SAMPLE_IN_FLASH) {
+    if (e.offset % 4 || e.offset < dataStart) return false;
+    return e.offset <= bankSize && e.frames <= (bankSize - e.offset) / 2;
+  }
+  return e.source == SAMPLE_ON_SD && e.path[0] == '/';
+}
+
+// Lee la cabecera, proyecta el banco y comprueba el directorio. Sin banco
+// válido bank.base queda a nullptr y las muestras no suenan
+bool sampleBankBegin(SampleBank &bank) {
+  bank = SampleBank();
+  SampleBankHeader header;
+  if (!hal::flashBegin() || !hal::flashRead(SAMPLE_BANK_OFFSET, &header, sizeof(header)) ||
+      header.magic != SAMPLE_BANK_MAGIC) {
+    bank.error = SAMPLE_BANK_EMPTY;
+    return false;
+  }
+  uint32_t dataStart = sizeof(header) + (uint32_t)header.count * sizeof(SampleBankEntry);
+  if (header.version != SAMPLE_BANK_VERSION || header.count == 0 || header.count > SAMPLE_MAX ||
+      header.size < dataStart || header.size > hal::flashSize() - SAMPLE_BANK_OFFSET) {
+    bank.error = SAMPLE_BANK_BAD_HEADER;
+    LOG(LOG_SAMPLE_BANK_INVALID, bank.error, 0);
+    return false;
+  }
+
+  const uint8_t *base = hal::flashMap(SAMPLE_BANK_OFFSET, header.size);
+  if (!base) {
+    bank.error = SAMPLE_BANK_NO_MAP;
+    LOG(LOG_SAMPLE_BANK_INVALID, bank.error, 0);
+    return false;
+  }
+  const SampleBankEntry *entries = (const SampleBankEntry *)(base + sizeof(header));
+  if (crc32(entries, dataStart - sizeof(header)) != header.crc) {
+    bank.error = SAMPLE_BANK_BAD_CRC;
+    LOG(LOG_SAMPLE_BANK_INVALID, bank.error, 0);
+    return false;
+  }
+  for (uint16_t i = 0; i < header.count; i++) {
+    if (!sampleBankEntryValid(entries[i], header.size, dataStart)) {
+      bank.error = SAMPLE_BANK_BAD_ENTRY;
+      LOG(LOG_SAMPLE_BANK_INVALID, bank.error, i);
+      return false;
+    }
+    if (entries[i].source == SAMPLE_IN_FLASH) {
+      bank.flashCount++;
+      bank.flashBytes += entries[i].frames * 2;
+    } else {
+      bank.sdCount++;
+    }
+  }
+
+  bank.base = base;
+  bank.entries = entries;
+  bank.count = header.count;
+  bank.size = header.size;
+  LOG(LOG_SAMPLE_BANK, bank.flashCount, bank.flashBytes / 1024, bank.sdCount);
+  return true;
+}
+
+// Índice de la muestra llamada name, o -1
+int16_t sampleFind(const SampleBank &bank, const char *name) {
+  for (uint16_t i = 0; i < bank.count; i++) {
+    if (strncmp(bank.entries[i].name, name, SAMPLE_NAME_SIZE) == 0) return i;
+  }
+  return -1;
+}
+
+// PCM de una muestra del banco, leído directamente de la flash proyectada
+inline const int16_t *sampleBankData(const SampleBank &bank, uint16_t id) {
+  return (const int16_t *)(bank.base + bank.entries[id].offset);
+}
+
+#endif // PIEZOBUGS_SAMPLE_BANK_H
@@ -0,0 +1,411 @@
+/*
+ * samples.h - Reproducción de muestras: banco en flash y caché LRU en PSRAM
+ *
+ * Las muestras suenan por las voces de muestra del sintetizador I2S
+ * (synth.h), que leen el PCM de donde ya está:
+ * - Muestras del banco (sample_bank.h): de la flash proyectada. Disparar es
+ *   pasar un puntero; nunca hay fallo.
+ * - Muestras de la SD: de una caché en la PSRAM con SAMPLE_CACHE_SLOTS
+ *   huecos fijos de SAMPLE_CACHE_SLOT_FRAMES. Un acierto también es solo un
+ *   puntero: ni se abre el archivo ni se copia nada en la ruta del audio.
+ *   Un fallo pide la carga, que hace la tarea "muestras" del planificador
+ *   por trozos de SAMPLE_LOAD_CHUNK bytes; el disparo suena al terminar si
+ *   no ha esperado más de SAMPLE_LATE_MS. Al llenarse se expulsa el hueco
+ *   usado hace más tiempo (LRU) que no esté sonando.
+ *
+ * Las muestras a otra frecuencia que SYNTH_SAMPLE_RATE suenan convertidas
+ * por la voz (resampler.h). samplesBegin() calcula una tabla de filtro por
+ * frecuencia del banco, hasta SAMPLE_RATE_TABLES y SAMPLE_RATE_COEFFS
+ * coeficientes; las que no caben no suenan (LOG_SAMPLE_UNPLAYABLE).
+ *
+ * La PSRAM se reserva una vez en samplesBegin(), dentro de setup(); el
+ * loop no reserva nada. Cada SAMPLE_REPORT_MS se registran los aciertos y
+ * fallos de la caché (LOG_SAMPLE_CACHE) si ha habido disparos.
+ */
+
+#ifndef PIEZOBUGS_SAMPLES_H
+#define PIEZOBUGS_SAMPLES_H
+
+#include <string.h>
+#include "hal.h"
+#include "config.h"
+#include "log.h"
+#include "profile.h"
+#include "resampler.h"
+#include "sample_bank.h"
+#include "synth.h"
+
+// Tras el último bloque de una muestra aún puede quedar audio en los
+// buffers DMA y eventos en la cola: el hueco sigue ocupado este margen
+const uint32_t SAMPLE_BUSY_MARGIN_MS = 50;
+
+// Motivos de fallo de carga (LOG_SAMPLE_LOAD_FAILED)
+enum SampleLoadError : uint8_t {
+  SAMPLE_LOAD_NO_CACHE = 1,   // Sin PSRAM
+  SAMPLE_LOAD_ALL_BUSY,       // Todos los huecos están sonando
+  SAMPLE_LOAD_OPEN,           // No se pudo abrir el WAV
+  SAMPLE_LOAD_SHORT,          // El WAV es más corto de lo que dice el banco
+  SAMPLE_LOAD_READ            // Error de lectura
+};
+
+// ===============================================
+// ESTADO
+// ===============================================
+
+struct Samples {
+  // Caché: hueco s = arena + s * SAMPLE_CACHE_SLOT_FRAMES
+  int16_t *arena;                                   // En la PSRAM; nullptr = sin caché
+  uint8_t slots;
+  int16_t slotSample[SAMPLE_CACHE_SLOTS];           // Muestra del hueco (-1 = libre)
+  uint32_t slotFrames[SAMPLE_CACHE_SLOTS];          // Cargadas hasta ahora
+  uint32_t slotUse[SAMPLE_CACHE_SLOTS];             // Marca del último uso (LRU)
+  uint32_t slotBusyUntil[SAMPLE_CACHE_SLOTS];       // Sonando hasta este millis(): no se expulsa
+  bool slotBusy[SAMPLE_CACHE_SLOTS];                // slotBusyUntil vale (ver sampleStillBusy)
+  int8_t sampleSlot[SAMPLE_MAX];                    // Hueco de cada muestra (-1 = no está)
+  uint32_t useStamp;
+
+  // Carga en curso (una a la vez) y disparo que la espera
+  int8_t loadingSlot;                               // -1 = ninguna
+  int16_t pendingSample;                            // -1 = ninguno
+  uint16_t pendingGain;
+  uint32_t pendingSince;
+
+  // Voces de muestra del sintetizador
+  uint32_t voiceBusyUntil[SYNTH_SAMPLE_VOICES];
+  bool voiceBusy[SYNTH_SAMPLE_VOICES];
+
+  // Tablas de remuestreo, una por frecuencia del banco
+  ResamplerTable rateTables[SAMPLE_RATE_TABLES];
+  uint8_t rateTableCount;
+  uint32_t rateCoeffsUsed;
+
+  uint32_t reportDeadline;
+
+  // Estadísticas
+  uint32_t flashPlays;
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t evictions;
+  uint32_t late;                                    // Disparos que la carga dejó sin sonar
+  uint32_t loads;
+  uint32_t failures;
+  uint64_t loadedBytes;
+  uint32_t reportedHits;                            // En el último informe
+  uint32_t reportedMisses;
+  uint32_t reportedEvictions;
+  uint32_t reportedLate;
+};
+
+Samples samples;
+hal::SdFile sampleFile;   // WAV que se está cargando
+int16_t sampleRateCoeffs[SAMPLE_RATE_COEFFS];
+
+// ===============================================
+// INICIALIZACIÓN (en setup)
+// ===============================================
+
+// Tabla para convertir desde rate; nullptr si la muestra ya está a
+// SYNTH_SAMPLE_RATE o no hay tabla para ella
+const ResamplerTable *sampleRateTable(uint32_t rate) {
+  for (uint8_t t = 0; t < samples.rateTableCount; t++) {
+    if (samples.rateTables[t].inRate == rate) return &samples.rateTables[t];
+  }
+  return nullptr;
+}
+
+// Una tabla por frecuencia distinta de la del sintetizador, mientras quepan
+void sampleBuildRateTables() {
+  for (uint16_t id = 0; id < sampleBank.count; id++) {
+    uint32_t rate = sampleBank.entries[id].sampleRate;
+    if (rate == SYNTH_SAMPLE_RATE || sampleRateTable(rate) || samples.rateTableCount == SAMPLE_RATE_TABLES) continue;
+    ResamplerTable &t = samples.rateTables[samples.rateTableCount];
+    if (resamplerTableBuild(t, rate, SYNTH_SAMPLE_RATE, sampleRateCoeffs + samples.rateCoeffsUsed,
+                            SAMPLE_RATE_COEFFS - samples.rateCoeffsUsed)) {
+      samples.rateCoeffsUsed += resamplerTableSize(t.taps);
+      samples.rateTableCount++;
+    }
+  }
+}
+
+// Lee el banco y reserva la caché. sdReady indica si la SD está montada;
+// sin ella, o sin PSRAM, solo suenan las muestras del banco
+void samplesBegin(uint32_t now, bool sdReady) {
+  sampleFile.close();
+  samples = Samples();
+  for (uint8_t s = 0; s < SAMPLE_CACHE_SLOTS; s++) samples.slotSample[s] = -1;
+  memset(samples.sampleSlot, -1, sizeof(samples.sampleSlot));
+  samples.loadingSlot = -1;
+  samples.pendingSample = -1;
+  samples.reportDeadline = now + SAMPLE_REPORT_MS;
+
+  sampleBankBegin(sampleBank);
+  sampleBuildRateTables();
+  if (sdReady && sampleBank.sdCount > 0) {
+    samples.arena = (int16_t *)hal::psramAlloc(SAMPLE_CACHE_SLOTS * SAMPLE_CACHE_SLOT_FRAMES * sizeof(int16_t));
+    if (samples.arena) samples.slots = SAMPLE_CACHE_SLOTS;
+  }
+}
+
+// ===============================================
+// CACHÉ
+// ===============================================
+
+inline int16_t *sampleSlotData(uint8_t slot) {
+  return samples.arena + (uint32_t)slot * SAMPLE_CACHE_SLOT_FRAMES;
+}
+
+inline bool sampleCached(uint16_t id) {
+  int8_t slot = samples.sampleSlot[id];
+  return slot >= 0 && slot != samples.loadingSlot;
+}
+
+// Porcentaje de disparos de la SD servidos desde la caché
+uint8_t sampleCacheHitPercent() {
+  uint32_t total = samples.hits + samples.misses;
+  return total ? (uint8_t)((uint64_t)samples.hits * 100 / total) : 100;
+}
+
+void sampleLoadFailed(uint16_t id, uint8_t reason) {
+  samples.failures++;
+  LOG(LOG_SAMPLE_LOAD_FAILED, id, reason);
+}
+
+// Un hueco o una voz que sigue sonando. La marca solo se compara mientras
+// el flag está puesto y al pasar se borra: una marca sin usar (0) o de hace
+// más de 2^31 ms no parece futura cuando millis() da la vuelta
+inline bool sampleStillBusy(bool &busy, uint32_t until, uint32_t now) {
+  if (busy && deadlineReached(until, now)) busy = false;
+  return busy;
+}
+
+// Borra los flags vencidos, para que ninguna marca pase 2^31 ms sin mirarse
+void samplesExpireBusy(uint32_t now) {
+  for (uint8_t s = 0; s < SAMPLE_CACHE_SLOTS; s++) {
+    sampleStillBusy(samples.slotBusy[s], samples.slotBusyUntil[s], now);
+  }
+  for (uint8_t v = 0; v < SYNTH_SAMPLE_VOICES; v++) {
+    sampleStillBusy(samples.voiceBusy[v], samples.voiceBusyUntil[v], now);
+  }
+}
+
+// Marca el hueco como sonando al menos hasta until
+void sampleSlotBusyUntil(uint8_t slot, uint32_t until, uint32_t now) {
+  if (!sampleStillBusy(samples.slotBusy[slot], samples.slotBusyUntil[slot], now) ||
+      deadlineBefore(samples.slotBusyUntil[slot], until)) {
+    samples.slotBusyUntil[slot] = until;
+  }
+  samples.slotBusy[slot] = true;
+}
+
+// Hueco libre o, si no hay, el usado hace más tiempo que no esté sonando
+int8_t sampleSlotForLoad(uint32_t now) {
+  int8_t best = -1;
+  for (uint8_t s = 0; s < samples.slots; s++) {
+    if (samples.slotSample[s] < 0) return s;
+    if (sampleStillBusy(samples.slotBusy[s], samples.slotBusyUntil[s], now)) continue;
+    if (best < 0 || samples.slotUse[s] - samples.slotUse[best] > 0x7FFFFFFF) best = s;
+  }
+  return best;
+}
+
+// Empieza a cargar la muestra id; la lectura la hace samplesService()
+bool sampleStartLoad(uint16_t id, uint32_t now) {
+  if (!samples.slots) {
+    sampleLoadFailed(id, SAMPLE_LOAD_NO_CACHE);
+    return false;
+  }
+  int8_t slot = sampleSlotForLoad(now);
+  if (slot < 0) {
+    sampleLoadFailed(id, SAMPLE_LOAD_ALL_BUSY);
+    return false;
+  }
+  const SampleBankEntry &e = sampleBank.entries[id];
+  if (!sampleFile.open(e.path)) {
+    sampleLoadFailed(id, SAMPLE_LOAD_OPEN);
+    return false;
+  }
+  if (sampleFile.size() < e.offset || (sampleFile.size() - e.offset) / 2 < e.frames || !sampleFile.seek(e.offset)) {
+    sampleFile.close();
+    sampleLoadFailed(id, SAMPLE_LOAD_SHORT);
+    return false;
+  }
+
+  if (samples.slotSample[slot] >= 0) {
+    samples.sampleSlot[samples.slotSample[slot]] = -1;
+    samples.evictions++;
+  }
+  samples.slotSample[slot] = id;
+  samples.slotFrames[slot] = 0;
+  samples.slotUse[slot] = ++samples.useStamp;
+  samples.sampleSlot[id] = slot;
+  samples.loadingSlot = slot;
+  return true;
+}
+
+// ===============================================
+// DISPARO
+// ===============================================
+
+// Voz de muestra libre o, si todas suenan, la que acaba antes
+uint8_t sampleVoiceFor(uint32_t now) {
+  uint8_t best = 0;
+  for (uint8_t v = 0; v < SYNTH_SAMPLE_VOICES; v++) {
+    if (!sampleStillBusy(samples.voiceBusy[v], samples.voiceBusyUntil[v], now)) return v;
+    if (deadlineBefore(samples.voiceBusyUntil[v], samples.voiceBusyUntil[best])) best = v;
+  }
+  return best;
+}
+
+inline uint32_t sampleDurationMs(uint32_t frames, uint32_t rate) {
+  return (uint32_t)((uint64_t)frames * 1000 / rate) + SAMPLE_BUSY_MARGIN_MS;
+}
+
+void sampleStartVoice(const int16_t *data, uint32_t frames, uint32_t rate, uint16_t gain, uint32_t now) {
+  uint8_t v = sampleVoiceFor(now);
+  if (synthPlaySample(v, data, frames, gain, sampleRateTable(rate))) {
+    samples.voiceBusyUntil[v] = now + sampleDurationMs(frames, rate);
+    samples.voiceBusy[v] = true;
+  }
+}
+
+bool samplePlayable(uint16_t id) {
+  const SampleBankEntry &e = sampleBank.entries[id];
+  if ((e.sampleRate == SYNTH_SAMPLE_RATE || sampleRateTable(e.sampleRate)) && e.frames > 0 &&
+      (e.source == SAMPLE_IN_FLASH || e.frames <= SAMPLE_CACHE_SLOT_FRAMES)) {
+    return true;
+  }
+  LOG(LOG_SAMPLE_UNPLAYABLE, id, e.sampleRate, e.frames > 32767 ? 32767 : e.frames);
+  return false;
+}
+
+// Dispara la muestra id con ganancia gain (Q15). Devuelve true si ya suena;
+// false si no existe, no se puede reproducir o espera a la SD (entonces
+// samplesLoading() lo indica y suena al terminar la carga)
+bool samplePlay(uint16_t id, uint16_t gain, uint32_t now) {
+  if (id >= sampleBank.count || !samplePlayable(id)) return false;
+  const SampleBankEntry &e = sampleBank.entries[id];
+
+  if (e.source == SAMPLE_IN_FLASH) {
+    samples.flashPlays++;
+    sampleStartVoice(sampleBankData(sampleBank, id), e.frames, e.sampleRate, gain, now);
+    return true;
+  }
+
+  if (sampleCached(id)) {
+    uint8_t slot = samples.sampleSlot[id];
+    samples.hits++;
+    samples.slotUse[slot] = ++samples.useStamp;
+    sampleSlotBusyUntil(slot, now + sampleDurationMs(e.frames, e.sampleRate), now);
+    sampleStartVoice(sampleSlotData(slot), e.frames, e.sampleRate, gain, now);
+    return true;
+  }
+
+  // Fallo: el disparo espera a la carga; uno anterior que aún esperaba se pierde
+  samples.misses++;
+  if (samples.pendingSample >= 0 && samples.pendingSample != (int16_t)id) samples.late++;
+  samples.pendingSample = id;
+  samples.pendingGain = gain;
+  samples.pendingSince = now;
+  if (samples.loadingSlot < 0 && !sampleStartLoad(id, now)) samples.pendingSample = -1;
+  return false;
+}
+
+bool samplePlayByName(const char *name, uint16_t gain, uint32_t now) {
+  int16_t id = sampleFind(sampleBank, name);
+  return id >= 0 && samplePlay((uint16_t)id, gain, now);
+}
+
+// Carga la muestra id en la caché sin dispararla (p. ej. al arrancar, las
+// que van a sonar primero). false si ya hay otra carga en curso
+bool samplePreload(uint16_t id, uint32_t now) {
+  if (id >= sampleBank.count || sampleBank.entries[id].source != SAMPLE_ON_SD) return false;
+  if (samples.sampleSlot[id] >= 0) return true;
+  if (samples.loadingSlot >= 0 || !samplePlayable(id)) return false;
+  return sampleStartLoad(id, now);
+}
+
+inline bool samplesLoading() { return samples.loadingSlot >= 0; }
+
+// ===============================================
+// CARGA (tarea "muestras")
+// ===============================================
+
+void sampleFinishLoad(uint32_t now) {
+  uint8_t slot = samples.loadingSlot;
+  uint16_t id = samples.slotSample[slot];
+  sampleFile.close();
+  samples.loadingSlot = -1;
+  samples.loads++;
+
+  if (samples.pendingSample == (int16_t)id) {
+    samples.pendingSample = -1;
+    if (deadlineReached(samples.pendingSince + SAMPLE_LATE_MS, now)) {
+      samples.late++;
+    } else {
+      uint32_t rate = sampleBank.entries[id].sampleRate;
+      sampleSlotBusyUntil(slot, now + sampleDurationMs(samples.slotFrames[slot], rate), now);
+      sampleStartVoice(sampleSlotData(slot), samples.slotFrames[slot], rate, samples.pendingGain, now);
+    }
+  }
+  // Un disparo de otra muestra llegó durante la carga: ahora le toca a ella
+  if (samples.pendingSample >= 0 && !sampleCached(samples.pendingSample) &&
+      !sampleStartLoad(samples.pendingSample, now)) {
+    samples.pendingSample = -1;
+  }
+}
+
+// Lee hasta maxBytes de la muestra que se está cargando. Devuelve true si
+// la carga sigue en curso
+bool samplesService(uint32_t now, uint32_t maxBytes) {
+  if (samples.loadingSlot < 0) return false;
+  PROFILE_SCOPE(PROF_SAMPLES);
+  uint8_t slot = samples.loadingSlot;
+  uint16_t id = samples.slotSample[slot];
+  uint32_t frames = sampleBank.entries[id].frames;
+  uint32_t want = (frames - samples.slotFrames[slot]) * 2;
+  if (want > maxBytes) want = maxBytes & ~1u;
+
+  int32_t n = sampleFile.read(sampleSlotData(slot) + samples.slotFrames[slot], want);
+  if (n <= 0 || n % 2) {
+    sampleFile.close();
+    samples.sampleSlot[id] = -1;
+    samples.slotSample[slot] = -1;
+    samples.loadingSlot = -1;
+    if (samples.pendingSample == (int16_t)id) samples.pendingSample = -1;
+    sampleLoadFailed(id, SAMPLE_LOAD_READ);
+    return false;
+  }
+  samples.slotFrames[slot] += n / 2;
+  samples.loadedBytes += n;
+  if (samples.slotFrames[slot] >= frames) sampleFinishLoad(now);
+  return samples.loadingSlot >= 0;
+}
+
+// Aciertos y fallos desde el informe anterior; nada si no hubo disparos de la SD
+void samplesReport() {
+  uint32_t hits = samples.hits - samples.reportedHits;
+  uint32_t misses = samples.misses - samples.reportedMisses;
+  if (hits + misses > 0) {
+    LOG(LOG_SAMPLE_CACHE, hits > 32767 ? 32767 : hits, misses > 32767 ? 32767 : misses,
+        (uint32_t)((uint64_t)hits * 100 / (hits + misses)), samples.evictions - samples.reportedEvictions,
+        samples.late - samples.reportedLate);
+  }
+  samples.reportedHits = samples.hits;
+  samples.reportedMisses = samples.misses;
+  samples.reportedEvictions = samples.evictions;
+  samples.reportedLate = samples.late;
+}
+
+// Tarea del planificador: un trozo por vuelta mientras hay carga; si no,
+// solo el informe periódico (y el repaso de los flags de ocupado)
+uint32_t samplesTask(uint32_t now) {
+  bool loading = samplesService(now, SAMPLE_LOAD_CHUNK);
+  if (deadlineReached(samples.reportDeadline, now)) {
+    samplesExpireBusy(now);
+    samplesReport();
+    samples.reportDeadline = now + SAMPLE_REPORT_MS;
+  }
+  return loading ? now + 1 : samples.reportDeadline;
+}
+
+#endif // PIEZOBUGS_SAMPLES_H
@@ -0,0 +1,213 @@
+/*
+ * scheduler.h - Planificador por vencimientos de PiezoBugs
+ *
+ * Sustituye el loop de sondeo cada 10 ms: cada subsistema (voces, botones,
+ * Neopixel) es una tarea que devuelve su próximo vencimiento. Las tareas
+ * se guardan en un montículo mínimo ordenado por vencimiento; el loop
+ * ejecuta las vencidas y duerme hasta la siguiente. Si ningún piezo está
+ * sonando y la pausa es larga, se usa el sueño ligero del ESP32.
+ */
+
+#ifndef PIEZOBUGS_SCHEDULER_H
+#define PIEZOBUGS_SCHEDULER_H
+
+#include <string.h>
+#include "hal.h"
+#include "config.h"
+
+const uint8_t MAX_SCHEDULER_TASKS = 8;
+const uint32_t SCHEDULER_PARKED_MS = 0x3FFFFFFF;   // Una tarea que ya terminó vuelve a vencer en ~12 días
+
+// Ejecuta la tarea y devuelve su próximo vencimiento (millis)
+typedef uint32_t (*SchedulerTaskFunction)(uint32_t now);
+
+struct SchedulerTask {
+  SchedulerTaskFunction run;
+  const char* name;
+  uint32_t deadline;
+  uint32_t runs;           // Veces ejecutada
+  uint32_t maxLateMs;      // Mayor retraso sobre su vencimiento (ms)
+};
+
+struct Scheduler {
+  SchedulerTask tasks[MAX_SCHEDULER_TASKS];
+  uint8_t taskCount;
+
+  // Montículo mínimo por vencimiento (todas las tareas están siempre en él)
+  uint8_t heap[MAX_SCHEDULER_TASKS];
+  uint8_t heapPos[MAX_SCHEDULER_TASKS];
+
+  // Estadísticas
+  uint32_t wakeups;        // Iteraciones del loop
+  uint32_t idleSleeps;     // Pausas con delay()
+  uint32_t lightSleeps;    // Pausas con sueño ligero
+  uint64_t idleMs;
+  uint64_t lightSleepMs;
+  uint32_t earlyWakeups;   // Pausas cortadas por una interrupción
+};
+
+Scheduler scheduler;
+
+enum SleepMode {
+  SLEEP_NONE,    // Hay tareas vencidas: no dormir
+  SLEEP_IDLE,    // delay(): la CPU cede a FreeRTOS, los periféricos siguen
+  SLEEP_LIGHT    // Sueño ligero
+};
+
+struct SleepWindow {
+  SleepMode mode;
+  uint32_t ms;
+};
+
+// ===============================================
+// MONTÍCULO DE TAREAS
+// ===============================================
+
+void schedulerHeapSwap(uint8_t a, uint8_t b) {
+  uint8_t ta = scheduler.heap[a];
+  uint8_t tb = scheduler.heap[b];
+  scheduler.heap[a] = tb;
+  scheduler.heap[b] = ta;
+  scheduler.heapPos[tb] = a;
+  scheduler.heapPos[ta] = b;
+}
+
+bool schedulerTaskBefore(uint8_t a, uint8_t b) {
+  return deadlineBefore(scheduler.tasks[scheduler.heap[a]].deadline,
+                        scheduler.tasks[scheduler.heap[b]].deadline);
+}
+
+void schedulerSiftUp(uint8_t i) {
+  while (i > 0) {
+    uint8_t parent = (i - 1) / 2;
+    if (!schedulerTaskBefore(i, parent)) break;
+    schedulerHeapSwap(i, parent);
+    i = parent;
+  }
+}
+
+void schedulerSiftDown(uint8_t i) {
+  while (true) {
+    uint8_t left = 2 * i + 1;
+    uint8_t right = left + 1;
+    uint8_t smallest = i;
+    if (left < scheduler.taskCount && schedulerTaskBefore(left, smallest)) smallest = left;
+    if (right < scheduler.taskCount && schedulerTaskBefore(right, smallest)) smallest = right;
+    if (smallest == i) break;
+    schedulerHeapSwap(i, smallest);
+    i = smallest;
+  }
+}
+
+// ===============================================
+// GESTIÓN DE TAREAS
+// ===============================================
+
+void schedulerClear() {
+  memset(&scheduler, 0, sizeof(scheduler));
+}
+
+// Añade una tarea; devuelve su identificador o -1 si no hay sitio
+int schedulerAdd(const char* name, SchedulerTaskFunction run, uint32_t firstDeadline) {
+  if (scheduler.taskCount >= MAX_SCHEDULER_TASKS) return -1;
+  uint8_t id = scheduler.taskCount++;
+  SchedulerTask &task = scheduler.tasks[id];
+  task.run = run;
+  task.name = name;
+  task.deadline = firstDeadline;
+  task.runs = 0;
+  task.maxLateMs = 0;
+  scheduler.heap[id] = id;
+  scheduler.heapPos[id] = id;
+  schedulerSiftUp(id);
+  return id;
+}
+
+// Cambia el vencimiento de una tarea (p. ej. cuando otro subsistema
+// modifica su estado y la tarea debe atenderse antes)
+void schedulerSetDeadline(uint8_t id, uint32_t deadline) {
+  if (id >= scheduler.taskCount) return;
+  scheduler.tasks[id].deadline = deadline;
+  schedulerSiftUp(scheduler.heapPos[id]);
+  schedulerSiftDown(scheduler.heapPos[id]);
+}
+
+uint32_t schedulerNextDeadline() {
+  return scheduler.tasks[scheduler.heap[0]].deadline;
+}
+
+// Ejecuta todas las tareas vencidas en orden de vencimiento
+void schedulerRunDue(uint32_t now) {
+  while (scheduler.taskCount > 0) {
+    uint8_t id = scheduler.heap[0];
+    SchedulerTask &task = scheduler.tasks[id];
+    if (!deadlineReached(task.deadline, now)) break;
+
+    uint32_t late = now - task.deadline;
+    if (late > task.maxLateMs) task.maxLateMs = late;
+    task.runs++;
+
+    uint32_t next = task.run(now);
+    // Una tarea nunca puede volver a vencer en el mismo instante
+    if (deadlineReached(next, now)) next = now + 1;
+    schedulerSetDeadline(id, next);
+  }
+}
+
+// ===============================================
+// PAUSAS
+// ===============================================
+
+// Decide cómo esperar desde now hasta nextDeadline. Función pura para
+// poder probarla en el host.
+SleepWindow computeSleepWindow(uint32_t now, uint32_t nextDeadline, bool lightSleepAllowed) {
+  SleepWindow window = {SLEEP_NONE, 0};
+  if (deadlineReached(nextDeadline, now)) return window;
+
+  uint32_t gap = nextDeadline - now;
+  if (gap > MAX_SLEEP_MS) gap = MAX_SLEEP_MS;
+
+  if (lightSleepAllowed && gap >= LIGHT_SLEEP_MIN_MS) {
+    // Se despierta un poco antes y el resto se espera con delay()
+    window.mode = SLEEP_LIGHT;
+    window.ms = gap - LIGHT_SLEEP_GUARD_MS;
+  } else {
+    window.mode = SLEEP_IDLE;
+    window.ms = gap;
+  }
+  return window;
+}
+
+// Espera hasta el próximo vencimiento. El sueño ligero solo se usa con los
+// piezos en silencio porque detiene el LEDC, y nunca con el sintetizador
+// I2S, que necesita el DMA funcionando sin pausa. También para el RMT: si
+// hay un show() del aro a medio transmitir (casi siempre, la tarea del aro
+// acaba de correr) primero se espera a que termine, menos de 1 ms, y luego
+// se duerme el resto. Una interrupción (un botón) corta la espera: entonces
+// devuelve true.
+bool schedulerSleep(uint32_t now) {
+  bool lightSleepAllowed = ENABLE_LIGHT_SLEEP && !USE_I2S_SYNTH && hal::piezosIdle();
+  if (lightSleepAllowed && hal::pixelsBusy()) {
+    lightSleepAllowed = hal::pixelsWaitDone();
+    uint32_t waited = hal::millis() - now;
+    scheduler.idleMs += waited;
+    now += waited;
+  }
+  SleepWindow window = computeSleepWindow(now, schedulerNextDeadline(), lightSleepAllowed);
+  scheduler.wakeups++;
+
+  bool woken = false;
+  if (window.mode == SLEEP_LIGHT) {
+    scheduler.lightSleeps++;
+    woken = hal::lightSleep(window.ms);
+    scheduler.lightSleepMs += hal::millis() - now;
+  } else if (window.mode == SLEEP_IDLE) {
+    scheduler.idleSleeps++;
+    woken = hal::idleWait(window.ms);
+    scheduler.idleMs += hal::millis() - now;
+  }
+  if (woken) scheduler.earlyWakeups++;
+  return woken;
+}
+
+#endif // PIEZOBUGS_SCHEDULER_H
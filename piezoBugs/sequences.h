@@ -0,0 +1,263 @@
+/*
+ * sequences.h - Generador de secuencias de insecto y reservas por voz
+ *
+ * Cada tipo de insecto es una cadena de Markov sobre las posiciones de la
+ * escala: la primera nota sale al azar dentro de sus octavas y cada
+ * siguiente da un salto con los pesos de su perfil (la araña salta por
+ * todas partes, el grillo repite y se mueve a notas vecinas, el escarabajo
+ * solo toca la raíz cambiando de octava).
+ *
+ * Cada voz tiene su flujo PCG32 (prng.h) y una reserva de
+ * SEQUENCE_POOL_SIZE secuencias ya generadas, que el loop rellena cuando
+ * va a esperar (sequencePoolsRefill). Cambiar de secuencia en la ruta
+ * caliente es copiar la siguiente de la reserva (16 bytes), sin generar
+ * nada. Las reservas guardan también las posiciones de la escala, así que
+ * un cambio de nota raíz no las invalida: se pasan a notas con la nueva.
+ * Con la misma semilla (SEQUENCE_SEED) cada voz repite las mismas
+ * secuencias.
+ */
+
+#ifndef PIEZOBUGS_SEQUENCES_H
+#define PIEZOBUGS_SEQUENCES_H
+
+#include "config.h"
+#include "tuning.h"
+#include "insects.h"
+#include "prng.h"
+#include "log.h"
+#include "profile.h"
+
+// ===============================================
+// PERFILES DE MARKOV
+// ===============================================
+
+const uint8_t MARKOV_MAX_STEP = 7;
+
+struct MarkovProfile {
+  uint8_t firstOctave;         // Octavas absolutas (Do2 = octava 2)
+  uint8_t lastOctave;
+  uint8_t minLength;
+  uint8_t maxLength;
+  bool rootOnly;               // Solo la raíz: los saltos son de octava
+  uint8_t stepWeights[MARKOV_MAX_STEP + 1];  // Peso de cada tamaño de salto (0 = repetir)
+};
+
+// Mismas octavas y longitudes que las secuencias originales
+constexpr MarkovProfile MARKOV_PROFILES[INSECT_TYPE_COUNT] = {
+  // Araña: octavas 5-8, 3-16 notas, saltos de cualquier tamaño
+  {5, 8, 3, 16, false, {1, 2, 2, 2, 2, 2, 2, 2}},
+  // Grillo: octavas 2-4, 3-4 notas, repite o va a la nota de al lado
+  {2, 4, 3, 4, false, {3, 4, 2, 1, 0, 0, 0, 0}},
+  // Escarabajo: raíz de las octavas 2-4, 4-7 notas
+  {2, 4, 4, 7, true, {2, 3, 1, 0, 0, 0, 0, 0}},
+};
+
+static_assert(MARKOV_PROFILES[SPIDER].maxLength <= MAX_SEQUENCE_LENGTH, "La araña cabe en una secuencia");
+static_assert(SCALE_FIRST_OCTAVE + SCALE_OCTAVES > 8, "Las octavas de la araña están en la tabla de escalas");
+
+// Tamaño de salto para cada valor del sorteo (pesos expandidos), al compilar
+const uint8_t MARKOV_MAX_WEIGHT_TOTAL = 32;
+
+struct MarkovTable {
+  uint8_t total[INSECT_TYPE_COUNT];
+  uint8_t step[INSECT_TYPE_COUNT][MARKOV_MAX_WEIGHT_TOTAL];
+};
+
+constexpr MarkovTable buildMarkovTable() {
+  MarkovTable table = {};
+  for (int t = 0; t < INSECT_TYPE_COUNT; t++) {
+    int total = 0;
+    for (int s = 0; s <= MARKOV_MAX_STEP; s++) {
+      for (int w = 0; w < MARKOV_PROFILES[t].stepWeights[s] && total < MARKOV_MAX_WEIGHT_TOTAL; w++) {
+        table.step[t][total++] = (uint8_t)s;
+      }
+    }
+    table.total[t] = (uint8_t)total;
+  }
+  return table;
+}
+
+constexpr MarkovTable MARKOV_TABLE = buildMarkovTable();
+
+constexpr bool markovWeightsFit() {
+  for (int t = 0; t < INSECT_TYPE_COUNT; t++) {
+    int total = 0;
+    for (int s = 0; s <= MARKOV_MAX_STEP; s++) total += MARKOV_PROFILES[t].stepWeights[s];
+    if (total == 0 || total > MARKOV_MAX_WEIGHT_TOTAL) return false;
+  }
+  return true;
+}
+
+static_assert(markovWeightsFit(), "Los pesos de cada perfil deben sumar entre 1 y MARKOV_MAX_WEIGHT_TOTAL");
+
+// Salto con signo según los pesos del perfil: un solo número aleatorio,
+// el bit bajo para el sentido y los altos para el tamaño
+inline int markovStep(Prng &rng, InsectType type) {
+  uint32_t x = prngNext(rng);
+  uint32_t pick = (uint32_t)(((uint64_t)(x >> 1) * MARKOV_TABLE.total[type]) >> 31);
+  int step = MARKOV_TABLE.step[type][pick];
+  return (x & 1) ? -step : step;
+}
+
+// Nueva secuencia de posiciones de la escala (sin raíz) para un tipo
+void sequenceGenerate(Prng &stream, InsectType type, ScaleId scale, uint8_t positions[], uint8_t &length) {
+  if (type >= INSECT_TYPE_COUNT) {
+    LOG(LOG_BAD_GENERATE_TYPE, (int)type);
+    type = SPIDER; // Usar tipo por defecto
+  }
+  const MarkovProfile &profile = MARKOV_PROFILES[type];
+  uint8_t size = scaleSize(scale);
+  // Copia local: las escrituras en positions podrían solapar con el estado
+  Prng rng = stream;
+
+  // Estados: posiciones de la escala, u octavas si solo toca la raíz
+  int lowest = 0;
+  int highest = profile.lastOctave - profile.firstOctave;
+  if (!profile.rootOnly) {
+    lowest = (profile.firstOctave - SCALE_FIRST_OCTAVE) * size;
+    highest = (profile.lastOctave - SCALE_FIRST_OCTAVE + 1) * size - 1;
+  }
+
+  length = (uint8_t)prngRange(rng, profile.minLength, profile.maxLength + 1);
+  int state = prngRange(rng, lowest, highest + 1);
+  for (uint8_t i = 0; i < length; i++) {
+    if (i > 0) {
+      int step = markovStep(rng, type);
+      // Si se sale del rango, el salto rebota hacia dentro
+      if (state + step > highest || state + step < lowest) step = -step;
+      state += step;
+      if (state > highest) state = highest;
+      if (state < lowest) state = lowest;
+    }
+    positions[i] = profile.rootOnly
+                     ? (uint8_t)((profile.firstOctave - SCALE_FIRST_OCTAVE + state) * size)
+                     : (uint8_t)state;
+  }
+  stream = rng;
+}
+
+// Posiciones a notas con la escala y la raíz de ahora
+inline void sequenceToNotes(const uint8_t positions[], uint8_t length, ScaleId scale, int root, NoteIndex notes[]) {
+  for (uint8_t i = 0; i < length; i++) notes[i] = scaleNote(scale, root, positions[i]);
+}
+
+// ===============================================
+// RESERVAS POR VOZ
+// ===============================================
+
+const uint8_t SEQUENCE_POOL_VOICES = 16;   // Como MAX_VOICES (voices.h)
+
+static_assert(SEQUENCE_POOL_SIZE >= 1 && SEQUENCE_POOL_SIZE <= 16, "Reserva de 1 a 16 secuencias");
+
+struct SequencePools {
+  Prng rng[SEQUENCE_POOL_VOICES];
+  uint8_t positions[SEQUENCE_POOL_VOICES][SEQUENCE_POOL_SIZE][MAX_SEQUENCE_LENGTH];
+  NoteIndex notes[SEQUENCE_POOL_VOICES][SEQUENCE_POOL_SIZE][MAX_SEQUENCE_LENGTH];  // Con la raíz de root
+  uint8_t root[SEQUENCE_POOL_VOICES][SEQUENCE_POOL_SIZE];
+  uint8_t length[SEQUENCE_POOL_VOICES][SEQUENCE_POOL_SIZE];
+  uint8_t type[SEQUENCE_POOL_VOICES];     // Tipo para el que está generada la reserva
+  uint8_t head[SEQUENCE_POOL_VOICES];     // Próxima a coger
+  uint8_t count[SEQUENCE_POOL_VOICES];
+  uint16_t needMask;                      // Bit v = la reserva de v no está llena
+  ScaleId scale;                          // Escala para la que están generadas
+  bool seeded;
+
+  // Estadísticas
+  uint32_t generated;
+  uint32_t taken;                         // Cogidas de la reserva
+  uint32_t misses;                        // Reserva vacía: generada en la ruta caliente
+};
+
+SequencePools sequencePools;
+
+// Siembra un flujo por voz y vacía las reservas
+void sequencePoolsBegin(uint32_t seed) {
+  memset(&sequencePools, 0, sizeof(sequencePools));
+  for (uint8_t v = 0; v < SEQUENCE_POOL_VOICES; v++) prngSeed(sequencePools.rng[v], seed, v);
+  sequencePools.needMask = 0xFFFF;
+  sequencePools.scale = currentScale;
+  sequencePools.seeded = true;
+}
+
+void sequencePoolFlush(uint8_t v) {
+  sequencePools.count[v] = 0;
+  sequencePools.needMask |= (1u << v);
+}
+
+// Genera una secuencia más para la reserva de v
+void sequencePoolFill(uint8_t v, InsectType type) {
+  SequencePools &p = sequencePools;
+  if (p.type[v] != type) {
+    sequencePoolFlush(v);
+    p.type[v] = type;
+  }
+  if (p.count[v] >= SEQUENCE_POOL_SIZE) return;
+  uint8_t slot = (p.head[v] + p.count[v]) % SEQUENCE_POOL_SIZE;
+  sequenceGenerate(p.rng[v], type, p.scale, p.positions[v][slot], p.length[v][slot]);
+  sequenceToNotes(p.positions[v][slot], p.length[v][slot], p.scale, rootNoteOffset, p.notes[v][slot]);
+  p.root[v][slot] = (uint8_t)rootNoteOffset;
+  p.count[v]++;
+  p.generated++;
+  if (p.count[v] >= SEQUENCE_POOL_SIZE) p.needMask &= ~(1u << v);
+}
+
+// Siguiente secuencia de la voz v, ya en notas. Si la reserva no vale
+// (vacía, de otro tipo o de otra escala) se genera aquí mismo
+void sequencePoolTake(uint8_t v, InsectType type, NoteIndex notes[], uint8_t &length) {
+  SequencePools &p = sequencePools;
+  if (!p.seeded) sequencePoolsBegin(SEQUENCE_SEED);
+  if (p.scale != currentScale) {
+    for (uint8_t i = 0; i < SEQUENCE_POOL_VOICES; i++) sequencePoolFlush(i);
+    p.scale = currentScale;
+  }
+  if (type >= INSECT_TYPE_COUNT || p.type[v] != type || p.count[v] == 0) {
+    uint8_t positions[MAX_SEQUENCE_LENGTH];
+    sequenceGenerate(p.rng[v], type, currentScale, positions, length);
+    sequenceToNotes(positions, length, currentScale, rootNoteOffset, notes);
+    if (type < INSECT_TYPE_COUNT && p.type[v] != type) {
+      sequencePoolFlush(v);
+      p.type[v] = type;
+    }
+    p.needMask |= (1u << v);
+    p.generated++;
+    p.misses++;
+    return;
+  }
+
+  // Ya en notas: una copia de tamaño fijo. Si la raíz ha cambiado desde
+  // que se generó, se pasa de posiciones a notas con la nueva
+  uint8_t slot = p.head[v];
+  length = p.length[v][slot];
+  if (p.root[v][slot] == rootNoteOffset) {
+    memcpy(notes, p.notes[v][slot], MAX_SEQUENCE_LENGTH * sizeof(NoteIndex));
+  } else {
+    sequenceToNotes(p.positions[v][slot], length, currentScale, rootNoteOffset, notes);
+  }
+  p.head[v] = (slot + 1) % SEQUENCE_POOL_SIZE;
+  p.count[v]--;
+  p.needMask |= (1u << v);
+  p.taken++;
+}
+
+// Rellena hasta maxSequences secuencias de las voces cuyo tipo se da en
+// types; devuelve las generadas. Para llamar cuando el loop va a esperar
+uint8_t sequencePoolsRefill(const uint8_t types[], uint8_t voiceCount, uint8_t maxSequences) {
+  SequencePools &p = sequencePools;
+  uint16_t pending = p.needMask & (uint16_t)((1u << voiceCount) - 1);
+  if (!pending || !p.seeded) return 0;
+  PROFILE_SCOPE(PROF_SEQUENCES);
+  uint8_t made = 0;
+  while (pending && made < maxSequences) {
+    uint8_t v = __builtin_ctz(pending);
+    if (types[v] < INSECT_TYPE_COUNT) {
+      sequencePoolFill(v, (InsectType)types[v]);
+      made++;
+    } else {
+      p.needMask &= ~(1u << v);   // voiceValidate la arreglará antes
+    }
+    if (!(p.needMask & (1u << v))) pending &= ~(1u << v);
+  }
+  return made;
+}
+
+#endif // PIEZOBUGS_SEQUENCES_H
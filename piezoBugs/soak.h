@@ -0,0 +1,477 @@
+/*
+ * soak.h - Simulación de semanas de funcionamiento en minutos (solo nativo)
+ *
+ * Ejecuta piezoBugsSetup()/piezoBugsLoop() sobre el reloj virtual de la HAL
+ * tan deprisa como da el host, desde una semilla fija: la misma semilla
+ * repite exactamente la misma ejecución. Por defecto arranca una hora antes
+ * de que millis() se desborde (49,7 días), que es donde suelen esconderse
+ * los fallos de larga duración.
+ *
+ * Mientras corre:
+ * - pulsa botones al azar (cortas, largas y dobles) con un generador propio,
+ *   para que las pulsaciones no dependan de lo que consume el motor;
+ * - cambia de vez en cuando los datos del árbol (densidad, ritmo...);
+ * - guarda una traza compacta de eventos (8 bytes cada uno: secuencias,
+ *   cambios de tipo, mute, frecuencia, nota raíz, desbordes de millis());
+ * - comprueba invariantes tras cada vuelta del loop: estado de las voces,
+ *   montículos, vencimientos dentro de un horizonte razonable, voces que
+ *   dejan de cantar, parámetros en rango y mensajes de error en el registro
+ *   (las reparaciones a posteriori de voiceValidate cuentan como fallo).
+ *
+ * src/native/main.cpp lo expone como "program soak"; tools/soak_decode.py
+ * lee la traza binaria.
+ */
+
+#ifndef PIEZOBUGS_SOAK_H
+#define PIEZOBUGS_SOAK_H
+
+#if !defined(PIEZOBUGS_NATIVE)
+#error "soak.h solo se compila en el build nativo"
+#endif
+
+#include <math.h>
+#include <stdio.h>
+#include "piezo_bugs.h"
+
+// ===============================================
+// PARÁMETROS
+// ===============================================
+
+const uint32_t SOAK_DAY_MS = 86400000UL;
+const uint32_t SOAK_DEFAULT_START_MS = 0xFFFFFFFFUL - 3600000UL + 1;  // 1 h antes del desborde
+const uint32_t SOAK_PRESS_MEAN_MS = 15 * 60000UL;   // Una pulsación cada 15 min de media
+const uint32_t SOAK_TREE_MEAN_MS = 10 * 60000UL;    // Datos nuevos del árbol cada 10 min
+const uint32_t SOAK_HORIZON_MS = 10 * 60000UL;      // Ningún vencimiento más lejos que esto
+const uint32_t SOAK_MAX_LATE_MS = 1000;             // Retraso máximo de una voz o tarea
+const uint32_t SOAK_STALL_MS = 20 * 60000UL;        // Voz sin mutear que no canta en este tiempo
+const uint16_t SOAK_TRACE_SIZE = 4096;              // Últimos eventos en memoria (potencia de 2)
+const uint8_t SOAK_VIOLATION_TRACE_MAX = 16;        // Violaciones de cada tipo que van a la traza
+
+static_assert((SOAK_TRACE_SIZE & (SOAK_TRACE_SIZE - 1)) == 0, "La traza debe ser potencia de 2");
+
+// Cabecera de la traza binaria: "PBSOAK01", semilla y millis() inicial
+const char SOAK_TRACE_MAGIC[8] = {'P', 'B', 'S', 'O', 'A', 'K', '0', '1'};
+
+// ===============================================
+// EVENTOS E INVARIANTES
+// ===============================================
+
+// Tipos de evento de la traza (tools/soak_decode.py usa los mismos números)
+enum SoakEventType : uint8_t {
+  SOAK_EV_BUTTON,        // a = botón (0..5), b = ButtonPressType
+  SOAK_EV_SEQUENCE,      // a = voz, b = longitud de la secuencia que empieza
+  SOAK_EV_SEQUENCE_END,  // a = voz
+  SOAK_EV_TYPE,          // a = voz, b = InsectType
+  SOAK_EV_MUTE,          // a = voz, b = 1 muteada, 0 activa
+  SOAK_EV_FREQ,          // b = SystemState
+  SOAK_EV_ROOT,          // b = nota raíz (0-11)
+  SOAK_EV_TREE,          // b = densidad objetivo x100
+  SOAK_EV_WRAP,          // b = número de desbordes de millis()
+  SOAK_EV_DAY,           // b = días simulados
+  SOAK_EV_VIOLATION      // a = SoakCheck, b = voz, tarea o id de mensaje
+};
+
+// Invariantes; X(id, nombre)
+#define SOAK_CHECKS(X) \
+  X(SOAK_CHECK_TYPE,         "tipo") \
+  X(SOAK_CHECK_LENGTH,       "longitud") \
+  X(SOAK_CHECK_INDEX,        "índice") \
+  X(SOAK_CHECK_FREQUENCY,    "frecuencia") \
+  X(SOAK_CHECK_VOICE_HEAP,   "montículo de voces") \
+  X(SOAK_CHECK_VOICE_HORIZON, "horizonte de voz") \
+  X(SOAK_CHECK_VOICE_LATE,   "retraso de voz") \
+  X(SOAK_CHECK_STALL,        "voz callada") \
+  X(SOAK_CHECK_TASK_HORIZON, "horizonte de tarea") \
+  X(SOAK_CHECK_TASK_LATE,    "retraso de tarea") \
+  X(SOAK_CHECK_PARAM,        "parámetro") \
+  X(SOAK_CHECK_LOG_DROPPED,  "mensajes perdidos") \
+  X(SOAK_CHECK_LOG_ERROR,    "error en el registro")
+
+#define SOAK_CHECK_ID(id, name) id,
+#define SOAK_CHECK_NAME(id, name) name,
+
+enum SoakCheck : uint8_t {
+  SOAK_CHECKS(SOAK_CHECK_ID)
+  SOAK_CHECK_COUNT
+};
+
+const char* const SOAK_CHECK_NAMES[SOAK_CHECK_COUNT] = {SOAK_CHECKS(SOAK_CHECK_NAME)};
+
+struct SoakEvent {
+  uint32_t ms;     // millis() del firmware (se desborda como en el ESP32)
+  uint8_t type;    // SoakEventType
+  uint8_t a;
+  uint16_t b;
+};
+
+static_assert(sizeof(SoakEvent) == 8, "Evento de 8 bytes");
+
+// Pulsación en curso
+enum SoakPressStage : uint8_t {
+  SOAK_PRESS_IDLE,
+  SOAK_PRESS_DOWN,
+  SOAK_PRESS_GAP     // Entre las dos pulsaciones de una doble
+};
+
+struct SoakConfig {
+  uint32_t seed;
+  uint64_t durationMs;
+  uint32_t startMs;        // millis() al arrancar
+  uint32_t pressMeanMs;    // 0 = sin pulsaciones
+  uint32_t treeMeanMs;     // 0 = sin datos del árbol
+  FILE *trace;             // Traza binaria completa (opcional)
+};
+
+struct Soak {
+  SoakConfig config;
+  uint64_t startMicros;
+  uint64_t elapsedMs;
+  uint64_t loops;
+  uint32_t random;            // xorshift32 de las entradas
+  uint32_t lastMillis;
+  uint32_t wraps;
+  uint32_t days;
+
+  // Entradas programadas (en ms desde el arranque)
+  uint64_t nextPressMs;
+  uint64_t nextTreeMs;
+  SoakPressStage pressStage;
+  uint8_t pressButton;
+  uint8_t pressType;
+  bool pressSecond;
+
+  // Lo último visto, para trazar cambios
+  uint16_t activeMask;
+  uint16_t mutedMask;
+  uint8_t type[MAX_VOICES];
+  uint8_t state;
+  int rootNote;
+  uint64_t lastSequenceMs[MAX_VOICES];
+  uint32_t logHead;
+  uint32_t logDropped;
+  uint32_t taskLateSeen[MAX_SCHEDULER_TASKS];
+
+  // Traza
+  SoakEvent trace[SOAK_TRACE_SIZE];
+  uint32_t events;
+  uint32_t digest;            // FNV-1a de todos los eventos
+
+  // Violaciones
+  uint32_t violations;
+  uint32_t checkCount[SOAK_CHECK_COUNT];
+  uint64_t checkFirstMs[SOAK_CHECK_COUNT];
+};
+
+Soak soak;
+
+// ===============================================
+// TRAZA
+// ===============================================
+
+void soakTrace(SoakEventType type, uint8_t a = 0, uint16_t b = 0) {
+  SoakEvent &e = soak.trace[soak.events % SOAK_TRACE_SIZE];
+  e.ms = hal::millis();
+  e.type = type;
+  e.a = a;
+  e.b = b;
+  soak.events++;
+
+  const uint8_t *bytes = (const uint8_t *)&e;
+  for (uint8_t i = 0; i < sizeof(SoakEvent); i++) {
+    soak.digest = (soak.digest ^ bytes[i]) * 16777619u;
+  }
+  if (soak.config.trace) fwrite(&e, sizeof(e), 1, soak.config.trace);
+}
+
+void soakViolation(SoakCheck check, uint16_t detail) {
+  if (soak.checkCount[check] == 0) soak.checkFirstMs[check] = soak.elapsedMs;
+  if (soak.checkCount[check] < SOAK_VIOLATION_TRACE_MAX) soakTrace(SOAK_EV_VIOLATION, check, detail);
+  soak.checkCount[check]++;
+  soak.violations++;
+}
+
+// ===============================================
+// ENTRADAS
+// ===============================================
+
+uint32_t soakRandom(uint32_t low, uint32_t high) {
+  uint32_t x = soak.random;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  soak.random = x;
+  return high > low ? low + x % (high - low) : low;
+}
+
+// Espera hasta la siguiente entrada: uniforme entre 0 y el doble de la media
+uint64_t soakNextAfter(uint32_t meanMs) {
+  return soak.elapsedMs + 1 + soakRandom(0, 2 * meanMs);
+}
+
+void soakSetButton(uint8_t button, bool pressed) {
+  uint8_t pin = BUTTON_PINS[button];
+  if (button == BUTTON_ADC) hal::sim::setAnalog(pin, pressed ? 0 : 4095);
+  else hal::sim::setDigital(pin, pressed ? LOW : HIGH);
+}
+
+// Pulsaciones: corta (60%), larga (25%) o doble (15%) en un botón al azar
+void soakInjectPress() {
+  if (soak.elapsedMs < soak.nextPressMs) return;
+  switch (soak.pressStage) {
+    case SOAK_PRESS_IDLE: {
+      uint32_t kind = soakRandom(0, 100);
+      soak.pressButton = (uint8_t)soakRandom(0, BUTTON_COUNT);
+      soak.pressType = kind < 60 ? PRESS_SHORT : (kind < 85 ? PRESS_LONG : PRESS_DOUBLE);
+      soak.pressSecond = false;
+      soakTrace(SOAK_EV_BUTTON, soak.pressButton, soak.pressType);
+      soakSetButton(soak.pressButton, true);
+      soak.pressStage = SOAK_PRESS_DOWN;
+      // Más que el muestreo del ADC y el antirrebote
+      uint32_t hold = soak.pressType == PRESS_LONG ? soakRandom(LONG_PRESS_TIME + 100, LONG_PRESS_TIME + 1500)
+                                                   : soakRandom(2 * BUTTON_ADC_POLL_MS, 300);
+      soak.nextPressMs = soak.elapsedMs + hold;
+      break;
+    }
+    case SOAK_PRESS_DOWN:
+      soakSetButton(soak.pressButton, false);
+      if (soak.pressType == PRESS_DOUBLE && !soak.pressSecond) {
+        soak.pressStage = SOAK_PRESS_GAP;
+        soak.nextPressMs = soak.elapsedMs + soakRandom(2 * BUTTON_ADC_POLL_MS, 200);
+      } else {
+        soak.pressStage = SOAK_PRESS_IDLE;
+        soak.nextPressMs = soakNextAfter(soak.config.pressMeanMs);
+      }
+      break;
+    case SOAK_PRESS_GAP:
+      soakSetButton(soak.pressButton, true);
+      soak.pressSecond = true;
+      soak.pressStage = SOAK_PRESS_DOWN;
+      soak.nextPressMs = soak.elapsedMs + soakRandom(2 * BUTTON_ADC_POLL_MS, 200);
+      break;
+  }
+}
+
+// Datos del árbol de todo el rango de las correspondencias, y algo más
+void soakInjectTree() {
+  if (soak.elapsedMs < soak.nextTreeMs) return;
+  TreeData data;
+  data.humidity = (float)soakRandom(0, 101);
+  data.temperature = (float)soakRandom(0, 46) - 5.0f;
+  data.bioelectrical_activity = soakRandom(0, 1001) / 100000.0f;
+  data.light_level = (float)soakRandom(0, 2501);
+  data.data_valid = true;
+  piezoBugsSetTreeData(data);
+  soakTrace(SOAK_EV_TREE, 0, (uint16_t)(paramTarget(PARAM_DENSITY) * 100 + 0.5f));
+  soak.nextTreeMs = soakNextAfter(soak.config.treeMeanMs);
+}
+
+// ===============================================
+// OBSERVACIÓN E INVARIANTES
+// ===============================================
+
+// Cambios de estado desde la vuelta anterior, a la traza
+void soakObserve() {
+  uint32_t now = hal::millis();
+  if (now < soak.lastMillis) {
+    soak.wraps++;
+    soakTrace(SOAK_EV_WRAP, 0, (uint16_t)soak.wraps);
+  }
+  soak.lastMillis = now;
+
+  for (uint8_t v = 0; v < voices.count; v++) {
+    uint16_t bit = 1u << v;
+    if ((voices.activeMask ^ soak.activeMask) & bit) {
+      if (voices.activeMask & bit) {
+        soakTrace(SOAK_EV_SEQUENCE, v, voices.sequenceLength[v]);
+        soak.lastSequenceMs[v] = soak.elapsedMs;
+      } else {
+        soakTrace(SOAK_EV_SEQUENCE_END, v);
+      }
+    }
+    if ((voices.mutedMask ^ soak.mutedMask) & bit) {
+      soakTrace(SOAK_EV_MUTE, v, (voices.mutedMask & bit) ? 1 : 0);
+      soak.lastSequenceMs[v] = soak.elapsedMs;   // El plazo cuenta desde que vuelve
+    }
+    if (voices.type[v] != soak.type[v]) {
+      soakTrace(SOAK_EV_TYPE, v, voices.type[v]);
+      soak.type[v] = voices.type[v];
+    }
+  }
+  soak.activeMask = voices.activeMask;
+  soak.mutedMask = voices.mutedMask;
+
+  if (currentState != soak.state) {
+    soak.state = currentState;
+    soakTrace(SOAK_EV_FREQ, 0, currentState);
+  }
+  if (rootNoteOffset != soak.rootNote) {
+    soak.rootNote = rootNoteOffset;
+    soakTrace(SOAK_EV_ROOT, 0, (uint16_t)rootNoteOffset);
+  }
+}
+
+void soakCheckVoices(uint32_t now) {
+  uint8_t heapMembers = 0;
+  for (uint8_t v = 0; v < voices.count; v++) {
+    if (voices.type[v] >= INSECT_TYPE_COUNT) {
+      soakViolation(SOAK_CHECK_TYPE, v);
+      continue;   // El resto depende del tipo
+    }
+    uint8_t length = voices.sequenceLength[v];
+    if (length < 3 || length > getMaxSequenceLength(voiceType(v))) soakViolation(SOAK_CHECK_LENGTH, v);
+    if (voices.sequenceIndex[v] >= length) soakViolation(SOAK_CHECK_INDEX, v);
+    for (uint8_t i = 0; i < length && i < MAX_SEQUENCE_LENGTH; i++) {
+      uint16_t hz = noteFrequency(noteTranspose(voices.notes[v][i], paramSemitones()));
+      if (hz < 20 || hz > 8000) {
+        soakViolation(SOAK_CHECK_FREQUENCY, v);
+        break;
+      }
+    }
+
+    bool muted = voiceIsMuted(v);
+    bool inHeap = voices.heapPos[v] != VOICE_NOT_IN_HEAP;
+    if (inHeap == muted || (inHeap && voices.heap[voices.heapPos[v]] != v)) soakViolation(SOAK_CHECK_VOICE_HEAP, v);
+    if (inHeap) heapMembers++;
+    if (muted) continue;
+
+    // Vencimientos: ni muy lejos (un intervalo que desborda) ni atrasados
+    int32_t ahead = (int32_t)(voices.deadline[v] - now);
+    if (ahead > (int32_t)SOAK_HORIZON_MS) soakViolation(SOAK_CHECK_VOICE_HORIZON, v);
+    if (ahead < -(int32_t)SOAK_MAX_LATE_MS) soakViolation(SOAK_CHECK_VOICE_LATE, v);
+    if (soak.elapsedMs - soak.lastSequenceMs[v] > SOAK_STALL_MS) {
+      soakViolation(SOAK_CHECK_STALL, v);
+      soak.lastSequenceMs[v] = soak.elapsedMs;   // Un aviso por plazo
+    }
+  }
+
+  if (heapMembers != voices.heapSize) soakViolation(SOAK_CHECK_VOICE_HEAP, MAX_VOICES);
+  for (uint8_t i = 1; i < voices.heapSize; i++) {
+    uint8_t parent = (i - 1) / 2;
+    if (deadlineBefore(voices.deadline[voices.heap[i]], voices.deadline[voices.heap[parent]])) {
+      soakViolation(SOAK_CHECK_VOICE_HEAP, voices.heap[i]);
+      break;
+    }
+  }
+}
+
+void soakCheckTasks(uint32_t now) {
+  for (uint8_t t = 0; t < scheduler.taskCount; t++) {
+    const SchedulerTask &task = scheduler.tasks[t];
+    int32_t ahead = (int32_t)(task.deadline - now);
+    if (ahead > (int32_t)SCHEDULER_PARKED_MS) soakViolation(SOAK_CHECK_TASK_HORIZON, t);
+    if (ahead < -(int32_t)SOAK_MAX_LATE_MS) soakViolation(SOAK_CHECK_TASK_LATE, t);
+    if (task.maxLateMs > SOAK_MAX_LATE_MS && task.maxLateMs > soak.taskLateSeen[t]) {
+      soakViolation(SOAK_CHECK_TASK_LATE, t);
+    }
+    soak.taskLateSeen[t] = task.maxLateMs;
+  }
+}
+
+void soakCheckParams() {
+  for (uint8_t p = 0; p < PARAM_COUNT; p++) {
+    float value = paramValue((ParamId)p);
+    float target = paramTarget((ParamId)p);
+    const ParamSpec &spec = PARAM_SPECS[p];
+    if (!isfinite(value) || value < spec.minValue || value > spec.maxValue ||
+        !isfinite(target) || target < spec.minValue || target > spec.maxValue) {
+      soakViolation(SOAK_CHECK_PARAM, p);
+    }
+  }
+}
+
+// Mensajes de error o aviso escritos en esta vuelta (siguen en el anillo
+// aunque ya se hayan vaciado)
+void soakCheckLog() {
+  uint32_t head = logRing.head.load();
+  uint32_t first = head - soak.logHead > LOG_RING_SIZE ? head - LOG_RING_SIZE : soak.logHead;
+  for (uint32_t i = first; i != head; i++) {
+    const LogRecord &r = logRing.records[i % LOG_RING_SIZE];
+    if (r.level <= LOG_LEVEL_WARN && r.id != LOG_DROPPED) soakViolation(SOAK_CHECK_LOG_ERROR, r.id);
+  }
+  soak.logHead = head;
+  if (logRing.dropped != soak.logDropped) {
+    soakViolation(SOAK_CHECK_LOG_DROPPED, (uint16_t)(logRing.dropped - soak.logDropped));
+    soak.logDropped = logRing.dropped;
+  }
+}
+
+void soakCheck() {
+  uint32_t now = hal::millis();
+  soakCheckVoices(now);
+  soakCheckTasks(now);
+  soakCheckParams();
+  soakCheckLog();
+}
+
+// ===============================================
+// EJECUCIÓN
+// ===============================================
+
+void soakBegin(const SoakConfig &config) {
+  memset(&soak, 0, sizeof(soak));
+  soak.config = config;
+  soak.random = (config.seed ^ 0x9E3779B9u) ? (config.seed ^ 0x9E3779B9u) : 1;
+  soak.digest = 2166136261u;
+
+  hal::sim::reset(config.seed);
+  hal::sim::setMillis(config.startMs);
+  soak.startMicros = hal::sim::state().nowMicros;
+  piezoBugsSetup();
+
+  soak.lastMillis = hal::millis();
+  soak.state = currentState;
+  soak.rootNote = rootNoteOffset;
+  memcpy(soak.type, voices.type, sizeof(soak.type));
+  soak.logHead = logRing.head.load();
+  soak.logDropped = logRing.dropped;
+  soak.nextPressMs = config.pressMeanMs ? soakNextAfter(config.pressMeanMs) : UINT64_MAX;
+  soak.nextTreeMs = config.treeMeanMs ? soakNextAfter(config.treeMeanMs) : UINT64_MAX;
+
+  if (config.trace) {
+    fwrite(SOAK_TRACE_MAGIC, 1, sizeof(SOAK_TRACE_MAGIC), config.trace);
+    fwrite(&config.seed, sizeof(config.seed), 1, config.trace);
+    fwrite(&config.startMs, sizeof(config.startMs), 1, config.trace);
+  }
+  soakObserve();   // La primera secuencia de piezoBugsSetup()
+}
+
+// Una vuelta del loop, con entradas, traza y comprobaciones
+void soakStep() {
+  soakInjectPress();
+  soakInjectTree();
+  piezoBugsLoop();
+  soak.loops++;
+  soak.elapsedMs = (hal::sim::state().nowMicros - soak.startMicros) / 1000;
+  if (soak.elapsedMs / SOAK_DAY_MS > soak.days) {
+    soak.days = soak.elapsedMs / SOAK_DAY_MS;
+    soakTrace(SOAK_EV_DAY, 0, (uint16_t)soak.days);
+  }
+  soakObserve();
+  soakCheck();
+}
+
+inline bool soakDone() {
+  return soak.elapsedMs >= soak.config.durationMs;
+}
+
+void soakRunFor(uint64_t ms) {
+  uint64_t end = soak.elapsedMs + ms;
+  while (soak.elapsedMs < end) soakStep();
+}
+
+// Resumen: violaciones por invariante, con el primer instante (desde el arranque)
+void soakPrintReport(FILE *out) {
+  fprintf(out, "Vueltas del loop:  %llu\n", (unsigned long long)soak.loops);
+  fprintf(out, "Desbordes millis:  %lu\n", (unsigned long)soak.wraps);
+  fprintf(out, "Eventos:           %lu (resumen %08lx)\n", (unsigned long)soak.events, (unsigned long)soak.digest);
+  fprintf(out, "Pulsaciones:       %lu eventos, %lu perdidos\n", (unsigned long)buttonInput.events,
+          (unsigned long)buttonInput.dropped);
+  fprintf(out, "Violaciones:       %lu\n", (unsigned long)soak.violations);
+  for (uint8_t c = 0; c < SOAK_CHECK_COUNT; c++) {
+    if (soak.checkCount[c] == 0) continue;
+    fprintf(out, "  %-20s %lu, la primera a los %.3f s\n", SOAK_CHECK_NAMES[c],
+            (unsigned long)soak.checkCount[c], soak.checkFirstMs[c] / 1000.0);
+  }
+}
+
+#endif // PIEZOBUGS_SOAK_H
@@ -0,0 +1,442 @@
+/*
+ * synth.h - Sintetizador polifónico por bloques para la salida I2S
+ *
+ * Alternativa a tone(): en lugar de una onda cuadrada por piezo, todas las
+ * voces de insecto se mezclan por software en bloques del tamaño del DMA
+ * y salen por el codec del AudioKit (pines I2S de
+ * tests/wav_player/audio_config.h, probados en tests/simple_tone_test).
+ *
+ * - Osciladores de tabla (256 muestras) con acumulador de fase de 32 bits
+ * - Envolvente ADSR por tipo de insecto, en enteros
+ * - Mezcla en 32 bits con saturación a 16 bits
+ * - Las notas llegan desde voices.h por una cola de eventos de un solo
+ *   productor (loop) y un solo consumidor (tarea de audio)
+ * - Voces de muestra (samples.h): leen PCM de 16 bits de donde ya está,
+ *   la flash proyectada o la caché en PSRAM, sin abrir ni copiar nada; si
+ *   la muestra va a otra frecuencia, pasa por un conversor (resampler.h)
+ *
+ * Se activa con USE_I2S_SYNTH=1 (ver config.h). El render no usa coma
+ * flotante: solo synthInit() calcula las tablas de onda.
+ */
+
+#ifndef PIEZOBUGS_SYNTH_H
+#define PIEZOBUGS_SYNTH_H
+
+#include <atomic>
+#include <math.h>
+#include <string.h>
+#include "hal.h"
+#include "config.h"
+#include "insects.h"
+#include "resampler.h"
+
+// ===============================================
+// ESTRUCTURAS Y TIPOS
+// ===============================================
+
+const uint8_t SYNTH_MAX_VOICES = 32;
+const uint16_t SYNTH_WAVE_SIZE = 256;
+const uint8_t SYNTH_EVENT_QUEUE_SIZE = 32;    // Potencia de 2
+const uint8_t SYNTH_SAMPLE_VOICES = 4;
+const uint8_t SYNTH_SAMPLE_QUEUE_SIZE = 8;    // Potencia de 2
+
+// Nivel máximo de una voz (Q15). 16 voces a la vez superan el fondo de
+// escala y la mezcla satura en lugar de desbordar.
+const int32_t SYNTH_VOICE_LEVEL = 6000;
+const uint8_t SYNTH_ENV_SHIFT = 8;            // Bits de fracción de la envolvente
+
+enum SynthWave {
+  WAVE_SINE,
+  WAVE_PULSE,      // Pulso al 25%
+  WAVE_TRIANGLE,
+  WAVE_COUNT
+};
+
+enum SynthStage {
+  STAGE_OFF,
+  STAGE_ATTACK,
+  STAGE_DECAY,
+  STAGE_SUSTAIN,
+  STAGE_RELEASE
+};
+
+// Timbre de cada tipo de insecto
+struct SynthPatch {
+  uint8_t wave;
+  uint16_t attackMs;
+  uint16_t decayMs;
+  uint8_t sustainPercent;
+  uint16_t releaseMs;
+};
+
+const SynthPatch synthPatches[INSECT_TYPE_COUNT] = {
+  {WAVE_SINE,     2, 15, 50, 20},   // SPIDER: chirridos agudos y limpios
+  {WAVE_PULSE,    1,  8, 70, 10},   // CRICKET: ataque seco
+  {WAVE_TRIANGLE, 8, 30, 60, 40}    // BEETLE: zumbido grave y suave
+};
+
+struct SynthEvent {
+  uint8_t voice;
+  uint8_t type;          // InsectType
+  uint16_t frequency;    // 0 = note off
+  uint16_t durationMs;
+};
+
+// Disparo de una muestra: data debe seguir siendo válido mientras suena
+struct SynthSampleEvent {
+  const int16_t *data;
+  uint32_t frames;
+  uint16_t gain;         // Q15
+  uint8_t voice;
+  const ResamplerTable *rate;   // nullptr = ya está a SYNTH_SAMPLE_RATE
+};
+
+struct Synth {
+  // Estado por voz (un array por campo, como voices.h)
+  uint32_t phase[SYNTH_MAX_VOICES];
+  uint32_t increment[SYNTH_MAX_VOICES];
+  uint8_t wave[SYNTH_MAX_VOICES];
+  uint8_t stage[SYNTH_MAX_VOICES];
+  int32_t level[SYNTH_MAX_VOICES];           // Envolvente, Q15 << SYNTH_ENV_SHIFT
+  int32_t attackStep[SYNTH_MAX_VOICES];
+  int32_t decayStep[SYNTH_MAX_VOICES];
+  int32_t releaseStep[SYNTH_MAX_VOICES];
+  uint32_t releaseSamples[SYNTH_MAX_VOICES];
+  int32_t sustainLevel[SYNTH_MAX_VOICES];
+  uint32_t holdSamples[SYNTH_MAX_VOICES];    // Muestras hasta el release
+  uint32_t activeMask;                       // Bit v = voz v sonando
+
+  // Voces de muestra
+  const int16_t *sampleData[SYNTH_SAMPLE_VOICES];
+  uint32_t sampleFrames[SYNTH_SAMPLE_VOICES];
+  uint32_t samplePos[SYNTH_SAMPLE_VOICES];
+  int32_t sampleGain[SYNTH_SAMPLE_VOICES];
+  Resampler sampleResampler[SYNTH_SAMPLE_VOICES];   // table = nullptr: sin conversión
+  uint8_t sampleMask;                        // Bit v = muestra v sonando
+
+  int16_t waves[WAVE_COUNT][SYNTH_WAVE_SIZE];
+  int32_t mix[SYNTH_BLOCK_FRAMES];
+  int16_t resampled[SYNTH_BLOCK_FRAMES];
+
+  // Cola de eventos: escribe el loop, lee la tarea de audio
+  SynthEvent events[SYNTH_EVENT_QUEUE_SIZE];
+  std::atomic<uint8_t> eventHead;
+  std::atomic<uint8_t> eventTail;
+  SynthSampleEvent sampleEvents[SYNTH_SAMPLE_QUEUE_SIZE];
+  std::atomic<uint8_t> sampleHead;
+  std::atomic<uint8_t> sampleTail;
+
+  // Estadísticas
+  uint32_t blocksRendered;
+  uint32_t clippedSamples;
+  uint32_t droppedEvents;
+};
+
+Synth synth;
+
+// ===============================================
+// INICIALIZACIÓN
+// ===============================================
+
+void synthInit() {
+  memset(synth.phase, 0, sizeof(synth.phase));
+  memset(synth.stage, 0, sizeof(synth.stage));
+  memset(synth.level, 0, sizeof(synth.level));
+  synth.activeMask = 0;
+  synth.sampleMask = 0;
+  synth.eventHead.store(0);
+  synth.eventTail.store(0);
+  synth.sampleHead.store(0);
+  synth.sampleTail.store(0);
+  synth.blocksRendered = 0;
+  synth.clippedSamples = 0;
+  synth.droppedEvents = 0;
+
+  for (uint16_t i = 0; i < SYNTH_WAVE_SIZE; i++) {
+    synth.waves[WAVE_SINE][i] = (int16_t)(sinf(2.0f * (float)M_PI * i / SYNTH_WAVE_SIZE) * 32767.0f);
+    synth.waves[WAVE_PULSE][i] = (i < SYNTH_WAVE_SIZE / 4) ? 32767 : -32767;
+    int32_t tri = (i < SYNTH_WAVE_SIZE / 2) ? (int32_t)i * 4 * 32767 / SYNTH_WAVE_SIZE - 32767
+                                            : 32767 - ((int32_t)i - SYNTH_WAVE_SIZE / 2) * 4 * 32767 / SYNTH_WAVE_SIZE;
+    synth.waves[WAVE_TRIANGLE][i] = (int16_t)tri;
+  }
+}
+
+// ===============================================
+// EVENTOS (llamar desde el loop)
+// ===============================================
+
+bool synthPushEvent(const SynthEvent &event) {
+  uint8_t head = synth.eventHead.load(std::memory_order_relaxed);
+  uint8_t next = (head + 1) & (SYNTH_EVENT_QUEUE_SIZE - 1);
+  if (next == synth.eventTail.load(std::memory_order_acquire)) {
+    synth.droppedEvents++;
+    return false;
+  }
+  synth.events[head] = event;
+  synth.eventHead.store(next, std::memory_order_release);
+  return true;
+}
+
+void synthNoteOn(uint8_t voice, InsectType type, uint16_t frequency, uint16_t durationMs) {
+  SynthEvent event = {voice, (uint8_t)type, frequency, durationMs};
+  synthPushEvent(event);
+}
+
+void synthNoteOff(uint8_t voice) {
+  SynthEvent event = {voice, 0, 0, 0};
+  synthPushEvent(event);
+}
+
+// La voz de muestra voice pasa a leer frames muestras desde data; rate
+// convierte desde la frecuencia de la muestra
+bool synthPlaySample(uint8_t voice, const int16_t *data, uint32_t frames, uint16_t gain,
+                     const ResamplerTable *rate = nullptr) {
+  uint8_t head = synth.sampleHead.load(std::memory_order_relaxed);
+  uint8_t next = (head + 1) & (SYNTH_SAMPLE_QUEUE_SIZE - 1);
+  if (next == synth.sampleTail.load(std::memory_order_acquire)) {
+    synth.droppedEvents++;
+    return false;
+  }
+  synth.sampleEvents[head] = {data, frames, gain, voice, rate};
+  synth.sampleHead.store(next, std::memory_order_release);
+  return true;
+}
+
+// ===============================================
+// RENDER (tarea de audio)
+// ===============================================
+
+uint32_t synthMsToSamples(uint32_t ms) {
+  uint32_t samples = ms * SYNTH_SAMPLE_RATE / 1000;
+  return samples > 0 ? samples : 1;
+}
+
+// Pasa la voz a release: baja a cero desde el nivel actual
+void synthStartRelease(uint8_t v, int32_t level) {
+  int32_t step = level / (int32_t)synth.releaseSamples[v];
+  synth.releaseStep[v] = step > 0 ? step : 1;
+  synth.stage[v] = STAGE_RELEASE;
+}
+
+void synthApplyEvent(const SynthEvent &event) {
+  uint8_t v = event.voice;
+  if (v >= SYNTH_MAX_VOICES) return;
+
+  if (event.frequency == 0) {
+    if (synth.stage[v] != STAGE_OFF && synth.stage[v] != STAGE_RELEASE) {
+      synthStartRelease(v, synth.level[v]);
+    }
+    return;
+  }
+
+  const SynthPatch &patch = synthPatches[event.type < INSECT_TYPE_COUNT ? event.type : SPIDER];
+  const int32_t peak = SYNTH_VOICE_LEVEL << SYNTH_ENV_SHIFT;
+
+  synth.increment[v] = (uint32_t)(((uint64_t)event.frequency << 32) / SYNTH_SAMPLE_RATE);
+  synth.wave[v] = patch.wave;
+  synth.sustainLevel[v] = peak / 100 * patch.sustainPercent;
+  synth.attackStep[v] = peak / (int32_t)synthMsToSamples(patch.attackMs);
+  synth.decayStep[v] = (peak - synth.sustainLevel[v]) / (int32_t)synthMsToSamples(patch.decayMs);
+  synth.releaseSamples[v] = synthMsToSamples(patch.releaseMs);
+  synth.holdSamples[v] = synthMsToSamples(event.durationMs);
+  if (synth.attackStep[v] < 1) synth.attackStep[v] = 1;
+  if (synth.decayStep[v] < 1) synth.decayStep[v] = 1;
+
+  // Retrigger desde el nivel actual para evitar clics
+  synth.stage[v] = STAGE_ATTACK;
+  synth.activeMask |= (1UL << v);
+}
+
+void synthDrainEvents() {
+  uint8_t tail = synth.eventTail.load(std::memory_order_relaxed);
+  uint8_t head = synth.eventHead.load(std::memory_order_acquire);
+  while (tail != head) {
+    synthApplyEvent(synth.events[tail]);
+    tail = (tail + 1) & (SYNTH_EVENT_QUEUE_SIZE - 1);
+  }
+  synth.eventTail.store(tail, std::memory_order_release);
+
+  tail = synth.sampleTail.load(std::memory_order_relaxed);
+  head = synth.sampleHead.load(std::memory_order_acquire);
+  while (tail != head) {
+    const SynthSampleEvent &event = synth.sampleEvents[tail];
+    uint8_t v = event.voice;
+    if (v < SYNTH_SAMPLE_VOICES) {
+      synth.sampleData[v] = event.data;
+      synth.sampleFrames[v] = event.frames;
+      synth.samplePos[v] = 0;
+      synth.sampleGain[v] = event.gain;
+      resamplerReset(synth.sampleResampler[v], event.rate);
+      if (event.data && event.frames) synth.sampleMask |= (1 << v);
+      else synth.sampleMask &= ~(1 << v);
+    }
+    tail = (tail + 1) & (SYNTH_SAMPLE_QUEUE_SIZE - 1);
+  }
+  synth.sampleTail.store(tail, std::memory_order_release);
+}
+
+// Suma una voz al buffer de mezcla. La envolvente se procesa por tramos
+// lineales: dentro de cada tramo el bucle interno no tiene ramas.
+void synthRenderVoice(uint8_t v, uint16_t frames) {
+  const int16_t *table = synth.waves[synth.wave[v]];
+  const int32_t peak = SYNTH_VOICE_LEVEL << SYNTH_ENV_SHIFT;
+  uint32_t phase = synth.phase[v];
+  const uint32_t increment = synth.increment[v];
+  int32_t level = synth.level[v];
+  uint16_t i = 0;
+
+  while (i < frames && synth.stage[v] != STAGE_OFF) {
+    uint32_t n = frames - i;
+    int32_t step = 0;
+    uint8_t stage = synth.stage[v];
+
+    // Mientras dura la nota, el tramo no puede pasar del release
+    if (stage != STAGE_RELEASE && synth.holdSamples[v] < n) n = synth.holdSamples[v];
+
+    if (stage == STAGE_ATTACK) {
+      step = synth.attackStep[v];
+      int32_t toPeak = (peak - level + step - 1) / step;
+      if (toPeak < 0) toPeak = 0;
+      if ((uint32_t)toPeak < n) n = toPeak;
+    } else if (stage == STAGE_DECAY) {
+      step = -synth.decayStep[v];
+      int32_t toSustain = (level - synth.sustainLevel[v] + synth.decayStep[v] - 1) / synth.decayStep[v];
+      if (toSustain < 0) toSustain = 0;
+      if ((uint32_t)toSustain < n) n = toSustain;
+    } else if (stage == STAGE_RELEASE) {
+      step = -synth.releaseStep[v];
+      int32_t toZero = (level + synth.releaseStep[v] - 1) / synth.releaseStep[v];
+      if (toZero < 0) toZero = 0;
+      if ((uint32_t)toZero < n) n = toZero;
+    }
+
+    int32_t *mix = synth.mix + i;
+    for (uint32_t k = 0; k < n; k++) {
+      level += step;
+      mix[k] += ((int32_t)table[phase >> 24] * (level >> SYNTH_ENV_SHIFT)) >> 15;
+      phase += increment;
+    }
+    i += n;
+    if (stage != STAGE_RELEASE) synth.holdSamples[v] -= n;
+
+    // Transiciones de la envolvente
+    if (stage == STAGE_ATTACK && level >= peak) {
+      level = peak;
+      synth.stage[v] = STAGE_DECAY;
+    } else if (stage == STAGE_DECAY && level <= synth.sustainLevel[v]) {
+      level = synth.sustainLevel[v];
+      synth.stage[v] = STAGE_SUSTAIN;
+    } else if (stage == STAGE_RELEASE && level <= 0) {
+      level = 0;
+      synth.stage[v] = STAGE_OFF;
+      synth.activeMask &= ~(1UL << v);
+    }
+    if (synth.stage[v] != STAGE_RELEASE && synth.stage[v] != STAGE_OFF && synth.holdSamples[v] == 0) {
+      synthStartRelease(v, level);
+    }
+  }
+
+  synth.phase[v] = phase;
+  synth.level[v] = level;
+}
+
+// Voz de muestra a otra frecuencia: tras la muestra entran taps / 2 ceros
+// para sacar la cola del filtro
+void synthRenderResampled(uint8_t v, uint16_t frames) {
+  Resampler &r = synth.sampleResampler[v];
+  const uint32_t sampleFrames = synth.sampleFrames[v];
+  const uint32_t end = sampleFrames + r.table->taps / 2;
+  uint32_t pos = synth.samplePos[v];
+  uint32_t n = 0;
+  while (n < frames && pos < end) {
+    bool tail = pos >= sampleFrames;
+    uint32_t used;
+    n += resamplerProcess(r, tail ? nullptr : synth.sampleData[v] + pos, (tail ? end : sampleFrames) - pos,
+                          synth.resampled + n, frames - n, used);
+    pos += used;
+  }
+  const int32_t gain = synth.sampleGain[v];
+  for (uint32_t k = 0; k < n; k++) synth.mix[k] += ((int32_t)synth.resampled[k] * gain) >> 15;
+  synth.samplePos[v] = pos;
+  if (n < frames) synth.sampleMask &= ~(1 << v);
+}
+
+// Suma una voz de muestra al buffer de mezcla; al acabar la muestra se apaga
+void synthRenderSample(uint8_t v, uint16_t frames) {
+  if (synth.sampleResampler[v].table) {
+    synthRenderResampled(v, frames);
+    return;
+  }
+  uint32_t pos = synth.samplePos[v];
+  uint32_t n = synth.sampleFrames[v] - pos;
+  if (n > frames) n = frames;
+  const int16_t *data = synth.sampleData[v] + pos;
+  const int32_t gain = synth.sampleGain[v];
+  for (uint32_t k = 0; k < n; k++) synth.mix[k] += ((int32_t)data[k] * gain) >> 15;
+  synth.samplePos[v] = pos + n;
+  if (synth.samplePos[v] >= synth.sampleFrames[v]) synth.sampleMask &= ~(1 << v);
+}
+
+// Renderiza un bloque estéreo intercalado (L, R, L, R...) de frames muestras
+void synthRender(int16_t *out, uint16_t frames) {
+  if (frames > SYNTH_BLOCK_FRAMES) frames = SYNTH_BLOCK_FRAMES;
+  synthDrainEvents();
+  memset(synth.mix, 0, frames * sizeof(int32_t));
+
+  uint32_t active = synth.activeMask;
+  while (active) {
+    uint8_t v = __builtin_ctz(active);
+    active &= active - 1;
+    synthRenderVoice(v, frames);
+  }
+  uint8_t samples = synth.sampleMask;
+  while (samples) {
+    uint8_t v = __builtin_ctz(samples);
+    samples &= samples - 1;
+    synthRenderSample(v, frames);
+  }
+
+  for (uint16_t i = 0; i < frames; i++) {
+    int32_t s = synth.mix[i];
+    if (s > 32767) {
+      s = 32767;
+      synth.clippedSamples++;
+    } else if (s < -32768) {
+      s = -32768;
+      synth.clippedSamples++;
+    }
+    out[2 * i] = (int16_t)s;
+    out[2 * i + 1] = (int16_t)s;
+  }
+  synth.blocksRendered++;
+}
+
+// ===============================================
+// TAREA DE AUDIO
+// ===============================================
+
+void synthAudioTask(void *arg) {
+  static int16_t block[SYNTH_BLOCK_FRAMES * 2];
+  for (;;) {
+    synthRender(block, SYNTH_BLOCK_FRAMES);
+    hal::audioWrite(block, SYNTH_BLOCK_FRAMES);  // Bloquea hasta que hay DMA libre
+  }
+}
+
+// Configura el I2S y arranca la tarea de audio en el núcleo 0 (el loop de
+// Arduino corre en el 1)
+bool synthBegin() {
+  synthInit();
+  if (!hal::audioBegin(SYNTH_SAMPLE_RATE, SYNTH_BLOCK_FRAMES, SYNTH_DMA_BUFFERS,
+                       SYNTH_I2S_BCLK, SYNTH_I2S_LRC, SYNTH_I2S_DOUT)) {
+    Serial.println("Error: no se pudo configurar el I2S");
+    return false;
+  }
+  if (!hal::startTask("synth", synthAudioTask, 4096, 5, 0)) {
+    Serial.println("Error: no se pudo crear la tarea de audio");
+    return false;
+  }
+  return true;
+}
+
+#endif // PIEZOBUGS_SYNTH_H
@@ -0,0 +1,287 @@
+/*
+ * tree_cache.h - Últimas lecturas del árbol guardadas en flash
+ *
+ * Anillo de registros en TREE_CACHE_SECTORS sectores de la partición de
+ * datos (hal::flashWrite). Solo se añade al final: cuando el sector en uso
+ * se llena se borra el más antiguo y pasa a ser el nuevo, así que todos
+ * los sectores se borran por turno (nivelado de desgaste) y cada uno
+ * aguanta siglos a un registro por minuto.
+ *
+ * Formato de cada sector:
+ *   cabecera (16 B): magic, generación, CRC-32 de los anteriores, relleno
+ *   registros (32 B): secuencia, 4 campos, timestamp, validez, CRC-32
+ * Un hueco con todos los bytes a 0xFF está libre.
+ *
+ * Ante un corte de alimentación: un registro a medias no cuadra con su CRC
+ * y se salta; un sector a medio borrar o con la cabecera a medias no es
+ * válido y se vuelve a borrar la próxima vez. Al arrancar siempre se
+ * recupera el último registro completo.
+ *
+ * Al arrancar, treeCacheBegin() solo lee las cabeceras y el sector en uso
+ * (unos pocos ms), y el motor puede sonar con los últimos datos antes de
+ * que haya WiFi.
+ */
+
+#ifndef PIEZOBUGS_TREE_CACHE_H
+#define PIEZOBUGS_TREE_CACHE_H
+
+#include <stddef.h>
+#include <string.h>
+#include "hal.h"
+#include "tree_data.h"
+
+// ===============================================
+// CONFIGURACIÓN Y FORMATO
+// ===============================================
+
+const uint8_t TREE_CACHE_SECTORS = 8;                 // 32 KB al principio de la partición
+const uint32_t TREE_CACHE_MIN_INTERVAL_MS = 60000;    // Un registro por minuto como mucho
+const uint32_t TREE_CACHE_MAGIC = 0x31435254;         // "TRC1"
+
+struct TreeCacheHeader {
+  uint32_t magic;
+  uint32_t generation;   // Crece con cada sector abierto; 0 = nunca
+  uint32_t crc;
+  uint32_t reserved;     // Se queda en 0xFFFFFFFF
+};
+
+struct TreeCacheRecord {
+  uint32_t sequence;
+  float humidity;
+  float temperature;
+  float bioelectrical_activity;
+  float light_level;
+  uint32_t timestamp;
+  uint32_t valid;
+  uint32_t crc;          // Último: se escribe el último
+};
+
+static_assert(sizeof(TreeCacheHeader) == 16, "Cabecera de 16 bytes");
+static_assert(sizeof(TreeCacheRecord) == 32, "Registro de 32 bytes");
+
+const uint16_t TREE_CACHE_SLOTS = (hal::FLASH_SECTOR_SIZE - sizeof(TreeCacheHeader)) / sizeof(TreeCacheRecord);
+// Registros que sobreviven siempre: el sector más antiguo se borra al llenar el actual
+const uint16_t TREE_CACHE_CAPACITY = (TREE_CACHE_SECTORS - 1) * TREE_CACHE_SLOTS;
+
+// CRC-32 (IEEE) con tabla en flash
+struct CrcTable {
+  uint32_t entry[256];
+};
+
+constexpr CrcTable buildCrcTable() {
+  CrcTable table = {};
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    table.entry[i] = c;
+  }
+  return table;
+}
+
+constexpr CrcTable CRC_TABLE = buildCrcTable();
+
+inline uint32_t crc32(const void *data, uint32_t length) {
+  const uint8_t *bytes = (const uint8_t *)data;
+  uint32_t crc = 0xFFFFFFFFu;
+  for (uint32_t i = 0; i < length; i++) crc = CRC_TABLE.entry[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+// ===============================================
+// ESTADO
+// ===============================================
+
+struct TreeCache {
+  bool ready;                                    // Hay partición de datos
+  uint32_t generation[TREE_CACHE_SECTORS];       // 0 = sector sin cabecera válida
+  int8_t head;                                   // Sector en uso (-1 = ninguno)
+  uint32_t writeOffset;                          // Próximo hueco dentro de head
+  uint32_t nextSequence;
+  uint32_t lastStoreMs;
+  bool stored;                                   // Ya se guardó algo en esta sesión
+
+  // Estadísticas
+  uint32_t recovered;                            // Registros válidos en el sector en uso al arrancar
+  uint32_t torn;                                 // Registros a medias saltados al arrancar
+  uint32_t appends;
+  uint32_t erases;
+  uint32_t failures;
+};
+
+TreeCache treeCache;
+
+inline uint32_t treeCacheSectorAddress(uint8_t sector) {
+  return (uint32_t)sector * hal::FLASH_SECTOR_SIZE;
+}
+
+inline bool treeCacheFree(const TreeCacheRecord &r) {
+  const uint8_t *bytes = (const uint8_t *)&r;
+  for (uint32_t i = 0; i < sizeof(r); i++) {
+    if (bytes[i] != 0xFF) return false;
+  }
+  return true;
+}
+
+inline bool treeCacheRecordValid(const TreeCacheRecord &r) {
+  return r.crc == crc32(&r, offsetof(TreeCacheRecord, crc));
+}
+
+inline void treeCacheToData(const TreeCacheRecord &r, TreeData &data) {
+  data.humidity = r.humidity;
+  data.temperature = r.temperature;
+  data.bioelectrical_activity = r.bioelectrical_activity;
+  data.light_level = r.light_level;
+  data.timestamp = r.timestamp;
+  data.data_valid = r.valid != 0;
+}
+
+// ===============================================
+// LECTURA
+// ===============================================
+
+// Hasta max lecturas, de la más reciente a la más antigua. Si se pasa
+// newestSequence, recibe la secuencia de la más reciente
+uint16_t treeCacheRecent(const TreeCache &cache, TreeData *out, uint16_t max, uint32_t *newestSequence = nullptr) {
+  uint16_t count = 0;
+  uint32_t below = 0xFFFFFFFFu;   // Generación del sector leído antes
+  while (count < max) {
+    // Sector válido más nuevo por debajo de la generación anterior
+    int8_t sector = -1;
+    for (uint8_t s = 0; s < TREE_CACHE_SECTORS; s++) {
+      uint32_t g = cache.generation[s];
+      if (g == 0 || g >= below) continue;
+      if (sector < 0 || g > cache.generation[sector]) sector = s;
+    }
+    if (sector < 0) break;
+    below = cache.generation[sector];
+
+    uint32_t base = treeCacheSectorAddress(sector);
+    for (int i = TREE_CACHE_SLOTS - 1; i >= 0 && count < max; i--) {
+      TreeCacheRecord r;
+      hal::flashRead(base + sizeof(TreeCacheHeader) + i * sizeof(TreeCacheRecord), &r, sizeof(r));
+      if (treeCacheFree(r) || !treeCacheRecordValid(r)) continue;
+      if (count == 0 && newestSequence) *newestSequence = r.sequence;
+      treeCacheToData(r, out[count++]);
+    }
+  }
+  return count;
+}
+
+bool treeCacheLatest(const TreeCache &cache, TreeData &out) {
+  return cache.ready && treeCacheRecent(cache, &out, 1) == 1;
+}
+
+// ===============================================
+// ARRANQUE
+// ===============================================
+
+// Lee las cabeceras y busca el final del sector en uso. Devuelve true si
+// hay algún registro guardado
+bool treeCacheBegin(TreeCache &cache) {
+  memset(&cache, 0, sizeof(cache));
+  cache.head = -1;
+  cache.ready = hal::flashBegin() &&
+                hal::flashSize() >= TREE_CACHE_SECTORS * hal::FLASH_SECTOR_SIZE;
+  if (!cache.ready) return false;
+
+  for (uint8_t s = 0; s < TREE_CACHE_SECTORS; s++) {
+    TreeCacheHeader h;
+    if (!hal::flashRead(treeCacheSectorAddress(s), &h, sizeof(h))) continue;
+    if (h.magic != TREE_CACHE_MAGIC || h.crc != crc32(&h, offsetof(TreeCacheHeader, crc))) continue;
+    cache.generation[s] = h.generation;
+    if (cache.head < 0 || h.generation > cache.generation[cache.head]) cache.head = s;
+  }
+  if (cache.head < 0) return false;
+
+  // El sector en uso se llena en orden: el primer hueco libre es el final
+  uint32_t base = treeCacheSectorAddress(cache.head);
+  cache.writeOffset = sizeof(TreeCacheHeader);
+  for (uint16_t i = 0; i < TREE_CACHE_SLOTS; i++) {
+    TreeCacheRecord r;
+    uint32_t offset = sizeof(TreeCacheHeader) + i * sizeof(TreeCacheRecord);
+    hal::flashRead(base + offset, &r, sizeof(r));
+    if (treeCacheFree(r)) break;
+    cache.writeOffset = offset + sizeof(TreeCacheRecord);
+    if (!treeCacheRecordValid(r)) {
+      cache.torn++;
+      continue;
+    }
+    cache.recovered++;
+    if (r.sequence >= cache.nextSequence) cache.nextSequence = r.sequence + 1;
+  }
+
+  // Si el sector en uso no tiene registros, la secuencia sigue la del anterior
+  TreeData latest;
+  if (cache.recovered == 0 && treeCacheRecent(cache, &latest, 1, &cache.nextSequence) == 1) {
+    cache.nextSequence++;
+  }
+  return cache.nextSequence > 0;
+}
+
+// ===============================================
+// ESCRITURA
+// ===============================================
+
+// Borra el sector más antiguo (el siguiente en el anillo) y lo abre
+bool treeCacheOpenSector(TreeCache &cache) {
+  uint8_t next = cache.head < 0 ? 0 : (cache.head + 1) % TREE_CACHE_SECTORS;
+  uint32_t generation = cache.head < 0 ? 1 : cache.generation[cache.head] + 1;
+  cache.generation[next] = 0;
+  cache.erases++;
+  if (!hal::flashErase(treeCacheSectorAddress(next))) return false;
+
+  TreeCacheHeader h;
+  h.magic = TREE_CACHE_MAGIC;
+  h.generation = generation;
+  h.crc = crc32(&h, offsetof(TreeCacheHeader, crc));
+  h.reserved = 0xFFFFFFFFu;
+  if (!hal::flashWrite(treeCacheSectorAddress(next), &h, sizeof(h))) return false;
+  cache.generation[next] = generation;
+  cache.head = next;
+  cache.writeOffset = sizeof(TreeCacheHeader);
+  return true;
+}
+
+// Añade una lectura al final del anillo
+bool treeCacheAppend(TreeCache &cache, const TreeData &data) {
+  if (!cache.ready) return false;
+  if (cache.head < 0 || cache.writeOffset + sizeof(TreeCacheRecord) > hal::FLASH_SECTOR_SIZE) {
+    if (!treeCacheOpenSector(cache)) {
+      cache.failures++;
+      return false;
+    }
+  }
+
+  TreeCacheRecord r;
+  r.sequence = cache.nextSequence;
+  r.humidity = data.humidity;
+  r.temperature = data.temperature;
+  r.bioelectrical_activity = data.bioelectrical_activity;
+  r.light_level = data.light_level;
+  r.timestamp = (uint32_t)data.timestamp;
+  r.valid = data.data_valid ? 1 : 0;
+  r.crc = crc32(&r, offsetof(TreeCacheRecord, crc));
+
+  // El hueco se da por usado aunque falle: un registro a medias no se reescribe
+  uint32_t address = treeCacheSectorAddress(cache.head) + cache.writeOffset;
+  cache.writeOffset += sizeof(TreeCacheRecord);
+  if (!hal::flashWrite(address, &r, sizeof(r))) {
+    cache.failures++;
+    return false;
+  }
+  cache.nextSequence++;
+  cache.appends++;
+  return true;
+}
+
+// Guarda una lectura válida como mucho cada TREE_CACHE_MIN_INTERVAL_MS
+bool treeCacheStore(TreeCache &cache, const TreeData &data, uint32_t now) {
+  if (!cache.ready || !data.data_valid) return false;
+  if (cache.stored && now - cache.lastStoreMs < TREE_CACHE_MIN_INTERVAL_MS) return false;
+  if (!treeCacheAppend(cache, data)) return false;
+  cache.stored = true;
+  cache.lastStoreMs = now;
+  return true;
+}
+
+#endif // PIEZOBUGS_TREE_CACHE_H
@@ -0,0 +1,44 @@
+/*
+ * tree_data.h - Lecturas de los sensores del árbol (InfluxDB, bucket biodata)
+ *
+ * Estructura compartida por forestData y por el parser de influx_csv.h.
+ */
+
+#ifndef PIEZOBUGS_TREE_DATA_H
+#define PIEZOBUGS_TREE_DATA_H
+
+#include <stdint.h>
+
+// Campos (_field) que se leen de InfluxDB
+enum TreeField {
+  TREE_HUMIDITY,
+  TREE_TEMPERATURE,
+  TREE_BIOELECTRICAL_ACTIVITY,
+  TREE_LIGHT_LEVEL,
+  TREE_FIELD_COUNT
+};
+
+const char* const TREE_FIELD_NAMES[TREE_FIELD_COUNT] = {
+  "humidity", "temperature", "bioelectrical_activity", "light_level"
+};
+
+struct TreeData {
+  float humidity = 0.0;
+  float temperature = 0.0;
+  float bioelectrical_activity = 0.0;
+  float light_level = 0.0;
+  unsigned long timestamp = 0;
+  bool data_valid = false;
+};
+
+inline void treeDataSet(TreeData &data, TreeField field, float value) {
+  switch (field) {
+    case TREE_HUMIDITY: data.humidity = value; break;
+    case TREE_TEMPERATURE: data.temperature = value; break;
+    case TREE_BIOELECTRICAL_ACTIVITY: data.bioelectrical_activity = value; break;
+    case TREE_LIGHT_LEVEL: data.light_level = value; break;
+    default: break;
+  }
+}
+
+#endif // PIEZOBUGS_TREE_DATA_H
@@ -0,0 +1,54 @@
+/*
+ * tree_slot.h - Entrega de TreeData entre núcleos sin bloqueos
+ *
+ * Triple buffer de un productor (la tarea de red) y un consumidor (el
+ * loop de sonido y luz). Cada lado es dueño de un buffer y el tercero
+ * queda en medio; publicar y leer intercambian el propio con el del medio
+ * en una sola operación atómica. Ninguno de los dos espera nunca al otro
+ * ni repite lecturas, y el lector siempre recibe una instantánea entera:
+ * la última publicada.
+ */
+
+#ifndef PIEZOBUGS_TREE_SLOT_H
+#define PIEZOBUGS_TREE_SLOT_H
+
+#include <atomic>
+#include "tree_data.h"
+
+const uint8_t TREE_SLOT_FRESH = 0x04;   // Bit del índice del medio: publicado y sin leer
+
+struct TreeDataSlot {
+  TreeData buffers[3];
+  std::atomic<uint8_t> middle;   // Índice del buffer intermedio | TREE_SLOT_FRESH
+  uint8_t back;                  // Solo lo toca el productor
+  uint8_t front;                 // Solo lo toca el consumidor
+  std::atomic<uint32_t> published;
+};
+
+// Antes de arrancar el productor
+void treeSlotInit(TreeDataSlot &slot) {
+  for (TreeData &b : slot.buffers) b = TreeData();
+  slot.back = 0;
+  slot.middle.store(1);
+  slot.front = 2;
+  slot.published.store(0);
+}
+
+// Productor: copia data en su buffer y lo deja en medio
+void treeSlotPublish(TreeDataSlot &slot, const TreeData &data) {
+  slot.buffers[slot.back] = data;
+  uint8_t previous = slot.middle.exchange(slot.back | TREE_SLOT_FRESH, std::memory_order_acq_rel);
+  slot.back = previous & 0x03;
+  slot.published.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Consumidor: si hay una instantánea nueva la copia en out y devuelve true
+bool treeSlotRead(TreeDataSlot &slot, TreeData &out) {
+  if (!(slot.middle.load(std::memory_order_relaxed) & TREE_SLOT_FRESH)) return false;
+  uint8_t previous = slot.middle.exchange(slot.front, std::memory_order_acq_rel);
+  slot.front = previous & 0x03;
+  out = slot.buffers[slot.front];
+  return true;
+}
+
+#endif // PIEZOBUGS_TREE_SLOT_H
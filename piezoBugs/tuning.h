@@ -0,0 +1,171 @@
+/*
+ * tuning.h - Afinación de PiezoBugs calculada en tiempo de compilación
+ *
+ * Las notas se guardan como índices de semitono desde Do0 (NoteIndex):
+ * 0 = Do0 (16,35 Hz), 57 = La4 (440 Hz). Las tablas de frecuencias y la de
+ * todas las escalas y modos transportadas a las 12 notas raíz se
+ * construyen con constexpr y quedan en flash, así que frecuencia, octava
+ * y nombre de una nota son accesos O(1) sin coma flotante en ejecución.
+ *
+ * Sustituye a pentatonicScale[], applyRootNoteOffset() (pow en cada nota),
+ * getOctaveFromFrequency() y getNoteNameFromScale() (búsqueda lineal).
+ */
+
+#ifndef PIEZOBUGS_TUNING_H
+#define PIEZOBUGS_TUNING_H
+
+#include <stdint.h>
+
+// ===============================================
+// NOTAS
+// ===============================================
+
+typedef uint8_t NoteIndex;
+
+const uint8_t SEMITONES = 12;
+const uint8_t NOTE_COUNT = 120;              // Do0 .. Si9
+const NoteIndex NOTE_A4 = 57;                // La4 = 440 Hz
+const NoteIndex NOTE_MAX_PLAYABLE = 107;     // Si8 (7902 Hz), bajo el límite de 8000 Hz
+
+const char* const NOTE_NAMES[SEMITONES] = {
+  "Do", "Do#", "Re", "Re#", "Mi", "Fa", "Fa#", "Sol", "Sol#", "La", "La#", "Si"
+};
+
+// Temperamento igual con La4 = 440 Hz, redondeado al Hz más cercano
+constexpr uint16_t tuningNoteHz(int note) {
+  double hz = 440.0;
+  int octaves = (note - NOTE_A4) / (int)SEMITONES;
+  int semitones = (note - NOTE_A4) % (int)SEMITONES;
+  for (int i = 0; i < octaves; i++) hz *= 2.0;
+  for (int i = 0; i > octaves; i--) hz /= 2.0;
+  for (int i = 0; i < semitones; i++) hz *= 1.0594630943592953;  // 2^(1/12)
+  for (int i = 0; i > semitones; i--) hz /= 1.0594630943592953;
+  return (uint16_t)(hz + 0.5);
+}
+
+struct NoteTable {
+  uint16_t hz[NOTE_COUNT];
+};
+
+constexpr NoteTable buildNoteTable() {
+  NoteTable table = {};
+  for (int n = 0; n < NOTE_COUNT; n++) table.hz[n] = tuningNoteHz(n);
+  return table;
+}
+
+constexpr NoteTable NOTE_TABLE = buildNoteTable();
+
+static_assert(NOTE_TABLE.hz[NOTE_A4] == 440, "La4 debe ser 440 Hz");
+static_assert(NOTE_TABLE.hz[24] == 65, "Do2 como en la escala original");
+static_assert(NOTE_TABLE.hz[NOTE_MAX_PLAYABLE] < 8000, "Si8 debe caber bajo 8000 Hz");
+
+inline uint16_t noteFrequency(NoteIndex note) {
+  return note < NOTE_COUNT ? NOTE_TABLE.hz[note] : 0;
+}
+
+inline uint8_t noteOctave(NoteIndex note) {
+  return note / SEMITONES;
+}
+
+inline const char* noteName(NoteIndex note) {
+  return NOTE_NAMES[note % SEMITONES];
+}
+
+// Nota desplazada semitones; lo que se sale del rango tocable vuelve por octavas
+inline NoteIndex noteTranspose(NoteIndex note, int semitones) {
+  int shifted = (int)note + semitones;
+  while (shifted > NOTE_MAX_PLAYABLE) shifted -= SEMITONES;
+  while (shifted < 0) shifted += SEMITONES;
+  return (NoteIndex)shifted;
+}
+
+// ===============================================
+// ESCALAS Y MODOS
+// ===============================================
+
+enum ScaleId {
+  SCALE_INSECT_PENTATONIC,   // Do Re Mi Fa# La: la escala original de PiezoBugs
+  SCALE_MAJOR_PENTATONIC,
+  SCALE_MINOR_PENTATONIC,
+  SCALE_IONIAN,
+  SCALE_DORIAN,
+  SCALE_PHRYGIAN,
+  SCALE_LYDIAN,
+  SCALE_MIXOLYDIAN,
+  SCALE_AEOLIAN,
+  SCALE_LOCRIAN,
+  SCALE_HARMONIC_MINOR,
+  SCALE_BLUES,
+  SCALE_CHROMATIC,
+  SCALE_COUNT
+};
+
+struct ScaleDefinition {
+  const char* name;
+  uint8_t size;                    // Grados por octava
+  uint8_t degrees[SEMITONES];      // Semitonos desde la raíz
+};
+
+constexpr ScaleDefinition SCALES[SCALE_COUNT] = {
+  {"Pentatónica insectos", 5, {0, 2, 4, 6, 9}},
+  {"Pentatónica mayor",    5, {0, 2, 4, 7, 9}},
+  {"Pentatónica menor",    5, {0, 3, 5, 7, 10}},
+  {"Jónico",               7, {0, 2, 4, 5, 7, 9, 11}},
+  {"Dórico",               7, {0, 2, 3, 5, 7, 9, 10}},
+  {"Frigio",               7, {0, 1, 3, 5, 7, 8, 10}},
+  {"Lidio",                7, {0, 2, 4, 6, 7, 9, 11}},
+  {"Mixolidio",            7, {0, 2, 4, 5, 7, 9, 10}},
+  {"Eólico",               7, {0, 2, 3, 5, 7, 8, 10}},
+  {"Locrio",               7, {0, 1, 3, 5, 6, 8, 10}},
+  {"Menor armónica",       7, {0, 2, 3, 5, 7, 8, 11}},
+  {"Blues",                6, {0, 3, 5, 6, 7, 10}},
+  {"Cromática",           12, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11}}
+};
+
+// Las escalas cubren las octavas 2 a 8, como la pentatonicScale original
+const uint8_t SCALE_FIRST_OCTAVE = 2;
+const uint8_t SCALE_OCTAVES = 7;
+const uint8_t SCALE_MAX_POSITIONS = SCALE_OCTAVES * SEMITONES;
+
+struct ScaleTable {
+  NoteIndex note[SCALE_COUNT][SEMITONES][SCALE_MAX_POSITIONS];  // [escala][raíz][posición]
+};
+
+// Cada posición es grado + octava * tamaño. Las notas que la transposición
+// lleva por encima de Si8 bajan una octava para seguir en la escala
+constexpr ScaleTable buildScaleTable() {
+  ScaleTable table = {};
+  for (int s = 0; s < SCALE_COUNT; s++) {
+    const ScaleDefinition &scale = SCALES[s];
+    for (int root = 0; root < SEMITONES; root++) {
+      for (int p = 0; p < scale.size * SCALE_OCTAVES; p++) {
+        int note = (SCALE_FIRST_OCTAVE + p / scale.size) * SEMITONES + scale.degrees[p % scale.size] + root;
+        while (note > NOTE_MAX_PLAYABLE) note -= SEMITONES;
+        table.note[s][root][p] = (NoteIndex)note;
+      }
+    }
+  }
+  return table;
+}
+
+constexpr ScaleTable SCALE_TABLE = buildScaleTable();
+
+static_assert(SCALE_TABLE.note[SCALE_INSECT_PENTATONIC][0][0] == 24, "La escala empieza en Do2");
+static_assert(SCALE_TABLE.note[SCALE_INSECT_PENTATONIC][0][34] == 105, "y termina en La8");
+
+// Posiciones disponibles de una escala (grados x octavas)
+inline uint8_t scalePositions(ScaleId scale) {
+  return SCALES[scale].size * SCALE_OCTAVES;
+}
+
+inline uint8_t scaleSize(ScaleId scale) {
+  return SCALES[scale].size;
+}
+
+// Nota en una posición de la escala transportada a la raíz (0 = Do)
+inline NoteIndex scaleNote(ScaleId scale, uint8_t root, uint8_t position) {
+  if (position >= scalePositions(scale)) position = scalePositions(scale) - 1;
+  return SCALE_TABLE.note[scale][root % SEMITONES][position];
+}
+
+#endif // PIEZOBUGS_TUNING_H
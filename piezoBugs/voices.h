@@ -0,0 +1,483 @@
+/*
+ * voices.h - Tabla de voces de insectos para PiezoBugs
+ *
+ * Sustituye a las variables duplicadas insect1* / insect2*. Cada voz es
+ * un índice en arrays paralelos (estructura de arrays) con las notas
+ * guardadas como índices de tuning.h, y todas se actualizan con
+ * voicesUpdate().
+ *
+ * Las voces no silenciadas están en un montículo mínimo ordenado por su
+ * próximo vencimiento (nota o cambio de secuencia), así cada iteración
+ * solo toca las voces que vencen: O(1) si no vence ninguna y O(k log N)
+ * para k voces vencidas. Varias voces pueden compartir un piezo.
+ */
+
+#ifndef PIEZOBUGS_VOICES_H
+#define PIEZOBUGS_VOICES_H
+
+#include <string.h>
+#include "hal.h"
+#include "config.h"
+#include "insects.h"
+#include "sequences.h"
+#include "synth.h"
+#include "boot.h"
+#include "profile.h"
+
+// ===============================================
+// ESTRUCTURAS Y TIPOS
+// ===============================================
+
+const uint8_t MAX_VOICES = 16;          // Cabe en las máscaras de 16 bits
+const uint8_t VOICE_NOT_IN_HEAP = 0xFF;
+
+static_assert(MAX_VOICES <= SEQUENCE_POOL_VOICES, "Una reserva de secuencias por voz");
+
+struct VoiceTable {
+  uint8_t count;
+
+  // Estado por voz (un array por campo)
+  uint8_t type[MAX_VOICES];              // InsectType
+  uint8_t pin[MAX_VOICES];               // Piezo de salida
+  uint8_t sequenceLength[MAX_VOICES];
+  uint8_t sequenceIndex[MAX_VOICES];
+  uint32_t noteDeadline[MAX_VOICES];     // Próxima nota o inicio de secuencia (ms)
+  uint32_t sequenceDeadline[MAX_VOICES]; // Próximo cambio de secuencia (ms)
+  uint32_t deadline[MAX_VOICES];         // El más cercano de los dos anteriores
+  NoteIndex notes[MAX_VOICES][MAX_SEQUENCE_LENGTH]; // Índices de nota (tuning.h)
+
+  // Bit v = voz v
+  uint16_t activeMask;                   // Reproduciendo una secuencia
+  uint16_t mutedMask;
+  uint16_t typeMask[INSECT_TYPE_COUNT];
+
+  // Montículo mínimo de voces no silenciadas por vencimiento
+  uint8_t heap[MAX_VOICES];
+  uint8_t heapPos[MAX_VOICES];
+  uint8_t heapSize;
+
+  // Estadística: voces procesadas desde el último voicesClear()
+  uint32_t processed;
+};
+
+VoiceTable voices;
+
+// ===============================================
+// MONTÍCULO DE VENCIMIENTOS
+// ===============================================
+
+inline void voiceHeapSwap(uint8_t i, uint8_t j) {
+  uint8_t a = voices.heap[i];
+  uint8_t b = voices.heap[j];
+  voices.heap[i] = b;
+  voices.heap[j] = a;
+  voices.heapPos[b] = i;
+  voices.heapPos[a] = j;
+}
+
+void voiceHeapSiftUp(uint8_t i) {
+  while (i > 0) {
+    uint8_t parent = (i - 1) / 2;
+    if (!deadlineBefore(voices.deadline[voices.heap[i]], voices.deadline[voices.heap[parent]])) break;
+    voiceHeapSwap(i, parent);
+    i = parent;
+  }
+}
+
+void voiceHeapSiftDown(uint8_t i) {
+  while (true) {
+    uint8_t left = 2 * i + 1;
+    if (left >= voices.heapSize) break;
+    uint8_t smallest = left;
+    uint8_t right = left + 1;
+    if (right < voices.heapSize &&
+        deadlineBefore(voices.deadline[voices.heap[right]], voices.deadline[voices.heap[left]])) {
+      smallest = right;
+    }
+    if (!deadlineBefore(voices.deadline[voices.heap[smallest]], voices.deadline[voices.heap[i]])) break;
+    voiceHeapSwap(i, smallest);
+    i = smallest;
+  }
+}
+
+void voiceHeapInsert(uint8_t v) {
+  if (voices.heapPos[v] != VOICE_NOT_IN_HEAP) return;
+  uint8_t i = voices.heapSize++;
+  voices.heap[i] = v;
+  voices.heapPos[v] = i;
+  voiceHeapSiftUp(i);
+}
+
+void voiceHeapRemove(uint8_t v) {
+  uint8_t i = voices.heapPos[v];
+  if (i == VOICE_NOT_IN_HEAP) return;
+  uint8_t last = --voices.heapSize;
+  if (i != last) {
+    voiceHeapSwap(i, last);
+    voiceHeapSiftDown(i);
+    voiceHeapSiftUp(i);
+  }
+  voices.heapPos[v] = VOICE_NOT_IN_HEAP;
+}
+
+// Recalcula el vencimiento de la voz y la recoloca en el montículo
+void voiceRefreshDeadline(uint8_t v) {
+  uint32_t noteAt = voices.noteDeadline[v];
+  uint32_t sequenceAt = voices.sequenceDeadline[v];
+  voices.deadline[v] = deadlineBefore(sequenceAt, noteAt) ? sequenceAt : noteAt;
+  uint8_t i = voices.heapPos[v];
+  if (i != VOICE_NOT_IN_HEAP) {
+    voiceHeapSiftUp(i);
+    voiceHeapSiftDown(voices.heapPos[v]);
+  }
+}
+
+// ===============================================
+// GESTIÓN DE VOCES
+// ===============================================
+
+inline InsectType voiceType(uint8_t v) { return (InsectType)voices.type[v]; }
+inline bool voiceIsActive(uint8_t v) { return voices.activeMask & (1u << v); }
+inline bool voiceIsMuted(uint8_t v) { return voices.mutedMask & (1u << v); }
+
+// true si alguna voz no silenciada de este tipo está reproduciendo
+inline bool voicesTypePlaying(InsectType type) {
+  return (voices.activeMask & ~voices.mutedMask & voices.typeMask[type]) != 0;
+}
+
+// Tipo por defecto de cada voz: araña, grillo y después rotando
+inline InsectType defaultVoiceType(uint8_t v) {
+  if (v == 0) return SPIDER;
+  if (v == 1) return CRICKET;
+  return (InsectType)(v % INSECT_TYPE_COUNT);
+}
+
+// Salida de una voz: su piezo con tone() o el sintetizador I2S
+void voiceOutputNote(uint8_t v, uint16_t frequency, uint16_t duration) {
+  bootMark(BOOT_FIRST_SOUND);
+#if USE_I2S_SYNTH
+  synthNoteOn(v, voiceType(v), frequency, duration);
+#else
+  hal::tone(voices.pin[v], frequency, duration);
+#endif
+}
+
+void voiceOutputSilence(uint8_t v) {
+#if USE_I2S_SYNTH
+  synthNoteOff(v);
+#else
+  hal::noTone(voices.pin[v]);
+#endif
+}
+
+void voicesClear() {
+  memset(&voices, 0, sizeof(voices));
+  memset(voices.heapPos, VOICE_NOT_IN_HEAP, sizeof(voices.heapPos));
+}
+
+// Siguiente secuencia de la reserva de la voz (sequences.h). Si la voz está
+// sonando, la nueva sigue desde la misma posición; si es más corta, desde
+// su última nota
+void voiceGenerateSequence(uint8_t v) {
+  sequencePoolTake(v, voiceType(v), voices.notes[v], voices.sequenceLength[v]);
+  if (voices.sequenceIndex[v] >= voices.sequenceLength[v]) {
+    voices.sequenceIndex[v] = voices.sequenceLength[v] > 0 ? voices.sequenceLength[v] - 1 : 0;
+  }
+}
+
+void voiceSetActive(uint8_t v, bool active) {
+  if (active) {
+    voices.activeMask |= (1u << v);
+  } else {
+    voices.activeMask &= ~(1u << v);
+  }
+}
+
+// Nueva pausa larga hasta la próxima secuencia
+void voiceScheduleSequencePause(uint8_t v, uint32_t now) {
+  voices.noteDeadline[v] = now + getInsectSequenceInterval(voiceType(v));
+}
+
+void voiceScheduleSequenceChange(uint8_t v, uint32_t now) {
+  voices.sequenceDeadline[v] = now + getSequenceChangeInterval();
+}
+
+// Empieza ya una secuencia: la primera nota sale en el próximo voicesUpdate()
+void voiceStartSequence(uint8_t v, uint32_t now) {
+  voiceSetActive(v, true);
+  voices.sequenceIndex[v] = 0;
+  voices.noteDeadline[v] = now;
+  voiceRefreshDeadline(v);
+}
+
+// Añade una voz; devuelve su índice o -1 si la tabla está llena
+int voiceAdd(InsectType type, uint8_t pin) {
+  if (voices.count >= MAX_VOICES) return -1;
+  uint8_t v = voices.count++;
+  uint32_t now = hal::millis();
+
+  voices.type[v] = type;
+  voices.pin[v] = pin;
+  voices.sequenceIndex[v] = 0;
+  voices.typeMask[type] |= (1u << v);
+  voiceSetActive(v, false);
+  voiceGenerateSequence(v);
+  voiceScheduleSequencePause(v, now);
+  voiceScheduleSequenceChange(v, now);
+  voiceRefreshDeadline(v);
+  voiceHeapInsert(v);
+  return v;
+}
+
+void voiceSetType(uint8_t v, InsectType type) {
+  for (uint8_t t = 0; t < INSECT_TYPE_COUNT; t++) {
+    voices.typeMask[t] &= ~(1u << v);
+  }
+  voices.type[v] = type;
+  voices.typeMask[type] |= (1u << v);
+
+  // Resetear índices para evitar corrupción
+  voices.sequenceIndex[v] = 0;
+  voiceSetActive(v, false);
+
+  voiceGenerateSequence(v);
+  voiceScheduleSequencePause(v, hal::millis());
+  voiceRefreshDeadline(v);
+}
+
+// Funciones para cambiar tipos de insectos
+void voiceNextType(uint8_t v) {
+  // Validar tipo actual antes de cambiar
+  if (voices.type[v] >= INSECT_TYPE_COUNT) {
+    LOG(LOG_TYPE_RESET, v + 1, voices.type[v]);
+    voices.type[v] = (v == 1) ? CRICKET : SPIDER;
+  }
+
+  voiceSetType(v, (InsectType)((voices.type[v] + 1) % INSECT_TYPE_COUNT));
+
+  LOG(LOG_TYPE_CHANGED, v + 1, voiceType(v));
+}
+
+void voiceToggleMute(uint8_t v) {
+  voices.mutedMask ^= (1u << v);
+  if (voiceIsMuted(v)) {
+    LOG(LOG_MUTED, v + 1);
+    voiceHeapRemove(v);
+    voiceOutputSilence(v);
+  } else {
+    LOG(LOG_UNMUTED, v + 1);
+    // Vuelve a cantar ya: los vencimientos de antes del mute pueden ser de
+    // hace horas (o, tras 24,8 días, parecer futuros por el desborde)
+    uint32_t now = hal::millis();
+    voices.noteDeadline[v] = now;
+    if (deadlineReached(voices.sequenceDeadline[v], now)) voices.sequenceDeadline[v] = now;
+    voiceRefreshDeadline(v);
+    voiceHeapInsert(v);
+  }
+}
+
+// ===============================================
+// REPRODUCCIÓN
+// ===============================================
+
+// Funciones para reproducir sonidos
+void voicePlaySound(uint8_t v) {
+  uint8_t index = voices.sequenceIndex[v];
+
+  // Validar índice antes de acceder al array
+  if (index >= MAX_SEQUENCE_LENGTH || index >= voices.sequenceLength[v]) {
+    LOG(LOG_BAD_SEQUENCE_INDEX, v + 1, index, voices.sequenceLength[v]);
+    voiceOutputSilence(v);
+    return;
+  }
+
+  // La transposición del bus se aplica al tocar: las secuencias no se regeneran
+  NoteIndex note = noteTranspose(voices.notes[v][index], paramSemitones());
+  int freq = noteFrequency(note);
+  int duration = getInsectDuration(voiceType(v));
+
+  // Validar frecuencia antes de reproducir
+  if (freq < 20 || freq > 8000) {
+    LOG(LOG_BAD_FREQUENCY, v + 1, freq);
+    freq = 440;
+  }
+
+  voiceOutputNote(v, freq, duration);
+
+  // Debug: tipo de insecto, nota raíz y octava (se formatea al vaciar el log)
+  if (index == 0) {
+    LOG(LOG_SEQUENCE_START, v + 1, voiceType(v), rootNoteOffset, note, freq);
+  }
+}
+
+// Termina la secuencia en curso y programa la siguiente pausa
+void voiceEndSequence(uint8_t v, uint32_t now) {
+  voiceSetActive(v, false);
+  voices.sequenceIndex[v] = 0; // Reset para próxima secuencia
+  voiceOutputSilence(v);
+  voiceScheduleSequencePause(v, now);
+}
+
+// Validar el estado de una voz para prevenir corrupción (antes
+// validateSystemState, ahora solo para las voces que vencen)
+void voiceValidate(uint8_t v) {
+  PROFILE_SCOPE(PROF_VALIDATE);
+  
+  // Validar tipos de insectos
+  if (voices.type[v] >= INSECT_TYPE_COUNT) {
+    LOG(LOG_CORRUPT_TYPE, v + 1, voices.type[v]);
+    voiceSetType(v, defaultVoiceType(v));
+  }
+
+  // Validar longitudes de secuencias
+  uint8_t maxLength = getMaxSequenceLength(voiceType(v));
+  if (voices.sequenceLength[v] > maxLength) {
+    LOG(LOG_CORRUPT_LENGTH, v + 1, voices.sequenceLength[v]);
+    voices.sequenceIndex[v] = 0;
+    voiceSetActive(v, false);
+    voiceGenerateSequence(v);
+  }
+
+  // Validar índices de secuencias
+  if (voices.sequenceIndex[v] > voices.sequenceLength[v]) {
+    LOG(LOG_CORRUPT_INDEX, v + 1, voices.sequenceIndex[v]);
+    voices.sequenceIndex[v] = 0;
+    voiceSetActive(v, false);
+  }
+}
+
+// Paso de nota de una voz vencida (antes handleInsect1/handleInsect2)
+void voiceStep(uint8_t v, uint32_t now) {
+  InsectType type = voiceType(v);
+
+  if (!voiceIsActive(v)) {
+    // Iniciar secuencia
+    voiceSetActive(v, true);
+    voices.sequenceIndex[v] = 0;
+    voices.noteDeadline[v] = now + getInsectNoteInterval(type);
+    return;
+  }
+
+  uint8_t index = voices.sequenceIndex[v];
+  uint8_t length = voices.sequenceLength[v];
+  if (index < length && length > 0) {
+    voicePlaySound(v);
+
+    // Verificar límites ANTES de incrementar
+    if (index < length - 1) {
+      voices.sequenceIndex[v] = index + 1;
+      voices.noteDeadline[v] = now + getInsectNoteInterval(type);
+    } else {
+      // Último sonido reproducido, terminar secuencia
+      voiceEndSequence(v, now);
+    }
+  } else {
+    // Terminar secuencia (condición de seguridad)
+    voiceEndSequence(v, now);
+  }
+}
+
+// Único punto de actualización de todas las voces
+void voicesUpdate(uint32_t now) {
+  PROFILE_SCOPE(PROF_VOICES);
+  while (voices.heapSize > 0) {
+    uint8_t v = voices.heap[0];
+    if (!deadlineReached(voices.deadline[v], now)) break;
+
+    voiceValidate(v);
+    if (deadlineReached(voices.noteDeadline[v], now)) {
+      voiceStep(v, now);
+    }
+    if (deadlineReached(voices.sequenceDeadline[v], now)) {
+      voiceGenerateSequence(v);
+      voiceScheduleSequenceChange(v, now);
+    }
+    voiceRefreshDeadline(v);
+    voices.processed++;
+  }
+}
+
+// Prepara secuencias para las próximas, cuando el loop va a esperar
+uint8_t voicesRefillSequences(uint8_t maxSequences) {
+  return sequencePoolsRefill(voices.type, voices.count, maxSequences);
+}
+
+// Próximo vencimiento de cualquier voz; si no hay ninguna planificada
+// (todas muteadas) devuelve now + maxWait
+uint32_t voicesNextDeadline(uint32_t now, uint32_t maxWait) {
+  if (voices.heapSize == 0) return now + maxWait;
+  return voices.deadline[voices.heap[0]];
+}
+
+// ===============================================
+// CAMBIOS GLOBALES
+// ===============================================
+
+// Crea VOICE_COUNT voces repartidas entre los piezos
+void voicesInitDefaults() {
+  voicesClear();
+  for (uint8_t v = 0; v < VOICE_COUNT && v < MAX_VOICES; v++) {
+    voiceAdd(defaultVoiceType(v), PIEZO_PINS[v % PIEZO_PIN_COUNT]);
+  }
+}
+
+void voicesRegenerateSequences() {
+  for (uint8_t v = 0; v < voices.count; v++) {
+    voiceGenerateSequence(v);
+  }
+}
+
+// Regenerar intervalos con el multiplicador actual
+void voicesRescheduleAll() {
+  uint32_t now = hal::millis();
+  for (uint8_t v = 0; v < voices.count; v++) {
+    voiceScheduleSequencePause(v, now);
+    voiceScheduleSequenceChange(v, now);
+    voiceRefreshDeadline(v);
+  }
+}
+
+void changeFrequency() {
+  // Cambiar entre los cuatro estados de frecuencia
+  switch (currentState) {
+    case FREQ_NORMAL:
+      currentState = FREQ_SLOW;
+      LOG(LOG_FREQ_SLOW);
+      break;
+    case FREQ_SLOW:
+      currentState = FREQ_VERY_SLOW;
+      LOG(LOG_FREQ_VERY_SLOW);
+      break;
+    case FREQ_VERY_SLOW:
+      currentState = FREQ_EXTREMELY_SLOW;
+      LOG(LOG_FREQ_EXTREMELY_SLOW);
+      break;
+    case FREQ_EXTREMELY_SLOW:
+    default:
+      currentState = FREQ_NORMAL;
+      LOG(LOG_FREQ_NORMAL);
+      break;
+  }
+
+  voicesRescheduleAll();
+}
+
+void changeRootNote() {
+  rootNoteOffset = (rootNoteOffset + 1) % 12; // Ciclar de 0 a 11
+  LOG(LOG_ROOT_CHANGED, rootNoteOffset);
+
+  // Regenerar secuencias con la nueva nota raíz
+  voicesRegenerateSequences();
+}
+
+// Pulsación larga del botón 1: tipos, nota raíz, velocidad y mute por defecto
+void voicesResetDefaults() {
+  rootNoteOffset = 0;
+  currentState = FREQ_NORMAL;
+  for (uint8_t v = 0; v < voices.count; v++) {
+    voiceOutputSilence(v);
+  }
+  voicesInitDefaults();
+}
+
+#endif // PIEZOBUGS_VOICES_H
@@ -1,8 +1,9 @@
 #include <Arduino.h>
 #include <WiFi.h>
-#include <HTTPClient.h>
-#include <ArduinoJson.h>
 #include <Adafruit_NeoPixel.h>
+#include "boot.h"       // piezoBugs/: cronología del arranque
+#include "net_task.h"   // piezoBugs/: WiFi y consultas a InfluxDB en el núcleo 0
+#include "param_bus.h"  // piezoBugs/: datos del árbol suavizados (PARAM_ACTIVITY)
 
 // Configuración de pines para ESP32 Audio Kit
 #define PIEZO_PIN_1 25    // GPIO25 para primer piezoeléctrico
@@ -14,13 +15,21 @@
 const char* ssid = "TU_WIFI_SSID";
 const char* password = "TU_WIFI_PASSWORD";
 
-// Configuración InfluxDB
-const char* influxdb_url = "http://tu-influxdb-server:8086";
-const char* database = "arbol_data";
+// Configuración InfluxDB (HTTPS; el certificado se verifica contra la CA)
+const char* influxHost = "tu-influxdb-server";
+const uint16_t influxPort = 443;
+const char* influxOrg = "TU_ORGANIZACION";
+const char* influxToken = "TU_TOKEN_INFLUXDB";
+const char* influxBucket = "arbol_data";
+const char* influxRootCa = nullptr;   // PEM de la CA raíz del servidor
 
 // Objeto para controlar LEDs
 Adafruit_NeoPixel pixels(LED_COUNT, LED_PIN, NEO_GRB + NEO_KHZ800);
 
+// Última instantánea de la tarea de red
+TreeData treeData;
+unsigned long treeDataTimestamp = 0;
+
 // Variables para control de piezoeléctricos
 unsigned long lastPiezoUpdate = 0;
 int piezo1Freq = 1000;
@@ -28,32 +37,70 @@ int piezo2Freq = 2000;
 bool piezo1Active = false;
 bool piezo2Active = false;
 
+// Etapas de fondo del arranque (boot.h); terminan desde el loop
+int8_t wifiStage = -1;
+int8_t selfTestStage = -1;
+
+void connectToWiFi();
+void selfTestBegin(uint32_t now);
+bool selfTestUpdate(uint32_t now);
+void updateTreeData();
+void updatePiezoElectrics();
+void updateLEDs();
+
 void setup() {
+  bootBegin();
+  int8_t stage = bootStageBegin("serie");
   Serial.begin(115200);
   Serial.println("Centinelas del Bosque - Iniciando...");
+  bootStageEnd(stage);
   
   // Configurar pines de piezoeléctricos
+  stage = bootStageBegin("pines");
   pinMode(PIEZO_PIN_1, OUTPUT);
   pinMode(PIEZO_PIN_2, OUTPUT);
+  bootStageEnd(stage);
+  
+  // Actividad neutra hasta que lleguen datos
+  paramBusBegin();
   
   // Inicializar LEDs
+  stage = bootStageBegin("leds");
   pixels.begin();
   pixels.setBrightness(50);
   pixels.show();
+  bootStageEnd(stage);
   
-  // Conectar a WiFi
+  // Conectar a WiFi en segundo plano
+  wifiStage = bootStageBegin("wifi", true);
   connectToWiFi();
   
-  // Test inicial de componentes
-  testPiezoElectrics();
-  testLEDs();
+  // Las autopruebas avanzan desde el loop: son la primera luz y el primer sonido
+  selfTestStage = bootStageBegin("autoprueba", true);
+  selfTestBegin(millis());
   
   Serial.println("Sistema iniciado correctamente");
 }
 
 void loop() {
-  // Simular datos de árbol (por ahora)
-  simulateTreeData();
+  if (wifiStage >= 0 && WiFi.status() == WL_CONNECTED) {
+    bootStageEnd(wifiStage);
+    wifiStage = -1;
+  }
+  bootReportWhenSettled();
+
+  // Mientras duran las autopruebas el resto no toca piezos ni LEDs
+  if (selfTestStage >= 0) {
+    if (!selfTestUpdate(millis())) {
+      bootStageEnd(selfTestStage);
+      selfTestStage = -1;
+    }
+    delay(10);
+    return;
+  }
+
+  // Datos del árbol: los de InfluxDB si hay, si no simulados
+  updateTreeData();
   
   // Actualizar piezoeléctricos cada 100ms
   if (millis() - lastPiezoUpdate > 100) {
@@ -67,79 +114,129 @@ void loop() {
   delay(50);
 }
 
+// WiFi, reconexiones y consultas en la tarea de red (net_task.h), en el
+// núcleo 0: el loop (núcleo 1) nunca espera a la red
 void connectToWiFi() {
-  WiFi.begin(ssid, password);
-  Serial.print("Conectando a WiFi");
-  
-  while (WiFi.status() != WL_CONNECTED) {
-    delay(500);
-    Serial.print(".");
+  if (!influxClientBegin(netTask.client, influxHost, influxPort, influxOrg, influxToken, influxRootCa,
+                         nullptr, 0)) {
+    Serial.println("Error: No se pudo preparar el cliente de InfluxDB");
   }
-  
-  Serial.println();
-  Serial.println("WiFi conectado!");
-  Serial.print("IP address: ");
-  Serial.println(WiFi.localIP());
+  netTaskBegin(influxBucket);
+  WiFi.begin(ssid, password);
+  Serial.println("Conectando a WiFi en segundo plano...");
+  netTaskStart();
 }
 
-void testPiezoElectrics() {
-  Serial.println("Probando piezoeléctricos...");
-  
-  // Test piezoeléctrico 1 - sonido grave
-  Serial.println("Piezo 1 - Sonido grave (500Hz)");
-  tone(PIEZO_PIN_1, 500, 1000);
-  delay(1200);
-  
-  // Test piezoeléctrico 2 - sonido agudo
-  Serial.println("Piezo 2 - Sonido agudo (3000Hz)");
-  tone(PIEZO_PIN_2, 3000, 1000);
-  delay(1200);
-  
-  // Test simultáneo
-  Serial.println("Test simultáneo - Ambos piezoeléctricos");
-  tone(PIEZO_PIN_1, 800, 2000);
-  tone(PIEZO_PIN_2, 2500, 2000);
-  delay(2200);
-  
-  noTone(PIEZO_PIN_1);
-  noTone(PIEZO_PIN_2);
-  
-  Serial.println("Test de piezoeléctricos completado");
+// ===============================================
+// AUTOPRUEBAS SIN BLOQUEO
+// ===============================================
+// Las mismas pruebas de siempre, pero como pasos con su instante (ms desde
+// el inicio) que el loop va lanzando; piezos y LEDs se prueban a la vez
+
+struct PiezoTestStep {
+  uint16_t atMs;
+  uint8_t pin;
+  uint16_t frequency;
+  uint16_t durationMs;
+  const char* label;
+};
+
+const PiezoTestStep PIEZO_TEST[] = {
+  {0,    PIEZO_PIN_1, 500,  1000, "Piezo 1 - Sonido grave (500Hz)"},
+  {1200, PIEZO_PIN_2, 3000, 1000, "Piezo 2 - Sonido agudo (3000Hz)"},
+  {2400, PIEZO_PIN_1, 800,  2000, "Test simultáneo - Ambos piezoeléctricos"},
+  {2400, PIEZO_PIN_2, 2500, 2000, nullptr},
+};
+const uint8_t PIEZO_TEST_STEPS = sizeof(PIEZO_TEST) / sizeof(PIEZO_TEST[0]);
+const uint16_t PIEZO_TEST_END_MS = 4600;
+
+const uint16_t LED_TEST_STEP_MS = 200;                                  // Un LED rojo más
+const uint16_t LED_TEST_GREEN_MS = LED_COUNT * LED_TEST_STEP_MS;        // Todos en verde
+const uint16_t LED_TEST_END_MS = LED_TEST_GREEN_MS + 1000;              // Apagar
+
+struct SelfTest {
+  uint32_t startMs;
+  uint8_t piezoStep;
+  uint8_t ledStep;        // 0..LED_COUNT-1 rojos, LED_COUNT verde, LED_COUNT+1 apagado
+  bool piezoDone;
+  bool ledDone;
+};
+
+SelfTest selfTest;
+
+void selfTestBegin(uint32_t now) {
+  selfTest = SelfTest();
+  selfTest.startMs = now;
+  Serial.println("Probando piezoeléctricos y LEDs...");
 }
 
-void testLEDs() {
-  Serial.println("Probando LEDs...");
-  
-  // Test secuencial
-  for (int i = 0; i < LED_COUNT; i++) {
-    pixels.setPixelColor(i, pixels.Color(255, 0, 0)); // Rojo
-    pixels.show();
-    delay(200);
+// Lanza los pasos que ya tocan; devuelve false cuando ha terminado todo
+bool selfTestUpdate(uint32_t now) {
+  uint32_t elapsed = now - selfTest.startMs;
+
+  while (selfTest.piezoStep < PIEZO_TEST_STEPS && elapsed >= PIEZO_TEST[selfTest.piezoStep].atMs) {
+    const PiezoTestStep &step = PIEZO_TEST[selfTest.piezoStep++];
+    if (step.label) Serial.println(step.label);
+    tone(step.pin, step.frequency, step.durationMs);
+    bootMark(BOOT_FIRST_SOUND);
   }
-  
-  // Test todos juntos
-  for (int i = 0; i < LED_COUNT; i++) {
-    pixels.setPixelColor(i, pixels.Color(0, 255, 0)); // Verde
+  if (!selfTest.piezoDone && elapsed >= PIEZO_TEST_END_MS) {
+    noTone(PIEZO_PIN_1);
+    noTone(PIEZO_PIN_2);
+    selfTest.piezoDone = true;
+    Serial.println("Test de piezoeléctricos completado");
   }
-  pixels.show();
-  delay(1000);
-  
-  // Apagar todos
-  pixels.clear();
-  pixels.show();
-  
-  Serial.println("Test de LEDs completado");
+
+  bool changed = false;
+  while (selfTest.ledStep < LED_COUNT && elapsed >= selfTest.ledStep * LED_TEST_STEP_MS) {
+    pixels.setPixelColor(selfTest.ledStep++, pixels.Color(255, 0, 0)); // Rojo
+    changed = true;
+  }
+  if (selfTest.ledStep == LED_COUNT && elapsed >= LED_TEST_GREEN_MS) {
+    for (int i = 0; i < LED_COUNT; i++) {
+      pixels.setPixelColor(i, pixels.Color(0, 255, 0)); // Verde
+    }
+    selfTest.ledStep++;
+    changed = true;
+  }
+  if (!selfTest.ledDone && elapsed >= LED_TEST_END_MS) {
+    pixels.clear();
+    selfTest.ledDone = true;
+    changed = true;
+    Serial.println("Test de LEDs completado");
+  }
+  if (changed) {
+    pixels.show();
+    bootMark(BOOT_FIRST_LIGHT);
+  }
+
+  return !(selfTest.piezoDone && selfTest.ledDone);
 }
 
-void simulateTreeData() {
-  // Simular datos de actividad del árbol
-  static float treeActivity = 0.5;
+// La actividad pasa por el bus de parámetros (param_bus.h): cada dato nuevo
+// solo mueve el objetivo y el valor lo sigue con su suavizado, así las
+// frecuencias se deslizan en vez de saltar con cada consulta
+void updateTreeData() {
+  static float simulated = 0.5;
   static float increment = 0.01;
   
-  treeActivity += increment;
-  if (treeActivity >= 1.0 || treeActivity <= 0.0) {
-    increment = -increment;
+  treeSlotRead(netTask.slot, treeData);
+  if (treeData.data_valid) {
+    // Actividad bioeléctrica real, por la curva de PARAM_ACTIVITY
+    if (treeData.timestamp != treeDataTimestamp) {
+      paramBusApplyTree(treeData);
+      treeDataTimestamp = treeData.timestamp;
+    }
+  } else {
+    // Sin datos todavía: simular la actividad del árbol
+    simulated += increment;
+    if (simulated >= 1.0 || simulated <= 0.0) {
+      increment = -increment;
+    }
+    paramSetTarget(PARAM_ACTIVITY, simulated);
   }
+  paramBusTick(millis());
+  float treeActivity = paramValue(PARAM_ACTIVITY);
   
   // Convertir actividad a frecuencias de piezoeléctricos
   piezo1Freq = 500 + (treeActivity * 1000);  // 500-1500 Hz
@@ -190,30 +287,3 @@ void updateLEDs() {
     lastLEDUpdate = millis();
   }
 }
-
-// Función para obtener datos reales de InfluxDB (implementar después)
-void fetchTreeData() {
-  if (WiFi.status() == WL_CONNECTED) {
-    HTTPClient http;
-    http.begin(influxdb_url);
-    http.addHeader("Content-Type", "application/json");
-    
-    // Query para obtener datos más recientes del árbol
-    String query = "SELECT * FROM arbol_vital_signs ORDER BY time DESC LIMIT 1";
-    
-    int httpResponseCode = http.GET();
-    
-    if (httpResponseCode > 0) {
-      String response = http.getString();
-      Serial.println("Datos recibidos: " + response);
-      
-      // Parsear JSON y actualizar variables
-      // TODO: Implementar parsing de datos reales
-    } else {
-      Serial.print("Error en HTTP: ");
-      Serial.println(httpResponseCode);
-    }
-    
-    http.end();
-  }
-}
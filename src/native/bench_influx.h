@@ -0,0 +1,171 @@
+/*
+ * bench_influx.h - Parser de respuestas de InfluxDB: String frente a streaming
+ *
+ * Reproduce respuestas grabadas de la consulta de forestData (last() de
+ * los cuatro campos y una hora de lecturas cada 10 s, con
+ * Transfer-Encoding: chunked) y las procesa:
+ * - Como el sketch anterior: leer byte a byte a un String (aquí
+ *   std::string, con el mismo corte a 5000 bytes) y trocearlo con
+ *   substring por cuerpo, línea y campo
+ * - Con influx_csv.h, en lecturas de 1, 64 y 1460 bytes
+ */
+
+#ifndef BENCH_INFLUX_H
+#define BENCH_INFLUX_H
+
+#include <chrono>
+#include <stdio.h>
+#include <string>
+
+#include "influx_csv.h"
+
+// ===============================================
+// RESPUESTAS GRABADAS
+// ===============================================
+
+static std::string influxChunked(const std::string &body, size_t chunkSize) {
+  char size[16];
+  std::string out;
+  for (size_t i = 0; i < body.size(); i += chunkSize) {
+    size_t n = body.size() - i < chunkSize ? body.size() - i : chunkSize;
+    snprintf(size, sizeof(size), "%zx\r\n", n);
+    out += size + body.substr(i, n) + "\r\n";
+  }
+  return out + "0\r\n\r\n";
+}
+
+// points lecturas por campo, cada 10 s, una tabla por campo
+static std::string influxRecordedResponse(int points) {
+  static const char *values[TREE_FIELD_COUNT] = {"61.8", "17.43", "0.00412", "1184"};
+  std::string body = ",result,table,_start,_stop,_time,_value,_field,_measurement,tree\r\n";
+  char line[200];
+  for (int f = 0; f < TREE_FIELD_COUNT; f++) {
+    for (int i = 0; i < points; i++) {
+      int seconds = 3600 - points * 10 + i * 10;
+      snprintf(line, sizeof(line),
+               ",_result,%d,2025-06-01T10:00:00Z,2025-06-01T11:00:00Z,2025-06-01T10:%02d:%02dZ,%s,%s,sensors,roble\r\n",
+               f, (seconds / 60) % 60, seconds % 60, values[f], TREE_FIELD_NAMES[f]);
+      body += line;
+    }
+  }
+  body += "\r\n";
+  return "HTTP/1.1 200 OK\r\n"
+         "Content-Type: text/csv; charset=utf-8\r\n"
+         "Date: Sun, 01 Jun 2025 11:00:00 GMT\r\n"
+         "Vary: Accept-Encoding\r\n"
+         "X-Influxdb-Build: OSS\r\n"
+         "X-Influxdb-Version: v2.7.1\r\n"
+         "Transfer-Encoding: chunked\r\n"
+         "\r\n" + influxChunked(body, 4096);
+}
+
+// ===============================================
+// PARSER ANTERIOR (referencia)
+// ===============================================
+
+static TreeData legacyTreeData;
+
+static void legacyParseDataLine(std::string line) {
+  size_t fieldStart = 0;
+  size_t fieldEnd = line.find(',');
+  int fieldIndex = 0;
+  std::string field = "";
+  std::string value = "";
+  while (fieldEnd != std::string::npos && fieldIndex < 8) {
+    std::string fieldValue = line.substr(fieldStart, fieldEnd - fieldStart);
+    if (fieldIndex == 6) field = fieldValue;
+    if (fieldIndex == 5) value = fieldValue;
+    fieldStart = fieldEnd + 1;
+    fieldEnd = line.find(',', fieldStart);
+    fieldIndex++;
+  }
+  for (int f = 0; f < TREE_FIELD_COUNT; f++) {
+    if (field == TREE_FIELD_NAMES[f] && value.length() > 0) {
+      treeDataSet(legacyTreeData, (TreeField)f, strtof(value.c_str(), nullptr));
+    }
+  }
+}
+
+static void legacyParse(const std::string &wire) {
+  // Lectura byte a byte con el límite de 5000 bytes del sketch
+  std::string response = "";
+  for (size_t i = 0; i < wire.size(); i++) {
+    response += wire[i];
+    if (response.length() > 5000) break;
+  }
+  size_t bodyStart = response.find("\r\n\r\n");
+  if (bodyStart == std::string::npos) return;
+  std::string body = response.substr(bodyStart + 4);
+
+  size_t lineStart = 0;
+  size_t lineEnd = body.find('\n');
+  if (lineEnd != std::string::npos) {
+    lineStart = lineEnd + 1;
+    lineEnd = body.find('\n', lineStart);
+  }
+  while (lineEnd != std::string::npos) {
+    std::string line = body.substr(lineStart, lineEnd - lineStart);
+    if (line.length() > 10) legacyParseDataLine(line);
+    lineStart = lineEnd + 1;
+    lineEnd = body.find('\n', lineStart);
+  }
+  legacyTreeData.data_valid = true;
+}
+
+// ===============================================
+// BENCHMARK
+// ===============================================
+
+static bool influxMatches(const TreeData &data) {
+  return data.data_valid && data.humidity > 61.7f && data.humidity < 61.9f &&
+         data.light_level > 1183.0f && data.light_level < 1185.0f;
+}
+
+void runInfluxBenchmark() {
+  struct Sample {
+    const char *name;
+    int points;
+  };
+  const Sample samples[] = {{"last()", 1}, {"10 min", 60}, {"1 h", 360}};
+  const size_t readSizes[] = {1, 64, 1460};
+
+  printf("=== Benchmark del parser de InfluxDB (estado del parser: %u bytes) ===\n",
+         (unsigned)sizeof(InfluxCsvParser));
+  printf("respuesta  bytes   parser          lectura  procesados  us/respuesta  MB/s    valores\n");
+
+  for (const Sample &sample : samples) {
+    std::string wire = influxRecordedResponse(sample.points);
+    int repeats = (int)(2000000 / wire.size()) + 1;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++) {
+      legacyTreeData = TreeData();
+      legacyParse(wire);
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repeats;
+    // El sketch anterior corta a 5000 bytes y toma _time como _value
+    size_t legacyBytes = wire.size() < 5001 ? wire.size() : 5001;
+    printf("%-9s  %6zu  %-14s  %7s  %10zu  %12.1f  %6.1f  %s\n", sample.name, wire.size(), "String", "1",
+           legacyBytes, us, legacyBytes / us, influxMatches(legacyTreeData) ? "ok" : "incorrectos");
+
+    for (size_t readSize : readSizes) {
+      TreeData data;
+      InfluxCsvParser parser;
+      start = std::chrono::steady_clock::now();
+      for (int r = 0; r < repeats; r++) {
+        influxParserBegin(parser);
+        const uint8_t *bytes = (const uint8_t *)wire.data();
+        for (size_t i = 0; i < wire.size() && !influxParserDone(parser); i += readSize) {
+          size_t n = wire.size() - i < readSize ? wire.size() - i : readSize;
+          influxParserFeed(parser, bytes + i, n);
+        }
+        influxParserFinish(parser, data, 0);
+      }
+      us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / repeats;
+      printf("%-9s  %6zu  %-14s  %7zu  %10u  %12.1f  %6.1f  %s\n", sample.name, wire.size(), "influx_csv.h",
+             readSize, (unsigned)parser.bytes, us, parser.bytes / us, influxMatches(data) ? "ok" : "incorrectos");
+    }
+  }
+}
+
+#endif // BENCH_INFLUX_H
@@ -0,0 +1,58 @@
+/*
+ * bench_log.h - Coste de un mensaje en la ruta caliente
+ *
+ * Compara registrar el inicio de secuencia en el anillo de log.h con
+ * formatear la misma línea (lo que hacían los Serial.print) y estima lo que
+ * tarda la UART a 115200 baudios en sacar el texto frente al registro.
+ */
+
+#ifndef BENCH_LOG_H
+#define BENCH_LOG_H
+
+#include <chrono>
+#include <stdio.h>
+
+#include "piezo_bugs.h"
+
+template <typename F>
+double benchLogNs(uint32_t iterations, F body) {
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < iterations; i++) body(i);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+void runLogBenchmark() {
+  const uint32_t iterations = 1000000;
+  hal::sim::reset(1);
+  logClear();
+
+  printf("=== Benchmark del registro diferido ===\n");
+  printf("operación                                  ns/mensaje\n");
+
+  double record = benchLogNs(iterations, [&](uint32_t i) {
+    LOG(LOG_SEQUENCE_START, 1 + (i & 1), SPIDER, 0, 60 + (i % 40), 1760);
+    if ((i & 31) == 31) logRing.tail.store(logRing.head.load());   // Vaciado instantáneo
+  });
+  printf("LOG() en el anillo                         %10.1f\n", record);
+
+  char line[128];
+  volatile uint16_t sink = 0;
+  double format = benchLogNs(iterations, [&](uint32_t i) {
+    NoteIndex note = 60 + (i % 40);
+    sink = sink + snprintf(line, sizeof(line), "Insecto%d %s %s - %s%u (%d Hz)", 1 + (int)(i & 1),
+                           getInsectTypeName(SPIDER), NOTE_NAMES[0], noteName(note), noteOctave(note), 1760);
+  });
+  printf("formatear la línea (antes, en el loop)     %10.1f\n", format);
+
+  LogRecord r = {};
+  r.id = LOG_SEQUENCE_START;
+  const int16_t args[LOG_MAX_ARGS] = {1, SPIDER, 0, 81, 1760};
+  memcpy(r.args, args, sizeof(args));
+  uint16_t textBytes = logFormat(r, line, sizeof(line)) + 2;
+  const double byteUs = 10.0 * 1e6 / 115200;
+  printf("UART: %u bytes de texto = %.0f us, registro de %u bytes = %.0f us\n", (unsigned)textBytes,
+         textBytes * byteUs, (unsigned)(sizeof(LogRecord) + 1), (sizeof(LogRecord) + 1) * byteUs);
+}
+
+#endif // BENCH_LOG_H
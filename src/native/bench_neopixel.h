@@ -0,0 +1,145 @@
+/*
+ * bench_neopixel.h - Coste del efecto ola verde: float frente a enteros
+ *
+ * Compara el render anterior (calculateFadeBrightness en float, show() en
+ * cada frame, llamado cada 10 ms desde el loop antiguo) con el actual en
+ * enteros con gamma, dithering y show() solo si el frame cambia. Cada
+ * caso renderiza 10 minutos simulados; se mide el coste por frame en el
+ * host y cuántos show() por minuto llegarían al aro.
+ *
+ * En el ESP32 cada show() deja las interrupciones bloqueadas unos
+ * 30 us por LED (24 bits a 800 kHz) más 50 us de reset. El reloj virtual
+ * avanza un periodo por frame: show() rechaza el frame si la transmisión
+ * anterior no ha terminado en ese reloj.
+ */
+
+#ifndef BENCH_NEOPIXEL_H
+#define BENCH_NEOPIXEL_H
+
+#include <chrono>
+#include <stdio.h>
+
+#include "piezo_bugs.h"
+
+// ===============================================
+// RENDER ANTERIOR (referencia)
+// ===============================================
+
+static hal::PixelStrip legacyPixels(NEOPIXEL_COUNT, NEOPIXEL_PIN);
+
+static float legacyFadeBrightness(unsigned long timeInState, unsigned long totalDuration) {
+  float brightness = 0.0;
+  if (timeInState <= FADE_IN_TIME) {
+    brightness = (float)timeInState / (float)FADE_IN_TIME;
+    if (brightness > 1.0) brightness = 1.0;
+    if (brightness < 0.0) brightness = 0.0;
+    return brightness;
+  }
+  if (timeInState >= (totalDuration - FADE_OUT_TIME)) {
+    unsigned long timeUntilEnd = totalDuration - timeInState;
+    brightness = (float)timeUntilEnd / (float)FADE_OUT_TIME;
+    if (brightness > 1.0) brightness = 1.0;
+    if (brightness < 0.0) brightness = 0.0;
+    return brightness;
+  }
+  return 1.0;
+}
+
+// Misma lógica que el updateNeopixel() anterior, sin el resaltado de la
+// araña (el benchmark corre sin voces)
+static void legacyUpdateNeopixel(unsigned long currentTime) {
+  unsigned long cycleTime = NEOPIXEL_COUNT * LED_INTERVAL;
+  for (int i = 0; i < NEOPIXEL_COUNT; i++) {
+    unsigned long currentCycle = currentTime / cycleTime;
+    unsigned long ledStartTimeInCycle = i * LED_INTERVAL;
+    unsigned long ledStartTimeAbsolute = (currentCycle * cycleTime) + ledStartTimeInCycle;
+    unsigned long ledStartTimePreviousCycle = 0;
+    bool checkPreviousCycle = false;
+    if (currentCycle > 0) {
+      ledStartTimePreviousCycle = ((currentCycle - 1) * cycleTime) + ledStartTimeInCycle;
+      checkPreviousCycle = true;
+    }
+
+    bool shouldBeOn = false;
+    unsigned long timeInState = 0;
+    if (currentTime >= ledStartTimeAbsolute &&
+        currentTime < (ledStartTimeAbsolute + LED_DURATION)) {
+      shouldBeOn = true;
+      timeInState = currentTime - ledStartTimeAbsolute;
+    } else if (checkPreviousCycle &&
+               currentTime >= ledStartTimePreviousCycle &&
+               currentTime < (ledStartTimePreviousCycle + LED_DURATION)) {
+      shouldBeOn = true;
+      timeInState = currentTime - ledStartTimePreviousCycle;
+    }
+
+    if (shouldBeOn) {
+      float fadeFactor = legacyFadeBrightness(timeInState, LED_DURATION);
+      uint8_t fadedR = (uint8_t)(NEO_COLOR_R * fadeFactor);
+      uint8_t fadedG = (uint8_t)(NEO_COLOR_G * fadeFactor);
+      uint8_t fadedB = (uint8_t)(NEO_COLOR_B * fadeFactor);
+      legacyPixels.setPixelColor(i, legacyPixels.Color(fadedR, fadedG, fadedB));
+    } else {
+      legacyPixels.setPixelColor(i, legacyPixels.Color(0, 0, 0));
+    }
+  }
+  legacyPixels.setBrightness(NEO_BRIGHTNESS);
+  legacyPixels.show();
+}
+
+// ===============================================
+// BENCHMARK
+// ===============================================
+
+static void printNeopixelCase(const char *name, uint32_t periodMs, uint32_t frames,
+                              double wallUs, uint32_t shows, uint32_t minutes) {
+  double showsPerMin = (double)shows / minutes;
+  double blockedMsPerMin = showsPerMin * (NEOPIXEL_COUNT * 30 + 50) / 1000.0;
+  printf("%-16s %5lu  %9.3f  %10.0f  %14.1f\n", name, (unsigned long)periodMs,
+         wallUs / frames, showsPerMin, blockedMsPerMin);
+}
+
+void runNeopixelBenchmark() {
+  const uint32_t minutes = 10;
+  const uint32_t durationMs = minutes * 60000UL;
+
+  printf("=== Benchmark del aro Neopixel (%u LEDs, %lu min simulados) ===\n",
+         (unsigned)NEOPIXEL_COUNT, (unsigned long)minutes);
+  printf("render           ms/fr  us/frame   show()/min  ms sin IRQ/min\n");
+
+  hal::sim::reset(1);
+  voicesClear();
+
+  // Render anterior a 10 ms (loop antiguo) y a 20 ms (mismo ritmo que el nuevo)
+  const uint32_t legacyPeriods[] = {10, NEOPIXEL_FRAME_MS};
+  for (uint32_t period : legacyPeriods) {
+    uint32_t before = legacyPixels.showCount();
+    uint32_t frames = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t t = 0; t < durationMs; t += period) {
+      legacyUpdateNeopixel(t);
+      frames++;
+      hal::sim::advance(period);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    printNeopixelCase("float", period, frames,
+                      std::chrono::duration<double, std::micro>(elapsed).count(),
+                      legacyPixels.showCount() - before, minutes);
+  }
+
+  initNeopixel();
+  uint32_t before = pixels.showCount();
+  uint32_t frames = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t t = 0; t < durationMs; t += NEOPIXEL_FRAME_MS) {
+    updateNeopixel(t);
+    frames++;
+    hal::sim::advance(NEOPIXEL_FRAME_MS);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  printNeopixelCase(NEO_DITHER ? "enteros+dither" : "enteros", NEOPIXEL_FRAME_MS, frames,
+                    std::chrono::duration<double, std::micro>(elapsed).count(),
+                    pixels.showCount() - before, minutes);
+}
+
+#endif // BENCH_NEOPIXEL_H
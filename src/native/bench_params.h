@@ -0,0 +1,67 @@
+/*
+ * bench_params.h - Coste de aplicar datos del árbol al motor
+ *
+ * Compara una actualización por el bus de parámetros (objetivos + un paso
+ * de control) con el camino de los botones, que regenera las secuencias y
+ * replanifica todas las voces, con MAX_VOICES voces activas.
+ */
+
+#ifndef BENCH_PARAMS_H
+#define BENCH_PARAMS_H
+
+#include <chrono>
+#include <stdio.h>
+
+#include "piezo_bugs.h"
+
+template <typename F>
+double benchParamsNs(uint32_t iterations, F body) {
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < iterations; i++) body(i);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+void runParamsBenchmark() {
+  const uint32_t iterations = 200000;
+  hal::sim::reset(1);
+  voicesClear();
+  for (uint8_t v = 0; v < MAX_VOICES; v++) voiceAdd(defaultVoiceType(v), PIEZO_PINS[v % PIEZO_PIN_COUNT]);
+  paramBusBegin();
+
+  TreeData data;
+  data.data_valid = true;
+  volatile float sink = 0;
+
+  printf("=== Benchmark del bus de parámetros (%u voces) ===\n", (unsigned)MAX_VOICES);
+  printf("operación                                  ns/llamada\n");
+
+  double apply = benchParamsNs(iterations, [&](uint32_t i) {
+    data.humidity = 30.0f + (i % 60);
+    data.temperature = 5.0f + (i % 25);
+    data.bioelectrical_activity = 0.002f + (i % 60) * 0.0001f;
+    data.light_level = (float)(i % 2000);
+    paramBusApplyTree(data);
+  });
+  printf("paramBusApplyTree                          %10.1f\n", apply);
+
+  double tick = benchParamsNs(iterations, [&](uint32_t i) {
+    paramBusTick(i * PARAM_CONTROL_MS);
+    sink = sink + paramValue(PARAM_DENSITY);
+  });
+  printf("paramBusTick (paso de control)             %10.1f\n", tick);
+
+  double read = benchParamsNs(iterations, [&](uint32_t i) {
+    sink = sink + getInsectNoteInterval(SPIDER) + paramSemitones();
+  });
+  printf("intervalo + transposición en ruta caliente %10.1f\n", read);
+
+  double regenerate = benchParamsNs(iterations / 100, [&](uint32_t i) {
+    voicesRegenerateSequences();
+    voicesRescheduleAll();
+  });
+  printf("regenerar secuencias + replanificar voces  %10.1f\n", regenerate);
+  printf("Una actualización por el bus cuesta %.0fx menos\n", regenerate / (apply + tick));
+}
+
+#endif // BENCH_PARAMS_H
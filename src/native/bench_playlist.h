@@ -0,0 +1,176 @@
+/*
+ * bench_playlist.h - Arranque y cambio de pista del wav_player con y sin índice
+ *
+ * Sobre una carpeta del host que hace de SD (5, 100 y 1000 WAV en /musica)
+ * compara lo que hacía el wav_player (recorrer la carpeta con openNextFile(),
+ * que abre cada entrada, y leer la cabecera del WAV al empezar cada pista)
+ * con el índice de tests/wav_player/playlist_index.h: arrancar con el índice
+ * al día, arrancar reconstruyéndolo y cambiar de pista saltando al PCM.
+ * El recorrido de antes se mide sin el límite de 5 pistas, que es lo que
+ * costaría ver la carpeta entera.
+ *
+ * Las operaciones se cuentan (playlistStats) y se pasan a tiempo de SD con
+ * el modelo de hal_native.h (sdOpenUs por apertura, sdReadUsPerKb; cada
+ * entrada de directorio son 64 bytes con su nombre largo). La escritura del
+ * índice se cuenta como lectura, así que la reconstrucción se queda corta.
+ * "accesos" son las lecturas, escrituras y saltos dentro de los archivos; el
+ * modelo no les pone coste propio. También se da el tiempo real en el host.
+ */
+
+#ifndef BENCH_PLAYLIST_H
+#define BENCH_PLAYLIST_H
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hal.h"
+#include "../../tests/wav_player/playlist_index.h"
+
+const uint32_t BENCH_PLAYLIST_DIRENT_BYTES = 64;
+const uint32_t BENCH_PLAYLIST_BUFFER = 1024;      // Primer bloque de PCM, como el wav_player
+
+static char benchPlaylistRoot[] = "/tmp/bench_playlist_XXXXXX";
+
+static void benchPlaylistPath(char *out, uint16_t size, uint32_t track) {
+  snprintf(out, size, "%s%s/pista%04lu.wav", benchPlaylistRoot, PLAYLIST_DIR, (unsigned long)track);
+}
+
+// WAV mono de 16 bits a 22050 Hz con un bloque LIST y 4 KB de PCM
+static void benchPlaylistWriteWav(uint32_t track) {
+  static const uint8_t header[] = {
+      'R', 'I', 'F', 'F', 0x38, 0x10, 0, 0, 'W', 'A', 'V', 'E',
+      'f', 'm', 't', ' ', 16, 0, 0, 0, 1, 0, 1, 0, 0x22, 0x56, 0, 0, 0x44, 0xAC, 0, 0, 2, 0, 16, 0,
+      'L', 'I', 'S', 'T', 12, 0, 0, 0, 'I', 'N', 'F', 'O', 'I', 'S', 'F', 'T', 0, 0, 0, 0,
+      'd', 'a', 't', 'a', 0, 0x10, 0, 0};
+  static uint8_t pcm[4096];
+  char path[192];
+  benchPlaylistPath(path, sizeof(path), track);
+  FILE *f = fopen(path, "wb");
+  if (!f) return;
+  fwrite(header, 1, sizeof(header), f);
+  fwrite(pcm, 1, sizeof(pcm), f);
+  fclose(f);
+}
+
+static void benchPlaylistFill(uint32_t from, uint32_t to) {
+  for (uint32_t i = from; i < to; i++) benchPlaylistWriteWav(i);
+}
+
+static void benchPlaylistCleanup(uint32_t tracks) {
+  char path[192];
+  for (uint32_t i = 0; i < tracks; i++) {
+    benchPlaylistPath(path, sizeof(path), i);
+    unlink(path);
+  }
+  snprintf(path, sizeof(path), "%s%s", benchPlaylistRoot, PLAYLIST_INDEX);
+  unlink(path);
+  snprintf(path, sizeof(path), "%s%s", benchPlaylistRoot, PLAYLIST_DIR);
+  rmdir(path);
+  rmdir(benchPlaylistRoot);
+}
+
+// Antes: openNextFile() abre cada entrada para saber su nombre y tipo
+static uint32_t benchPlaylistWalk() {
+  char dirPath[192], path[512];
+  snprintf(dirPath, sizeof(dirPath), "%s%s", benchPlaylistRoot, PLAYLIST_DIR);
+  DIR *dir = opendir(dirPath);
+  uint32_t found = 0;
+  while (struct dirent *entry = readdir(dir)) {
+    playlistStats.dirEntries++;
+    if (entry->d_name[0] == '.') continue;
+    snprintf(path, sizeof(path), "%s/%s", dirPath, entry->d_name);
+    int fd = playlistOpenFile(path, O_RDONLY);
+    if (fd >= 0) close(fd);
+    if (playlistIsWavName(entry->d_name)) found++;
+  }
+  closedir(dir);
+  return found;
+}
+
+// Antes: abrir la pista, interpretar la cabecera y leer el primer bloque
+static void benchPlaylistStartByHeader(uint32_t track) {
+  static uint8_t buffer[BENCH_PLAYLIST_BUFFER];
+  char path[192];
+  benchPlaylistPath(path, sizeof(path), track);
+  int fd = playlistOpenFile(path, O_RDONLY);
+  struct stat st;
+  PlaylistEntry e = {};
+  if (fd < 0) return;
+  if (fstat(fd, &st) == 0 && wavReadInfo(fd, st.st_size, e)) playlistReadFile(fd, buffer, sizeof(buffer));
+  close(fd);
+}
+
+// Ahora: entrada del índice, abrir ya en el PCM y leer el primer bloque
+static void benchPlaylistStartByIndex(Playlist &list, uint32_t track) {
+  static uint8_t buffer[BENCH_PLAYLIST_BUFFER];
+  PlaylistEntry e;
+  if (!playlistGet(list, track, e)) return;
+  int fd = playlistOpenTrack(list, e);
+  if (fd < 0) return;
+  playlistReadFile(fd, buffer, sizeof(buffer));
+  close(fd);
+}
+
+// Tiempo de SD del modelo para las operaciones contadas desde el último cero
+static double benchPlaylistSdMs(uint32_t repeats) {
+  const hal::sim::State &s = hal::sim::state();
+  const PlaylistStats &st = playlistStats;
+  uint64_t bytes = (uint64_t)st.bytesRead + st.bytesWritten + (uint64_t)st.dirEntries * BENCH_PLAYLIST_DIRENT_BYTES;
+  double us = (double)st.opens * s.sdOpenUs + (double)bytes * s.sdReadUsPerKb / 1024;
+  return us / 1000 / repeats;
+}
+
+template <typename F>
+static void benchPlaylistRow(const char *name, uint32_t repeats, F body) {
+  playlistStats = PlaylistStats();
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < repeats; i++) body(i);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  double hostUs = std::chrono::duration<double, std::micro>(elapsed).count() / repeats;
+  printf("  %-36s %9lu %8lu %8lu %10.1f %10.1f\n", name, (unsigned long)(playlistStats.opens / repeats),
+         (unsigned long)((playlistStats.reads + playlistStats.seeks + playlistStats.writes) / repeats),
+         (unsigned long)((playlistStats.bytesRead + playlistStats.bytesWritten) / repeats),
+         benchPlaylistSdMs(repeats), hostUs);
+}
+
+void runPlaylistBenchmark() {
+  static const uint32_t SIZES[] = {5, 100, 1000};
+  const uint32_t switches = 200;
+  hal::sim::reset(1);
+  char dirPath[192];
+  if (!mkdtemp(benchPlaylistRoot)) {
+    printf("No se pudo crear la carpeta de prueba\n");
+    return;
+  }
+  snprintf(dirPath, sizeof(dirPath), "%s%s", benchPlaylistRoot, PLAYLIST_DIR);
+  mkdir(dirPath, 0755);
+
+  printf("=== Benchmark de la lista del wav_player (SD: %lu us por apertura, %lu us/KB) ===\n",
+         (unsigned long)hal::sim::state().sdOpenUs, (unsigned long)hal::sim::state().sdReadUsPerKb);
+  uint32_t tracks = 0;
+  for (uint32_t size : SIZES) {
+    benchPlaylistFill(tracks, size);
+    tracks = size;
+    char label[32];
+    snprintf(label, sizeof(label), "%lu pistas", (unsigned long)size);
+    printf("\n%-38s aperturas  accesos    bytes   ms de SD    us host\n", label);
+
+    benchPlaylistRow("arranque recorriendo la carpeta", 1, [&](uint32_t) { benchPlaylistWalk(); });
+    Playlist list = {};
+    strcpy(list.root, benchPlaylistRoot);
+    benchPlaylistRow("arranque reconstruyendo el índice", 1, [&](uint32_t) { playlistRebuild(list); });
+    playlistEnd(list);
+    benchPlaylistRow("arranque con el índice al día", 1, [&](uint32_t) { playlistBegin(list, benchPlaylistRoot); });
+    if (list.rebuilt || list.count != size) printf("  AVISO: el índice no estaba al día\n");
+
+    benchPlaylistRow("cambio de pista leyendo la cabecera", switches,
+                     [&](uint32_t i) { benchPlaylistStartByHeader(i * 7 % size); });
+    benchPlaylistRow("cambio de pista con el índice", switches,
+                     [&](uint32_t i) { benchPlaylistStartByIndex(list, i * 7 % size); });
+    playlistEnd(list);
+  }
+  benchPlaylistCleanup(tracks);
+}
+
+#endif // BENCH_PLAYLIST_H
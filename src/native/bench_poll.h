@@ -0,0 +1,199 @@
+/*
+ * bench_poll.h - Consultas a InfluxDB: last() fijo frente a marca de agua adaptativa
+ *
+ * Tres horas simuladas contra un InfluxDB sustituto (handler del servidor
+ * TLS de hal_native.h) que recibe un punto por campo cada 10 s y responde
+ * a las dos formas de consulta de forestData:
+ * - range(start: -1h) |> last(): el último punto de cada campo
+ * - range(start: time(v: N)) |> tail(n: M): los puntos desde N
+ * keep(columns: ...) recorta las columnas como lo haría InfluxDB.
+ *
+ * bioelectrical_activity está casi plana la primera hora, oscila durante
+ * media hora y vuelve a estar plana hora y media.
+ */
+
+#ifndef BENCH_POLL_H
+#define BENCH_POLL_H
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "influx_poll.h"
+
+// ===============================================
+// INFLUXDB SUSTITUTO
+// ===============================================
+
+const int64_t STANDIN_EPOCH_S = 1748772000;      // 2025-06-01T10:00:00Z
+const uint32_t STANDIN_PERIOD_MS = 10000;        // Un punto por campo cada 10 s
+const uint32_t STANDIN_VOLATILE_FROM_MS = 3600000;
+const uint32_t STANDIN_VOLATILE_TO_MS = 5400000;
+
+struct InfluxStandin {
+  std::string response;
+  std::vector<bool> bioServed;     // Puntos de bioelectrical_activity ya entregados
+  uint64_t delaySumMs[2];          // Retraso de entrega por fase (plana, volátil)
+  uint32_t delayCount[2];
+};
+
+static InfluxStandin standin;
+
+static bool standinVolatile(uint32_t ms) {
+  return ms >= STANDIN_VOLATILE_FROM_MS && ms < STANDIN_VOLATILE_TO_MS;
+}
+
+static float standinValue(int field, uint32_t index) {
+  uint32_t ms = index * STANDIN_PERIOD_MS;
+  switch (field) {
+    case TREE_HUMIDITY: return 61.8f + (index % 7) * 0.01f;
+    case TREE_TEMPERATURE: return 17.4f + (index % 5) * 0.01f;
+    case TREE_BIOELECTRICAL_ACTIVITY:
+      if (standinVolatile(ms)) return 0.0041f + 0.002f * sinf(ms / 180000.0f * 6.2831853f);
+      return 0.0041f + ((index * 2654435761u) >> 28) * 0.000001f;
+    default: return 1184.0f + (index % 3);
+  }
+}
+
+static void standinTime(char *out, size_t size, uint32_t index) {
+  int64_t t = STANDIN_EPOCH_S + (int64_t)index * (STANDIN_PERIOD_MS / 1000);
+  int day = (int)(t / 86400 - 20240);     // 2025-06-01 = día 20240
+  int s = (int)(t % 86400);
+  snprintf(out, size, "2025-06-%02dT%02d:%02d:%02dZ", day + 1, s / 3600, (s / 60) % 60, s % 60);
+}
+
+static const char *standinHandler(const char *request, uint32_t length, uint32_t *responseLength) {
+  std::string text(request, length);
+  bool keep = text.find("keep(columns") != std::string::npos;
+  uint32_t now = hal::millis();
+  uint32_t newest = now / STANDIN_PERIOD_MS;
+  uint32_t first = newest;
+  uint32_t tail = 1;
+  size_t at = text.find("time(v: ");
+  if (at != std::string::npos) {
+    int64_t startNs = strtoll(text.c_str() + at + 8, nullptr, 10);
+    int64_t offsetNs = startNs - STANDIN_EPOCH_S * 1000000000LL;
+    int64_t periodNs = (int64_t)STANDIN_PERIOD_MS * 1000000;
+    first = offsetNs <= 0 ? 0 : (uint32_t)((offsetNs + periodNs - 1) / periodNs);
+    size_t tailAt = text.find("tail(n: ");
+    tail = tailAt != std::string::npos ? (uint32_t)atoi(text.c_str() + tailAt + 8) : 0xFFFFFFFF;
+  }
+  if (newest + 1 - first > tail) first = newest + 1 - tail;
+
+  std::string body;
+  char line[200];
+  char time[32];
+  for (int f = 0; f < TREE_FIELD_COUNT && first <= newest; f++) {
+    body += keep ? ",result,table,_time,_value,_field\r\n"
+                 : ",result,table,_start,_stop,_time,_value,_field,_measurement,tree\r\n";
+    for (uint32_t i = first; i <= newest; i++) {
+      standinTime(time, sizeof(time), i);
+      if (keep) {
+        snprintf(line, sizeof(line), ",_result,%d,%s,%.6g,%s\r\n", f, time, standinValue(f, i), TREE_FIELD_NAMES[f]);
+      } else {
+        snprintf(line, sizeof(line),
+                 ",_result,%d,2025-06-01T09:00:00Z,2025-06-01T10:00:00Z,%s,%.6g,%s,sensors,roble\r\n",
+                 f, time, standinValue(f, i), TREE_FIELD_NAMES[f]);
+      }
+      body += line;
+      if (f == TREE_BIOELECTRICAL_ACTIVITY) {
+        if (standin.bioServed.size() <= i) standin.bioServed.resize(i + 1, false);
+        if (!standin.bioServed[i]) {
+          standin.bioServed[i] = true;
+          int phase = standinVolatile(i * STANDIN_PERIOD_MS) ? 1 : 0;
+          standin.delaySumMs[phase] += now - i * STANDIN_PERIOD_MS;
+          standin.delayCount[phase]++;
+        }
+      }
+    }
+    body += "\r\n";
+  }
+
+  char size[16];
+  snprintf(size, sizeof(size), "%zx\r\n", body.size());
+  standin.response = "HTTP/1.1 200 OK\r\n"
+                     "Content-Type: text/csv; charset=utf-8\r\n"
+                     "Date: Sun, 01 Jun 2025 11:00:00 GMT\r\n"
+                     "X-Influxdb-Build: OSS\r\n"
+                     "X-Influxdb-Version: v2.7.1\r\n"
+                     "Transfer-Encoding: chunked\r\n"
+                     "\r\n";
+  if (!body.empty()) standin.response += size + body + "\r\n";
+  standin.response += "0\r\n\r\n";
+  *responseLength = (uint32_t)standin.response.size();
+  return standin.response.c_str();
+}
+
+// ===============================================
+// BENCHMARK
+// ===============================================
+
+void runPollBenchmark() {
+  enum Mode { FIXED_LAST, WATERMARK_FIXED, WATERMARK_ADAPTIVE };
+  struct Scenario {
+    const char *name;
+    Mode mode;
+  };
+  const Scenario scenarios[] = {
+    {"last() cada 10 s (antes)", FIXED_LAST},
+    {"marca de agua cada 10 s", WATERMARK_FIXED},
+    {"marca de agua adaptativa", WATERMARK_ADAPTIVE},
+  };
+  const uint32_t durationMs = 3 * 3600000UL;
+  const double hours = durationMs / 3600000.0;
+  static const uint8_t pin[1][hal::TLS_PIN_SIZE] = {{1}};
+
+  printf("=== Benchmark de consultas a InfluxDB (%.0f h simuladas, un punto por campo cada 10 s) ===\n", hours);
+  printf("escenario                  consultas/h  bytes/h   bio perdidos  retraso plana  retraso volátil  intervalo\n");
+
+  for (const Scenario &scenario : scenarios) {
+    hal::sim::reset(1);
+    hal::sim::TlsServer &server = hal::sim::tlsServer();
+    server.spki[0] = 1;
+    server.handler = standinHandler;
+    standin = InfluxStandin();
+
+    static InfluxClient client;
+    client = InfluxClient();
+    influxClientBegin(client, "db.sinfoniabiotica.xyz", 443, "bosque", "token", nullptr, pin, 1);
+    influxClientSetQuery(client, "from(bucket: \"biodata\") |> range(start: -1h) |> last()");
+    InfluxPoller poller;
+    influxPollerBegin(poller, "biodata");
+    TreeData data;
+    uint32_t minInterval = POLL_MAX_MS;
+    uint32_t maxInterval = 0;
+    uint32_t lastQueryTime = 0;
+
+    hal::sim::advance(1000);
+    while (hal::millis() < durationMs) {
+      if (scenario.mode == FIXED_LAST) {
+        if (client.queries == 0 || hal::millis() - lastQueryTime >= POLL_START_MS) {
+          influxClientQuery(client, data);
+          lastQueryTime = hal::millis();
+        }
+      } else if (influxPollerDue(poller, hal::millis())) {
+        influxPollerFetch(poller, client, data);
+        if (scenario.mode == WATERMARK_FIXED) poller.intervalMs = POLL_START_MS;
+        if (poller.intervalMs < minInterval) minInterval = poller.intervalMs;
+        if (poller.intervalMs > maxInterval) maxInterval = poller.intervalMs;
+      }
+      hal::sim::advance(100);
+    }
+
+    // Puntos saltados entre dos consultas (los posteriores a la última aún no se han pedido)
+    uint32_t lost = 0;
+    for (bool served : standin.bioServed) lost += served ? 0 : 1;
+    char intervals[32] = "10 s";
+    if (scenario.mode == WATERMARK_ADAPTIVE) {
+      snprintf(intervals, sizeof(intervals), "%.0f-%.0f s", minInterval / 1000.0, maxInterval / 1000.0);
+    }
+    printf("%-25s  %11.0f  %8.0f  %12lu  %11.1f s  %13.1f s  %s\n", scenario.name, client.queries / hours,
+           (client.bytesSent + client.bytesReceived) / hours, (unsigned long)lost,
+           standin.delayCount[0] ? standin.delaySumMs[0] / 1000.0 / standin.delayCount[0] : 0.0,
+           standin.delayCount[1] ? standin.delaySumMs[1] / 1000.0 / standin.delayCount[1] : 0.0, intervals);
+  }
+}
+
+#endif // BENCH_POLL_H
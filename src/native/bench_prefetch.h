@@ -0,0 +1,188 @@
+/*
+ * bench_prefetch.h - Cortes del wav_player leyendo a demanda o por adelantado
+ *
+ * Simula en tiempo virtual (pasos de 100 us) diez minutos de una pista
+ * estéreo de 16 bits a 44,1 kHz: el DMA del I2S se vacía a ritmo constante
+ * y el loop lo rellena cada MAIN_LOOP_DELAY_MS. A demanda (lo de antes) el
+ * loop lee de la SD un bloque de AUDIO_BUFFER_SIZE cuando se le acaba y se
+ * queda bloqueado mientras tanto; con wav_prefetch.h la tarea lee bloques
+ * de PREFETCH_BLOCK_SIZE al anillo en paralelo y el loop copia de RAM.
+ *
+ * La tarjeta: 300 us por orden más sdReadUsPerKb de hal_native.h; un 4 %
+ * de las lecturas tarda de 5 a 20 ms más y un 0,4 %, de 80 a 250 ms (la SD
+ * reorganizando su flash). Se cuenta un corte cada vez que el DMA se queda
+ * vacío. El DMA de 4 KB (unos 23 ms) es una suposición sobre la
+ * configuración de AudioOutputI2S.
+ */
+
+#ifndef BENCH_PREFETCH_H
+#define BENCH_PREFETCH_H
+
+#include <fcntl.h>
+#include <stdio.h>
+
+#include "hal.h"
+#include "prng.h"
+#include "../../tests/wav_player/wav_prefetch.h"
+
+const uint32_t BENCH_PREFETCH_STEP_US = 100;
+const uint32_t BENCH_PREFETCH_SECONDS = 600;
+const double BENCH_PREFETCH_BYTES_PER_US = 44100.0 * 4 / 1000000;
+const double BENCH_PREFETCH_DMA_BYTES = 4096;
+const uint32_t BENCH_PREFETCH_COMMAND_US = 300;
+
+struct BenchPrefetchResult {
+  uint32_t dropouts;       // Veces que el DMA se quedó vacío
+  double silentMs;
+  uint32_t underruns;      // Vacíos del anillo (solo con lectura anticipada)
+  uint32_t fillMinPercent;
+  uint32_t readMaxUs;
+};
+
+static uint64_t benchPrefetchClockUs;
+static uint32_t benchPrefetchPendingUs;
+static Prng benchPrefetchCard;
+
+static uint32_t benchPrefetchLatencyUs(uint32_t bytes) {
+  uint32_t us = BENCH_PREFETCH_COMMAND_US + bytes * hal::sim::state().sdReadUsPerKb / 1024;
+  uint32_t r = prngBelow(benchPrefetchCard, 1000);
+  if (r < 4) {
+    us += prngRange(benchPrefetchCard, 80000, 250000);
+  } else if (r < 44) {
+    us += prngRange(benchPrefetchCard, 5000, 20000);
+  }
+  return us;
+}
+
+// La lectura ya "duró" benchPrefetchPendingUs: el reloj lo refleja al volver
+static int32_t benchPrefetchRead(int fd, void *buffer, uint32_t bytes) {
+  benchPrefetchClockUs += benchPrefetchPendingUs;
+  return read(fd, buffer, bytes);
+}
+
+static uint32_t benchPrefetchClock() { return (uint32_t)benchPrefetchClockUs; }
+
+// Lo que pedirá prefetchService en su próxima lectura; 0 si no cabe
+static uint32_t benchPrefetchWant(const Prefetch &p) {
+  uint32_t head = p.head.load();
+  uint32_t space = p.size - (head - p.tail.load());
+  uint32_t contiguous = p.size - (head & (p.size - 1));
+  uint32_t want = PREFETCH_BLOCK_SIZE - p.filePos % PREFETCH_BLOCK_SIZE;
+  if (want > p.fileLeft) want = p.fileLeft;
+  if (want > contiguous) want = contiguous;
+  return space >= want ? want : 0;
+}
+
+// ringSize 0: el loop lee a demanda, como antes
+static BenchPrefetchResult benchPrefetchRun(uint32_t ringSize) {
+  static uint8_t ring[PREFETCH_BUFFER_SIZE];
+  static uint8_t pcm[AUDIO_BUFFER_SIZE];
+  static Prefetch p;
+  BenchPrefetchResult result = {};
+  prngSeed(benchPrefetchCard, 11, 0);
+  const uint64_t endUs = (uint64_t)BENCH_PREFETCH_SECONDS * 1000000;
+  const uint32_t trackBytes = (uint32_t)(BENCH_PREFETCH_SECONDS * 1000000.0 * BENCH_PREFETCH_BYTES_PER_US) + 1000000;
+  double dma = BENCH_PREFETCH_DMA_BYTES;
+  bool silent = false;
+
+  uint64_t loopAt = 0;                 // Próxima vuelta del loop
+  uint64_t loopBusyUntil = 0;          // A demanda: lectura en curso del loop
+  uint32_t pcmLength = 0;
+  uint64_t taskBusyUntil = 0;          // Lectura anticipada: bloque en curso de la tarea
+  uint32_t taskUs = 0;
+
+  if (ringSize) {
+    prefetchBegin(p, ring, ringSize, benchPrefetchRead, benchPrefetchClock);
+    prefetchStart(p, open("/dev/zero", O_RDONLY), 44, trackBytes);
+    prefetchService(p);
+  }
+
+  for (uint64_t t = 0; t < endUs; t += BENCH_PREFETCH_STEP_US) {
+    // Tarea: termina el bloque en curso o empieza otro si cabe
+    if (ringSize) {
+      if (taskUs && t >= taskBusyUntil) {
+        benchPrefetchClockUs = t - taskUs;
+        benchPrefetchPendingUs = taskUs;
+        prefetchService(p);
+        taskUs = 0;
+      }
+      uint32_t want = taskUs ? 0 : benchPrefetchWant(p);
+      if (want) {
+        taskUs = benchPrefetchLatencyUs(want);
+        taskBusyUntil = t + taskUs;
+      }
+    }
+
+    // Loop: rellena el DMA cada MAIN_LOOP_DELAY_MS
+    if (t >= loopAt && t >= loopBusyUntil) {
+      bool full = false;
+      while (!full) {
+        uint32_t room = (uint32_t)(BENCH_PREFETCH_DMA_BYTES - dma) & ~3u;
+        if (room == 0) {
+          full = true;
+        } else if (ringSize) {
+          uint32_t n = prefetchRead(p, pcm, room < sizeof(pcm) ? room : sizeof(pcm), 4);
+          if (n == 0) break;
+          dma += n;
+        } else if (pcmLength) {
+          uint32_t n = room < pcmLength ? room : pcmLength;
+          pcmLength -= n;
+          dma += n;
+        } else {
+          // A demanda: el loop espera a la SD
+          if (loopBusyUntil > 0 && t >= loopBusyUntil) {
+            pcmLength = sizeof(pcm);
+            loopBusyUntil = 0;
+            continue;
+          }
+          loopBusyUntil = t + benchPrefetchLatencyUs(sizeof(pcm));
+          break;
+        }
+      }
+      if (full || ringSize) loopAt = t + MAIN_LOOP_DELAY_MS * 1000;
+    }
+
+    // El I2S saca audio a ritmo constante
+    dma -= BENCH_PREFETCH_BYTES_PER_US * BENCH_PREFETCH_STEP_US;
+    if (dma <= 0) {
+      dma = 0;
+      if (!silent) result.dropouts++;
+      silent = true;
+      result.silentMs += BENCH_PREFETCH_STEP_US / 1000.0;
+    } else {
+      silent = false;
+    }
+  }
+
+  if (ringSize) {
+    result.underruns = p.stats.underruns;
+    result.fillMinPercent = (uint64_t)p.stats.fillMin * 100 / ringSize;
+    result.readMaxUs = p.stats.readUsMax;
+    prefetchStop(p);
+    prefetchService(p);
+  }
+  return result;
+}
+
+void runPrefetchBenchmark() {
+  static const uint32_t RINGS[] = {0, 8 * AUDIO_BUFFER_SIZE, 16 * AUDIO_BUFFER_SIZE,
+                                   32 * AUDIO_BUFFER_SIZE, PREFETCH_BUFFER_SIZE};
+  hal::sim::reset(1);
+  printf("=== Benchmark de lectura anticipada (%u s de estéreo 16 bits a 44,1 kHz) ===\n",
+         BENCH_PREFETCH_SECONDS);
+  printf("lectura                       cortes  ms en silencio  vacíos  anillo mín  bloque máx\n");
+  for (uint32_t ring : RINGS) {
+    BenchPrefetchResult r = benchPrefetchRun(ring);
+    if (ring == 0) {
+      printf("a demanda (%4u B en el loop) %6lu %15.1f\n", AUDIO_BUFFER_SIZE, (unsigned long)r.dropouts,
+             r.silentMs);
+    } else {
+      char label[32];
+      snprintf(label, sizeof(label), "anillo de %lu KB", (unsigned long)(ring / 1024));
+      printf("%-29s %6lu %15.1f %7lu %10lu%% %8.1f ms\n", label, (unsigned long)r.dropouts, r.silentMs,
+             (unsigned long)r.underruns, (unsigned long)r.fillMinPercent, r.readMaxUs / 1000.0);
+    }
+  }
+}
+
+#endif // BENCH_PREFETCH_H
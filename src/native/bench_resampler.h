@@ -0,0 +1,173 @@
+/*
+ * bench_resampler.h - Coste y alias del conversor de frecuencia (resampler.h)
+ *
+ * Para cada frecuencia de muestra habitual convierte a SYNTH_SAMPLE_RATE:
+ * - Coste: 10 s de ruido por bloques de SYNTH_BLOCK_FRAMES salidas, como la
+ *   voz de muestra. Se da en ns por salida y en ciclos del contador de
+ *   tiempo del procesador (TSC en x86; en otras máquinas, ns).
+ * - Alias: un barrido de 48 tonos por la banda de entrada. Los tonos que
+ *   caben en la salida se ajustan a un seno y todo lo demás (imágenes,
+ *   alias, ruido de cuantización) cuenta como error; los que no caben
+ *   deberían desaparecer, así que todo lo que sale es alias. Se da el peor
+ *   caso en dB. Los tonos de la banda de transición no cuentan.
+ * - "-1 dB hasta": el tono más agudo que pasa con menos de 1 dB de pérdida.
+ * La columna "lineal" es el alias de interpolar entre dos muestras, lo que
+ * se haría sin tablas.
+ */
+
+#ifndef BENCH_RESAMPLER_H
+#define BENCH_RESAMPLER_H
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "prng.h"
+#include "resampler.h"
+
+const uint32_t BENCH_RESAMPLER_TONES = 48;
+const uint32_t BENCH_RESAMPLER_SECONDS = 10;
+
+static int16_t benchResamplerIn[48000];
+static int16_t benchResamplerOut[66150];
+static volatile int16_t benchResamplerSink;   // Que el compilador no se salte el render
+
+static uint64_t benchResamplerTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+// Un segundo de entrada convertido con la tabla; devuelve las salidas
+static uint32_t benchResamplerConvert(const ResamplerTable &t, uint32_t frames) {
+  static Resampler r;
+  resamplerReset(r, &t);
+  uint32_t used;
+  return resamplerProcess(r, benchResamplerIn, frames, benchResamplerOut, sizeof(benchResamplerOut) / 2, used);
+}
+
+// Interpolación lineal entre dos muestras, como referencia
+static uint32_t benchResamplerLinear(uint32_t inRate, uint32_t frames) {
+  uint64_t step = ((uint64_t)inRate << 32) / SYNTH_SAMPLE_RATE;
+  uint32_t n = 0;
+  for (uint64_t pos = 0; (pos >> 32) + 1 < frames && n < sizeof(benchResamplerOut) / 2; pos += step) {
+    uint32_t i = pos >> 32;
+    int32_t w = (uint32_t)pos >> 17;
+    benchResamplerOut[n++] = (int16_t)(benchResamplerIn[i] + (((benchResamplerIn[i + 1] - benchResamplerIn[i]) * w) >> 15));
+  }
+  return n;
+}
+
+// Error en dB del tono f de la entrada en la salida. inBand: se ajusta el
+// seno y el resto es error; si no, todo lo que sale es error. gain: la
+// ganancia del seno ajustado
+static double benchResamplerToneError(double f, uint32_t n, bool inBand, double amplitude, double &gain) {
+  // Fuera los bordes: el arranque y la cola del filtro
+  const uint32_t from = 200, to = n - 200;
+  double ss = 0, sc = 0, cc = 0, ys = 0, yc = 0, yy = 0;
+  for (uint32_t i = from; i < to; i++) {
+    double s = sin(2.0 * M_PI * f * i / SYNTH_SAMPLE_RATE), c = cos(2.0 * M_PI * f * i / SYNTH_SAMPLE_RATE);
+    double y = benchResamplerOut[i];
+    ss += s * s;
+    sc += s * c;
+    cc += c * c;
+    ys += y * s;
+    yc += y * c;
+    yy += y * y;
+  }
+  double reference = amplitude * amplitude / 2 * (to - from);
+  if (!inBand) return 10 * log10((yy + 1e-9) / reference);
+  double det = ss * cc - sc * sc;
+  double a = (ys * cc - yc * sc) / det, b = (yc * ss - ys * sc) / det;
+  double fitted = a * a * ss + 2 * a * b * sc + b * b * cc;
+  gain = 10 * log10(fitted / reference);
+  return 10 * log10((yy - fitted + 1e-9) / fitted);
+}
+
+struct BenchResamplerSweep {
+  double worst;        // dB
+  double worstLinear;
+  double flatHz;       // -1 dB hasta
+};
+
+static BenchResamplerSweep benchResamplerSweep(const ResamplerTable &t) {
+  const double amplitude = 20000;
+  const double inNyquist = t.inRate / 2.0, outNyquist = SYNTH_SAMPLE_RATE / 2.0;
+  const double nyquist = inNyquist < outNyquist ? inNyquist : outNyquist;
+  // Banda de paso útil: antes de la transición del filtro
+  const double transition = (RESAMPLER_KAISER_BETA / 0.1102 + 8.7 - 8) / (2.285 * 2 * M_PI * t.taps) * t.inRate;
+  BenchResamplerSweep sweep = {-200, -200, 0};
+  for (uint32_t k = 0; k < BENCH_RESAMPLER_TONES; k++) {
+    double f = (k + 0.5) * inNyquist / BENCH_RESAMPLER_TONES;
+    bool inBand = f <= nyquist - transition;
+    bool outOfBand = f >= outNyquist;
+    if (!inBand && !outOfBand) continue;
+    for (uint32_t i = 0; i < t.inRate; i++) {
+      benchResamplerIn[i] = (int16_t)lround(amplitude * sin(2.0 * M_PI * f * i / t.inRate));
+    }
+    double gain = 0;
+    double error = benchResamplerToneError(f, benchResamplerConvert(t, t.inRate), inBand, amplitude, gain);
+    if (error > sweep.worst) sweep.worst = error;
+    if (inBand && gain > -1 && f > sweep.flatHz) sweep.flatHz = f;
+    double linearGain = 0;
+    error = benchResamplerToneError(f, benchResamplerLinear(t.inRate, t.inRate), inBand, amplitude, linearGain);
+    if (error > sweep.worstLinear) sweep.worstLinear = error;
+  }
+  return sweep;
+}
+
+void runResamplerBenchmark() {
+  static const uint32_t RATES[] = {8000, 11025, 16000, 32000, 44100, 48000};
+  static int16_t coeffs[SAMPLE_RATE_COEFFS];
+  static int16_t block[SYNTH_BLOCK_FRAMES];
+  printf("=== Benchmark del conversor de frecuencia (a %lu Hz, %u fases, bloques de %u salidas) ===\n",
+         (unsigned long)SYNTH_SAMPLE_RATE, (unsigned)RESAMPLER_PHASES, (unsigned)SYNTH_BLOCK_FRAMES);
+#if defined(__x86_64__) || defined(__i386__)
+  const char *ticks = "ciclos TSC";
+#else
+  const char *ticks = "ns";
+#endif
+  printf("entrada   coefs  tabla  ns/salida  %s/salida   alias  lineal  -1 dB hasta\n", ticks);
+
+  for (uint32_t rate : RATES) {
+    ResamplerTable t;
+    if (!resamplerTableBuild(t, rate, SYNTH_SAMPLE_RATE, coeffs, SAMPLE_RATE_COEFFS)) {
+      printf("%5lu Hz  no cabe\n", (unsigned long)rate);
+      continue;
+    }
+
+    // Coste: ruido de entrada, salidas por bloques como la voz de muestra
+    Prng noise;
+    prngSeed(noise, 5, 0);
+    for (uint32_t i = 0; i < rate; i++) benchResamplerIn[i] = (int16_t)(prngBelow(noise, 40001) - 20000);
+    Resampler r;
+    resamplerReset(r, &t);
+    const uint32_t outputs = BENCH_RESAMPLER_SECONDS * SYNTH_SAMPLE_RATE;
+    uint32_t produced = 0, position = 0;
+    auto start = std::chrono::steady_clock::now();
+    uint64_t startTicks = benchResamplerTicks();
+    while (produced < outputs) {
+      uint32_t used;
+      uint32_t n = resamplerProcess(r, benchResamplerIn + position, rate - position, block, SYNTH_BLOCK_FRAMES, used);
+      position += used;
+      if (position == rate) position = 0;
+      produced += n;
+      if (n) benchResamplerSink = block[n - 1];
+    }
+    uint64_t elapsedTicks = benchResamplerTicks() - startTicks;
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    BenchResamplerSweep sweep = benchResamplerSweep(t);
+    printf("%5lu Hz  %5u %4.1f KB %10.1f %15.1f %5.0f dB %4.0f dB %8.0f Hz\n", (unsigned long)rate, (unsigned)t.taps,
+           resamplerTableSize(t.taps) * 2 / 1024.0, ns / produced, (double)elapsedTicks / produced, sweep.worst,
+           sweep.worstLinear, sweep.flatHz);
+  }
+}
+
+#endif // BENCH_RESAMPLER_H
@@ -0,0 +1,195 @@
+/*
+ * bench_samples.h - Disparo de muestras: abrir el WAV frente a banco y caché
+ *
+ * Compara lo que hace tests/wav_player en cada reproducción (abrir el
+ * archivo en la SD, leer la cabecera y el primer bloque antes de sonar)
+ * con disparar desde el banco proyectado en flash y desde la caché de la
+ * PSRAM (samples.h). Los tiempos de la SD son los del modelo de
+ * hal_native.h (sdOpenUs, sdReadUsPerKb) en el reloj virtual; el coste de
+ * CPU del disparo se mide en el host. Al final, tasa de aciertos de la
+ * caché con 24 muestras de la SD disparadas con una distribución de Zipf
+ * (unas pocas suenan mucho más que el resto) sobre SAMPLE_CACHE_SLOTS huecos.
+ */
+
+#ifndef BENCH_SAMPLES_H
+#define BENCH_SAMPLES_H
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "samples.h"
+#include "prng.h"
+
+const uint8_t BENCH_FLASH_SAMPLES = 4;
+const uint8_t BENCH_SD_SAMPLES = 24;
+
+static char benchSamplesRoot[] = "/tmp/bench_samples_XXXXXX";
+
+static void benchSamplesWrite(const char *path, const void *data, uint32_t size) {
+  FILE *f = fopen(path, "wb");
+  if (!f) return;
+  fwrite(data, 1, size, f);
+  fclose(f);
+}
+
+// Banco con 4 golpes cortos en flash y 24 muestras de 1 a 4 s en la SD
+static bool benchSamplesBuild(char *flashPath, uint32_t flashPathSize) {
+  static uint8_t image[SAMPLE_BANK_OFFSET + 64 * 1024];
+  static int16_t pcm[4 * SYNTH_SAMPLE_RATE];
+  const uint16_t count = BENCH_FLASH_SAMPLES + BENCH_SD_SAMPLES;
+  memset(image, 0xFF, sizeof(image));
+  uint8_t *bank = image + SAMPLE_BANK_OFFSET;
+  SampleBankEntry *entries = (SampleBankEntry *)(bank + sizeof(SampleBankHeader));
+  uint32_t dataStart = sizeof(SampleBankHeader) + count * sizeof(SampleBankEntry);
+  uint32_t offset = dataStart;
+  for (uint32_t i = 0; i < sizeof(pcm) / 2; i++) pcm[i] = (int16_t)((i * 131) & 0x3FFF);
+
+  for (uint16_t id = 0; id < count; id++) {
+    SampleBankEntry &e = entries[id];
+    memset(&e, 0, sizeof(e));
+    e.sampleRate = SYNTH_SAMPLE_RATE;
+    if (id < BENCH_FLASH_SAMPLES) {
+      snprintf(e.name, SAMPLE_NAME_SIZE, "golpe%u", id);
+      e.source = SAMPLE_IN_FLASH;
+      e.frames = SYNTH_SAMPLE_RATE / 10 * (id + 1);
+      e.offset = offset;
+      memcpy(bank + offset, pcm, e.frames * 2);
+      offset += (e.frames * 2 + 3) & ~3u;
+    } else {
+      snprintf(e.name, SAMPLE_NAME_SIZE, "fondo%u", id);
+      snprintf(e.path, SAMPLE_PATH_SIZE, "/fondo%u.wav", id);
+      e.source = SAMPLE_ON_SD;
+      e.frames = SYNTH_SAMPLE_RATE * (1 + id % 4);
+      e.offset = 44;
+      char path[192];
+      snprintf(path, sizeof(path), "%s%s", benchSamplesRoot, e.path);
+      FILE *f = fopen(path, "wb");
+      if (!f) return false;
+      static const uint8_t header[44] = {};
+      fwrite(header, 1, sizeof(header), f);
+      fwrite(pcm, 2, e.frames, f);
+      fclose(f);
+    }
+  }
+  SampleBankHeader header = {SAMPLE_BANK_MAGIC, SAMPLE_BANK_VERSION, count, offset,
+                             crc32(entries, dataStart - sizeof(SampleBankHeader))};
+  memcpy(bank, &header, sizeof(header));
+  snprintf(flashPath, flashPathSize, "%s/flash.bin", benchSamplesRoot);
+  benchSamplesWrite(flashPath, image, SAMPLE_BANK_OFFSET + ((offset + 4095) & ~4095u));
+  return hal::sim::flashAttachFile(flashPath);
+}
+
+static void benchSamplesCleanup(const char *flashPath) {
+  hal::sim::reset(1);
+  unlink(flashPath);
+  for (uint16_t id = BENCH_FLASH_SAMPLES; id < BENCH_FLASH_SAMPLES + BENCH_SD_SAMPLES; id++) {
+    char path[192];
+    snprintf(path, sizeof(path), "%s/fondo%u.wav", benchSamplesRoot, id);
+    unlink(path);
+  }
+  rmdir(benchSamplesRoot);
+}
+
+template <typename F>
+double benchSamplesNs(uint32_t iterations, F body) {
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < iterations; i++) body(i);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+// Índice con distribución de Zipf (peso 1/(k+1)) entre n
+static uint16_t benchZipf(Prng &rng, uint16_t n) {
+  static double cumulative[BENCH_SD_SAMPLES];
+  static bool ready = false;
+  if (!ready) {
+    double total = 0;
+    for (uint16_t k = 0; k < BENCH_SD_SAMPLES; k++) cumulative[k] = (total += 1.0 / (k + 1));
+    for (uint16_t k = 0; k < BENCH_SD_SAMPLES; k++) cumulative[k] /= total;
+    ready = true;
+  }
+  double u = prngNext(rng) / 4294967296.0;
+  for (uint16_t k = 0; k < n; k++) {
+    if (u < cumulative[k]) return k;
+  }
+  return n - 1;
+}
+
+void runSamplesBenchmark() {
+  const uint32_t iterations = 200000;
+  char flashPath[192];
+  hal::sim::reset(1);
+  if (!mkdtemp(benchSamplesRoot) || !benchSamplesBuild(flashPath, sizeof(flashPath))) {
+    printf("No se pudo crear el banco de prueba\n");
+    return;
+  }
+  hal::sim::setSdRoot(benchSamplesRoot);
+  synthInit();
+  samplesBegin(0, true);
+  const uint16_t firstSd = BENCH_FLASH_SAMPLES;
+  volatile uint32_t sink = 0;
+
+  printf("=== Benchmark de muestras (%u en flash, %u en la SD, %u huecos de caché) ===\n",
+         BENCH_FLASH_SAMPLES, BENCH_SD_SAMPLES, SAMPLE_CACHE_SLOTS);
+  printf("disparo                                   ms de SD antes de sonar   ns de CPU\n");
+
+  // Antes: abrir el WAV, leer la cabecera y el primer buffer en cada disparo
+  static uint8_t buffer[2048];
+  hal::SdFile file;
+  uint64_t startUs = hal::sim::state().nowMicros;
+  double openNs = benchSamplesNs(1000, [&](uint32_t i) {
+    file.open(sampleBank.entries[firstSd + i % BENCH_SD_SAMPLES].path);
+    file.read(buffer, 44);
+    file.read(buffer, sizeof(buffer));
+    file.close();
+    sink = sink + buffer[0];
+  });
+  double openMs = (hal::sim::state().nowMicros - startUs) / 1000.0 / 1000;
+  printf("abrir el WAV en la SD (wav_player)        %10.2f            %10.0f\n", openMs, openNs);
+
+  double flashNs = benchSamplesNs(iterations, [&](uint32_t i) {
+    samplePlay(i % BENCH_FLASH_SAMPLES, 16384, hal::millis());
+    synthDrainEvents();
+  });
+  printf("banco en flash proyectada                 %10.2f            %10.1f\n", 0.0, flashNs);
+
+  samplePreload(firstSd, hal::millis());
+  while (samplesLoading()) samplesTask(hal::millis());
+  uint32_t opens = hal::sim::state().sdOpens;
+  double hitNs = benchSamplesNs(iterations, [&](uint32_t i) {
+    samplePlay(firstSd, 16384, hal::millis());
+    synthDrainEvents();
+  });
+  printf("caché en PSRAM (acierto)                  %10.2f            %10.1f\n", 0.0, hitNs);
+  if (hal::sim::state().sdOpens != opens) printf("AVISO: los aciertos abrieron archivos\n");
+
+  // Tasa de aciertos: disparos cada 0,2-2 s con unas muestras más frecuentes
+  samplesBegin(hal::millis(), true);
+  Prng rng;
+  prngSeed(rng, 7, 0);
+  const uint32_t triggers = 20000;
+  uint64_t loadUs = 0;
+  for (uint32_t t = 0; t < triggers; t++) {
+    hal::sim::advance(prngRange(rng, 200, 2000));
+    samplePlay(firstSd + benchZipf(rng, BENCH_SD_SAMPLES), 16384, hal::millis());
+    synthDrainEvents();
+    uint64_t before = hal::sim::state().nowMicros;
+    while (samplesLoading()) samplesTask(hal::millis());
+    loadUs += hal::sim::state().nowMicros - before;
+  }
+  printf("\nZipf sobre %u muestras de la SD, %lu disparos:\n", BENCH_SD_SAMPLES, (unsigned long)triggers);
+  printf("  aciertos %lu, fallos %lu (%u%% aciertos), expulsiones %lu, tarde %lu\n",
+         (unsigned long)samples.hits, (unsigned long)samples.misses, sampleCacheHitPercent(),
+         (unsigned long)samples.evictions, (unsigned long)samples.late);
+  printf("  SD por disparo: %.1f ms de carga en la tarea de muestras, fuera del audio (antes %.2f ms de espera en cada disparo)\n",
+         loadUs / 1000.0 / triggers, openMs);
+  printf("  PSRAM de la caché: %lu KB\n",
+         (unsigned long)(SAMPLE_CACHE_SLOTS * SAMPLE_CACHE_SLOT_FRAMES * sizeof(int16_t) / 1024));
+
+  benchSamplesCleanup(flashPath);
+  (void)sink;
+}
+
+#endif // BENCH_SAMPLES_H
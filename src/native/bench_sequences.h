@@ -0,0 +1,83 @@
+/*
+ * bench_sequences.h - Coste de cambiar de secuencia en la ruta caliente
+ *
+ * Compara generar la secuencia con random() nota a nota (lo que hacía
+ * generateRandomSequence), generarla con el Markov de sequences.h y
+ * cogerla ya hecha de la reserva de la voz, que es lo que hace ahora
+ * voiceGenerateSequence. El relleno de la reserva se mide aparte: va en
+ * el tiempo libre del loop. En el host random() es un xorshift; el de
+ * Arduino en el ESP32 lee el generador por hardware y divide, así que la
+ * primera línea se queda corta respecto al firmware.
+ */
+
+#ifndef BENCH_SEQUENCES_H
+#define BENCH_SEQUENCES_H
+
+#include <chrono>
+#include <stdio.h>
+
+#include "piezo_bugs.h"
+
+template <typename F>
+double benchSequencesNs(uint32_t iterations, F body) {
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < iterations; i++) body(i);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+void runSequencesBenchmark() {
+  const uint32_t iterations = 1000000;
+  hal::sim::reset(1);
+  sequencePoolsBegin(1);
+  NoteIndex notes[MAX_SEQUENCE_LENGTH];
+  uint8_t positions[MAX_SEQUENCE_LENGTH];
+  uint8_t length = 0;
+  volatile uint32_t sink = 0;
+
+  printf("=== Benchmark de secuencias (araña, hasta 16 notas) ===\n");
+  printf("operación                                  ns/secuencia\n");
+
+  // Antes: un random() por nota con la nota raíz aplicada al generar
+  double before = benchSequencesNs(iterations, [&](uint32_t i) {
+    uint8_t size = scaleSize(currentScale);
+    length = hal::random(3, 17);
+    for (uint8_t n = 0; n < length; n++) {
+      notes[n] = scaleNote(currentScale, rootNoteOffset, hal::random(3 * size, 7 * size));
+    }
+    sink = sink + notes[0];
+  });
+  printf("random() por nota (antes)                  %10.1f\n", before);
+
+  double markov = benchSequencesNs(iterations, [&](uint32_t i) {
+    sequenceGenerate(sequencePools.rng[0], SPIDER, currentScale, positions, length);
+    sequenceToNotes(positions, length, currentScale, rootNoteOffset, notes);
+    sink = sink + notes[0];
+  });
+  printf("Markov con flujo PCG32 por voz             %10.1f\n", markov);
+
+  // Coger de la reserva; rellenarla queda fuera del tiempo medido
+  double takeNs = 0;
+  double refillNs = 0;
+  uint32_t taken = 0;
+  while (taken < iterations) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint8_t s = 0; s < SEQUENCE_POOL_SIZE; s++) sequencePoolFill(0, SPIDER);
+    auto filled = std::chrono::steady_clock::now();
+    for (uint8_t s = 0; s < SEQUENCE_POOL_SIZE; s++) {
+      sequencePoolTake(0, SPIDER, notes, length);
+      sink = sink + notes[0];
+    }
+    auto end = std::chrono::steady_clock::now();
+    refillNs += std::chrono::duration<double, std::nano>(filled - start).count();
+    takeNs += std::chrono::duration<double, std::nano>(end - filled).count();
+    taken += SEQUENCE_POOL_SIZE;
+  }
+  printf("coger de la reserva (ruta caliente)        %10.1f\n", takeNs / taken);
+  printf("rellenar la reserva (loop en espera)       %10.1f\n", refillNs / taken);
+  printf("Fallos de reserva: %lu de %lu\n", (unsigned long)sequencePools.misses,
+         (unsigned long)(sequencePools.taken + sequencePools.misses));
+  printf("Cambiar de secuencia cuesta %.1fx menos que antes\n", before / (takeNs / taken));
+}
+
+#endif // BENCH_SEQUENCES_H
@@ -0,0 +1,56 @@
+/*
+ * bench_synth.h - Coste del sintetizador I2S según el número de voces
+ *
+ * Para cada número de voces dispara notas largas con los timbres de los
+ * tres insectos y renderiza 10 s de audio. El presupuesto de un bloque es
+ * su duración (SYNTH_BLOCK_FRAMES / SYNTH_SAMPLE_RATE); la carga es el
+ * porcentaje de ese presupuesto que consume el render en el host.
+ */
+
+#ifndef BENCH_SYNTH_H
+#define BENCH_SYNTH_H
+
+#include <chrono>
+#include <stdio.h>
+
+#include "synth.h"
+
+void runSynthBenchmark() {
+  const uint8_t voiceCounts[] = {1, 2, 4, 8, 16, 24, 32};
+  const uint32_t blocks = 10UL * SYNTH_SAMPLE_RATE / SYNTH_BLOCK_FRAMES;
+  const double blockBudgetUs = 1e6 * SYNTH_BLOCK_FRAMES / SYNTH_SAMPLE_RATE;
+  static int16_t block[SYNTH_BLOCK_FRAMES * 2];
+
+  printf("=== Benchmark del sintetizador (%lu Hz, bloques de %u muestras = %.0f us) ===\n",
+         (unsigned long)SYNTH_SAMPLE_RATE, (unsigned)SYNTH_BLOCK_FRAMES, blockBudgetUs);
+  printf("voces  us/bloque  ns/muestra/voz  carga  recortes\n");
+
+  for (uint8_t n : voiceCounts) {
+    hal::sim::reset(1);
+    synthInit();
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t b = 0; b < blocks; b++) {
+      // Renueva las notas antes de que terminen para mantener n voces sonando
+      if (b % 64 == 0) {
+        for (uint8_t v = 0; v < n; v++) {
+          uint16_t freq = noteFrequency(scaleNote(SCALE_INSECT_PENTATONIC, 0, hal::random(0, 35)));
+          synthNoteOn(v, (InsectType)(v % INSECT_TYPE_COUNT), freq, 2000);
+        }
+      }
+      synthRender(block, SYNTH_BLOCK_FRAMES);
+      hal::audioWrite(block, SYNTH_BLOCK_FRAMES);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double us = std::chrono::duration<double, std::micro>(elapsed).count() / blocks;
+
+    printf("%5u  %9.2f  %14.2f  %4.1f%%  %8lu\n",
+           (unsigned)n,
+           us,
+           1000.0 * us / ((double)SYNTH_BLOCK_FRAMES * n),
+           100.0 * us / blockBudgetUs,
+           (unsigned long)synth.clippedSamples);
+  }
+}
+
+#endif // BENCH_SYNTH_H
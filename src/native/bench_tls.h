@@ -0,0 +1,77 @@
+/*
+ * bench_tls.h - Conexión con InfluxDB: handshakes y latencia al primer byte
+ *
+ * Diez minutos de consultas de forestData (una cada 10 s) contra el
+ * servidor TLS sustituto de hal_native.h, con sus latencias modeladas:
+ * - Como el sketch anterior: conexión nueva y handshake completo en cada
+ *   consulta
+ * - Keep-alive con un servidor que cierra a los 5 s de inactividad, sin
+ *   y con reanudación de sesión
+ * - Keep-alive con un servidor que mantiene la conexión 60 s
+ *
+ * Para medir en el dispositivo, tests/forestData/tls_standin.py hace de
+ * servidor TLS real en la red local.
+ */
+
+#ifndef BENCH_TLS_H
+#define BENCH_TLS_H
+
+#include <stdio.h>
+#include <string>
+
+#include "influx_client.h"
+
+void runTlsBenchmark() {
+  struct Scenario {
+    const char *name;
+    bool newConnectionEachQuery;
+    bool tickets;
+    uint32_t idleTimeoutMs;
+  };
+  const Scenario scenarios[] = {
+    {"cierre por consulta", true, true, 60000},
+    {"keep-alive 5 s, sin tickets", false, false, 5000},
+    {"keep-alive 5 s, reanudación", false, true, 5000},
+    {"keep-alive 60 s", false, true, 60000},
+  };
+  const int queries = 60;
+  static const uint8_t pin[1][hal::TLS_PIN_SIZE] = {{0x0b, 0x9f, 0xa5, 0xa5}};
+  std::string response = influxRecordedResponse(1);
+
+  printf("=== Benchmark de la conexión con InfluxDB (%d consultas cada 10 s, modelo de red en hal_native.h) ===\n",
+         queries);
+  printf("escenario                     conexiones  completos  reanudados  1er byte medio  1er byte máx  en handshakes\n");
+
+  for (const Scenario &scenario : scenarios) {
+    hal::sim::reset(1);
+    hal::sim::TlsServer &server = hal::sim::tlsServer();
+    memcpy(server.spki, pin[0], sizeof(server.spki));
+    server.tickets = scenario.tickets;
+    server.idleTimeoutMs = scenario.idleTimeoutMs;
+    hal::sim::tlsSetResponse(response.data(), (uint32_t)response.size());
+
+    static InfluxClient client;
+    client = InfluxClient();
+    influxClientBegin(client, "db.sinfoniabiotica.xyz", 443, "bosque", "token", nullptr, pin, 1);
+    influxClientSetQuery(client, "from(bucket: \"biodata\") |> range(start: -1h) |> last()");
+
+    TreeData data;
+    uint64_t handshakeUs = 0;
+    for (int q = 0; q < queries; q++) {
+      if (scenario.newConnectionEachQuery) {
+        client.link.stop();
+        client.link.forgetSession();
+      }
+      uint32_t handshakes = client.link.handshakeCount();
+      influxClientQuery(client, data);
+      if (client.link.handshakeCount() != handshakes) handshakeUs += client.link.handshakeMicros();
+      hal::sim::advance(10000);
+    }
+    printf("%-28s  %10lu  %9lu  %10lu  %11.1f ms  %9.1f ms  %10.2f s%s\n", scenario.name,
+           (unsigned long)server.accepts, (unsigned long)server.fullHandshakes,
+           (unsigned long)server.resumedHandshakes, influxClientMeanTtfbUs(client) / 1000.0,
+           client.maxTtfbUs / 1000.0, handshakeUs / 1e6, client.failures ? "  (fallos)" : "");
+  }
+}
+
+#endif // BENCH_TLS_H
@@ -0,0 +1,52 @@
+/*
+ * bench_voices.h - Escalado del coste de voicesUpdate() con el número de voces
+ *
+ * Para cada número de voces simula una hora a pasos de 1 ms (3,6 M
+ * llamadas) y mide el coste real por llamada y por voz procesada.
+ */
+
+#ifndef BENCH_VOICES_H
+#define BENCH_VOICES_H
+
+#include <chrono>
+#include <stdio.h>
+
+#include "voices.h"
+
+void runVoiceBenchmark() {
+  const uint8_t voiceCounts[] = {1, 2, 4, 8, 12, 16};
+  const uint32_t simulatedMs = 3600UL * 1000;
+
+  printf("=== Benchmark de voces (1 h simulada, paso 1 ms) ===\n");
+  printf("voces  ns/loop  voces vencidas/s  ns/voz vencida  notas\n");
+
+  for (uint8_t n : voiceCounts) {
+    hal::sim::reset(1);
+    voicesClear();
+    for (uint8_t v = 0; v < n; v++) {
+      voiceAdd(defaultVoiceType(v), PIEZO_PINS[v % PIEZO_PIN_COUNT]);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t t = 0; t < simulatedMs; t++) {
+      voicesUpdate(hal::millis());
+      hal::sim::advance(1);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+
+    uint32_t notes = 0;
+    for (uint8_t p = 0; p < PIEZO_PIN_COUNT; p++) {
+      notes += hal::sim::piezo(PIEZO_PINS[p]).toneCount;
+    }
+    double processed = voices.processed;
+    printf("%5u  %7.2f  %16.1f  %14.1f  %5lu\n",
+           (unsigned)n,
+           ns / simulatedMs,
+           processed / (simulatedMs / 1000.0),
+           processed > 0 ? ns / processed : 0.0,
+           (unsigned long)notes);
+  }
+}
+
+#endif // BENCH_VOICES_H
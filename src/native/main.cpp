@@ -0,0 +1,222 @@
+/*
+ * main.cpp (native) - PiezoBugs como ejecutable de Linux
+ *
+ * Ejecuta piezoBugsSetup()/piezoBugsLoop() sobre el reloj virtual de la
+ * HAL y mide el coste real de cada iteración del loop.
+ *
+ * Uso: pio run -e native && .pio/build/native/program [segundos] [semilla] [-v]
+ *   segundos: tiempo simulado (por defecto 600)
+ *   semilla:  semilla del generador aleatorio (por defecto 1)
+ *   -v:       mostrar la salida Serial del firmware
+ * Con -DENABLE_PROFILER=1 termina con el volcado del perfilador (profile.h),
+ * que se lee con tools/profile_decode.py
+ *
+ * Benchmarks: program bench-voices | bench-synth | bench-neopixel | bench-influx |
+ *             bench-tls | bench-poll | bench-params | bench-log | bench-sequences |
+ *             bench-samples | bench-playlist | bench-prefetch | bench-resampler
+ *
+ * Prueba de larga duración (soak.h):
+ *   program soak [días] [semilla] [-t traza.bin] [-s inicio_ms]
+ *   días:   tiempo simulado (por defecto 60, más allá del desborde de millis())
+ *   -t:     traza binaria completa, para tools/soak_decode.py
+ *   -s:     millis() al arrancar (por defecto 1 h antes del desborde)
+ *   Termina con código 1 si algún invariante falla.
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "piezo_bugs.h"
+#include "bench_voices.h"
+#include "bench_synth.h"
+#include "bench_neopixel.h"
+#include "bench_influx.h"
+#include "bench_tls.h"
+#include "bench_poll.h"
+#include "bench_params.h"
+#include "bench_log.h"
+#include "bench_sequences.h"
+#include "bench_samples.h"
+#include "bench_playlist.h"
+#include "bench_prefetch.h"
+#include "bench_resampler.h"
+#include "soak.h"
+
+static int runSoak(int argc, char **argv) {
+  SoakConfig config = {};
+  config.seed = 1;
+  config.durationMs = 60ULL * SOAK_DAY_MS;
+  config.startMs = SOAK_DEFAULT_START_MS;
+  config.pressMeanMs = SOAK_PRESS_MEAN_MS;
+  config.treeMeanMs = SOAK_TREE_MEAN_MS;
+  const char *tracePath = nullptr;
+
+  int positional = 0;
+  for (int i = 2; i < argc; i++) {
+    if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      tracePath = argv[++i];
+    } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      config.startMs = (uint32_t)strtoul(argv[++i], nullptr, 0);
+    } else if (positional == 0) {
+      config.durationMs = (uint64_t)(strtod(argv[i], nullptr) * SOAK_DAY_MS);
+      positional++;
+    } else {
+      config.seed = (uint32_t)strtoul(argv[i], nullptr, 10);
+    }
+  }
+  if (tracePath) {
+    config.trace = fopen(tracePath, "wb");
+    if (!config.trace) {
+      fprintf(stderr, "No se puede crear %s\n", tracePath);
+      return 2;
+    }
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  soakBegin(config);
+  uint32_t reportedDays = 0;
+  while (!soakDone()) {
+    soakStep();
+    if (soak.days != reportedDays) {
+      reportedDays = soak.days;
+      fprintf(stderr, "Día %lu: %lu violaciones\n", (unsigned long)reportedDays, (unsigned long)soak.violations);
+    }
+  }
+  double wallS = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (config.trace) fclose(config.trace);
+
+  printf("=== PiezoBugs soak ===\n");
+  printf("Tiempo simulado:   %.2f días desde millis()=%lu (semilla %lu)\n", soak.elapsedMs / (double)SOAK_DAY_MS,
+         (unsigned long)config.startMs, (unsigned long)config.seed);
+  printf("Tiempo real:       %.1f s (x%.0f)\n", wallS, wallS > 0 ? soak.elapsedMs / 1000.0 / wallS : 0.0);
+  soakPrintReport(stdout);
+  return soak.violations ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "bench-voices") == 0) {
+    runVoiceBenchmark();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "bench-synth") == 0) {
+    runSynthBenchmark();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "bench-neopixel") == 0) {
+    runNeopixelBenchmark();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "bench-influx") == 0) {
+    runInfluxBenchmark();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "bench-tls") == 0) {
+    runTlsBenchmark();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "bench-poll") == 0) {
+    runPollBenchmark();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "bench-params") == 0) {
+    runParamsBenchmark();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "bench-log") == 0) {
+    runLogBenchmark();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "bench-sequences") == 0) {
+    runSequencesBenchmark();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "bench-samples") == 0) {
+    runSamplesBenchmark();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "bench-playlist") == 0) {
+    runPlaylistBenchmark();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "bench-prefetch") == 0) {
+    runPrefetchBenchmark();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "bench-resampler") == 0) {
+    runResamplerBenchmark();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "soak") == 0) {
+    return runSoak(argc, argv);
+  }
+
+  uint32_t seconds = 600;
+  uint32_t seed = 1;
+  bool verbose = false;
+
+  int positional = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-v") == 0) {
+      verbose = true;
+    } else if (positional == 0) {
+      seconds = (uint32_t)strtoul(argv[i], nullptr, 10);
+      positional++;
+    } else {
+      seed = (uint32_t)strtoul(argv[i], nullptr, 10);
+    }
+  }
+
+  hal::sim::reset(seed);
+  hal::sim::setSerialEnabled(verbose);
+  piezoBugsSetup();
+
+  const uint32_t endTime = hal::millis() + seconds * 1000UL;
+  uint64_t loops = 0;
+  auto start = std::chrono::steady_clock::now();
+  while (hal::millis() < endTime) {
+    piezoBugsLoop();
+    loops++;
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  double wallUs = std::chrono::duration<double, std::micro>(elapsed).count();
+
+
+  printf("=== PiezoBugs nativo ===\n");
+  printf("Tiempo simulado:   %lu s (semilla %lu)\n", (unsigned long)seconds, (unsigned long)seed);
+  printf("Iteraciones loop:  %llu\n", (unsigned long long)loops);
+  printf("Coste por loop:    %.3f us (host)\n", loops ? wallUs / loops : 0.0);
+  for (uint8_t p = 0; p < PIEZO_PIN_COUNT; p++) {
+    const hal::sim::PiezoState &piezo = hal::sim::piezo(PIEZO_PINS[p]);
+    printf("Piezo %u (GPIO%u):   %lu tone / %lu noTone\n", (unsigned)(p + 1), (unsigned)PIEZO_PINS[p],
+           (unsigned long)piezo.toneCount, (unsigned long)piezo.noToneCount);
+  }
+  printf("Voces procesadas:  %lu\n", (unsigned long)voices.processed);
+  printf("Neopixel show():   %lu (%lu descartados con el aro ocupado)\n",
+         (unsigned long)neoFrame.shows, (unsigned long)neoFrame.busySkips);
+  printf("Compositor:        %lu frames, %lu por límite de fps, %lu sobre presupuesto\n",
+         (unsigned long)ledCompositor.frames, (unsigned long)ledCompositor.rateSkips,
+         (unsigned long)ledCompositor.overBudgetFrames);
+  for (uint8_t l = 0; l < ledCompositor.layerCount; l++) {
+    printf("Capa %-12s %lu evaluaciones, %lu saltadas, coste máx %lu us\n", ledCompositor.name[l],
+           (unsigned long)ledCompositor.runs[l], (unsigned long)ledCompositor.budgetSkips[l],
+           (unsigned long)ledCompositor.maxUs[l]);
+  }
+  printf("Despertares:       %lu (%.1f/s)\n", (unsigned long)scheduler.wakeups,
+         seconds ? (double)scheduler.wakeups / seconds : 0.0);
+  printf("Sueño ligero:      %lu pausas, %.1f%% del tiempo\n", (unsigned long)scheduler.lightSleeps,
+         seconds ? 100.0 * scheduler.lightSleepMs / (seconds * 1000.0) : 0.0);
+  printf("Pausas delay():    %lu, %.1f%% del tiempo\n", (unsigned long)scheduler.idleSleeps,
+         seconds ? 100.0 * scheduler.idleMs / (seconds * 1000.0) : 0.0);
+  for (uint8_t t = 0; t < scheduler.taskCount; t++) {
+    const SchedulerTask &task = scheduler.tasks[t];
+    printf("Tarea %-9s %lu ejecuciones, retraso máx %lu ms\n", task.name,
+           (unsigned long)task.runs, (unsigned long)task.maxLateMs);
+  }
+#if ENABLE_PROFILER
+  hal::sim::setSerialEnabled(true);
+  profileDump();
+#endif
+  return 0;
+}
@@ -4,67 +4,121 @@
  * 
  * Características:
  * - WiFiManager para configuración fácil de red
- * - Conexión HTTPS a InfluxDB Cloud
- * - Consultas cada 10 segundos
- * - Parsing de datos de sensores de árboles
+ * - Conexión HTTPS persistente (keep-alive) a InfluxDB Cloud con
+ *   reanudación de sesión TLS y pin del certificado (influx_client.h)
+ * - Consultas incrementales desde el último _time recibido, con un
+ *   intervalo de 5 s a 2 min que sigue a la actividad bioeléctrica
+ *   (influx_poll.h)
+ * - Parsing de datos de sensores de árboles con el parser incremental
+ *   de piezoBugs/influx_csv.h (sin String ni límite de tamaño)
+ * - WiFi y consultas en una tarea del núcleo 0 (net_task.h): el loop solo
+ *   recoge la última instantánea y nunca espera a la red. Todo se imprime
+ *   desde el loop: la tarea deja el resumen de cada consulta en un buzón
+ * - Últimas lecturas guardadas en flash (tree_cache.h): al arrancar hay
+ *   datos del árbol al instante, aunque no haya red
+ * - Sin String ni reservas de memoria tras setup(); informe del heap cada
+ *   minuto (heap_monitor.h) por el registro diferido (log.h)
  */
 
 #include <WiFiManager.h>
-#include <HTTPClient.h>
-#include <ArduinoJson.h>
-#include <WiFiClientSecure.h>
+#include "net_task.h"
+#include "heap_monitor.h"
 
 // 🔐 Importar configuración sensible desde archivo externo
 // ⚠️  VERIFICAR que secrets.h existe y está en .gitignore
 #include "secrets.h"
-
-// Configuración de timing
-const unsigned long QUERY_INTERVAL = 10000; // 10 segundos
-unsigned long lastQueryTime = 0;
+#include "influx_tls.h"
 
 // WiFiManager
 WiFiManager wm;
 
-// Cliente HTTPS
-WiFiClientSecure client;
+// Cliente HTTPS persistente (una conexión para todas las consultas) y
+// marca de agua con intervalo adaptativo; los usa solo la tarea de red
+InfluxClient &influx = netTask.client;
+InfluxPoller &poller = netTask.poller;
+
+// Última instantánea recibida de la tarea de red (TreeData en tree_data.h)
+TreeData currentTreeData;
 
-// Variables para datos del árbol
-struct TreeData {
-  float humidity = 0.0;
-  float temperature = 0.0;
-  float bioelectrical_activity = 0.0;
-  float light_level = 0.0;
-  unsigned long timestamp = 0;
-  bool data_valid = false;
-} currentTreeData;
+// Resumen de una consulta, copiado por la tarea de red para que el loop lo
+// imprima: así las líneas de las dos tareas no se mezclan en la consola
+struct FetchReport {
+  bool ok;
+  bool emptyResponse;        // Respuesta válida pero sin filas nuevas
+  bool newHandshake;
+  bool handshakeResumed;
+  bool verifyFailed;         // Pines que no coinciden desde el último resumen
+  uint32_t fetchMs;
+  uint32_t handshakeUs;
+  uint32_t bytes;
+  uint16_t status;
+  uint32_t rows;
+  uint32_t ttfbUs;
+  uint32_t handshakes;
+  uint32_t resumedHandshakes;
+  uint32_t queries;
+  uint32_t meanTtfbUs;
+  float rate;
+  uint32_t intervalMs;
+  uint32_t totalBytes;
+  char query[INFLUX_QUERY_MAX];
+  TreeData data;
+};
+
+// Buzón de un solo resumen: la tarea lo llena si está vacío y el loop lo
+// vacía al imprimirlo. Si el loop aún no ha leído el anterior, el nuevo se
+// descarta (y se cuenta)
+FetchReport fetchReport;
+std::atomic<bool> fetchReportReady(false);
+std::atomic<uint32_t> fetchReportsLost(0);
 
 void setup() {
   Serial.begin(115200);
   Serial.println("\n=== Forest Data - InfluxDB Test ===");
   
-  // Configurar cliente HTTPS
-  client.setInsecure(); // Para pruebas, en producción usar certificados
+  // Configurar cliente HTTPS: cabecera de la petición construida una vez
+  if (!influxClientBegin(influx, INFLUX_HOST, INFLUX_PORT, INFLUXDB_ORG, INFLUXDB_TOKEN,
+                         INFLUX_ROOT_CA, INFLUX_PINS, INFLUX_PIN_COUNT)) {
+    Serial.println("Error: No se pudo preparar el cliente de InfluxDB");
+  }
+  // Últimos datos guardados: se muestran ya y las consultas los completan
+  if (treeCacheBegin(treeCache)) {
+    Serial.print("Caché en flash: ");
+    Serial.print(treeCache.recovered);
+    Serial.print(" lecturas en el sector en uso");
+    if (treeCache.torn) {
+      Serial.print(", ");
+      Serial.print(treeCache.torn);
+      Serial.print(" a medias descartadas");
+    }
+    Serial.println();
+  } else if (!treeCache.ready) {
+    Serial.println("Aviso: sin partición de datos, no se guardarán lecturas");
+  }
+  netTaskBegin("biodata", reportFetch);
   
   // Configurar WiFiManager
   setupWiFiManager();
   
+  // WiFi y consultas en el núcleo 0 a partir de aquí
+  netTaskStart();
+  
   Serial.println("Sistema iniciado correctamente");
   Serial.println("Esperando datos de InfluxDB...");
+  heapMonitorBegin();
 }
 
 void loop() {
-  // Verificar conexión WiFi
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("WiFi desconectado, intentando reconectar...");
-    WiFi.reconnect();
-    delay(5000);
-    return;
-  }
-  
-  // Consultar InfluxDB cada 10 segundos
-  if (millis() - lastQueryTime >= QUERY_INTERVAL) {
-    fetchTreeData();
-    lastQueryTime = millis();
+  // Portal de configuración (si está abierto); no bloquea. Mientras está
+  // abierto la tarea de red no intenta reconectar
+  wm.process();
+  netTask.wifiHold.store(wm.getConfigPortalActive());
+  
+  // Recoger datos nuevos de la tarea de red, si los hay
+  treeSlotRead(netTask.slot, currentTreeData);
+  if (fetchReportReady.load(std::memory_order_acquire)) {
+    printFetch(fetchReport);
+    fetchReportReady.store(false, std::memory_order_release);
   }
   
   // Mostrar datos actuales cada 5 segundos
@@ -74,6 +128,13 @@ void loop() {
     lastDisplayTime = millis();
   }
   
+  // Memoria libre y fragmentación cada HEAP_REPORT_MS
+  static uint32_t nextHeapReport = millis() + HEAP_REPORT_MS;
+  if (deadlineReached(nextHeapReport, millis())) {
+    nextHeapReport = heapMonitorTask(millis());
+  }
+  logDrain(LOG_DRAIN_MAX);
+  
   delay(100);
 }
 
@@ -83,12 +144,15 @@ void setupWiFiManager() {
   wm.setConnectTimeout(20); // 20 segundos para conectar
   wm.setAPStaticIPConfig(IPAddress(192,168,4,1), IPAddress(192,168,4,1), IPAddress(255,255,255,0));
   
+  // Sin credenciales el portal queda abierto y lo atiende wm.process()
+  // desde el loop; las reconexiones las lleva la tarea de red
+  wm.setConfigPortalBlocking(false);
+  
   // Intentar conectar con credenciales guardadas
   if (!wm.autoConnect("ESP32-ForestData")) {
     Serial.println("No se pudo conectar a WiFi");
-    Serial.println("Configuración fallida, reiniciando...");
-    delay(3000);
-    ESP.restart();
+    Serial.println("Portal de configuración abierto en la red \"ESP32-ForestData\"");
+    return;
   }
   
   Serial.println("WiFi conectado exitosamente!");
@@ -98,207 +162,155 @@ void setupWiFiManager() {
   Serial.println(WiFi.SSID());
 }
 
-void fetchTreeData() {
-  Serial.println("\n--- Consultando InfluxDB ---");
-  Serial.println("Intentando conectar a: db.sinfoniabiotica.xyz:443");
-  
-  if (!client.connect("db.sinfoniabiotica.xyz", 443)) {
-    Serial.println("Error: No se pudo conectar a InfluxDB");
-    Serial.println("Verifica la conexión a internet y la URL");
-    return;
-  }
-  
-  Serial.println("Conexión HTTPS establecida exitosamente");
-  
-  // Construir query para obtener los datos más recientes
-  String query = "from(bucket: \"biodata\") |> range(start: -1h) |> last()";
-  Serial.println("Query: " + query);
-  
-  // Construir request HTTP
-  String httpRequest = "POST /api/v2/query?org=" + String(INFLUXDB_ORG) + " HTTP/1.1\r\n";
-  httpRequest += "Host: db.sinfoniabiotica.xyz\r\n";
-  httpRequest += "Authorization: Token " + String(INFLUXDB_TOKEN) + "\r\n";
-  httpRequest += "Content-Type: application/vnd.flux\r\n";
-  httpRequest += "Content-Length: " + String(query.length()) + "\r\n";
-  httpRequest += "Connection: close\r\n\r\n";
-  httpRequest += query;
-  
-  Serial.println("Enviando request HTTP...");
-  Serial.println("Organización: " + String(INFLUXDB_ORG));
-  
-  // Enviar request
-  client.print(httpRequest);
-  Serial.println("Request enviado, esperando respuesta...");
-  
-  // Leer respuesta
-  String response = "";
-  unsigned long timeout = millis() + 10000; // 10 segundos timeout
-  int bytesReceived = 0;
-  
-  Serial.println("Leyendo respuesta...");
-  while (client.connected() && millis() < timeout) {
-    if (client.available()) {
-      char c = client.read();
-      response += c;
-      bytesReceived++;
-      
-      // Mostrar progreso cada 100 bytes
-      if (bytesReceived % 100 == 0) {
-        Serial.print(".");
-      }
-      
-      // Limitar tamaño de respuesta
-      if (response.length() > 5000) {
-        Serial.println("\nRespuesta demasiado grande, truncando...");
-        break;
-      }
-    }
-  }
-  
-  Serial.println("\nConexión cerrada");
-  client.stop();
-  
-  if (response.length() == 0) {
-    Serial.println("Error: No se recibió respuesta de InfluxDB");
-    Serial.println("Timeout alcanzado o conexión perdida");
-    return;
-  }
-  
-  Serial.println("Respuesta recibida (" + String(response.length()) + " bytes)");
-  Serial.println("Primeros 200 caracteres de la respuesta:");
-  Serial.println(response.substring(0, min(200, (int)response.length())));
-  
-  // Parsear respuesta
-  parseInfluxResponse(response);
+// Milisegundos con un decimal, a partir de microsegundos
+void printMillis(uint32_t micros) {
+  Serial.print(micros / 1000.0, 1);
+  Serial.print(" ms");
 }
 
-void parseInfluxResponse(String response) {
-  // Buscar el cuerpo de la respuesta (después de headers HTTP)
-  int bodyStart = response.indexOf("\r\n\r\n");
-  if (bodyStart == -1) {
-    Serial.println("Error: No se encontró el cuerpo de la respuesta");
-    return;
-  }
-  
-  String body = response.substring(bodyStart + 4);
-  
-  // Verificar si hay datos
-  if (body.length() < 10) {
-    Serial.println("No hay datos disponibles en InfluxDB");
-    currentTreeData.data_valid = false;
+void printTreeData(const TreeData &data) {
+  Serial.print("Humedad: ");
+  Serial.print(data.humidity);
+  Serial.println("%");
+  Serial.print("Temperatura: ");
+  Serial.print(data.temperature);
+  Serial.println("°C");
+  Serial.print("Actividad bioeléctrica: ");
+  Serial.println(data.bioelectrical_activity);
+  Serial.print("Nivel de luz: ");
+  Serial.println(data.light_level);
+}
+
+// Se llama desde la tarea de red tras cada consulta: copia en el buzón
+// lo que imprimirá el loop. Los datos de la consulta están en netTask.data
+void reportFetch(bool ok) {
+  static uint32_t handshakes = 0;
+  static uint32_t verifyFailures = 0;
+  if (fetchReportReady.load(std::memory_order_acquire)) {
+    fetchReportsLost.fetch_add(1, std::memory_order_relaxed);
     return;
   }
-  
-  Serial.println("Datos CSV recibidos:");
-  Serial.println(body);
-  
-  // Parsear datos CSV de InfluxDB
-  // Formato: _result,_table,_start,_stop,_time,_value,_field,_measurement
-  parseCSVData(body);
+  FetchReport &r = fetchReport;
+  r.ok = ok;
+  r.emptyResponse = !ok && influxParserComplete(influx.parser);
+  r.newHandshake = influx.link.handshakeCount() != handshakes;
+  handshakes = influx.link.handshakeCount();
+  r.handshakeResumed = influx.link.resumed();
+  r.handshakeUs = influx.link.handshakeMicros();
+  r.verifyFailed = influx.link.verifyFailureCount() != verifyFailures;
+  verifyFailures = influx.link.verifyFailureCount();
+  r.fetchMs = netTask.lastFetchMs.load();
+  r.bytes = influx.parser.bytes;
+  r.status = influx.parser.status;
+  r.rows = influx.parser.rows;
+  r.ttfbUs = influx.lastTtfbUs;
+  r.handshakes = influx.link.handshakeCount();
+  r.resumedHandshakes = influx.link.resumedCount();
+  r.queries = influx.queries;
+  r.meanTtfbUs = influxClientMeanTtfbUs(influx);
+  r.rate = poller.lastRate;
+  r.intervalMs = poller.intervalMs;
+  r.totalBytes = (uint32_t)(influx.bytesSent + influx.bytesReceived);
+  strncpy(r.query, poller.query, sizeof(r.query) - 1);
+  r.query[sizeof(r.query) - 1] = '\0';
+  r.data = netTask.data;
+  fetchReportReady.store(true, std::memory_order_release);
 }
 
-void parseCSVData(String csvData) {
-  // Resetear datos
-  currentTreeData.data_valid = false;
-  currentTreeData.timestamp = millis();
-  
-  // Dividir en líneas
-  int lineStart = 0;
-  int lineEnd = csvData.indexOf('\n');
-  
-  // Saltar primera línea (headers)
-  if (lineEnd != -1) {
-    lineStart = lineEnd + 1;
-    lineEnd = csvData.indexOf('\n', lineStart);
+// Todo con Serial.print: un String por línea fragmentaría el heap
+void printFetch(const FetchReport &r) {
+  Serial.print("\n--- Consulta a InfluxDB (");
+  Serial.print(INFLUX_HOST);
+  Serial.print(":");
+  Serial.print(INFLUX_PORT);
+  Serial.print(") en ");
+  Serial.print(r.fetchMs);
+  Serial.println(" ms ---");
+  Serial.print("Query: ");
+  Serial.println(r.query);
+  if (fetchReportsLost.load() > 0) {
+    Serial.print("(");
+    Serial.print(fetchReportsLost.exchange(0));
+    Serial.println(" consultas anteriores sin resumen)");
   }
   
-  // Procesar cada línea de datos
-  while (lineEnd != -1) {
-    String line = csvData.substring(lineStart, lineEnd);
-    if (line.length() > 10) { // Ignorar líneas vacías
-      parseDataLine(line);
-    }
-    
-    lineStart = lineEnd + 1;
-    lineEnd = csvData.indexOf('\n', lineStart);
+  if (r.newHandshake) {
+    Serial.print("Handshake TLS ");
+    Serial.print(r.handshakeResumed ? "reanudado" : "completo");
+    Serial.print(" en ");
+    printMillis(r.handshakeUs);
+    Serial.println();
   }
   
-  // Procesar última línea
-  if (lineStart < csvData.length()) {
-    String line = csvData.substring(lineStart);
-    if (line.length() > 10) {
-      parseDataLine(line);
-    }
+  if (r.emptyResponse) {
+    // Respuesta válida pero vacía: los datos actuales siguen siendo los últimos
+    Serial.print("Sin datos nuevos (");
+    Serial.print(r.bytes);
+    Serial.print(" bytes), próxima consulta en ");
+    Serial.print(r.intervalMs / 1000.0, 1);
+    Serial.println(" s");
+    return;
   }
   
-  currentTreeData.data_valid = true;
-  Serial.println("Datos parseados exitosamente");
-}
-
-void parseDataLine(String line) {
-  // Dividir línea por comas
-  int fieldStart = 0;
-  int fieldEnd = line.indexOf(',');
-  int fieldIndex = 0;
-  
-  String measurement = "";
-  String field = "";
-  String value = "";
-  
-  while (fieldEnd != -1 && fieldIndex < 8) {
-    String fieldValue = line.substring(fieldStart, fieldEnd);
-    
-    switch (fieldIndex) {
-      case 6: // _field
-        field = fieldValue;
-        break;
-      case 7: // _measurement
-        measurement = fieldValue;
-        break;
-      case 5: // _value
-        value = fieldValue;
-        break;
+  if (!r.ok) {
+    if (r.verifyFailed) {
+      Serial.println("Error: El certificado del servidor no coincide con los pines");
+    }
+    if (r.bytes == 0) {
+      Serial.println("Error: No se recibió respuesta de InfluxDB");
+      Serial.println("Verifica la conexión a internet y la URL");
+    } else {
+      Serial.print("No hay datos disponibles en InfluxDB (HTTP ");
+      Serial.print(r.status);
+      Serial.println(")");
     }
-    
-    fieldStart = fieldEnd + 1;
-    fieldEnd = line.indexOf(',', fieldStart);
-    fieldIndex++;
+    return;
   }
   
-  // Procesar último campo
-  if (fieldIndex == 7 && fieldStart < line.length()) {
-    measurement = line.substring(fieldStart);
-  }
+  Serial.print("Respuesta recibida (");
+  Serial.print(r.bytes);
+  Serial.print(" bytes, ");
+  Serial.print(r.rows);
+  Serial.print(" filas), primer byte en ");
+  printMillis(r.ttfbUs);
+  Serial.println();
+  Serial.print("Conexión: ");
+  Serial.print(r.handshakes);
+  Serial.print(" handshakes (");
+  Serial.print(r.resumedHandshakes);
+  Serial.print(" reanudados) en ");
+  Serial.print(r.queries);
+  Serial.print(" consultas, primer byte medio ");
+  printMillis(r.meanTtfbUs);
+  Serial.println();
+  Serial.print("Variación bioeléctrica ");
+  Serial.print(r.rate, 5);
+  Serial.print("/min, próxima consulta en ");
+  Serial.print(r.intervalMs / 1000.0, 1);
+  Serial.print(" s (");
+  Serial.print(r.totalBytes);
+  Serial.println(" bytes en total)");
   
-  // Asignar valores según el campo
-  if (field == "humidity" && value.length() > 0) {
-    currentTreeData.humidity = value.toFloat();
-    Serial.println("Humedad: " + String(currentTreeData.humidity) + "%");
-  }
-  else if (field == "temperature" && value.length() > 0) {
-    currentTreeData.temperature = value.toFloat();
-    Serial.println("Temperatura: " + String(currentTreeData.temperature) + "°C");
-  }
-  else if (field == "bioelectrical_activity" && value.length() > 0) {
-    currentTreeData.bioelectrical_activity = value.toFloat();
-    Serial.println("Actividad bioeléctrica: " + String(currentTreeData.bioelectrical_activity));
-  }
-  else if (field == "light_level" && value.length() > 0) {
-    currentTreeData.light_level = value.toFloat();
-    Serial.println("Nivel de luz: " + String(currentTreeData.light_level));
-  }
+  Serial.println("Datos parseados exitosamente");
+  printTreeData(r.data);
 }
 
 void displayCurrentData() {
   Serial.println("\n=== DATOS ACTUALES DEL ÁRBOL ===");
-  Serial.println("Timestamp: " + String(currentTreeData.timestamp));
-  Serial.println("Datos válidos: " + String(currentTreeData.data_valid ? "SÍ" : "NO"));
+  Serial.print("Timestamp: ");
+  Serial.print(currentTreeData.timestamp);
+  Serial.print(" (");
+  Serial.print(netTask.slot.published.load());
+  Serial.print(" instantáneas, consulta más lenta ");
+  Serial.print(netTask.maxFetchMs.load());
+  Serial.print(" ms, ");
+  Serial.print(netTask.wifiDrops.load());
+  Serial.println(" caídas del WiFi)");
+  Serial.print("Datos válidos: ");
+  Serial.println(currentTreeData.data_valid ? "SÍ" : "NO");
   
   if (currentTreeData.data_valid) {
-    Serial.println("Humedad: " + String(currentTreeData.humidity) + "%");
-    Serial.println("Temperatura: " + String(currentTreeData.temperature) + "°C");
-    Serial.println("Actividad bioeléctrica: " + String(currentTreeData.bioelectrical_activity));
-    Serial.println("Nivel de luz: " + String(currentTreeData.light_level));
+    printTreeData(currentTreeData);
   } else {
     Serial.println("No hay datos disponibles");
   }
@@ -48,4 +48,11 @@ const char* INFLUXDB_BUCKET = "tu_bucket";
 // Certificados SSL personalizados (si necesarios)
 // const char* SSL_CERT = "-----BEGIN CERTIFICATE-----\n...\n-----END CERTIFICATE-----";
 
+// Servidor y pines TLS (ver influx_tls.h). Para medir contra
+// tls_standin.py en la red local:
+// #define INFLUX_HOST "192.168.1.50"
+// #define INFLUX_PORT 8443
+// #define INFLUX_PIN_LIST {0x6e, 0xea, ...}   // Pin que imprime tls_standin.py
+// #define INFLUX_ROOT_CA nullptr              // Certificado autofirmado: solo el pin
+
 #endif // SECRETS_H
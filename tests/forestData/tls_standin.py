@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+"""
+tls_standin.py - Servidor HTTPS sustituto de InfluxDB para medir forestData
+
+Responde a POST /api/v2/query con CSV chunked, como InfluxDB 2.x, sobre
+una serie sintética con un punto por campo cada 10 s desde que arranca.
+Entiende las consultas de influx_poll.h: last() de la última hora,
+range(start: time(v: N)) con tail(n: M) y keep(columns: ...). Mantiene
+las conexiones HTTP/1.1 abiertas y acepta reanudar sesiones TLS 1.2. Por cada conexión registra si el handshake fue
+completo o reanudado y cuánto tardó, y por cada petición el tiempo hasta
+enviar la respuesta y su tamaño. Al arrancar imprime el pin SPKI (SHA-256) de su
+certificado, listo para INFLUX_PINS en forestData.
+
+Uso:
+  openssl req -x509 -newkey ec -pkeyopt ec_paramgen_curve:P-256 -nodes \\
+      -keyout standin.key -out standin.pem -days 365 -subj "/CN=<ip del PC>"
+  python3 tls_standin.py --cert standin.pem --key standin.key [--port 8443] [--idle 60]
+"""
+
+import argparse
+import hashlib
+import math
+import re
+import socket
+import ssl
+import threading
+import time
+
+FIELDS = ["humidity", "temperature", "bioelectrical_activity", "light_level"]
+PERIOD_S = 10
+
+stats_lock = threading.Lock()
+stats = {"connections": 0, "full": 0, "resumed": 0, "requests": 0}
+
+
+def value(field, t):
+    """Serie sintética: bioelectrical_activity oscila 5 de cada 15 minutos"""
+    if field == "bioelectrical_activity":
+        if (t // 300) % 3 == 2:
+            return 0.0041 + 0.002 * math.sin(t / 180.0 * 2 * math.pi)
+        return 0.0041 + (t % 7) * 0.000001
+    return {"humidity": 61.8, "temperature": 17.43, "light_level": 1184.0}[field] + (t % 5) * 0.01
+
+
+def query_response(query, epoch):
+    """CSV de los puntos que pide la consulta Flux"""
+    newest = int(time.time()) // PERIOD_S * PERIOD_S
+    first = newest
+    start = re.search(r"time\(v: (\d+)\)", query)
+    if start:
+        first = max(epoch, -(-int(start.group(1)) // 10**9 // PERIOD_S) * PERIOD_S)
+        tail = re.search(r"tail\(n: (\d+)\)", query)
+        if tail:
+            first = max(first, newest - (int(tail.group(1)) - 1) * PERIOD_S)
+    keep = "keep(columns" in query
+    body = ""
+    for table, field in enumerate(FIELDS):
+        if first > newest:
+            break
+        body += (",result,table,_time,_value,_field\r\n" if keep else
+                 ",result,table,_start,_stop,_time,_value,_field,_measurement,tree\r\n")
+        for t in range(first, newest + 1, PERIOD_S):
+            stamp = time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime(t))
+            if keep:
+                body += ",_result,%d,%s,%.6g,%s\r\n" % (table, stamp, value(field, t), field)
+            else:
+                body += (",_result,%d,%s,%s,%s,%.6g,%s,sensors,roble\r\n" %
+                         (table, stamp, stamp, stamp, value(field, t), field))
+        body += "\r\n"
+    data = body.encode()
+    response = (b"HTTP/1.1 200 OK\r\n"
+                b"Content-Type: text/csv; charset=utf-8\r\n"
+                b"X-Influxdb-Version: v2.7.1\r\n"
+                b"Transfer-Encoding: chunked\r\n\r\n")
+    if data:
+        response += b"%x\r\n" % len(data) + data + b"\r\n"
+    return response + b"0\r\n\r\n"
+
+
+def der_element(buf, pos):
+    """(inicio del contenido, fin) del elemento DER que empieza en pos"""
+    length = buf[pos + 1]
+    start = pos + 2
+    if length & 0x80:
+        count = length & 0x7F
+        length = int.from_bytes(buf[start:start + count], "big")
+        start += count
+    return start, start + length
+
+
+def spki_pin(cert_pem):
+    """SHA-256 del SubjectPublicKeyInfo del certificado"""
+    der = ssl.PEM_cert_to_DER_cert(open(cert_pem).read())
+    tbs, _ = der_element(der, 0)
+    pos, _ = der_element(der, tbs)
+    if der[pos] == 0xA0:                     # version [0]
+        pos = der_element(der, pos)[1]
+    for _ in range(5):                       # serial, firma, emisor, validez, sujeto
+        pos = der_element(der, pos)[1]
+    return hashlib.sha256(der[pos:der_element(der, pos)[1]]).digest()
+
+
+def read_request(conn, pending):
+    """Una petición completa (cabeceras + Content-Length) o None al cerrar"""
+    while b"\r\n\r\n" not in pending:
+        data = conn.recv(4096)
+        if not data:
+            return (None, ""), b""
+        pending += data
+    head, rest = pending.split(b"\r\n\r\n", 1)
+    length = 0
+    close = False
+    for line in head.split(b"\r\n")[1:]:
+        name, _, value = line.partition(b":")
+        if name.strip().lower() == b"content-length":
+            length = int(value.strip())
+        if name.strip().lower() == b"connection" and value.strip().lower() == b"close":
+            close = True
+    while len(rest) < length:
+        data = conn.recv(4096)
+        if not data:
+            return (None, ""), b""
+        rest += data
+    return (close, rest[:length].decode(errors="replace")), rest[length:]
+
+
+def serve(context, sock, addr, idle, epoch):
+    start = time.monotonic()
+    try:
+        conn = context.wrap_socket(sock, server_side=True)
+    except (ssl.SSLError, OSError) as error:
+        print("%s  handshake fallido: %s" % (addr[0], error))
+        sock.close()
+        return
+    handshake_ms = (time.monotonic() - start) * 1000
+    resumed = conn.session_reused
+    with stats_lock:
+        stats["connections"] += 1
+        stats["resumed" if resumed else "full"] += 1
+        print("%s  handshake %-10s %7.1f ms  (conexiones %d: %d completos, %d reanudados)" %
+              (addr[0], "reanudado" if resumed else "completo", handshake_ms,
+               stats["connections"], stats["full"], stats["resumed"]))
+    conn.settimeout(idle)
+    pending = b""
+    served = 0
+    try:
+        while True:
+            (close, query), pending = read_request(conn, pending)
+            if close is None:
+                break
+            received = time.monotonic()
+            response = query_response(query, epoch)
+            conn.sendall(response)
+            served += 1
+            with stats_lock:
+                stats["requests"] += 1
+            print("%s  petición %d en la conexión, %d bytes en %.2f ms (%s)" %
+                  (addr[0], served, len(response), (time.monotonic() - received) * 1000,
+                   "incremental" if "time(v:" in query else "last()"))
+            if close:
+                break
+    except (socket.timeout, ssl.SSLError, OSError):
+        pass
+    print("%s  conexión cerrada tras %d peticiones" % (addr[0], served))
+    conn.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("--cert", required=True)
+    parser.add_argument("--key", required=True)
+    parser.add_argument("--port", type=int, default=8443)
+    parser.add_argument("--idle", type=float, default=60.0, help="segundos de inactividad antes de cerrar")
+    args = parser.parse_args()
+
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    # TLS 1.2: como el cliente, para que la sesión se pueda reanudar con ticket
+    context.maximum_version = ssl.TLSVersion.TLSv1_2
+    context.load_cert_chain(args.cert, args.key)
+
+    pin = spki_pin(args.cert)
+    print("Pin SPKI (SHA-256) para INFLUX_PINS:")
+    print("  {" + ", ".join("0x%02x" % b for b in pin) + "}")
+    print("Escuchando en el puerto %d, cierre por inactividad a los %.0f s" % (args.port, args.idle))
+
+    epoch = int(time.time()) // PERIOD_S * PERIOD_S
+    listener = socket.create_server(("", args.port))
+    while True:
+        sock, addr = listener.accept()
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        threading.Thread(target=serve, args=(context, sock, addr, args.idle, epoch), daemon=True).start()
+
+
+if __name__ == "__main__":
+    main()
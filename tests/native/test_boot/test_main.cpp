@@ -0,0 +1,99 @@
+/*
+ * test_boot - Pruebas nativas del arranque por etapas (boot.h)
+ *
+ * En el reloj virtual solo cuentan las esperas: setup() no debe esperar
+ * nada, y la primera luz y el primer sonido deben llegar antes de
+ * BOOT_TARGET_MS.
+ *
+ * Ejecutar con: pio test -e native -f test_boot
+ */
+
+#include <unity.h>
+
+#include "piezo_bugs.h"
+
+static void runUntil(uint32_t ms) {
+  while (hal::millis() < ms) piezoBugsLoop();
+}
+
+void setUp() {
+  hal::sim::reset(1);
+}
+
+void tearDown() {}
+
+void test_stages_and_events_are_recorded_once() {
+  bootBegin();
+  int8_t a = bootStageBegin("a");
+  hal::sim::advanceMicros(1500);
+  bootStageEnd(a);
+  int8_t b = bootStageBegin("b", true);
+  bootMark(BOOT_FIRST_SOUND);
+  hal::sim::advance(5);
+  bootMark(BOOT_FIRST_SOUND);
+  TEST_ASSERT_EQUAL_UINT32(1500, bootTimeline.stages[a].durationUs);
+  TEST_ASSERT_EQUAL_UINT32(1500, bootTimeline.eventUs[BOOT_FIRST_SOUND]);
+  TEST_ASSERT_FALSE(bootSettled());
+
+  bootMark(BOOT_FIRST_LIGHT);
+  TEST_ASSERT_FALSE(bootSettled());   // b sigue de fondo
+  bootStageEnd(b);
+  bootStageEnd(b);                    // Solo cuenta la primera vez
+  TEST_ASSERT_EQUAL_UINT32(5000, bootTimeline.stages[b].durationUs);
+  TEST_ASSERT_TRUE(bootSettled());
+  TEST_ASSERT_TRUE(bootReportWhenSettled());
+
+  // Etapas de más no rompen nada
+  for (uint8_t i = bootTimeline.count; i < BOOT_MAX_STAGES; i++) bootStageBegin("x");
+  TEST_ASSERT_EQUAL(-1, bootStageBegin("de más"));
+  bootStageEnd(-1);
+}
+
+void test_setup_does_not_wait() {
+  piezoBugsSetup();
+  // Antes había un delay(2000) y la tabla de la escala entera por la UART
+  TEST_ASSERT_TRUE(hal::millis() < 5);
+  TEST_ASSERT_FALSE(bootTimeline.reported);
+  for (uint8_t i = 0; i < bootTimeline.count; i++) {
+    if (!bootTimeline.stages[i].background) TEST_ASSERT_TRUE(bootTimeline.stages[i].done);
+  }
+}
+
+void test_light_and_sound_within_target() {
+  piezoBugsSetup();
+  runUntil(BOOT_TARGET_MS);
+  TEST_ASSERT_TRUE(bootEventSeen(BOOT_FIRST_SOUND));
+  TEST_ASSERT_TRUE(bootEventSeen(BOOT_FIRST_LIGHT));
+  TEST_ASSERT_TRUE(bootTimeline.eventUs[BOOT_FIRST_SOUND] <= BOOT_TARGET_MS * 1000);
+  TEST_ASSERT_TRUE(bootTimeline.eventUs[BOOT_FIRST_LIGHT] <= BOOT_TARGET_MS * 1000);
+  TEST_ASSERT_TRUE(hal::sim::piezo(PIEZO_PINS[0]).toneCount > 0);
+}
+
+void test_help_prints_in_background_then_report() {
+  piezoBugsSetup();
+  runUntil(3000);
+  TEST_ASSERT_EQUAL(-1, bootInfoStage);
+  TEST_ASSERT_TRUE(bootTimeline.reported);
+  TEST_ASSERT_TRUE(bootSettled());
+
+  // La ayuda se reparte en pasos de BOOT_INFO_LINE_MS sin retrasar al resto
+  const BootStage &help = bootTimeline.stages[bootTimeline.count - 1];
+  TEST_ASSERT_TRUE(help.background);
+  TEST_ASSERT_TRUE(help.durationUs >= (PIEZO_BUGS_HELP_LINES + PIEZO_BUGS_DETAIL_LINES) * BOOT_INFO_LINE_MS * 1000);
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.tasks[voicesTaskId].maxLateMs);
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.tasks[neopixelTaskId].maxLateMs);
+
+  // Después queda aparcada
+  uint32_t runs = scheduler.tasks[bootTaskId].runs;
+  runUntil(60000);
+  TEST_ASSERT_EQUAL_UINT32(runs, scheduler.tasks[bootTaskId].runs);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_stages_and_events_are_recorded_once);
+  RUN_TEST(test_setup_does_not_wait);
+  RUN_TEST(test_light_and_sound_within_target);
+  RUN_TEST(test_help_prints_in_background_then_report);
+  return UNITY_END();
+}
@@ -0,0 +1,189 @@
+/*
+ * test_buttons - Pruebas nativas del subsistema de botones (buttons.h)
+ *
+ * En el host setDigital() dispara la interrupción del pin al instante, así
+ * que la tarea se puede comprobar vuelta a vuelta con el reloj virtual.
+ *
+ * Ejecutar con: pio test -e native -f test_buttons
+ */
+
+#include <unity.h>
+
+#include "piezo_bugs.h"
+
+static const uint8_t BUTTON_2 = 1;   // Índices en BUTTON_PINS
+static const uint8_t BUTTON_4 = 3;
+
+static uint8_t popAll(ButtonEvent *events, uint8_t max) {
+  uint8_t n = 0;
+  ButtonEvent e;
+  while (buttonPop(e)) {
+    if (n < max) events[n] = e;
+    n++;
+  }
+  return n;
+}
+
+static void runFor(uint32_t ms) {
+  uint32_t end = hal::millis() + ms;
+  while (deadlineBefore(hal::millis(), end)) piezoBugsLoop();
+}
+
+void setUp() {
+  hal::sim::reset(1);
+}
+
+void tearDown() {}
+
+void test_interrupt_runs_the_task_at_once() {
+  piezoBugsSetup();
+  runFor(1000);
+  uint32_t runs = scheduler.tasks[buttonsTaskId].runs;
+
+  hal::sim::setDigital(BUTTON_2_PIN, LOW);
+  TEST_ASSERT_EQUAL_UINT32(1, hal::sim::state().isrWakes);
+  uint32_t pressedAt = hal::millis();
+  piezoBugsLoop();
+  TEST_ASSERT_EQUAL_UINT32(runs + 1, scheduler.tasks[buttonsTaskId].runs);
+  TEST_ASSERT_TRUE(buttonInput.buttons[BUTTON_2].isPressed);
+  TEST_ASSERT_EQUAL_UINT32(pressedAt, buttonInput.buttons[BUTTON_2].pressStartTime);
+
+  // Al soltar, el tipo del insecto 1 cambia en la misma vuelta
+  runFor(100);
+  InsectType before = voiceType(0);
+  hal::sim::setDigital(BUTTON_2_PIN, HIGH);
+  piezoBugsLoop();
+  TEST_ASSERT_TRUE(voiceType(0) != before);
+  TEST_ASSERT_EQUAL_UINT32(1, buttonInput.events);
+}
+
+void test_bounces_give_one_press() {
+  buttonsBegin(0);
+  hal::sim::setDigital(BUTTON_2_PIN, LOW);
+  uint32_t next = buttonsUpdate(0);
+  TEST_ASSERT_EQUAL_UINT32(BUTTON_DEBOUNCE_MS, next);
+
+  // Rebotes dentro de BUTTON_DEBOUNCE_MS: no se leen
+  hal::sim::setDigital(BUTTON_2_PIN, HIGH);
+  buttonsUpdate(10);
+  hal::sim::setDigital(BUTTON_2_PIN, LOW);
+  buttonsUpdate(20);
+  TEST_ASSERT_TRUE(buttonInput.buttons[BUTTON_2].isPressed);
+  TEST_ASSERT_EQUAL_UINT8(1, buttonInput.buttons[BUTTON_2].consecutivePresses);
+
+  // Soltar con rebote: una sola corta
+  hal::sim::setDigital(BUTTON_2_PIN, HIGH);
+  buttonsUpdate(200);
+  hal::sim::setDigital(BUTTON_2_PIN, LOW);
+  buttonsUpdate(210);
+  hal::sim::setDigital(BUTTON_2_PIN, HIGH);
+  buttonsUpdate(260);
+
+  ButtonEvent events[4];
+  TEST_ASSERT_EQUAL_UINT8(1, popAll(events, 4));
+  TEST_ASSERT_EQUAL_UINT8(BUTTON_2, events[0].button);
+  TEST_ASSERT_EQUAL_UINT8(PRESS_SHORT, events[0].type);
+  TEST_ASSERT_EQUAL_UINT32(200, events[0].ms);
+}
+
+void test_long_press_fires_while_held() {
+  buttonsBegin(0);
+  hal::sim::setDigital(BUTTON_2_PIN, LOW);
+  buttonsUpdate(100);
+  // Nada que leer hasta que se cumpla la larga (salvo el ADC)
+  uint32_t next = buttonsUpdate(100 + BUTTON_DEBOUNCE_MS);
+  TEST_ASSERT_TRUE(deadlineBefore(next, 100 + LONG_PRESS_TIME + 1));
+
+  ButtonEvent events[4];
+  buttonsUpdate(100 + LONG_PRESS_TIME - 1);
+  TEST_ASSERT_EQUAL_UINT8(0, popAll(events, 4));
+  buttonsUpdate(100 + LONG_PRESS_TIME);
+  TEST_ASSERT_EQUAL_UINT8(1, popAll(events, 4));
+  TEST_ASSERT_EQUAL_UINT8(PRESS_LONG, events[0].type);
+
+  // Al soltar no hay corta, y la siguiente no cuenta como doble
+  hal::sim::setDigital(BUTTON_2_PIN, HIGH);
+  buttonsUpdate(3000);
+  TEST_ASSERT_EQUAL_UINT8(0, popAll(events, 4));
+  hal::sim::setDigital(BUTTON_2_PIN, LOW);
+  buttonsUpdate(3100);
+  hal::sim::setDigital(BUTTON_2_PIN, HIGH);
+  buttonsUpdate(3200);
+  TEST_ASSERT_EQUAL_UINT8(1, popAll(events, 4));
+  TEST_ASSERT_EQUAL_UINT8(PRESS_SHORT, events[0].type);
+}
+
+void test_double_press_follows_a_short_one() {
+  buttonsBegin(0);
+  const uint32_t times[] = {1000, 1100, 1250, 1350, 2000, 2100};
+  for (uint8_t i = 0; i < 6; i++) {
+    hal::sim::setDigital(BUTTON_6_PIN, i % 2 ? HIGH : LOW);
+    buttonsUpdate(times[i]);
+  }
+  ButtonEvent events[4];
+  TEST_ASSERT_EQUAL_UINT8(3, popAll(events, 4));
+  TEST_ASSERT_EQUAL_UINT8(PRESS_SHORT, events[0].type);
+  TEST_ASSERT_EQUAL_UINT8(PRESS_DOUBLE, events[1].type);
+  TEST_ASSERT_EQUAL_UINT8(PRESS_SHORT, events[2].type);   // Fuera de la ventana
+}
+
+void test_adc_button_is_sampled_at_its_rate() {
+  buttonsBegin(0);
+  TEST_ASSERT_EQUAL_UINT32(BUTTON_ADC_POLL_MS, buttonsUpdate(0));
+
+  hal::sim::setAnalog(BUTTON_1_PIN, 0);
+  buttonsUpdate(10);   // Despertada por otro motivo: el ADC no se lee
+  TEST_ASSERT_FALSE(buttonInput.buttons[BUTTON_ADC].isPressed);
+  buttonsUpdate(BUTTON_ADC_POLL_MS);
+  TEST_ASSERT_TRUE(buttonInput.buttons[BUTTON_ADC].isPressed);
+
+  hal::sim::setAnalog(BUTTON_1_PIN, 4095);
+  buttonsUpdate(2 * BUTTON_ADC_POLL_MS);
+  ButtonEvent events[2];
+  TEST_ASSERT_EQUAL_UINT8(1, popAll(events, 2));
+  TEST_ASSERT_EQUAL_UINT8(BUTTON_ADC, events[0].button);
+  TEST_ASSERT_EQUAL_UINT8(PRESS_SHORT, events[0].type);
+}
+
+void test_pin_shared_with_neopixel_is_polled() {
+  buttonsBegin(0);
+  TEST_ASSERT_FALSE(buttonInput.interrupt[BUTTON_4]);
+  TEST_ASSERT_TRUE(buttonInput.interrupt[BUTTON_2]);
+  TEST_ASSERT_NULL(hal::sim::state().pinChange[BUTTON_4_PIN]);
+
+  hal::sim::setDigital(BUTTON_4_PIN, LOW);
+  TEST_ASSERT_FALSE(buttonsTakeWake());
+  buttonsUpdate(BUTTON_ADC_POLL_MS);
+  TEST_ASSERT_TRUE(buttonInput.buttons[BUTTON_4].isPressed);
+}
+
+void test_idle_buttons_only_wake_for_the_adc() {
+  piezoBugsSetup();
+  runFor(60000);
+  uint32_t runs = scheduler.tasks[buttonsTaskId].runs;
+  TEST_ASSERT_TRUE(runs <= 60000 / BUTTON_ADC_POLL_MS + 1);
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.tasks[buttonsTaskId].maxLateMs);
+  TEST_ASSERT_EQUAL_UINT32(0, buttonInput.events);
+}
+
+void test_full_queue_drops_and_counts() {
+  buttonsBegin(0);
+  for (uint8_t i = 0; i < BUTTON_QUEUE_SIZE + 3; i++) buttonPost(BUTTON_2, PRESS_SHORT, i);
+  TEST_ASSERT_EQUAL_UINT32(3, buttonInput.dropped);
+  ButtonEvent events[BUTTON_QUEUE_SIZE];
+  TEST_ASSERT_EQUAL_UINT8(BUTTON_QUEUE_SIZE, popAll(events, BUTTON_QUEUE_SIZE));
+  TEST_ASSERT_EQUAL_UINT32(0, events[0].ms);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_interrupt_runs_the_task_at_once);
+  RUN_TEST(test_bounces_give_one_press);
+  RUN_TEST(test_long_press_fires_while_held);
+  RUN_TEST(test_double_press_follows_a_short_one);
+  RUN_TEST(test_adc_button_is_sampled_at_its_rate);
+  RUN_TEST(test_pin_shared_with_neopixel_is_polled);
+  RUN_TEST(test_idle_buttons_only_wake_for_the_adc);
+  RUN_TEST(test_full_queue_drops_and_counts);
+  return UNITY_END();
+}
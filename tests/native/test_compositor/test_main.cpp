@@ -0,0 +1,149 @@
+/*
+ * test_compositor - Pruebas nativas del compositor de capas LED
+ *
+ * Ejecutar con: pio test -e native -f test_compositor
+ */
+
+#include <unity.h>
+
+#include "piezo_bugs.h"
+
+static const unsigned long CYCLE_TIME = NEOPIXEL_COUNT * LED_INTERVAL;
+// LED 0 a brillo completo, el resto apagados o a brillo completo
+static const unsigned long FULL_TIME = CYCLE_TIME * 3 + 2 * LED_INTERVAL;
+
+static uint32_t slowLayerUs;
+
+// Capa que consume tiempo del reloj virtual como si fuera cara
+static void slowLayer(uint8_t ring, unsigned long ringTime, LedPixel *out) {
+  hal::sim::advanceMicros(slowLayerUs);
+}
+
+static void redFlashLayer(uint8_t ring, unsigned long ringTime, LedPixel *out) {
+  out[0].r = 255 << 8;
+  out[0].a = 65535;
+}
+
+static void nextFrame(unsigned long t) {
+  hal::sim::advance(NEOPIXEL_FRAME_MS);
+  updateNeopixel(t);
+}
+
+void setUp() {
+  hal::sim::reset(1);
+  voicesClear();
+  initNeopixel();
+  slowLayerUs = 0;
+}
+
+void tearDown() {}
+
+void test_blend_modes() {
+  TEST_ASSERT_EQUAL_UINT16(1000, blendChannel(BLEND_NORMAL, 3000, 1000, 65535));
+  TEST_ASSERT_UINT16_WITHIN(1, 2000, blendChannel(BLEND_NORMAL, 3000, 1000, 32768));
+  TEST_ASSERT_EQUAL_UINT16(65535, blendChannel(BLEND_ADD, 60000, 60000, 65535));
+  TEST_ASSERT_EQUAL_UINT16(3000, blendChannel(BLEND_MAX, 3000, 1000, 65535));
+  TEST_ASSERT_EQUAL_UINT16(5000, blendChannel(BLEND_MAX, 3000, 5000, 65535));
+  TEST_ASSERT_UINT16_WITHIN(1, 30000, blendChannel(BLEND_MULTIPLY, 60000, 32768, 65535));
+  // Alfa 0: la capa de abajo queda intacta
+  TEST_ASSERT_EQUAL_UINT16(3000, blendChannel(BLEND_MULTIPLY, 3000, 0, 0));
+}
+
+void test_only_active_layers_are_evaluated() {
+  nextFrame(FULL_TIME);
+  nextFrame(FULL_TIME);
+  TEST_ASSERT_EQUAL_UINT32(2, ledCompositor.runs[neoWaveLayer]);
+  // Sin araña sonando ni tinte, sus capas no se evalúan
+  TEST_ASSERT_EQUAL_UINT32(0, ledCompositor.runs[neoSpiderLayer]);
+  TEST_ASSERT_EQUAL_UINT32(0, ledCompositor.runs[neoTintLayer]);
+
+  neopixelSetTint(255, 0, 0, 255);
+  nextFrame(FULL_TIME);
+  TEST_ASSERT_EQUAL_UINT32(1, ledCompositor.runs[neoTintLayer]);
+}
+
+void test_frame_rate_cap() {
+  updateNeopixel(FULL_TIME);
+  // Antes de 1/NEO_MAX_FPS (menos el margen) no se compone otro frame
+  hal::sim::advanceMicros(1000000UL / NEO_MAX_FPS - NEO_FRAME_JITTER_US - 1);
+  updateNeopixel(FULL_TIME + 1);
+  TEST_ASSERT_EQUAL_UINT32(1, ledCompositor.frames);
+  TEST_ASSERT_EQUAL_UINT32(1, ledCompositor.rateSkips);
+  hal::sim::advanceMicros(1);
+  updateNeopixel(FULL_TIME + 1);
+  TEST_ASSERT_EQUAL_UINT32(2, ledCompositor.frames);
+}
+
+void test_frame_task_jitter_does_not_drop_frames() {
+  // La tarea del aro a NEOPIXEL_FRAME_MS, despertando a veces 1 ms antes
+  for (uint32_t i = 0; i < 10; i++) {
+    updateNeopixel(FULL_TIME + i);
+    hal::sim::advance(i % 2 ? NEOPIXEL_FRAME_MS - 1 : NEOPIXEL_FRAME_MS + 1);
+  }
+  TEST_ASSERT_EQUAL_UINT32(10, ledCompositor.frames);
+  TEST_ASSERT_EQUAL_UINT32(0, ledCompositor.rateSkips);
+}
+
+void test_budget_skips_optional_layers_and_measures_cost() {
+  int slow = ledLayerAdd("lenta", slowLayer, BLEND_ADD);
+  int flash = ledLayerAdd("destello", redFlashLayer, BLEND_ADD);
+  slowLayerUs = NEO_FRAME_BUDGET_US + 500;
+
+  nextFrame(FULL_TIME);
+  TEST_ASSERT_EQUAL_UINT32(NEO_FRAME_BUDGET_US + 500, ledCompositor.lastUs[slow]);
+  TEST_ASSERT_EQUAL_UINT32(0, ledCompositor.runs[flash]);
+  TEST_ASSERT_EQUAL_UINT32(1, ledCompositor.budgetSkips[flash]);
+  TEST_ASSERT_EQUAL_UINT32(1, ledCompositor.overBudgetFrames);
+  // La base se pinta igualmente
+  TEST_ASSERT_EQUAL_UINT8(NEO_BRIGHTNESS, (pixels.getPixelColor(1) >> 8) & 0xFF);
+
+  // Dentro del presupuesto todas las capas se evalúan
+  slowLayerUs = 100;
+  nextFrame(FULL_TIME);
+  TEST_ASSERT_EQUAL_UINT32(1, ledCompositor.runs[flash]);
+  TEST_ASSERT_EQUAL_UINT32(NEO_FRAME_BUDGET_US + 500, ledCompositor.maxUs[slow]);
+  TEST_ASSERT_EQUAL_UINT32(NEO_BRIGHTNESS, (pixels.getPixelColor(0) >> 16) & 0xFF);
+}
+
+void test_tint_multiplies_the_wave() {
+  neopixelSetTint(0, 128, 0, 255);
+  nextFrame(FULL_TIME);
+  // LED 1 a brillo completo: verde a la mitad
+  TEST_ASSERT_UINT8_WITHIN(1, NEO_BRIGHTNESS / 2, (pixels.getPixelColor(1) >> 8) & 0xFF);
+
+  neopixelSetTint(255, 255, 255, 0);
+  nextFrame(FULL_TIME);
+  TEST_ASSERT_EQUAL_UINT8(NEO_BRIGHTNESS, (pixels.getPixelColor(1) >> 8) & 0xFF);
+}
+
+void test_spider_layer_whitens_leds_fading_in() {
+  voices.activeMask |= 1;
+  voices.typeMask[SPIDER] |= 1;
+  voices.mutedMask = 0;
+  // LED 2 empieza su fade in; LED 1 ya estaba encendido antes de la araña
+  nextFrame(FULL_TIME + LED_INTERVAL / 2);
+  TEST_ASSERT_EQUAL_UINT32(1, ledCompositor.runs[neoSpiderLayer]);
+  TEST_ASSERT_TRUE(ledWasWhite[0][2]);
+  TEST_ASSERT_FALSE(ledWasWhite[0][0]);
+  uint32_t led2 = pixels.getPixelColor(2);
+  TEST_ASSERT_EQUAL_UINT8((led2 >> 8) & 0xFF, (led2 >> 16) & 0xFF);
+  TEST_ASSERT_TRUE((led2 & 0xFF) > 0);
+
+  // Al callar la araña la capa se desactiva y se olvidan los LEDs blancos
+  voices.activeMask = 0;
+  nextFrame(FULL_TIME + LED_INTERVAL / 2);
+  TEST_ASSERT_FALSE(ledWasWhite[0][2]);
+  TEST_ASSERT_EQUAL_UINT32(0, pixels.getPixelColor(2) & 0xFF00FF);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_blend_modes);
+  RUN_TEST(test_only_active_layers_are_evaluated);
+  RUN_TEST(test_frame_rate_cap);
+  RUN_TEST(test_frame_task_jitter_does_not_drop_frames);
+  RUN_TEST(test_budget_skips_optional_layers_and_measures_cost);
+  RUN_TEST(test_tint_multiplies_the_wave);
+  RUN_TEST(test_spider_layer_whitens_leds_fading_in);
+  return UNITY_END();
+}
@@ -0,0 +1,118 @@
+/*
+ * test_hal - Pruebas nativas de la HAL y del motor PiezoBugs
+ *
+ * Ejecutar con: pio test -e native -f test_hal
+ */
+
+#include <unity.h>
+
+#include "piezo_bugs.h"
+
+// Ejecuta el loop durante ms de tiempo virtual (el planificador avanza el reloj)
+static void runFor(uint32_t ms) {
+  const uint32_t endTime = hal::millis() + ms;
+  while (deadlineBefore(hal::millis(), endTime)) {
+    piezoBugsLoop();
+  }
+}
+
+// Simula una pulsación de un botón digital con pull-up
+static void pressDigitalButton(uint8_t pin, uint32_t holdMs) {
+  hal::sim::setDigital(pin, LOW);
+  runFor(holdMs);
+  hal::sim::setDigital(pin, HIGH);
+  runFor(2 * BUTTON_ADC_POLL_MS);
+}
+
+void setUp() {
+  hal::sim::reset(1);
+  piezoBugsSetup();
+}
+
+void tearDown() {}
+
+void test_virtual_clock_only_moves_with_delay() {
+  uint32_t before = hal::millis();
+  TEST_ASSERT_EQUAL_UINT32(before, hal::millis());
+  hal::delay(25);
+  TEST_ASSERT_EQUAL_UINT32(before + 25, hal::millis());
+  hal::sim::advanceMicros(1500);
+  TEST_ASSERT_EQUAL_UINT32(before + 26, hal::millis());
+}
+
+void test_random_is_reproducible_for_same_seed() {
+  hal::sim::reset(1234);
+  long a = hal::random(0, 1000000);
+  long b = hal::random(0, 1000000);
+  hal::sim::reset(1234);
+  TEST_ASSERT_EQUAL(a, hal::random(0, 1000000));
+  TEST_ASSERT_EQUAL(b, hal::random(0, 1000000));
+}
+
+void test_setup_generates_valid_sequences() {
+  TEST_ASSERT_EQUAL(VOICE_COUNT, voices.count);
+  TEST_ASSERT_TRUE(voices.sequenceLength[0] >= 3 && voices.sequenceLength[0] <= 16);
+  TEST_ASSERT_TRUE(voices.sequenceLength[1] >= 3 && voices.sequenceLength[1] <= 8);
+  for (int i = 0; i < voices.sequenceLength[0]; i++) {
+    uint16_t hz = noteFrequency(voices.notes[0][i]);
+    TEST_ASSERT_TRUE(hz >= 523 && hz <= 8000);
+  }
+}
+
+void test_insects_play_tones_in_range() {
+  runFor(60000);
+  const hal::sim::PiezoState &p1 = hal::sim::piezo(PIEZO_1_PIN);
+  const hal::sim::PiezoState &p2 = hal::sim::piezo(PIEZO_2_PIN);
+  TEST_ASSERT_TRUE(p1.toneCount > 0);
+  TEST_ASSERT_TRUE(p2.toneCount > 0);
+  TEST_ASSERT_TRUE(p1.noToneCount > 0);
+}
+
+void test_short_press_button2_changes_insect1_type() {
+  TEST_ASSERT_EQUAL(SPIDER, voiceType(0));
+  pressDigitalButton(BUTTON_2_PIN, 100);
+  TEST_ASSERT_EQUAL(CRICKET, voiceType(0));
+}
+
+void test_long_press_button2_mutes_insect1() {
+  pressDigitalButton(BUTTON_2_PIN, LONG_PRESS_TIME + 50);
+  TEST_ASSERT_TRUE(voiceIsMuted(0));
+  TEST_ASSERT_EQUAL(SPIDER, voiceType(0));
+}
+
+void test_short_press_button1_changes_frequency_state() {
+  hal::sim::setAnalog(BUTTON_1_PIN, 0);
+  runFor(100);
+  hal::sim::setAnalog(BUTTON_1_PIN, 4095);
+  runFor(2 * BUTTON_ADC_POLL_MS);
+  TEST_ASSERT_EQUAL(FREQ_SLOW, currentState);
+  TEST_ASSERT_EQUAL(3, getFrequencyMultiplier());
+}
+
+void test_neopixel_wave_fades_in_green() {
+  // Inicio de un ciclo de la ola: LED 0 a mitad de su fade in
+  const unsigned long cycleTime = NEOPIXEL_COUNT * LED_INTERVAL;
+  voiceToggleMute(0);
+  hal::sim::setMillis(cycleTime * 10 + FADE_IN_TIME / 2);
+  updateNeopixel(hal::millis());
+
+  // El aro recibe el byte final: verde escalado por NEO_BRIGHTNESS y la gamma
+  uint32_t color = pixels.getPixelColor(0);
+  uint8_t g = (color >> 8) & 0xFF;
+  TEST_ASSERT_EQUAL_UINT8(0, (color >> 16) & 0xFF);
+  TEST_ASSERT_TRUE(g > 0 && g < NEO_BRIGHTNESS / 2);
+  TEST_ASSERT_EQUAL_UINT8(255, pixels.getBrightness());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_virtual_clock_only_moves_with_delay);
+  RUN_TEST(test_random_is_reproducible_for_same_seed);
+  RUN_TEST(test_setup_generates_valid_sequences);
+  RUN_TEST(test_insects_play_tones_in_range);
+  RUN_TEST(test_short_press_button2_changes_insect1_type);
+  RUN_TEST(test_long_press_button2_mutes_insect1);
+  RUN_TEST(test_short_press_button1_changes_frequency_state);
+  RUN_TEST(test_neopixel_wave_fades_in_green);
+  return UNITY_END();
+}
@@ -0,0 +1,201 @@
+/*
+ * test_heap - Pruebas nativas del estado estable sin heap (heap_monitor.h)
+ *
+ * Se sustituyen malloc/free (glibc) y new/delete para contar las reservas:
+ * tras piezoBugsSetup() el loop, los botones, los datos del árbol y el
+ * vaciado del registro no deben reservar nada, durante minutos simulados.
+ *
+ * Ejecutar con: pio test -e native -f test_heap
+ */
+
+#include <unity.h>
+
+#include <new>
+#include <stdlib.h>
+
+#include "piezo_bugs.h"
+
+// ===============================================
+// CONTADOR DE RESERVAS
+// ===============================================
+
+static bool countAllocations = false;
+static uint32_t allocations = 0;
+
+static void noteAllocation() {
+  if (countAllocations) allocations++;
+}
+
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size) {
+  noteAllocation();
+  return __libc_malloc(size);
+}
+void *calloc(size_t count, size_t size) {
+  noteAllocation();
+  return __libc_calloc(count, size);
+}
+void *realloc(void *ptr, size_t size) {
+  noteAllocation();
+  return __libc_realloc(ptr, size);
+}
+void free(void *ptr) { __libc_free(ptr); }
+}
+#endif
+
+// new/delete van por aquí en cualquier plataforma
+void *operator new(size_t size) {
+  noteAllocation();
+#if defined(__GLIBC__)
+  void *p = __libc_malloc(size ? size : 1);
+#else
+  void *p = malloc(size ? size : 1);
+#endif
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+static void armAllocationCounter() {
+  allocations = 0;
+  countAllocations = true;
+}
+
+static uint32_t disarmAllocationCounter() {
+  countAllocations = false;
+  return allocations;
+}
+
+// ===============================================
+// AYUDAS
+// ===============================================
+
+static void runFor(uint32_t ms) {
+  uint32_t end = hal::millis() + ms;
+  while (deadlineBefore(hal::millis(), end)) piezoBugsLoop();
+}
+
+// Pulsa un botón digital (pull-up) o el del ADC durante ms
+static void press(uint8_t pin, uint32_t ms) {
+  if (pin == BUTTON_1_PIN) hal::sim::setAnalog(pin, 0);
+  else hal::sim::setDigital(pin, LOW);
+  runFor(ms);
+  if (pin == BUTTON_1_PIN) hal::sim::setAnalog(pin, 4095);
+  else hal::sim::setDigital(pin, HIGH);
+  runFor(100);
+}
+
+void setUp() {
+  hal::sim::reset(3);
+}
+
+void tearDown() {
+  countAllocations = false;
+}
+
+// ===============================================
+// PRUEBAS
+// ===============================================
+
+void test_counter_sees_allocations() {
+  armAllocationCounter();
+  char *p = new char[32];
+  delete[] p;
+#if defined(__GLIBC__)
+  void *q = malloc(16);
+  free(q);
+#endif
+  TEST_ASSERT_TRUE(disarmAllocationCounter() >= 1);
+}
+
+void test_loop_does_not_allocate_after_setup() {
+  piezoBugsSetup();
+  armAllocationCounter();
+
+  runFor(10 * 60000);
+
+  // Todas las acciones de los botones
+  press(BUTTON_1_PIN, 100);                   // Frecuencia
+  press(BUTTON_1_PIN, LONG_PRESS_TIME + 100); // Valores por defecto
+  press(BUTTON_2_PIN, 100);                   // Tipo del insecto 1
+  press(BUTTON_2_PIN, LONG_PRESS_TIME + 100); // Mute
+  press(BUTTON_2_PIN, LONG_PRESS_TIME + 100);
+  press(BUTTON_4_PIN, 100);
+  press(BUTTON_6_PIN, 100);                   // Nota raíz
+  press(BUTTON_6_PIN, LONG_PRESS_TIME + 100);
+
+  // Datos nuevos del árbol cada pocos segundos
+  for (int i = 0; i < 20; i++) {
+    TreeData data;
+    data.humidity = 40 + i;
+    data.temperature = 15 + i * 0.5f;
+    data.bioelectrical_activity = i * 0.05f;
+    data.light_level = 100 * i;
+    data.data_valid = true;
+    piezoBugsSetTreeData(data);
+    runFor(3000);
+  }
+
+  runFor(10 * 60000);
+  uint32_t count = disarmAllocationCounter();
+  TEST_ASSERT_TRUE(scheduler.tasks[heapTaskId].runs >= 20);
+  TEST_ASSERT_EQUAL_UINT32(0, count);
+}
+
+void test_report_carries_free_largest_and_drift() {
+  logClear();
+  hal::sim::setHeap(200000, 100000);
+  heapMonitorBegin();
+  TEST_ASSERT_EQUAL_UINT32(200000, heapMonitor.baselineFree);
+  TEST_ASSERT_EQUAL(50, heapFragmentation());
+
+  // Se pierden 10000 bytes y el bloque mayor se parte
+  hal::sim::setHeap(190000, 47500);
+  TEST_ASSERT_EQUAL_UINT32(1000 + HEAP_REPORT_MS, heapMonitorTask(1000));
+  TEST_ASSERT_EQUAL(75, heapFragmentation());
+  TEST_ASSERT_EQUAL_INT32(-10000, heapDriftBytes());
+
+  TEST_ASSERT_EQUAL_UINT32(1, logPending());
+  const LogRecord &r = logRing.records[logRing.tail.load() % LOG_RING_SIZE];
+  TEST_ASSERT_EQUAL(LOG_HEAP, r.id);
+  TEST_ASSERT_EQUAL(185, r.args[0]);
+  TEST_ASSERT_EQUAL(46, r.args[1]);
+  TEST_ASSERT_EQUAL(75, r.args[2]);
+  TEST_ASSERT_EQUAL(185, r.args[3]);
+  TEST_ASSERT_EQUAL(-10000, r.args[4]);
+
+  char line[128];
+  logFormat(r, line, sizeof(line));
+  TEST_ASSERT_EQUAL_STRING("Memoria: 185 KB libres, bloque mayor 46 KB (75% fragmentado), mínimo 185 KB, -10000 B desde el arranque", line);
+}
+
+void test_drift_saturates_in_the_record() {
+  logClear();
+  hal::sim::setHeap(200000, 100000);
+  heapMonitorBegin();
+  hal::sim::setHeap(100000, 100000);
+  heapMonitorTask(0);
+  const LogRecord &r = logRing.records[logRing.tail.load() % LOG_RING_SIZE];
+  TEST_ASSERT_EQUAL(-32767, r.args[4]);
+  TEST_ASSERT_EQUAL(0, heapFragmentation());
+  TEST_ASSERT_EQUAL_UINT32(97, heapMonitor.minFree / 1024);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_counter_sees_allocations);
+  RUN_TEST(test_loop_does_not_allocate_after_setup);
+  RUN_TEST(test_report_carries_free_largest_and_drift);
+  RUN_TEST(test_drift_saturates_in_the_record);
+  return UNITY_END();
+}
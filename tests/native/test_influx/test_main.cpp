@@ -0,0 +1,197 @@
+/*
+ * test_influx - Pruebas nativas del parser incremental de CSV de InfluxDB
+ *
+ * Ejecutar con: pio test -e native -f test_influx
+ */
+
+#include <unity.h>
+#include <string>
+
+#include "influx_csv.h"
+
+static const char *HEADERS_CHUNKED =
+  "HTTP/1.1 200 OK\r\n"
+  "Content-Type: text/csv; charset=utf-8\r\n"
+  "Vary: Accept-Encoding\r\n"
+  "X-Influxdb-Version: v2.7.1\r\n"
+  "Transfer-Encoding: chunked\r\n"
+  "\r\n";
+
+// Respuesta de "range(start: -1h) |> last()": una tabla por serie
+static const char *BODY =
+  ",result,table,_start,_stop,_time,_value,_field,_measurement,tree\r\n"
+  ",_result,0,2025-06-01T10:00:00Z,2025-06-01T11:00:00Z,2025-06-01T10:59:50Z,62.5,humidity,sensors,roble\r\n"
+  ",_result,1,2025-06-01T10:00:00Z,2025-06-01T11:00:00Z,2025-06-01T10:59:50Z,18.25,temperature,sensors,roble\r\n"
+  ",_result,2,2025-06-01T10:00:00Z,2025-06-01T11:00:00Z,2025-06-01T10:59:51Z,-0.0042,bioelectrical_activity,sensors,roble\r\n"
+  ",_result,3,2025-06-01T10:00:00Z,2025-06-01T11:00:00Z,2025-06-01T10:59:51Z,1.2e3,light_level,sensors,roble\r\n"
+  ",_result,4,2025-06-01T10:00:00Z,2025-06-01T11:00:00Z,2025-06-01T10:59:52Z,3.3,battery,sensors,roble\r\n"
+  "\r\n";
+
+static std::string chunked(const std::string &body, size_t chunkSize) {
+  static const char HEX[] = "0123456789abcdef";
+  std::string out;
+  for (size_t i = 0; i < body.size(); i += chunkSize) {
+    size_t n = body.size() - i < chunkSize ? body.size() - i : chunkSize;
+    std::string size;
+    for (size_t v = n; v; v >>= 4) size.insert(size.begin(), HEX[v & 0xF]);
+    out += size + "\r\n" + body.substr(i, n) + "\r\n";
+  }
+  return out + "0\r\n\r\n";
+}
+
+// Alimenta el parser en lecturas de readSize bytes, como client.read(buf, n)
+static bool parse(InfluxCsvParser &p, const std::string &response, size_t readSize) {
+  influxParserBegin(p);
+  const uint8_t *data = (const uint8_t *)response.data();
+  for (size_t i = 0; i < response.size(); i += readSize) {
+    size_t n = response.size() - i < readSize ? response.size() - i : readSize;
+    if (!influxParserFeed(p, data + i, n)) return false;
+  }
+  return true;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_values_independent_of_read_size() {
+  std::string response = std::string(HEADERS_CHUNKED) + chunked(BODY, 100);
+  const size_t readSizes[] = {1, 2, 7, 64, 512, 100000};
+  for (size_t readSize : readSizes) {
+    InfluxCsvParser p;
+    TreeData data;
+    TEST_ASSERT_TRUE(parse(p, response, readSize));
+    TEST_ASSERT_EQUAL(INFLUX_DONE, p.state);
+    TEST_ASSERT_TRUE(influxParserFinish(p, data, 1234));
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 62.5, data.humidity);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 18.25, data.temperature);
+    TEST_ASSERT_FLOAT_WITHIN(1e-7, -0.0042, data.bioelectrical_activity);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, 1200.0, data.light_level);
+    TEST_ASSERT_TRUE(data.data_valid);
+    TEST_ASSERT_EQUAL_UINT32(1234, data.timestamp);
+    // battery no es un campo de TreeData
+    TEST_ASSERT_EQUAL_UINT32(5, p.rows);
+    TEST_ASSERT_EQUAL_UINT32(4, p.values);
+  }
+}
+
+void test_annotations_tables_and_quotes() {
+  // Dos tablas con columnas en distinto orden, anotaciones y comillas
+  std::string body =
+    "#datatype,string,long,string,double\r\n"
+    "#group,false,false,true,false\r\n"
+    "#default,_result,,,\r\n"
+    ",result,table,_field,_value\r\n"
+    ",,0,\"humidity\",\"55\"\r\n"
+    "\r\n"
+    "#datatype,string,long,double,string,string\r\n"
+    ",result,table,_value,note,_field\r\n"
+    ",,1,21.5,\"dice \"\"hola, árbol\"\"\",temperature\r\n";
+  InfluxCsvParser p;
+  TreeData data;
+  TEST_ASSERT_TRUE(parse(p, std::string(HEADERS_CHUNKED) + chunked(body, 37), 5));
+  TEST_ASSERT_TRUE(influxParserFinish(p, data, 0));
+  TEST_ASSERT_EQUAL_UINT32(2, p.tables);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 55.0, data.humidity);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 21.5, data.temperature);
+}
+
+void test_content_length_and_close_delimited_bodies() {
+  std::string body = ",result,table,_value,_field\r\n,,0,40,humidity\r\n,,0,7,light_level";
+  std::string withLength = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+  InfluxCsvParser p;
+  TreeData data;
+  TEST_ASSERT_TRUE(parse(p, withLength, 3));
+  // Con Content-Length la respuesta termina sola, sin esperar al cierre
+  TEST_ASSERT_TRUE(influxParserDone(p));
+  TEST_ASSERT_TRUE(influxParserKeepAlive(p));
+  TEST_ASSERT_TRUE(influxParserFinish(p, data, 0));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 7.0, data.light_level);
+
+  // Sin longitud: la última fila sin salto de línea se cierra en Finish
+  TreeData closed;
+  TEST_ASSERT_TRUE(parse(p, "HTTP/1.0 200 OK\r\n\r\n" + body, 4));
+  TEST_ASSERT_FALSE(influxParserDone(p));
+  TEST_ASSERT_FALSE(influxParserKeepAlive(p));
+  TEST_ASSERT_TRUE(influxParserFinish(p, closed, 0));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 40.0, closed.humidity);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 7.0, closed.light_level);
+
+  // Connection: close obliga a reconectar aunque haya longitud
+  std::string closing = "HTTP/1.1 200 OK\r\nconnection: Close\r\nContent-Length: " +
+                        std::to_string(body.size()) + "\r\n\r\n" + body;
+  TEST_ASSERT_TRUE(parse(p, closing, 7));
+  TEST_ASSERT_TRUE(influxParserDone(p));
+  TEST_ASSERT_TRUE(p.closeConnection);
+  TEST_ASSERT_FALSE(influxParserKeepAlive(p));
+}
+
+void test_errors_leave_data_untouched() {
+  TreeData data;
+  data.humidity = 10;
+  data.data_valid = true;
+
+  InfluxCsvParser p;
+  std::string unauthorized =
+    "HTTP/1.1 401 Unauthorized\r\nContent-Type: application/json\r\nContent-Length: 55\r\n\r\n"
+    "{\"code\":\"unauthorized\",\"message\":\"unauthorized access\"}";
+  TEST_ASSERT_TRUE(parse(p, unauthorized, 16));
+  TEST_ASSERT_EQUAL_UINT16(401, p.status);
+  TEST_ASSERT_FALSE(influxParserFinish(p, data, 0));
+
+  // Respuesta chunked cortada a mitad
+  std::string full = std::string(HEADERS_CHUNKED) + chunked(BODY, 64);
+  TEST_ASSERT_TRUE(parse(p, full.substr(0, full.size() / 2), 64));
+  TEST_ASSERT_FALSE(influxParserFinish(p, data, 0));
+
+  // Tamaño de trozo que no es hexadecimal
+  TEST_ASSERT_FALSE(parse(p, std::string(HEADERS_CHUNKED) + "zz\r\nabc\r\n", 8));
+
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 10.0, data.humidity);
+  TEST_ASSERT_TRUE(data.data_valid);
+}
+
+void test_number_parser() {
+  const char *texts[] = {"-1.25e2", "3", "0.000123", "+7.5E-1", "123456789012345678901"};
+  const double expected[] = {-125.0, 3.0, 0.000123, 0.75, 1.23456789012345678901e20};
+  for (int i = 0; i < 5; i++) {
+    NumberParser n;
+    numberBegin(n);
+    for (const char *c = texts[i]; *c; c++) numberFeed(n, *c);
+    TEST_ASSERT_TRUE(numberValid(n));
+    double tolerance = (expected[i] < 0 ? -expected[i] : expected[i]) * 1e-9;
+    TEST_ASSERT_FLOAT_WITHIN(tolerance, expected[i], numberValue(n));
+  }
+  const char *invalid[] = {"", "abc", "1.2.3", "1e", "--1", "NaN"};
+  for (const char *text : invalid) {
+    NumberParser n;
+    numberBegin(n);
+    for (const char *c = text; *c; c++) numberFeed(n, *c);
+    TEST_ASSERT_FALSE(numberValid(n));
+  }
+}
+
+void test_large_response_has_no_size_limit() {
+  // ~400 KB: la última lectura de cada campo es la que cuenta
+  std::string body = ",result,table,_value,_field\r\n";
+  for (int i = 0; i < 10000; i++) {
+    body += ",_result,0," + std::to_string(i) + ".5,humidity\r\n";
+  }
+  InfluxCsvParser p;
+  TreeData data;
+  TEST_ASSERT_TRUE(parse(p, std::string(HEADERS_CHUNKED) + chunked(body, 4096), 1460));
+  TEST_ASSERT_TRUE(influxParserFinish(p, data, 0));
+  TEST_ASSERT_EQUAL_UINT32(10000, p.values);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 9999.5, data.humidity);
+  TEST_ASSERT_EQUAL_UINT32(body.size(), p.bodyBytes);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_values_independent_of_read_size);
+  RUN_TEST(test_annotations_tables_and_quotes);
+  RUN_TEST(test_content_length_and_close_delimited_bodies);
+  RUN_TEST(test_errors_leave_data_untouched);
+  RUN_TEST(test_number_parser);
+  RUN_TEST(test_large_response_has_no_size_limit);
+  return UNITY_END();
+}
@@ -0,0 +1,172 @@
+/*
+ * test_influx_client - Pruebas nativas de la conexión persistente con InfluxDB
+ *
+ * Usa el servidor TLS sustituto de hal_native.h (latencias modeladas en
+ * el reloj virtual).
+ *
+ * Ejecutar con: pio test -e native -f test_influx_client
+ */
+
+#include <unity.h>
+#include <string>
+
+#include "influx_client.h"
+
+static const uint8_t SERVER_SPKI[hal::TLS_PIN_SIZE] = {1, 2, 3, 4, 5, 6, 7, 8};
+static const uint8_t PINS[][hal::TLS_PIN_SIZE] = {{9, 9, 9}, {1, 2, 3, 4, 5, 6, 7, 8}};
+static const uint8_t WRONG_PINS[][hal::TLS_PIN_SIZE] = {{9, 9, 9}};
+
+static const char *QUERY = "from(bucket: \"biodata\") |> range(start: -1h) |> last()";
+
+static const char RESPONSE[] =
+  "HTTP/1.1 200 OK\r\n"
+  "Content-Type: text/csv; charset=utf-8\r\n"
+  "Transfer-Encoding: chunked\r\n"
+  "\r\n"
+  "7e\r\n"
+  ",result,table,_value,_field\r\n"
+  ",_result,0,62.5,humidity\r\n"
+  ",_result,1,18.25,temperature\r\n"
+  ",_result,2,0.004,bioelectrical_activity\r\n"
+  "\r\n"
+  "0\r\n"
+  "\r\n";
+
+static const char RESPONSE_CLOSE[] =
+  "HTTP/1.1 200 OK\r\n"
+  "Connection: close\r\n"
+  "Content-Length: 52\r\n"
+  "\r\n"
+  ",result,table,_value,_field\r\n"
+  ",_result,0,7,humidity\r\n";
+
+static InfluxClient influx;
+
+static void beginClient(const uint8_t (*pins)[hal::TLS_PIN_SIZE], uint8_t pinCount) {
+  influx = InfluxClient();
+  TEST_ASSERT_TRUE(influxClientBegin(influx, "db.example.org", 443, "bosque", "secreto", nullptr, pins, pinCount));
+  TEST_ASSERT_TRUE(influxClientSetQuery(influx, QUERY));
+}
+
+// Una consulta cada 10 s, como forestData
+static void pollEvery10s(int count, TreeData &data) {
+  for (int i = 0; i < count; i++) {
+    TEST_ASSERT_TRUE(influxClientQuery(influx, data));
+    hal::sim::advance(10000);
+  }
+}
+
+void setUp() {
+  hal::sim::reset(1);
+  memcpy(hal::sim::tlsServer().spki, SERVER_SPKI, sizeof(SERVER_SPKI));
+  hal::sim::tlsSetResponse(RESPONSE, sizeof(RESPONSE) - 1);
+  beginClient(PINS, 2);
+}
+
+void tearDown() {}
+
+void test_request_header_is_built_once() {
+  const std::string header =
+    "POST /api/v2/query?org=bosque HTTP/1.1\r\n"
+    "Host: db.example.org\r\n"
+    "Authorization: Token secreto\r\n"
+    "Content-Type: application/vnd.flux\r\n"
+    "Connection: keep-alive\r\n"
+    "Content-Length: ";
+  TEST_ASSERT_EQUAL(header.size(), influx.headerLength);
+  TEST_ASSERT_EQUAL_STRING((header + std::to_string(strlen(QUERY)) + "\r\n\r\n" + QUERY).c_str(), influx.request);
+
+  // Otra consulta solo reescribe lo que va detrás de la cabecera
+  TEST_ASSERT_TRUE(influxClientSetQuery(influx, "buckets()"));
+  TEST_ASSERT_EQUAL_STRING((header + "9\r\n\r\nbuckets()").c_str(), influx.request);
+  TEST_ASSERT_EQUAL(header.size() + 14, influx.requestLength);
+
+  std::string huge(INFLUX_REQUEST_MAX, 'x');
+  TEST_ASSERT_FALSE(influxClientSetQuery(influx, huge.c_str()));
+  TreeData data;
+  TEST_ASSERT_FALSE(influxClientQuery(influx, data));
+  TEST_ASSERT_EQUAL_UINT32(0, hal::sim::tlsServer().requests);
+}
+
+void test_keep_alive_uses_one_handshake() {
+  TreeData data;
+  pollEvery10s(10, data);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 62.5, data.humidity);
+  TEST_ASSERT_EQUAL_UINT32(1, hal::sim::tlsServer().accepts);
+  TEST_ASSERT_EQUAL_UINT32(1, influx.link.handshakeCount());
+  TEST_ASSERT_EQUAL_UINT32(10, hal::sim::tlsServer().requests);
+  TEST_ASSERT_EQUAL_UINT32(9, influx.reused);
+
+  // La primera paga TCP + handshake completo; el resto, un viaje y la consulta
+  const hal::sim::TlsServer &server = hal::sim::tlsServer();
+  TEST_ASSERT_TRUE(influx.maxTtfbUs >= 4 * server.rttUs + server.fullHandshakeUs);
+  TEST_ASSERT_EQUAL_UINT32(server.rttUs + server.queryUs, influx.lastTtfbUs);
+}
+
+void test_idle_close_reconnects_with_resumed_session() {
+  hal::sim::tlsServer().idleTimeoutMs = 5000;
+  TreeData data;
+  pollEvery10s(5, data);
+  TEST_ASSERT_EQUAL_UINT32(5, influx.link.handshakeCount());
+  TEST_ASSERT_EQUAL_UINT32(1, hal::sim::tlsServer().fullHandshakes);
+  TEST_ASSERT_EQUAL_UINT32(4, influx.link.resumedCount());
+  TEST_ASSERT_EQUAL_UINT32(4, hal::sim::tlsServer().idleCloses);
+  TEST_ASSERT_TRUE(influx.link.resumed());
+  TEST_ASSERT_EQUAL_UINT32(0, influx.reused);
+
+  // Con la clave de los tickets rotada el handshake vuelve a ser completo
+  hal::sim::tlsRotateTickets();
+  pollEvery10s(1, data);
+  TEST_ASSERT_FALSE(influx.link.resumed());
+  TEST_ASSERT_EQUAL_UINT32(2, hal::sim::tlsServer().fullHandshakes);
+}
+
+void test_stale_connection_is_retried_once() {
+  TreeData data;
+  pollEvery10s(1, data);
+  hal::sim::tlsServer().dropNextRequest = true;
+  data.humidity = 0;
+  pollEvery10s(1, data);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 62.5, data.humidity);
+  TEST_ASSERT_EQUAL_UINT32(1, influx.retries);
+  TEST_ASSERT_EQUAL_UINT32(3, hal::sim::tlsServer().requests);
+  TEST_ASSERT_EQUAL_UINT32(0, influx.failures);
+  TEST_ASSERT_TRUE(influx.link.resumed());
+}
+
+void test_server_connection_close_is_honoured() {
+  hal::sim::tlsSetResponse(RESPONSE_CLOSE, sizeof(RESPONSE_CLOSE) - 1);
+  TreeData data;
+  pollEvery10s(3, data);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 7.0, data.humidity);
+  TEST_ASSERT_EQUAL_UINT32(3, hal::sim::tlsServer().accepts);
+  TEST_ASSERT_EQUAL_UINT32(2, influx.link.resumedCount());
+  TEST_ASSERT_EQUAL_UINT32(0, influx.reused);
+}
+
+void test_pin_mismatch_refuses_server() {
+  beginClient(WRONG_PINS, 1);
+  TreeData data;
+  data.humidity = 10;
+  TEST_ASSERT_FALSE(influxClientQuery(influx, data));
+  TEST_ASSERT_EQUAL_UINT32(1, influx.link.verifyFailureCount());
+  TEST_ASSERT_EQUAL_UINT32(0, influx.link.handshakeCount());
+  TEST_ASSERT_EQUAL_UINT32(0, hal::sim::tlsServer().requests);
+  TEST_ASSERT_EQUAL_UINT32(1, influx.failures);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 10.0, data.humidity);
+
+  // Sin CA ni pines no hay con qué verificar al servidor
+  InfluxClient unverified;
+  TEST_ASSERT_FALSE(influxClientBegin(unverified, "db.example.org", 443, "bosque", "secreto", nullptr, nullptr, 0));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_request_header_is_built_once);
+  RUN_TEST(test_keep_alive_uses_one_handshake);
+  RUN_TEST(test_idle_close_reconnects_with_resumed_session);
+  RUN_TEST(test_stale_connection_is_retried_once);
+  RUN_TEST(test_server_connection_close_is_honoured);
+  RUN_TEST(test_pin_mismatch_refuses_server);
+  return UNITY_END();
+}
@@ -0,0 +1,229 @@
+/*
+ * test_influx_poll - Pruebas nativas de las consultas incrementales a InfluxDB
+ *
+ * Ejecutar con: pio test -e native -f test_influx_poll
+ */
+
+#include <unity.h>
+#include <stdlib.h>
+#include <string>
+
+#include "influx_poll.h"
+
+static const uint8_t PINS[][hal::TLS_PIN_SIZE] = {{1}};
+static const int64_t EPOCH_NS = 1748772000LL * 1000000000LL;   // 2025-06-01T10:00:00Z
+
+static InfluxClient client;
+static InfluxPoller poller;
+
+// InfluxDB sustituto: un punto por campo cada 10 s, bio en bioValues
+static float bioValues[64];
+static std::string response;
+static uint32_t servedRows;
+
+static const char *standin(const char *request, uint32_t length, uint32_t *responseLength) {
+  std::string text(request, length);
+  uint32_t newest = hal::millis() / 10000;
+  uint32_t first = newest;
+  size_t at = text.find("time(v: ");
+  if (at != std::string::npos) {
+    int64_t offset = strtoll(text.c_str() + at + 8, nullptr, 10) - EPOCH_NS;
+    first = (uint32_t)((offset + 9999999999LL) / 10000000000LL);
+  }
+  std::string body;
+  if (first <= newest) body = ",result,table,_time,_value,_field\r\n";
+  char line[96];
+  for (uint32_t i = first; i <= newest; i++) {
+    snprintf(line, sizeof(line), ",_result,0,2025-06-01T10:%02u:%02uZ,%.6f,bioelectrical_activity\r\n",
+             (unsigned)(i / 6), (unsigned)(i % 6) * 10, bioValues[i % 64]);
+    body += line;
+    servedRows++;
+  }
+  response = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+  *responseLength = (uint32_t)response.size();
+  return response.c_str();
+}
+
+// Respuesta completa simulada con los puntos de bio dados
+static void parsedResponse(InfluxCsvParser &p, const float *values, int count, int64_t latestNs) {
+  influxParserBegin(p);
+  p.state = INFLUX_DONE;
+  p.status = 200;
+  for (int i = 0; i < count; i++) {
+    if (i == 0) p.firstValue[POLL_FIELD] = values[i];
+    if (i > 0) p.variation[POLL_FIELD] += fabsf(values[i] - values[i - 1]);
+    p.value[POLL_FIELD] = values[i];
+    p.points[POLL_FIELD]++;
+  }
+  p.latestTimeNs = latestNs;
+}
+
+static void timeOf(const char *text, TimeParser &t) {
+  timeBegin(t);
+  for (const char *c = text; *c; c++) timeFeed(t, *c);
+}
+
+void setUp() {
+  hal::sim::reset(1);
+  hal::sim::tlsServer().spki[0] = 1;
+  hal::sim::tlsServer().handler = standin;
+  for (int i = 0; i < 64; i++) bioValues[i] = 0.004f;
+  servedRows = 0;
+  client = InfluxClient();
+  influxClientBegin(client, "db.example.org", 443, "bosque", "secreto", nullptr, PINS, 1);
+  influxPollerBegin(poller, "biodata");
+}
+
+void tearDown() {}
+
+void test_rfc3339_times() {
+  TimeParser t;
+  timeOf("2025-06-01T10:00:00Z", t);
+  TEST_ASSERT_TRUE(timeValid(t));
+  TEST_ASSERT_TRUE(timeValueNs(t) == EPOCH_NS);
+  timeOf("2025-06-01T10:00:00.000000042Z", t);
+  TEST_ASSERT_TRUE(timeValueNs(t) == EPOCH_NS + 42);
+  timeOf("2025-06-01T10:00:01.5Z", t);
+  TEST_ASSERT_TRUE(timeValueNs(t) == EPOCH_NS + 1500000000LL);
+  timeOf("2025-06-01T12:00:00+02:00", t);
+  TEST_ASSERT_TRUE(timeValid(t));
+  TEST_ASSERT_TRUE(timeValueNs(t) == EPOCH_NS);
+  timeOf("2024-02-29T00:00:00Z", t);
+  TEST_ASSERT_TRUE(timeValueNs(t) == 1709164800LL * 1000000000LL);
+
+  const char *invalid[] = {"", "2025-06-01", "2025-06-01T10:00:00", "2025-6-01T10:00:00Z", "2025-13-01T10:00:00Z",
+                           "2025-06-01T10:00:00ZZ", "2025-06-01T10:00:00+02"};
+  for (const char *text : invalid) {
+    timeOf(text, t);
+    TEST_ASSERT_FALSE(timeValid(t));
+  }
+}
+
+void test_parser_tracks_watermark_and_variation() {
+  std::string body =
+    ",result,table,_value,_field,_time\r\n"
+    ",_result,0,0.004,bioelectrical_activity,2025-06-01T10:00:00Z\r\n"
+    ",_result,0,0.006,bioelectrical_activity,2025-06-01T10:00:10Z\r\n"
+    ",_result,0,0.003,bioelectrical_activity,2025-06-01T10:00:20Z\r\n"
+    ",_result,1,61.5,humidity,2025-06-01T10:00:30.25Z\r\n"
+    ",_result,1,61.0,humidity,not-a-time\r\n";
+  std::string http = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+  InfluxCsvParser p;
+  influxParserBegin(p);
+  TEST_ASSERT_TRUE(influxParserFeed(p, (const uint8_t *)http.data(), http.size()));
+  TreeData data;
+  TEST_ASSERT_TRUE(influxParserFinish(p, data, 0));
+  TEST_ASSERT_EQUAL_UINT16(3, p.points[TREE_BIOELECTRICAL_ACTIVITY]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.004, p.firstValue[TREE_BIOELECTRICAL_ACTIVITY]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.005, p.variation[TREE_BIOELECTRICAL_ACTIVITY]);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.003, data.bioelectrical_activity);
+  // La fila sin _time válido cuenta como valor pero no mueve la marca de agua
+  TEST_ASSERT_TRUE(p.latestTimeNs == EPOCH_NS + 30250000000LL);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 61.0, data.humidity);
+}
+
+void test_query_asks_only_for_newer_points() {
+  TEST_ASSERT_NOT_NULL(strstr(influxPollerQuery(poller), "range(start: -1h) |> last()"));
+  InfluxCsvParser p;
+  float one = 0.004f;
+  parsedResponse(p, &one, 1, EPOCH_NS + 20000000000LL);
+  influxPollerUpdate(poller, p, 0);
+  TEST_ASSERT_NOT_NULL(strstr(influxPollerQuery(poller), "range(start: time(v: 1748772020000000001))"));
+  TEST_ASSERT_NOT_NULL(strstr(poller.query, "keep(columns: [\"_time\", \"_value\", \"_field\"])"));
+
+  // Una respuesta vacía o fallida no retrocede la marca de agua
+  parsedResponse(p, nullptr, 0, 0);
+  influxPollerUpdate(poller, p, 10000);
+  p.status = 500;
+  influxPollerUpdate(poller, p, 20000);
+  TEST_ASSERT_TRUE(poller.watermarkNs == EPOCH_NS + 20000000000LL);
+}
+
+void test_interval_follows_volatility() {
+  InfluxCsvParser p;
+  float flat[2] = {0.004f, 0.004f};
+  uint32_t now = 0;
+  parsedResponse(p, flat, 1, 1);
+  influxPollerUpdate(poller, p, now);
+  TEST_ASSERT_EQUAL_UINT32(POLL_START_MS, poller.intervalMs);
+
+  // Serie plana: el intervalo crece hasta el máximo
+  for (int i = 0; i < 20; i++) {
+    now += poller.intervalMs;
+    parsedResponse(p, flat, 2, 1);
+    influxPollerUpdate(poller, p, now);
+  }
+  TEST_ASSERT_EQUAL_UINT32(POLL_MAX_MS, poller.intervalMs);
+
+  // Serie que oscila: vuelve al mínimo
+  float swing[4] = {0.004f, 0.006f, 0.002f, 0.005f};
+  for (int i = 0; i < 10; i++) {
+    now += poller.intervalMs;
+    parsedResponse(p, swing, 4, 1);
+    influxPollerUpdate(poller, p, now);
+  }
+  TEST_ASSERT_EQUAL_UINT32(POLL_MIN_MS, poller.intervalMs);
+  TEST_ASSERT_TRUE(poller.lastRate >= POLL_VOLATILE_RATE);
+
+  // Variación intermedia: se mantiene
+  float mild[2] = {0.005f, 0.00505f};
+  now += poller.intervalMs;
+  parsedResponse(p, mild, 2, 1);
+  influxPollerUpdate(poller, p, now);
+  uint32_t interval = poller.intervalMs;
+  now += poller.intervalMs;
+  parsedResponse(p, mild, 2, 1);
+  influxPollerUpdate(poller, p, now);
+  TEST_ASSERT_EQUAL_UINT32(interval, poller.intervalMs);
+
+  // Sin puntos nuevos cuenta como plana
+  parsedResponse(p, nullptr, 0, 0);
+  influxPollerUpdate(poller, p, now + 1000);
+  TEST_ASSERT_TRUE(poller.intervalMs > interval);
+  TEST_ASSERT_EQUAL_UINT32(1, poller.emptyPolls);
+}
+
+void test_incremental_polling_receives_each_point_once() {
+  for (int i = 0; i < 64; i++) bioValues[i] = 0.004f + (i % 2) * 0.003f;   // Oscila
+  TreeData data;
+  uint32_t fetches = 0;
+  hal::sim::advance(1000);
+  while (hal::millis() < 600000) {
+    if (influxPollerDue(poller, hal::millis())) {
+      influxPollerFetch(poller, client, data);
+      fetches++;
+    }
+    hal::sim::advance(100);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, client.failures);
+  // 60 puntos escritos antes de los 10 min: cada uno llega una sola vez
+  TEST_ASSERT_EQUAL_UINT32(60, servedRows);
+  // Más deprisa que los datos: las consultas vacías lo frenan entre 5 y 7,5 s
+  TEST_ASSERT_TRUE(poller.intervalMs < POLL_START_MS);
+  TEST_ASSERT_TRUE(fetches > 60);
+
+  // Serie plana: el poller se espacia y sigue sin repetir puntos
+  for (int i = 0; i < 64; i++) bioValues[i] = 0.004f;
+  uint32_t before = fetches;
+  while (hal::millis() < 1200000) {
+    if (influxPollerDue(poller, hal::millis())) {
+      influxPollerFetch(poller, client, data);
+      fetches++;
+    }
+    hal::sim::advance(100);
+  }
+  TEST_ASSERT_TRUE(fetches - before < 20);
+  TEST_ASSERT_EQUAL_UINT32(POLL_MAX_MS, poller.intervalMs);
+  TEST_ASSERT_TRUE(servedRows <= 120);
+  TEST_ASSERT_EQUAL_UINT32(0, client.failures);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_rfc3339_times);
+  RUN_TEST(test_parser_tracks_watermark_and_variation);
+  RUN_TEST(test_query_asks_only_for_newer_points);
+  RUN_TEST(test_interval_follows_volatility);
+  RUN_TEST(test_incremental_polling_receives_each_point_once);
+  return UNITY_END();
+}
@@ -0,0 +1,156 @@
+/*
+ * test_log - Pruebas nativas del registro diferido (log.h)
+ *
+ * Se compila con LOG_LEVEL_INFO para comprobar que los mensajes de debug
+ * (el inicio de cada secuencia) no llegan al anillo.
+ *
+ * Ejecutar con: pio test -e native -f test_log
+ */
+
+#define LOG_LEVEL LOG_LEVEL_INFO
+
+#include <unity.h>
+
+#include "piezo_bugs.h"
+
+const uint8_t TEST_PIN = 30;
+
+static LogRecord record(LogId id, int16_t a = 0, int16_t b = 0, int16_t c = 0, int16_t d = 0, int16_t e = 0) {
+  LogRecord r = {};
+  r.id = id;
+  r.level = LOG_LEVELS[id];
+  const int16_t args[LOG_MAX_ARGS] = {a, b, c, d, e};
+  memcpy(r.args, args, sizeof(args));
+  return r;
+}
+
+static const LogRecord &pendingRecord(uint32_t i) {
+  return logRing.records[(logRing.tail.load() + i) % LOG_RING_SIZE];
+}
+
+void setUp() {
+  hal::sim::reset(4);
+  rootNoteOffset = 0;
+  currentState = FREQ_NORMAL;
+  voicesClear();
+  paramBusBegin();
+  logClear();
+}
+
+void tearDown() {}
+
+void test_format_matches_old_messages() {
+  char line[128];
+  logFormat(record(LOG_SEQUENCE_START, 1, SPIDER, 0, 81, 1760), line, sizeof(line));
+  TEST_ASSERT_EQUAL_STRING("Insecto1 Araña Do - La6 (1760 Hz)", line);
+  logFormat(record(LOG_SEQUENCE_START, 2, BEETLE, 7, 31, 98), line, sizeof(line));
+  TEST_ASSERT_EQUAL_STRING("Insecto2 Escarabajo Sol - Sol2 (98 Hz)", line);
+  logFormat(record(LOG_BAD_LENGTH, CRICKET, 9, 4), line, sizeof(line));
+  TEST_ASSERT_EQUAL_STRING("Error: Longitud de secuencia inválida para Grillo: 9 (máximo 4), ajustando a 3", line);
+  logFormat(record(LOG_TYPE_CHANGED, 1, 7), line, sizeof(line));
+  TEST_ASSERT_EQUAL_STRING("Insecto 1 cambió a Desconocido", line);
+  logFormat(record(LOG_FREQ_NORMAL), line, sizeof(line));
+  TEST_ASSERT_EQUAL_STRING("Estado: Frecuencia NORMAL (x1)", line);
+
+  LogRecord unknown = record(LOG_MUTED);
+  unknown.id = 200;
+  logFormat(unknown, line, sizeof(line));
+  TEST_ASSERT_EQUAL_STRING("Log: mensaje 200 desconocido", line);
+
+  // Un buffer corto se corta sin desbordar
+  char small[12];
+  TEST_ASSERT_EQUAL_UINT16(11, logFormat(record(LOG_SEQUENCE_START, 1, SPIDER, 0, 81, 1760), small, sizeof(small)));
+  TEST_ASSERT_EQUAL_STRING("Insecto1 Ar", small);
+}
+
+void test_hot_path_only_records() {
+  int v = voiceAdd(SPIDER, TEST_PIN);
+  hal::sim::setMillis(1234);
+  voiceToggleMute(v);
+  TEST_ASSERT_EQUAL_UINT32(1, logPending());
+  const LogRecord &r = pendingRecord(0);
+  TEST_ASSERT_EQUAL_UINT8(LOG_MUTED, r.id);
+  TEST_ASSERT_EQUAL_UINT32(1234, r.ms);
+  TEST_ASSERT_EQUAL_INT16(1, r.args[0]);
+
+  // El inicio de secuencia es de debug: con LOG_LEVEL_INFO no se registra
+  voiceToggleMute(v);
+  voices.sequenceIndex[v] = 0;
+  voicePlaySound(v);
+  TEST_ASSERT_EQUAL_UINT32(2, logPending());
+  TEST_ASSERT_EQUAL_UINT8(LOG_UNMUTED, pendingRecord(1).id);
+
+  TEST_ASSERT_EQUAL_UINT8(2, logDrain(LOG_DRAIN_MAX));
+  TEST_ASSERT_EQUAL_UINT32(0, logPending());
+  TEST_ASSERT_EQUAL_UINT32(2, logRing.drained);
+}
+
+void test_full_ring_drops_and_reports() {
+  for (int i = 0; i < LOG_RING_SIZE + 6; i++) LOG(LOG_MUTED, i);
+  TEST_ASSERT_EQUAL_UINT32(LOG_RING_SIZE, logPending());
+  TEST_ASSERT_EQUAL_UINT32(6, logRing.dropped);
+  TEST_ASSERT_EQUAL_INT16(LOG_RING_SIZE - 1, pendingRecord(LOG_RING_SIZE - 1).args[0]);
+
+  // Cada vaciado respeta su límite
+  TEST_ASSERT_EQUAL_UINT8(LOG_DRAIN_MAX, logDrain(LOG_DRAIN_MAX));
+  while (logDrain(LOG_DRAIN_MAX) > 0) {}
+
+  // El siguiente mensaje va precedido del aviso de los perdidos
+  LOG(LOG_UNMUTED, 1);
+  TEST_ASSERT_EQUAL_UINT32(2, logPending());
+  TEST_ASSERT_EQUAL_UINT8(LOG_DROPPED, pendingRecord(0).id);
+  TEST_ASSERT_EQUAL_INT16(6, pendingRecord(0).args[0]);
+  TEST_ASSERT_EQUAL_UINT8(LOG_UNMUTED, pendingRecord(1).id);
+  char line[64];
+  logFormat(pendingRecord(0), line, sizeof(line));
+  TEST_ASSERT_EQUAL_STRING("Log: 6 mensajes perdidos", line);
+}
+
+void test_text_line_longer_than_the_uart_room_goes_out_in_pieces() {
+  LOG(LOG_BAD_LENGTH, CRICKET, 9, 4);
+  char line[128];
+  uint16_t length = logFormat(pendingRecord(0), line, sizeof(line)) + 2;
+
+  // Nunca hay sitio para la línea entera, pero cada vuelta envía un trozo
+  hal::sim::state().serialTxRoom = 16;
+  uint8_t rounds = 0;
+  while (!logWriteText(pendingRecord(0))) rounds++;
+  TEST_ASSERT_EQUAL_UINT8((length + 15) / 16 - 1, rounds);
+  TEST_ASSERT_TRUE(hal::sim::state().serialWritten == length);
+  TEST_ASSERT_EQUAL_UINT16(0, logRing.tailSent);
+
+  // Sin hueco no escribe nada
+  hal::sim::state().serialTxRoom = 0;
+  TEST_ASSERT_FALSE(logWriteText(pendingRecord(0)));
+  TEST_ASSERT_TRUE(hal::sim::state().serialWritten == length);
+}
+
+void test_binary_frames_wait_for_room() {
+  LOG(LOG_MUTED, 1);
+  hal::sim::state().serialTxRoom = sizeof(LogRecord);
+  TEST_ASSERT_FALSE(logWriteFrame(pendingRecord(0)));
+  TEST_ASSERT_TRUE(hal::sim::state().serialWritten == 0);
+  hal::sim::state().serialTxRoom = sizeof(LogRecord) + 1;
+  TEST_ASSERT_TRUE(logWriteFrame(pendingRecord(0)));
+  TEST_ASSERT_TRUE(hal::sim::state().serialWritten == sizeof(LogRecord) + 1);
+}
+
+void test_loop_drains_before_sleeping() {
+  piezoBugsSetup();
+  for (int i = 0; i < 3; i++) changeFrequency();
+  TEST_ASSERT_EQUAL_UINT32(3, logPending());
+  piezoBugsLoop();
+  TEST_ASSERT_EQUAL_UINT32(0, logPending());
+  TEST_ASSERT_EQUAL_UINT32(3, logRing.drained);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_format_matches_old_messages);
+  RUN_TEST(test_hot_path_only_records);
+  RUN_TEST(test_full_ring_drops_and_reports);
+  RUN_TEST(test_text_line_longer_than_the_uart_room_goes_out_in_pieces);
+  RUN_TEST(test_binary_frames_wait_for_room);
+  RUN_TEST(test_loop_drains_before_sleeping);
+  return UNITY_END();
+}
@@ -0,0 +1,157 @@
+/*
+ * test_neopixel - Pruebas nativas del fade en enteros del aro Neopixel
+ *                 y de la salida con doble buffer
+ *
+ * Ejecutar con: pio test -e native -f test_neopixel
+ */
+
+#include <unity.h>
+
+#include "piezo_bugs.h"
+
+static const unsigned long CYCLE_TIME = NEOPIXEL_COUNT * LED_INTERVAL;
+
+static uint8_t greenOf(uint16_t led) {
+  return (pixels.getPixelColor(led) >> 8) & 0xFF;
+}
+
+void setUp() {
+  hal::sim::reset(1);
+  voicesClear();
+  initNeopixel();
+  // Sin límite de fps: los tests llaman a updateNeopixel() sin esperar
+  ledCompositorSetMaxFps(0);
+  // Deja terminar la transmisión del aro apagado de initNeopixel()
+  hal::sim::advance(NEOPIXEL_FRAME_MS);
+}
+
+void tearDown() {}
+
+void test_gamma_table_is_monotonic() {
+  for (int i = 1; i <= 256; i++) {
+    TEST_ASSERT_TRUE(NEO_GAMMA.level[i] >= NEO_GAMMA.level[i - 1]);
+  }
+  // 0.5^2.2 = 0.2176
+  TEST_ASSERT_INT_WITHIN(100, 14263, gammaLevel(32768));
+  TEST_ASSERT_EQUAL_UINT16(0, gammaLevel(0));
+  TEST_ASSERT_EQUAL_UINT16(65535, gammaLevel(65535));
+}
+
+void test_full_led_has_exact_brightness() {
+  // LED 0 a mitad de su duración: brillo completo y sin resto de dithering
+  unsigned long t = CYCLE_TIME * 3 + LED_DURATION / 2;
+  for (int i = 0; i < 300; i++) {
+    updateNeopixel(t);
+    hal::sim::advance(NEOPIXEL_FRAME_MS);
+    TEST_ASSERT_EQUAL_UINT8(NEO_BRIGHTNESS, greenOf(0));
+  }
+}
+
+void test_unchanged_frame_is_not_shown() {
+  // En un múltiplo de LED_INTERVAL todos los LEDs están apagados o al
+  // brillo completo, sin fracciones que el dithering tenga que repartir
+  unsigned long t = CYCLE_TIME * 3 + 2 * LED_INTERVAL;
+  uint32_t before = pixels.showCount();
+  updateNeopixel(t);
+  uint32_t shows = pixels.showCount();
+  // Mismo instante: nada cambia
+  updateNeopixel(t);
+  updateNeopixel(t);
+  TEST_ASSERT_EQUAL_UINT32(shows, pixels.showCount());
+  TEST_ASSERT_EQUAL_UINT32(1, shows - before);
+  TEST_ASSERT_EQUAL_UINT32(1, neoFrame.shows);
+}
+
+void test_dithering_averages_to_fractional_level() {
+  // LED 0 a un tercio del fade in: el verde final no es un entero
+  unsigned long t = CYCLE_TIME * 3 + FADE_IN_TIME / 3;
+  uint16_t expected = scaleChannel(NEO_COLOR_G, NEO_BRIGHTNESS,
+                                   gammaLevel(calculateFadeLevel(FADE_IN_TIME / 3, LED_DURATION)));
+  TEST_ASSERT_TRUE((expected & 0xFF) != 0);
+
+  uint32_t sum = 0;
+  uint8_t low = 255, high = 0;
+  for (int i = 0; i < 256; i++) {
+    updateNeopixel(t);
+    hal::sim::advance(NEOPIXEL_FRAME_MS);
+    uint8_t g = greenOf(0);
+    sum += g;
+    if (g < low) low = g;
+    if (g > high) high = g;
+  }
+  // La media de 256 frames reproduce el valor 8.8 y solo alterna un LSB
+  TEST_ASSERT_INT_WITHIN(1, expected, sum);
+  TEST_ASSERT_EQUAL_UINT8(low + 1, high);
+}
+
+void test_led_off_outside_its_window() {
+  // LED 1 empieza en LED_INTERVAL: antes está apagado
+  updateNeopixel(CYCLE_TIME * 3 + LED_INTERVAL / 2);
+  TEST_ASSERT_EQUAL_UINT32(0, pixels.getPixelColor(1));
+  TEST_ASSERT_EQUAL_UINT32(0, pixels.getPixelColor(NEOPIXEL_COUNT - 1) & 0xFF00FF);
+}
+
+void test_show_returns_before_transmission_ends() {
+  hal::PixelStrip strip(24, 5, 1);
+  strip.setPixelColor(0, strip.Color(1, 2, 3));
+  TEST_ASSERT_TRUE(strip.show());
+  TEST_ASSERT_TRUE(strip.busy());
+  TEST_ASSERT_EQUAL_UINT32(0, strip.completedCount());
+
+  // Lo que se dibuja ahora no toca el frame en transmisión
+  strip.setPixelColor(0, strip.Color(9, 9, 9));
+  TEST_ASSERT_EQUAL_UINT32(strip.Color(1, 2, 3), strip.frontPixelColor(0));
+
+  // 24 LEDs: 24 * 30 us + 50 us de reset
+  hal::sim::advanceMicros(24 * 30 + 49);
+  TEST_ASSERT_TRUE(strip.busy());
+  hal::sim::advanceMicros(1);
+  TEST_ASSERT_FALSE(strip.busy());
+  TEST_ASSERT_EQUAL_UINT32(1, strip.completedCount());
+}
+
+void test_show_while_busy_is_dropped_and_retried() {
+  unsigned long t = CYCLE_TIME * 3 + FADE_IN_TIME / 3;
+  updateNeopixel(t);
+  TEST_ASSERT_TRUE(pixels.busy());
+  // Mismo instante de reloj: el aro sigue transmitiendo
+  updateNeopixel(t + 50);
+  TEST_ASSERT_EQUAL_UINT32(1, pixels.droppedCount());
+  TEST_ASSERT_EQUAL_UINT32(1, neoFrame.busySkips);
+  TEST_ASSERT_FALSE(neoFrame.valid[0]);
+
+  // En el siguiente frame se reintenta el envío
+  hal::sim::advance(NEOPIXEL_FRAME_MS);
+  uint32_t shows = pixels.showCount();
+  updateNeopixel(t + 50);
+  TEST_ASSERT_EQUAL_UINT32(shows + 1, pixels.showCount());
+  TEST_ASSERT_EQUAL_UINT32(pixels.getPixelColor(0), pixels.frontPixelColor(0));
+}
+
+void test_strips_transmit_in_parallel() {
+  hal::PixelStrip strips[hal::PIXEL_CHANNELS];
+  for (uint8_t c = 0; c < hal::PIXEL_CHANNELS; c++) {
+    strips[c].begin(NEOPIXEL_COUNT, 10 + c, c);
+    TEST_ASSERT_TRUE(strips[c].show());
+  }
+  // Todos terminan en el tiempo de un solo aro
+  hal::sim::advanceMicros(NEOPIXEL_COUNT * 30 + 50);
+  for (uint8_t c = 0; c < hal::PIXEL_CHANNELS; c++) {
+    TEST_ASSERT_EQUAL_UINT8(c, strips[c].rmtChannel());
+    TEST_ASSERT_FALSE(strips[c].busy());
+    TEST_ASSERT_EQUAL_UINT32(1, strips[c].completedCount());
+  }
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_gamma_table_is_monotonic);
+  RUN_TEST(test_full_led_has_exact_brightness);
+  RUN_TEST(test_unchanged_frame_is_not_shown);
+  RUN_TEST(test_dithering_averages_to_fractional_level);
+  RUN_TEST(test_led_off_outside_its_window);
+  RUN_TEST(test_show_returns_before_transmission_ends);
+  RUN_TEST(test_show_while_busy_is_dropped_and_retried);
+  RUN_TEST(test_strips_transmit_in_parallel);
+  return UNITY_END();
+}
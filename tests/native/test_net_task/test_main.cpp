@@ -0,0 +1,223 @@
+/*
+ * test_net_task - Pruebas nativas de la tarea de red y la entrega de TreeData
+ *
+ * Las pruebas concurrentes usan std::thread: un hilo hace de tarea de red
+ * (el único que toca el hardware simulado) y el hilo principal hace de
+ * loop de sonido y luz, que solo lee el slot.
+ *
+ * Ejecutar con: pio test -e native -f test_net_task
+ */
+
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "net_task.h"
+
+using Clock = std::chrono::steady_clock;
+
+static const uint8_t PINS[][hal::TLS_PIN_SIZE] = {{1}};
+
+// InfluxDB lento: tarda de verdad slowMs en responder con una fila nueva
+static std::atomic<uint32_t> slowMs;
+static uint32_t served;
+static std::string response;
+
+static const char *slowServer(const char *request, uint32_t length, uint32_t *responseLength) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(slowMs.load()));
+  served++;
+  char body[160];
+  snprintf(body, sizeof(body),
+           ",result,table,_time,_value,_field\r\n"
+           ",_result,0,2025-06-01T10:%02u:%02uZ,%u,humidity\r\n",
+           (unsigned)(served / 60 % 60), (unsigned)(served % 60), (unsigned)served);
+  response = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(strlen(body)) + "\r\n\r\n" + body;
+  *responseLength = (uint32_t)response.size();
+  return response.c_str();
+}
+
+// Instantánea cuyos campos salen todos de k: una lectura a medias se nota
+static TreeData snapshot(uint32_t k) {
+  TreeData d;
+  d.humidity = (float)k;
+  d.temperature = (float)k * 2;
+  d.bioelectrical_activity = (float)k * 3;
+  d.light_level = (float)k * 4;
+  d.timestamp = k;
+  d.data_valid = true;
+  return d;
+}
+
+static bool consistent(const TreeData &d) {
+  float k = (float)d.timestamp;
+  return d.humidity == k && d.temperature == k * 2 && d.bioelectrical_activity == k * 3 && d.light_level == k * 4;
+}
+
+void setUp() {
+  hal::sim::reset(1);
+  hal::sim::tlsServer().spki[0] = 1;
+  hal::sim::tlsServer().handler = slowServer;
+  slowMs.store(0);
+  served = 0;
+  influxClientBegin(netTask.client, "db.example.org", 443, "bosque", "secreto", nullptr, PINS, 1);
+  netTaskBegin("biodata");
+}
+
+void tearDown() {}
+
+void test_slot_hands_over_latest_snapshot() {
+  TreeDataSlot slot;
+  treeSlotInit(slot);
+  TreeData out;
+  TEST_ASSERT_FALSE(treeSlotRead(slot, out));
+
+  treeSlotPublish(slot, snapshot(1));
+  TEST_ASSERT_TRUE(treeSlotRead(slot, out));
+  TEST_ASSERT_EQUAL_UINT32(1, out.timestamp);
+  TEST_ASSERT_FALSE(treeSlotRead(slot, out));   // Ya leída
+  TEST_ASSERT_EQUAL_UINT32(1, out.timestamp);
+
+  // Varias publicaciones sin leer: solo cuenta la última
+  for (uint32_t k = 2; k <= 5; k++) treeSlotPublish(slot, snapshot(k));
+  TEST_ASSERT_TRUE(treeSlotRead(slot, out));
+  TEST_ASSERT_EQUAL_UINT32(5, out.timestamp);
+  TEST_ASSERT_TRUE(consistent(out));
+  TEST_ASSERT_EQUAL_UINT32(5, slot.published.load());
+}
+
+void test_slot_never_tears_between_threads() {
+  static TreeDataSlot slot;
+  treeSlotInit(slot);
+  const uint32_t count = 200000;
+  std::thread producer([&] {
+    for (uint32_t k = 1; k <= count; k++) treeSlotPublish(slot, snapshot(k));
+  });
+
+  TreeData out;
+  uint32_t last = 0;
+  uint32_t reads = 0;
+  uint32_t torn = 0;
+  uint32_t backwards = 0;
+  while (last < count) {
+    if (!treeSlotRead(slot, out)) continue;
+    reads++;
+    if (!consistent(out)) torn++;
+    if (out.timestamp <= last) backwards++;
+    last = out.timestamp;
+  }
+  producer.join();
+  TEST_ASSERT_EQUAL_UINT32(0, torn);
+  TEST_ASSERT_EQUAL_UINT32(0, backwards);
+  TEST_ASSERT_TRUE(reads > 0);
+}
+
+void test_step_fetches_and_backs_off_without_wifi() {
+  TreeData out;
+  TEST_ASSERT_EQUAL_UINT32(NET_CHECK_MS, netTaskStep(hal::millis()));
+  TEST_ASSERT_EQUAL_UINT32(1, netTask.fetches.load());
+  TEST_ASSERT_TRUE(treeSlotRead(netTask.slot, out));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.0f, out.humidity);
+
+  // Sin WiFi: la conexión se suelta y los intentos se espacian 1, 2, 4... s
+  hal::sim::setWifi(false);
+  uint32_t start = hal::millis();
+  uint32_t attempts[5];
+  uint8_t seen = 0;
+  while (seen < 5) {
+    uint32_t before = hal::sim::state().wifiReconnects;
+    hal::delay(netTaskStep(hal::millis()));
+    if (hal::sim::state().wifiReconnects != before) attempts[seen++] = hal::millis() - start;
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, netTask.wifiDrops.load());
+  TEST_ASSERT_FALSE(netTask.client.link.connected());
+  for (uint8_t i = 2; i < 5; i++) {
+    uint32_t gap = attempts[i] - attempts[i - 1];
+    uint32_t previous = attempts[i - 1] - attempts[i - 2];
+    TEST_ASSERT_TRUE(gap >= previous * 2 - NET_CHECK_MS && gap <= previous * 2 + NET_CHECK_MS);
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, netTask.fetches.load());
+
+  // Vuelve el WiFi: consulta en cuanto toca y publica
+  hal::sim::setWifi(true);
+  uint32_t deadline = hal::millis() + POLL_MAX_MS;
+  while (netTask.fetches.load() < 2 && hal::millis() < deadline) hal::delay(netTaskStep(hal::millis()));
+  TEST_ASSERT_EQUAL_UINT32(2, netTask.fetches.load());
+  TEST_ASSERT_TRUE(treeSlotRead(netTask.slot, out));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 2.0f, out.humidity);
+}
+
+void test_hold_stops_reconnects() {
+  hal::sim::setWifi(false);
+  netTask.wifiHold.store(true);
+  for (uint32_t i = 0; i < 400; i++) hal::delay(netTaskStep(hal::millis()));
+  TEST_ASSERT_EQUAL_UINT32(0, hal::sim::state().wifiReconnects);
+
+  // Sin la retención vuelve a intentarlo en cuanto toca
+  netTask.wifiHold.store(false);
+  hal::delay(netTaskStep(hal::millis()));
+  TEST_ASSERT_EQUAL_UINT32(1, hal::sim::state().wifiReconnects);
+}
+
+void test_sleep_follows_poll_interval() {
+  hal::delay(netTaskStep(hal::millis()));
+  uint32_t firstPoll = netTask.poller.lastPollMs;
+  uint32_t interval = netTask.poller.intervalMs;
+  // Nunca duerme más de NET_CHECK_MS y despierta justo cuando toca consultar
+  uint32_t fetchStart = 0;
+  while (netTask.fetches.load() < 2) {
+    fetchStart = hal::millis();
+    uint32_t sleep = netTaskStep(fetchStart);
+    TEST_ASSERT_TRUE(sleep >= 1 && sleep <= NET_CHECK_MS);
+    hal::delay(sleep);
+  }
+  TEST_ASSERT_EQUAL_UINT32(interval, fetchStart - firstPoll);
+}
+
+void test_render_loop_not_blocked_by_slow_fetch() {
+  slowMs.store(150);
+  std::atomic<bool> stop(false);
+  std::thread network([&] {
+    while (!stop.load()) hal::delay(netTaskStep(hal::millis()));
+  });
+
+  // Loop de render: lee el slot y dibuja; nunca toca el hardware simulado
+  TreeData current;
+  uint32_t frames = 0;
+  uint32_t updates = 0;
+  float level = 0;
+  Clock::duration worst(0);
+  Clock::time_point end = Clock::now() + std::chrono::milliseconds(1000);
+  while (Clock::now() < end) {
+    Clock::time_point start = Clock::now();
+    if (treeSlotRead(netTask.slot, current)) updates++;
+    for (int i = 0; i < 200; i++) level = level * 0.99f + current.humidity * 0.01f;
+    frames++;
+    Clock::duration took = Clock::now() - start;
+    if (took > worst) worst = took;
+  }
+  stop.store(true);
+  network.join();
+
+  uint32_t worstMs = (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(worst).count();
+  printf("  frames %lu, instantáneas %lu, peor frame %lu ms, consulta más lenta %lu ms de reloj real\n",
+         (unsigned long)frames, (unsigned long)updates, (unsigned long)worstMs, (unsigned long)slowMs.load());
+  TEST_ASSERT_TRUE(served >= 3);
+  TEST_ASSERT_TRUE(updates >= 3);
+  TEST_ASSERT_TRUE(frames > 1000);
+  // Cada consulta tarda 150 ms; un frame nunca se acerca a eso
+  TEST_ASSERT_TRUE(worstMs < 50);
+  TEST_ASSERT_TRUE(level > 0);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_slot_hands_over_latest_snapshot);
+  RUN_TEST(test_slot_never_tears_between_threads);
+  RUN_TEST(test_step_fetches_and_backs_off_without_wifi);
+  RUN_TEST(test_hold_stops_reconnects);
+  RUN_TEST(test_sleep_follows_poll_interval);
+  RUN_TEST(test_render_loop_not_blocked_by_slow_fetch);
+  return UNITY_END();
+}
@@ -0,0 +1,202 @@
+/*
+ * test_params - Pruebas nativas del bus de parámetros (param_bus.h)
+ *
+ * Ejecutar con: pio test -e native -f test_params
+ */
+
+#include <unity.h>
+#include <string.h>
+
+#include "piezo_bugs.h"
+
+const uint8_t TEST_PIN = 30;
+
+static TreeData reading(float humidity, float temperature, float bio, float light) {
+  TreeData d;
+  d.humidity = humidity;
+  d.temperature = temperature;
+  d.bioelectrical_activity = bio;
+  d.light_level = light;
+  d.data_valid = true;
+  return d;
+}
+
+void setUp() {
+  hal::sim::reset(3);
+  rootNoteOffset = 0;
+  currentState = FREQ_NORMAL;
+  voicesClear();
+  paramBusBegin();
+}
+
+void tearDown() {}
+
+void test_curves_map_and_clamp() {
+  ParamMapping m = {TREE_HUMIDITY, PARAM_TRANSPOSE, CURVE_LINEAR, 30.0f, 90.0f, 5.0f, -5.0f};
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 5.0f, paramMap(m, 30.0f));
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 0.0f, paramMap(m, 60.0f));
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, -5.0f, paramMap(m, 90.0f));
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, -5.0f, paramMap(m, 150.0f));   // Satura
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 5.0f, paramMap(m, NAN));
+
+  // Exponencial: el punto medio es la media geométrica
+  m = {TREE_BIOELECTRICAL_ACTIVITY, PARAM_DENSITY, CURVE_EXPONENTIAL, 0.0f, 1.0f, 0.5f, 2.0f};
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 0.5f, paramMap(m, 0.0f));
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 1.0f, paramMap(m, 0.5f));
+  TEST_ASSERT_FLOAT_WITHIN(1e-5, 2.0f, paramMap(m, 1.0f));
+
+  // Las curvas suaves unen los mismos extremos
+  const ParamCurve curves[] = {CURVE_EASE_IN, CURVE_EASE_OUT, CURVE_SMOOTH};
+  for (ParamCurve c : curves) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0f, paramCurve(c, 0.0f));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.0f, paramCurve(c, 1.0f));
+  }
+  TEST_ASSERT_TRUE(paramCurve(CURVE_EASE_IN, 0.5f) < 0.5f);
+  TEST_ASSERT_TRUE(paramCurve(CURVE_EASE_OUT, 0.5f) > 0.5f);
+
+  // Los objetivos nunca salen del rango del parámetro
+  paramSetTarget(PARAM_DENSITY, 100.0f);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, PARAM_SPECS[PARAM_DENSITY].maxValue, paramTarget(PARAM_DENSITY));
+}
+
+void test_neutral_bus_keeps_timing() {
+  // Sin datos los intervalos son exactamente los de siempre
+  hal::sim::reset(11);
+  unsigned long raw = hal::random(2000, 8000);
+  hal::sim::reset(11);
+  TEST_ASSERT_EQUAL_UINT32(raw, getInsectSequenceInterval(SPIDER));
+
+  hal::sim::reset(11);
+  paramSetNow(PARAM_DENSITY, 2.0f);
+  TEST_ASSERT_EQUAL_UINT32((raw + 1) / 2, getInsectSequenceInterval(SPIDER));
+
+  hal::sim::reset(11);
+  raw = hal::random(80, 250);
+  hal::sim::reset(11);
+  paramSetNow(PARAM_NOTE_RATE, 0.5f);
+  TEST_ASSERT_EQUAL_UINT32(raw * 2, getInsectNoteInterval(CRICKET));
+}
+
+void test_tree_data_only_moves_targets() {
+  paramBusApplyTree(reading(30.0f, 30.0f, 0.008f, 0.0f));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 2.5f, paramTarget(PARAM_DENSITY));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 1.4f, paramTarget(PARAM_NOTE_RATE));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 5.0f, paramTarget(PARAM_TRANSPOSE));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 100.0f, paramTarget(PARAM_LED_HUE));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 0.0f, paramTarget(PARAM_LED_TINT));
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 1.0f, paramTarget(PARAM_ACTIVITY));
+  // Hasta el siguiente paso de control los valores no cambian
+  for (uint8_t p = 0; p < PARAM_COUNT; p++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, PARAM_SPECS[p].neutral, paramValue((ParamId)p));
+  }
+
+  // Datos no válidos no cuentan
+  paramBusApplyTree(TreeData());
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 2.5f, paramTarget(PARAM_DENSITY));
+  TEST_ASSERT_EQUAL_UINT32(1, paramBus.updates);
+}
+
+void test_smoothing_follows_time_constant() {
+  const uint32_t tau = PARAM_SPECS[PARAM_DENSITY].smoothMs;
+  paramSetTarget(PARAM_DENSITY, 3.0f);
+  paramBusTick(0);
+
+  float previous = 1.0f;
+  for (uint32_t t = PARAM_CONTROL_MS; t <= tau; t += PARAM_CONTROL_MS) {
+    paramBusTick(t);
+    float value = paramValue(PARAM_DENSITY);
+    TEST_ASSERT_TRUE(value >= previous);
+    TEST_ASSERT_TRUE(value <= 3.0f);
+    previous = value;
+  }
+  // Una constante de tiempo: 1 - 1/e del camino
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.0f + 2.0f * 0.632f, previous);
+
+  // Con pasos más largos se llega al mismo sitio
+  paramSetNow(PARAM_DENSITY, 1.0f);
+  paramSetTarget(PARAM_DENSITY, 3.0f);
+  for (uint32_t t = tau + 100; t <= 2 * tau; t += 100) paramBusTick(t);
+  TEST_ASSERT_FLOAT_WITHIN(0.01f, previous, paramValue(PARAM_DENSITY));
+
+  // Al final se fija exacto en el objetivo
+  for (uint32_t t = 2 * tau; t <= 20 * tau; t += PARAM_CONTROL_MS) paramBusTick(t);
+  TEST_ASSERT_TRUE(paramValue(PARAM_DENSITY) == 3.0f);
+  TEST_ASSERT_EQUAL_UINT32((1u << PARAM_COUNT) - 1, paramBus.settledMask);
+}
+
+void test_transpose_applies_at_play_time() {
+  int v = voiceAdd(SPIDER, TEST_PIN);
+  NoteIndex notes[MAX_SEQUENCE_LENGTH];
+  memcpy(notes, voices.notes[v], sizeof(notes));
+
+  paramSetNow(PARAM_TRANSPOSE, 2.6f);
+  voices.sequenceIndex[v] = 0;
+  voicePlaySound(v);
+  TEST_ASSERT_EQUAL_UINT32(noteFrequency(noteTranspose(notes[0], 3)), hal::sim::piezo(TEST_PIN).frequency);
+  // Las secuencias no se tocan
+  TEST_ASSERT_EQUAL_MEMORY(notes, voices.notes[v], sizeof(notes));
+
+  // Por encima del rango tocable vuelve una octava abajo
+  TEST_ASSERT_EQUAL_UINT8(NOTE_MAX_PLAYABLE - 7, noteTranspose(NOTE_MAX_PLAYABLE, 5));
+  TEST_ASSERT_EQUAL_UINT8(7, noteTranspose(2, -7));
+}
+
+void test_hue_shift_turns_wave_color() {
+  initNeopixel();
+  ledCompositorSetMaxFps(0);
+  updateNeopixel(LED_INTERVAL);
+  TEST_ASSERT_EQUAL_UINT8(NEO_COLOR_R, neoWaveColor[0]);
+  TEST_ASSERT_EQUAL_UINT8(NEO_COLOR_G, neoWaveColor[1]);
+  TEST_ASSERT_EQUAL_UINT8(NEO_COLOR_B, neoWaveColor[2]);
+
+  // Verde girado 120 grados tira a azul
+  paramSetNow(PARAM_LED_HUE, 120.0f);
+  updateNeopixel(LED_INTERVAL * 2);
+  TEST_ASSERT_TRUE(neoWaveColor[2] > neoWaveColor[1]);
+  TEST_ASSERT_TRUE(neoWaveColor[2] > neoWaveColor[0]);
+
+  // Hacia el otro lado, a amarillo
+  paramSetNow(PARAM_LED_HUE, -40.0f);
+  updateNeopixel(LED_INTERVAL * 3);
+  TEST_ASSERT_TRUE(neoWaveColor[0] > neoWaveColor[2]);
+  TEST_ASSERT_TRUE(neoWaveColor[1] > neoWaveColor[2]);
+
+  paramSetNow(PARAM_LED_HUE, 0.0f);
+  updateNeopixel(LED_INTERVAL * 4);
+  TEST_ASSERT_EQUAL_UINT8(NEO_COLOR_G, neoWaveColor[1]);
+}
+
+void test_low_activity_tints_the_wave() {
+  piezoBugsSetup();
+  TEST_ASSERT_FALSE(ledCompositor.active[neoTintLayer]);
+
+  // Árbol en reposo: el control lleva el tinte a la capa poco a poco
+  piezoBugsSetTreeData(reading(50.0f, 20.0f, 0.002f, 500.0f));
+  uint32_t now = hal::millis();
+  controlTask(now);
+  controlTask(now + 1000);
+  TEST_ASSERT_TRUE(ledCompositor.active[neoTintLayer]);
+  uint8_t early = neoTintAmount;
+  TEST_ASSERT_TRUE(early > 0 && early < 153);
+  for (uint32_t t = 1000; t <= 60000; t += PARAM_CONTROL_MS) controlTask(now + t);
+  TEST_ASSERT_EQUAL_UINT8(153, neoTintAmount);
+  TEST_ASSERT_EQUAL_UINT8(NEO_TINT_B, neoTint[2]);
+
+  // Con actividad alta el tinte desaparece y la capa se apaga
+  piezoBugsSetTreeData(reading(50.0f, 20.0f, 0.008f, 500.0f));
+  for (uint32_t t = 60000; t <= 120000; t += PARAM_CONTROL_MS) controlTask(now + t);
+  TEST_ASSERT_EQUAL_UINT8(0, neoTintAmount);
+  TEST_ASSERT_FALSE(ledCompositor.active[neoTintLayer]);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_curves_map_and_clamp);
+  RUN_TEST(test_neutral_bus_keeps_timing);
+  RUN_TEST(test_tree_data_only_moves_targets);
+  RUN_TEST(test_smoothing_follows_time_constant);
+  RUN_TEST(test_transpose_applies_at_play_time);
+  RUN_TEST(test_hue_shift_turns_wave_color);
+  RUN_TEST(test_low_activity_tints_the_wave);
+  return UNITY_END();
+}
@@ -0,0 +1,348 @@
+/*
+ * test_playlist - Pruebas nativas del índice de la lista de reproducción
+ * del wav_player (tests/wav_player/playlist_index.h)
+ *
+ * La SD es un directorio temporal con la carpeta /musica; la fecha de la
+ * carpeta se mueve a mano con utimes() para no depender de la resolución
+ * del reloj del sistema de archivos.
+ *
+ * Ejecutar con: pio test -e native -f test_playlist
+ */
+
+#include <unity.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "../../wav_player/playlist_index.h"
+
+static char root[] = "/tmp/test_playlist_XXXXXX";
+static char musicDir[128];
+
+struct TestWav {
+  uint16_t channels;
+  uint16_t bits;
+  uint32_t rate;
+  uint32_t frames;
+  bool listChunk;        // Bloque LIST entre "fmt " y "data"
+};
+
+static const TestWav MONO16 = {1, 16, 22050, 1000, false};
+
+static void put16(uint8_t *p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+static void put32(uint8_t *p, uint32_t v) { put16(p, v); put16(p + 2, v >> 16); }
+
+// Escribe /musica/name con PCM cuyo byte i vale i & 0xFF
+static void writeWav(const char *name, const TestWav &w) {
+  static uint8_t file[64 * 1024];
+  uint16_t block = w.channels * w.bits / 8;
+  uint32_t data = w.frames * block;
+  uint32_t p = 0;
+  memcpy(file, "RIFFxxxxWAVEfmt ", 16);
+  put32(file + 16, 16);
+  put16(file + 20, 1);
+  put16(file + 22, w.channels);
+  put32(file + 24, w.rate);
+  put32(file + 28, w.rate * block);
+  put16(file + 32, block);
+  put16(file + 34, w.bits);
+  p = 36;
+  if (w.listChunk) {
+    memcpy(file + p, "LIST", 4);
+    put32(file + p + 4, 13);           // Tamaño impar: lleva un byte de relleno
+    memset(file + p + 8, 'x', 14);
+    p += 8 + 14;
+  }
+  memcpy(file + p, "data", 4);
+  put32(file + p + 4, data);
+  p += 8;
+  for (uint32_t i = 0; i < data; i++) file[p + i] = i & 0xFF;
+  put32(file + 4, p + data - 8);
+
+  char path[384];
+  snprintf(path, sizeof(path), "%s/%s", musicDir, name);
+  FILE *f = fopen(path, "wb");
+  fwrite(file, 1, p + data, f);
+  fclose(f);
+}
+
+static void removeFile(const char *name) {
+  char path[384];
+  snprintf(path, sizeof(path), "%s/%s", musicDir, name);
+  unlink(path);
+}
+
+// Mueve la fecha de la carpeta, como al copiar archivos desde un PC
+static void touchDir(long seconds) {
+  struct timeval times[2] = {{seconds, 0}, {seconds, 0}};
+  utimes(musicDir, times);
+}
+
+static void clearDir() {
+  while (true) {
+    DIR *dir = opendir(musicDir);
+    struct dirent *entry;
+    char name[256] = "";
+    while ((entry = readdir(dir))) {
+      if (strcmp(entry->d_name, ".") && strcmp(entry->d_name, "..")) {
+        strcpy(name, entry->d_name);
+        break;
+      }
+    }
+    closedir(dir);
+    if (!name[0]) break;
+    removeFile(name);
+  }
+  char path[384];
+  snprintf(path, sizeof(path), "%s%s", root, PLAYLIST_INDEX);
+  unlink(path);
+}
+
+static bool listed(Playlist &list, const char *path) {
+  PlaylistEntry e;
+  for (uint32_t i = 0; i < list.count; i++) {
+    if (playlistGet(list, i, e) && strcmp(e.path, path) == 0) return true;
+  }
+  return false;
+}
+
+void setUp() {
+  clearDir();
+  playlistStats = PlaylistStats();
+}
+
+void tearDown() {}
+
+void test_header_is_parsed_past_extra_chunks() {
+  TestWav stereo = {2, 16, 44100, 500, true};
+  writeWav("a.wav", stereo);
+  Playlist list = {};
+  PlaylistEntry e;
+  TEST_ASSERT_TRUE(playlistBegin(list, root));
+  TEST_ASSERT_TRUE(playlistGet(list, 0, e));
+  TEST_ASSERT_EQUAL_STRING("/musica/a.wav", e.path);
+  TEST_ASSERT_EQUAL_UINT32(36 + 8 + 14 + 8, e.dataOffset);
+  TEST_ASSERT_EQUAL_UINT32(2000, e.dataBytes);
+  TEST_ASSERT_EQUAL_UINT32(44100, e.sampleRate);
+  TEST_ASSERT_EQUAL_UINT16(2, e.channels);
+  TEST_ASSERT_EQUAL_UINT16(4, e.blockAlign);
+  playlistEnd(list);
+}
+
+void test_unsupported_files_are_skipped() {
+  writeWav("bien.wav", MONO16);
+  TestWav bits24 = {1, 24, 22050, 100, false};
+  writeWav("24bits.wav", bits24);
+  writeWav("._bien.wav", MONO16);          // Metadatos de macOS
+  writeWav("nota.txt", MONO16);
+  char path[384];
+  snprintf(path, sizeof(path), "%s/roto.wav", musicDir);
+  FILE *f = fopen(path, "wb");
+  fputs("RIFF", f);
+  fclose(f);
+
+  Playlist list = {};
+  TEST_ASSERT_TRUE(playlistBegin(list, root));
+  TEST_ASSERT_EQUAL_UINT32(1, list.count);
+  TEST_ASSERT_EQUAL_UINT32(2, list.skipped);
+  TEST_ASSERT_TRUE(listed(list, "/musica/bien.wav"));
+  playlistEnd(list);
+}
+
+void test_many_tracks_are_indexed() {
+  char name[32];
+  for (uint16_t i = 0; i < 40; i++) {
+    snprintf(name, sizeof(name), "pista%02u.wav", i);
+    writeWav(name, MONO16);
+  }
+  Playlist list = {};
+  TEST_ASSERT_TRUE(playlistBegin(list, root));
+  TEST_ASSERT_TRUE(list.rebuilt);
+  TEST_ASSERT_EQUAL_UINT32(40, list.count);
+  TEST_ASSERT_TRUE(listed(list, "/musica/pista00.wav"));
+  TEST_ASSERT_TRUE(listed(list, "/musica/pista39.wav"));
+  playlistEnd(list);
+}
+
+void test_unchanged_folder_boots_from_the_index() {
+  char name[32];
+  for (uint16_t i = 0; i < 20; i++) {
+    snprintf(name, sizeof(name), "pista%02u.wav", i);
+    writeWav(name, MONO16);
+  }
+  touchDir(1000);
+  Playlist list = {};
+  TEST_ASSERT_TRUE(playlistBegin(list, root));
+  TEST_ASSERT_TRUE(list.rebuilt);
+  playlistEnd(list);
+
+  // Segundo arranque: abrir el índice y leer su cabecera, ninguna pista
+  playlistStats = PlaylistStats();
+  TEST_ASSERT_TRUE(playlistBegin(list, root));
+  TEST_ASSERT_FALSE(list.rebuilt);
+  TEST_ASSERT_EQUAL_UINT32(20, list.count);
+  TEST_ASSERT_EQUAL_UINT32(1, playlistStats.opens);
+  TEST_ASSERT_EQUAL_UINT32(1, playlistStats.reads);
+  TEST_ASSERT_EQUAL_UINT32(sizeof(PlaylistHeader), playlistStats.bytesRead);
+  TEST_ASSERT_EQUAL_UINT32(0, playlistStats.dirEntries);
+  playlistEnd(list);
+}
+
+void test_folder_change_rebuilds_the_index() {
+  writeWav("a.wav", MONO16);
+  touchDir(1000);
+  Playlist list = {};
+  TEST_ASSERT_TRUE(playlistBegin(list, root));
+  playlistEnd(list);
+
+  writeWav("b.wav", MONO16);
+  touchDir(2000);
+  TEST_ASSERT_TRUE(playlistBegin(list, root));
+  TEST_ASSERT_TRUE(list.rebuilt);
+  TEST_ASSERT_EQUAL_UINT32(2, list.count);
+  TEST_ASSERT_TRUE(listed(list, "/musica/b.wav"));
+  playlistEnd(list);
+
+  // Escribir el índice no mueve la fecha de la carpeta
+  TEST_ASSERT_TRUE(playlistBegin(list, root));
+  TEST_ASSERT_FALSE(list.rebuilt);
+  playlistEnd(list);
+}
+
+void test_corrupt_index_is_rebuilt() {
+  writeWav("a.wav", MONO16);
+  touchDir(1000);
+  Playlist list = {};
+  TEST_ASSERT_TRUE(playlistBegin(list, root));
+  playlistEnd(list);
+
+  // Índice truncado: el tamaño no cuadra con el número de entradas
+  char path[384];
+  snprintf(path, sizeof(path), "%s%s", root, PLAYLIST_INDEX);
+  TEST_ASSERT_EQUAL_INT(0, truncate(path, sizeof(PlaylistHeader) + 10));
+  TEST_ASSERT_TRUE(playlistBegin(list, root));
+  TEST_ASSERT_TRUE(list.rebuilt);
+  TEST_ASSERT_EQUAL_UINT32(1, list.count);
+  playlistEnd(list);
+}
+
+void test_track_opens_at_its_pcm() {
+  TestWav w = {1, 16, 22050, 100, true};
+  writeWav("a.wav", w);
+  Playlist list = {};
+  PlaylistEntry e;
+  TEST_ASSERT_TRUE(playlistBegin(list, root));
+  TEST_ASSERT_TRUE(playlistGet(list, 0, e));
+  int fd = playlistOpenTrack(list, e);
+  TEST_ASSERT_TRUE(fd >= 0);
+  uint8_t pcm[8];
+  TEST_ASSERT_EQUAL_INT32(8, playlistReadFile(fd, pcm, sizeof(pcm)));
+  for (uint8_t i = 0; i < 8; i++) TEST_ASSERT_EQUAL_UINT8(i, pcm[i]);
+  close(fd);
+  playlistEnd(list);
+}
+
+void test_missing_track_marks_the_index_stale() {
+  writeWav("a.wav", MONO16);
+  writeWav("b.wav", MONO16);
+  touchDir(1000);
+  Playlist list = {};
+  PlaylistEntry e;
+  TEST_ASSERT_TRUE(playlistBegin(list, root));
+  TEST_ASSERT_TRUE(playlistGet(list, 0, e));
+
+  // Borrado con un sistema que no mueve la fecha de la carpeta
+  removeFile(e.path + strlen(PLAYLIST_DIR) + 1);
+  touchDir(1000);
+  TEST_ASSERT_EQUAL_INT(-1, playlistOpenTrack(list, e));
+  TEST_ASSERT_TRUE(list.stale);
+  TEST_ASSERT_TRUE(playlistBegin(list, root));
+  TEST_ASSERT_TRUE(list.rebuilt);
+  TEST_ASSERT_EQUAL_UINT32(1, list.count);
+  playlistEnd(list);
+}
+
+// Fecha de un archivo de la carpeta, como la de un archivo copiado
+static void touchFile(const char *name, long seconds) {
+  char path[384];
+  snprintf(path, sizeof(path), "%s/%s", musicDir, name);
+  struct timeval times[2] = {{seconds, 0}, {seconds, 0}};
+  utimes(path, times);
+}
+
+void test_track_replaced_in_place_marks_the_index_stale() {
+  writeWav("a.wav", MONO16);
+  touchFile("a.wav", 1000);
+  touchDir(1000);
+  Playlist list = {};
+  PlaylistEntry e;
+  TEST_ASSERT_TRUE(playlistBegin(list, root));
+  TEST_ASSERT_TRUE(playlistGet(list, 0, e));
+  TEST_ASSERT_EQUAL_UINT32(MONO16.frames * 2, e.dataBytes);
+
+  // Otra grabación con el mismo nombre y la fecha de la carpeta intacta:
+  // más corta y con una cabecera de otro tamaño
+  TestWav shorter = {1, 16, 22050, 300, true};
+  writeWav("a.wav", shorter);
+  touchFile("a.wav", 2000);
+  touchDir(1000);
+  TEST_ASSERT_EQUAL_INT(-1, playlistOpenTrack(list, e));
+  TEST_ASSERT_TRUE(list.stale);
+  TEST_ASSERT_TRUE(playlistBegin(list, root));
+  TEST_ASSERT_TRUE(list.rebuilt);
+  TEST_ASSERT_TRUE(playlistGet(list, 0, e));
+  TEST_ASSERT_EQUAL_UINT32(shorter.frames * 2, e.dataBytes);
+  int fd = playlistOpenTrack(list, e);
+  TEST_ASSERT_TRUE(fd >= 0);
+  close(fd);
+
+  // Mismo tamaño y otra fecha (reescrita con otro contenido): también
+  writeWav("a.wav", shorter);
+  touchFile("a.wav", 3000);
+  touchDir(1000);
+  TEST_ASSERT_EQUAL_INT(-1, playlistOpenTrack(list, e));
+  TEST_ASSERT_TRUE(list.stale);
+  playlistEnd(list);
+}
+
+void test_frames_become_stereo_16_bits() {
+  PlaylistEntry e = {};
+  int16_t out[2];
+  const uint8_t mono8[] = {0xFF};
+  e.channels = 1;
+  e.bitsPerSample = 8;
+  wavFrameToStereo(e, mono8, out);
+  TEST_ASSERT_EQUAL_INT16(127 << 8, out[0]);
+  TEST_ASSERT_EQUAL_INT16(127 << 8, out[1]);
+
+  const uint8_t stereo16[] = {0x34, 0x12, 0x00, 0x80};
+  e.channels = 2;
+  e.bitsPerSample = 16;
+  wavFrameToStereo(e, stereo16, out);
+  TEST_ASSERT_EQUAL_INT16(0x1234, out[0]);
+  TEST_ASSERT_EQUAL_INT16(-32768, out[1]);
+}
+
+int main(int argc, char **argv) {
+  if (!mkdtemp(root)) return 1;
+  snprintf(musicDir, sizeof(musicDir), "%s%s", root, PLAYLIST_DIR);
+  mkdir(musicDir, 0755);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_header_is_parsed_past_extra_chunks);
+  RUN_TEST(test_unsupported_files_are_skipped);
+  RUN_TEST(test_many_tracks_are_indexed);
+  RUN_TEST(test_unchanged_folder_boots_from_the_index);
+  RUN_TEST(test_folder_change_rebuilds_the_index);
+  RUN_TEST(test_corrupt_index_is_rebuilt);
+  RUN_TEST(test_track_opens_at_its_pcm);
+  RUN_TEST(test_missing_track_marks_the_index_stale);
+  RUN_TEST(test_track_replaced_in_place_marks_the_index_stale);
+  RUN_TEST(test_frames_become_stereo_16_bits);
+  int failures = UNITY_END();
+  clearDir();
+  rmdir(musicDir);
+  rmdir(root);
+  return failures;
+}
@@ -0,0 +1,242 @@
+/*
+ * test_prefetch - Pruebas nativas de la lectura anticipada del wav_player
+ * (tests/wav_player/wav_prefetch.h)
+ *
+ * La pista es un archivo temporal; la lectura pasa por una función que
+ * apunta cada bloque pedido y adelanta un reloj de mentira con la latencia
+ * que toque. La tarea y el loop se alternan a mano.
+ *
+ * Ejecutar con: pio test -e native -f test_prefetch
+ */
+
+#include <unity.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../../wav_player/wav_prefetch.h"
+
+static char path[] = "/tmp/test_prefetch_XXXXXX";
+static const uint32_t DATA_OFFSET = 44;
+static const uint32_t DATA_BYTES = 40000;
+static const uint32_t RING = 2 * PREFETCH_BLOCK_SIZE;
+
+static uint8_t ring[4 * PREFETCH_BLOCK_SIZE];
+static Prefetch p;
+
+// Lecturas hechas (posición y tamaño) y latencias que se van a simular
+static uint32_t readPositions[64];
+static uint32_t readSizes[64];
+static uint8_t readCount;
+static uint32_t fakeNow;
+static const uint32_t *latencies;
+static uint8_t latencyCount;
+static bool failReads;
+
+static int32_t fakeRead(int fd, void *buffer, uint32_t bytes) {
+  if (failReads) return -1;
+  if (readCount < 64) {
+    readPositions[readCount] = lseek(fd, 0, SEEK_CUR);
+    readSizes[readCount] = bytes;
+  }
+  fakeNow += latencyCount ? latencies[readCount % latencyCount] : 100;
+  readCount++;
+  return read(fd, buffer, bytes);
+}
+
+static uint32_t fakeClock() { return fakeNow; }
+
+// Byte i del archivo
+static uint8_t fileByte(uint32_t i) { return (uint8_t)(i * 7 + (i >> 8)); }
+
+static int openTrack() {
+  int fd = open(path, O_RDONLY);
+  lseek(fd, DATA_OFFSET, SEEK_SET);
+  return fd;
+}
+
+// Arranca una pista y deja que la tarea atienda la petición
+static int startTrack() {
+  int fd = openTrack();
+  prefetchStart(p, fd, DATA_OFFSET, DATA_BYTES);
+  prefetchService(p);
+  return fd;
+}
+
+static void serviceUntilIdle() {
+  while (prefetchService(p)) {
+  }
+}
+
+void setUp() {
+  readCount = 0;
+  fakeNow = 0;
+  latencies = nullptr;
+  latencyCount = 0;
+  failReads = false;
+  prefetchBegin(p, ring, RING, fakeRead, fakeClock);
+}
+
+void tearDown() {
+  prefetchStop(p);
+  prefetchService(p);
+}
+
+void test_ring_size_must_be_whole_blocks() {
+  TEST_ASSERT_FALSE(prefetchBegin(p, ring, 3 * PREFETCH_BLOCK_SIZE, fakeRead, fakeClock));
+  TEST_ASSERT_FALSE(prefetchBegin(p, ring, PREFETCH_BLOCK_SIZE / 2, fakeRead, fakeClock));
+  TEST_ASSERT_TRUE(prefetchBegin(p, ring, 4 * PREFETCH_BLOCK_SIZE, fakeRead, fakeClock));
+}
+
+void test_reads_are_aligned_blocks() {
+  startTrack();
+  serviceUntilIdle();
+  // El primero llega hasta el final del bloque; los demás, bloques enteros
+  TEST_ASSERT_EQUAL_UINT8(2, readCount);
+  TEST_ASSERT_EQUAL_UINT32(DATA_OFFSET, readPositions[0]);
+  TEST_ASSERT_EQUAL_UINT32(PREFETCH_BLOCK_SIZE - DATA_OFFSET, readSizes[0]);
+  TEST_ASSERT_EQUAL_UINT32(PREFETCH_BLOCK_SIZE, readPositions[1]);
+  TEST_ASSERT_EQUAL_UINT32(PREFETCH_BLOCK_SIZE, readSizes[1]);
+}
+
+void test_full_ring_stops_reading() {
+  startTrack();
+  serviceUntilIdle();
+  TEST_ASSERT_FALSE(prefetchService(p));
+  uint8_t out[PREFETCH_BLOCK_SIZE];
+  // Liberar medio bloque no basta para el siguiente bloque alineado
+  prefetchRead(p, out, PREFETCH_BLOCK_SIZE / 2, 2);
+  TEST_ASSERT_FALSE(prefetchService(p));
+  prefetchRead(p, out, PREFETCH_BLOCK_SIZE, 2);
+  TEST_ASSERT_TRUE(prefetchService(p));
+}
+
+void test_loop_gets_the_pcm_in_order() {
+  startTrack();
+  static uint8_t out[700];
+  uint32_t position = DATA_OFFSET;
+  while (!prefetchFinished(p)) {
+    prefetchService(p);
+    uint32_t n = prefetchRead(p, out, sizeof(out), 4);
+    TEST_ASSERT_EQUAL_UINT32(0, n % 4);
+    for (uint32_t i = 0; i < n; i++) TEST_ASSERT_EQUAL_UINT8(fileByte(position + i), out[i]);
+    position += n;
+  }
+  TEST_ASSERT_EQUAL_UINT32(DATA_OFFSET + DATA_BYTES, position);
+  TEST_ASSERT_EQUAL_UINT32(DATA_BYTES, p.stats.bytes);
+}
+
+void test_underrun_is_counted_once_per_empty_spell() {
+  startTrack();
+  uint8_t out[PREFETCH_BLOCK_SIZE];
+  // Esperar al primer bloque de la pista no es un vacío
+  TEST_ASSERT_EQUAL_UINT32(0, prefetchRead(p, out, sizeof(out), 2));
+  TEST_ASSERT_EQUAL_UINT32(0, p.stats.underruns);
+  TEST_ASSERT_EQUAL_UINT32(RING, p.stats.fillMin);
+
+  prefetchService(p);
+  TEST_ASSERT_TRUE(prefetchRead(p, out, sizeof(out), 2) > 0);
+  TEST_ASSERT_EQUAL_UINT32(0, prefetchRead(p, out, sizeof(out), 2));
+  TEST_ASSERT_EQUAL_UINT32(0, prefetchRead(p, out, sizeof(out), 2));
+  TEST_ASSERT_EQUAL_UINT32(1, p.stats.underruns);
+
+  prefetchService(p);
+  TEST_ASSERT_TRUE(prefetchRead(p, out, sizeof(out), 2) > 0);
+  TEST_ASSERT_EQUAL_UINT32(0, prefetchRead(p, out, sizeof(out), 2));
+  TEST_ASSERT_EQUAL_UINT32(2, p.stats.underruns);
+
+  // Al final de la pista el anillo vacío no es un vacío
+  while (!prefetchFinished(p)) {
+    prefetchService(p);
+    prefetchRead(p, out, sizeof(out), 2);
+  }
+  uint32_t underruns = p.stats.underruns;
+  TEST_ASSERT_EQUAL_UINT32(0, prefetchRead(p, out, sizeof(out), 2));
+  TEST_ASSERT_EQUAL_UINT32(underruns, p.stats.underruns);
+}
+
+void test_track_switch_waits_for_the_task() {
+  int first = startTrack();
+  serviceUntilIdle();
+  int second = openTrack();
+  TEST_ASSERT_TRUE(prefetchStart(p, second, DATA_OFFSET, 1000));
+  // Pendiente: el loop no lee lo que queda de la pista anterior ni cuenta vacíos
+  uint8_t out[64];
+  TEST_ASSERT_TRUE(prefetchPending(p));
+  TEST_ASSERT_FALSE(prefetchStart(p, -1, 0, 0));
+  TEST_ASSERT_EQUAL_UINT32(0, prefetchRead(p, out, sizeof(out), 2));
+  TEST_ASSERT_EQUAL_UINT32(0, p.stats.underruns);
+
+  // Al atenderla la tarea cierra el archivo anterior
+  TEST_ASSERT_TRUE(prefetchService(p));
+  TEST_ASSERT_FALSE(prefetchPending(p));
+  TEST_ASSERT_EQUAL_INT(-1, fcntl(first, F_GETFD));
+  prefetchService(p);
+  TEST_ASSERT_EQUAL_UINT32(64, prefetchRead(p, out, sizeof(out), 2));
+  TEST_ASSERT_EQUAL_UINT8(fileByte(DATA_OFFSET), out[0]);
+}
+
+void test_read_latency_histogram() {
+  static const uint32_t LATENCIES[] = {500, 3000, 150000};
+  latencies = LATENCIES;
+  latencyCount = 3;
+  startTrack();
+  uint8_t out[PREFETCH_BLOCK_SIZE];
+  for (uint8_t i = 0; i < 3; i++) {
+    prefetchService(p);
+    prefetchRead(p, out, sizeof(out), 2);
+  }
+  TEST_ASSERT_EQUAL_UINT32(3, p.stats.blocks);
+  TEST_ASSERT_EQUAL_UINT32(150000, p.stats.readUsMax);
+  TEST_ASSERT_EQUAL_UINT64(153500, p.stats.readUsTotal);
+  TEST_ASSERT_EQUAL_UINT32(1, p.stats.readHistogram[0]);
+  TEST_ASSERT_EQUAL_UINT32(1, p.stats.readHistogram[2]);
+  TEST_ASSERT_EQUAL_UINT32(1, p.stats.readHistogram[PREFETCH_LATENCY_BUCKETS - 1]);
+}
+
+void test_fill_levels_are_recorded() {
+  startTrack();
+  serviceUntilIdle();
+  uint8_t out[PREFETCH_BLOCK_SIZE];
+  // Lleno menos el trozo inicial hasta el bloque: último octavo
+  prefetchRead(p, out, 16, 2);
+  TEST_ASSERT_EQUAL_UINT32(1, p.stats.fillHistogram[PREFETCH_FILL_BUCKETS - 1]);
+  // Vaciarlo: la última lectura lo encuentra en el primer octavo
+  for (uint8_t i = 0; i < 3; i++) prefetchRead(p, out, sizeof(out), 2);
+  TEST_ASSERT_EQUAL_UINT32(1, p.stats.fillHistogram[0]);
+  TEST_ASSERT_TRUE(p.stats.fillMin < PREFETCH_BLOCK_SIZE / 8);
+  prefetchStatsReset(p);
+  TEST_ASSERT_EQUAL_UINT32(RING, p.stats.fillMin);
+}
+
+void test_read_error_ends_the_track() {
+  startTrack();
+  failReads = true;
+  TEST_ASSERT_FALSE(prefetchService(p));
+  TEST_ASSERT_EQUAL_UINT32(1, p.stats.readErrors);
+  TEST_ASSERT_TRUE(prefetchFinished(p));
+}
+
+int main(int argc, char **argv) {
+  int fd = mkstemp(path);
+  if (fd < 0) return 1;
+  static uint8_t data[DATA_OFFSET + DATA_BYTES];
+  for (uint32_t i = 0; i < sizeof(data); i++) data[i] = fileByte(i);
+  if (write(fd, data, sizeof(data)) != (ssize_t)sizeof(data)) return 1;
+  close(fd);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_ring_size_must_be_whole_blocks);
+  RUN_TEST(test_reads_are_aligned_blocks);
+  RUN_TEST(test_full_ring_stops_reading);
+  RUN_TEST(test_loop_gets_the_pcm_in_order);
+  RUN_TEST(test_underrun_is_counted_once_per_empty_spell);
+  RUN_TEST(test_track_switch_waits_for_the_task);
+  RUN_TEST(test_read_latency_histogram);
+  RUN_TEST(test_fill_levels_are_recorded);
+  RUN_TEST(test_read_error_ends_the_track);
+  int failures = UNITY_END();
+  unlink(path);
+  return failures;
+}
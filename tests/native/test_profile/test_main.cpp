@@ -0,0 +1,114 @@
+/*
+ * test_profile - Pruebas nativas del perfilador (profile.h)
+ *
+ * Se compila con el perfilador activo y el contador de ciclos manual de la
+ * HAL nativa, para que las duraciones sean exactas.
+ *
+ * Ejecutar con: pio test -e native -f test_profile
+ */
+
+#define ENABLE_PROFILER 1
+
+#include <unity.h>
+
+#include "piezo_bugs.h"
+
+static void runUntil(uint32_t ms) {
+  while (hal::millis() < ms) piezoBugsLoop();
+}
+
+void setUp() {
+  hal::sim::reset(2);
+  hal::sim::setManualCycles(true);
+  profileReset();
+}
+
+void tearDown() {}
+
+void test_buckets_cover_every_value_with_bounded_error() {
+  uint8_t previous = 0;
+  for (uint64_t x = 1; x <= 0xFFFFFFFFull; x = x * 9 / 8 + 1) {
+    uint32_t cycles = (uint32_t)x;
+    uint8_t b = profileBucket(cycles);
+    TEST_ASSERT_TRUE(b < PROFILE_BUCKETS);
+    TEST_ASSERT_TRUE(b >= previous);                  // Monótono
+    TEST_ASSERT_TRUE(profileBucketTop(b) >= cycles);
+    TEST_ASSERT_TRUE(profileBucketTop(b) - cycles <= cycles / 4);
+    if (b > 0) TEST_ASSERT_TRUE(profileBucketTop(b - 1) < cycles);
+    previous = b;
+  }
+  TEST_ASSERT_EQUAL_UINT8(PROFILE_BUCKETS - 1, profileBucket(0xFFFFFFFFu));
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFFu, profileBucketTop(PROFILE_BUCKETS - 1));
+}
+
+void test_stats_and_p99() {
+  for (int i = 0; i < 990; i++) profileRecord(PROF_VOICES, 100);
+  for (int i = 0; i < 10; i++) profileRecord(PROF_VOICES, 10000);
+  const ProfileHistogram &h = profiler.zones[PROF_VOICES];
+  TEST_ASSERT_EQUAL_UINT32(1000, h.count);
+  TEST_ASSERT_EQUAL_UINT32(100, h.minCycles);
+  TEST_ASSERT_EQUAL_UINT32(10000, h.maxCycles);
+  TEST_ASSERT_EQUAL_UINT32(199, profileMean(h));
+  // El p99 cae en la cubeta de 100, sin pasar del 25 %
+  uint32_t p99 = profilePercentile(h, 0.99f);
+  TEST_ASSERT_TRUE(p99 >= 100 && p99 <= 125);
+  TEST_ASSERT_EQUAL_UINT32(10000, profilePercentile(h, 0.999f));
+  TEST_ASSERT_EQUAL_UINT32(0, profilePercentile(profiler.zones[PROF_BUTTONS], 0.99f));
+}
+
+void test_scope_measures_its_block() {
+  {
+    PROFILE_SCOPE(PROF_CONTROL);
+    hal::sim::advanceCycles(500);
+    {
+      PROFILE_SCOPE(PROF_BUTTON_ADC);
+      hal::sim::advanceCycles(20);
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(520, profiler.zones[PROF_CONTROL].maxCycles);
+  TEST_ASSERT_EQUAL_UINT32(20, profiler.zones[PROF_BUTTON_ADC].maxCycles);
+
+  // El contador de 32 bits puede dar la vuelta en medio
+  profileReset();
+  hal::sim::advanceCycles(0xFFFFFFFFu - hal::cycleCount() - 10);
+  {
+    PROFILE_SCOPE(PROF_CONTROL);
+    hal::sim::advanceCycles(30);
+  }
+  TEST_ASSERT_EQUAL_UINT32(30, profiler.zones[PROF_CONTROL].maxCycles);
+}
+
+void test_app_zones_and_serial_commands() {
+  piezoBugsSetup();
+  runUntil(5000);
+  // Botones sin pulsar: la tarea solo corre para muestrear el ADC
+  const uint32_t buttonRuns = scheduler.tasks[buttonsTaskId].runs;
+  TEST_ASSERT_TRUE(buttonRuns >= 5000 / BUTTON_ADC_POLL_MS);
+  TEST_ASSERT_EQUAL_UINT32(buttonRuns, profiler.zones[PROF_BUTTONS].count);
+  TEST_ASSERT_EQUAL_UINT32(buttonRuns, profiler.zones[PROF_BUTTON_ADC].count);
+  TEST_ASSERT_EQUAL_UINT32(scheduler.tasks[controlTaskId].runs, profiler.zones[PROF_CONTROL].count);
+  TEST_ASSERT_EQUAL_UINT32(scheduler.tasks[neopixelTaskId].runs, profiler.zones[PROF_NEOPIXEL].count);
+  TEST_ASSERT_EQUAL_UINT32(scheduler.tasks[voicesTaskId].runs, profiler.zones[PROF_VOICES].count);
+  TEST_ASSERT_EQUAL_UINT32(neoFrame.shows + neoFrame.busySkips, profiler.zones[PROF_NEOPIXEL_SHOW].count);
+  TEST_ASSERT_TRUE(profiler.zones[PROF_VALIDATE].count >= voices.processed);
+  TEST_ASSERT_TRUE(profiler.zones[PROF_TASKS].count > 0);
+
+  // 'p' vuelca sin tocar nada; 'r' pone a cero
+  hal::sim::serialInput("p");
+  runUntil(hal::millis() + PROFILE_POLL_MS + 1);
+  TEST_ASSERT_EQUAL(0, Serial.available());
+  TEST_ASSERT_TRUE(profiler.zones[PROF_BUTTONS].count > buttonRuns);
+
+  hal::sim::serialInput("r");
+  runUntil(hal::millis() + PROFILE_POLL_MS + 1);
+  TEST_ASSERT_TRUE(profiler.zones[PROF_BUTTONS].count < PROFILE_POLL_MS / BUTTON_ADC_POLL_MS + 2);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_buckets_cover_every_value_with_bounded_error);
+  RUN_TEST(test_stats_and_p99);
+  RUN_TEST(test_scope_measures_its_block);
+  RUN_TEST(test_app_zones_and_serial_commands);
+  return UNITY_END();
+}
@@ -0,0 +1,161 @@
+/*
+ * test_resampler - Pruebas nativas del conversor de frecuencia polifásico
+ * (resampler.h)
+ *
+ * Ejecutar con: pio test -e native -f test_resampler
+ */
+
+#include <unity.h>
+
+#include <math.h>
+
+#include "resampler.h"
+
+static int16_t coeffs[SAMPLE_RATE_COEFFS];
+static ResamplerTable table;
+static Resampler resampler;
+
+static int16_t input[48000];
+static int16_t output[66150];
+
+// En double: con la fase en float el propio tono ya trae ruido a -50 dB
+static void fillTone(uint32_t rate, double frequency, double amplitude, uint32_t frames) {
+  for (uint32_t i = 0; i < frames; i++) input[i] = (int16_t)lround(amplitude * sin(2.0 * M_PI * frequency * i / rate));
+}
+
+// Convierte frames entradas de input en trozos de chunk, con la cola; devuelve las salidas
+static uint32_t convert(uint32_t frames, uint32_t chunk) {
+  resamplerReset(resampler, &table);
+  uint32_t produced = 0, position = 0, end = frames + table.taps / 2;
+  while (position < end && produced < sizeof(output) / 2) {
+    uint32_t n = end - position;
+    if (n > chunk) n = chunk;
+    uint32_t used;
+    produced += resamplerProcess(resampler, position < frames ? input + position : nullptr,
+                                 position < frames && position + n > frames ? frames - position : n,
+                                 output + produced, sizeof(output) / 2 - produced, used);
+    position += used;
+  }
+  return produced;
+}
+
+// Pico absoluto de output[from, to)
+static int32_t peak(uint32_t from, uint32_t to) {
+  int32_t p = 0;
+  for (uint32_t i = from; i < to; i++) {
+    int32_t a = output[i] < 0 ? -(int32_t)output[i] : output[i];
+    if (a > p) p = a;
+  }
+  return p;
+}
+
+void setUp() { memset(input, 0, sizeof(input)); }
+
+void tearDown() {}
+
+void test_every_phase_has_unity_gain() {
+  TEST_ASSERT_TRUE(resamplerTableBuild(table, 8000, 22050, coeffs, SAMPLE_RATE_COEFFS));
+  TEST_ASSERT_EQUAL_UINT8(RESAMPLER_TAPS, table.taps);
+  for (uint16_t p = 0; p <= RESAMPLER_PHASES; p++) {
+    int32_t sum = 0;
+    for (uint8_t j = 0; j < table.taps; j++) sum += table.coeffs[p * table.taps + j];
+    TEST_ASSERT_EQUAL_INT32(32768, sum);
+  }
+}
+
+void test_downsampling_widens_the_filter() {
+  TEST_ASSERT_TRUE(resamplerTableBuild(table, 44100, 22050, coeffs, SAMPLE_RATE_COEFFS));
+  TEST_ASSERT_EQUAL_UINT8(2 * RESAMPLER_TAPS, table.taps);
+  TEST_ASSERT_EQUAL_UINT32(2, table.stepInt);
+  TEST_ASSERT_EQUAL_UINT32(0, table.stepFrac);
+  TEST_ASSERT_EQUAL_UINT8(70, resamplerTaps(48000, 22050));
+}
+
+void test_unsupported_or_oversized_tables_are_refused() {
+  TEST_ASSERT_FALSE(resamplerTableBuild(table, 96000, 22050, coeffs, SAMPLE_RATE_COEFFS));
+  TEST_ASSERT_FALSE(resamplerTableBuild(table, 0, 22050, coeffs, SAMPLE_RATE_COEFFS));
+  TEST_ASSERT_FALSE(resamplerTableBuild(table, 8000, 22050, coeffs, resamplerTableSize(RESAMPLER_TAPS) - 1));
+  TEST_ASSERT_TRUE(resamplerTableBuild(table, 8000, 22050, coeffs, resamplerTableSize(RESAMPLER_TAPS)));
+}
+
+void test_output_count_follows_the_ratio() {
+  resamplerTableBuild(table, 8000, 22050, coeffs, SAMPLE_RATE_COEFFS);
+  uint32_t n = convert(8000, 8000);
+  // Un segundo de entrada es un segundo de salida, más la cola del filtro
+  TEST_ASSERT_TRUE(n >= 22050 && n <= 22050 + 3 * RESAMPLER_TAPS / 2);
+}
+
+void test_chunking_does_not_change_the_output() {
+  resamplerTableBuild(table, 11025, 22050, coeffs, SAMPLE_RATE_COEFFS);
+  for (uint32_t i = 0; i < 4000; i++) input[i] = (int16_t)((i * 7919) % 20001 - 10000);
+  uint32_t n = convert(4000, 4000);
+  static int16_t whole[8200];
+  memcpy(whole, output, n * 2);
+  TEST_ASSERT_EQUAL_UINT32(n, convert(4000, 37));
+  TEST_ASSERT_EQUAL_INT16_ARRAY(whole, output, n);
+  TEST_ASSERT_EQUAL_UINT32(n, convert(4000, 1));
+  TEST_ASSERT_EQUAL_INT16_ARRAY(whole, output, n);
+}
+
+void test_impulse_lands_at_its_time() {
+  resamplerTableBuild(table, 11025, 22050, coeffs, SAMPLE_RATE_COEFFS);
+  input[100] = 20000;
+  convert(400, 400);
+  int32_t best = 0;
+  for (uint32_t i = 1; i < 800; i++) {
+    if (output[i] > output[best]) best = i;
+  }
+  TEST_ASSERT_EQUAL_UINT32(200, best);
+}
+
+void test_constant_input_stays_constant() {
+  resamplerTableBuild(table, 16000, 22050, coeffs, SAMPLE_RATE_COEFFS);
+  for (uint32_t i = 0; i < 4000; i++) input[i] = -12345;
+  convert(4000, 256);
+  for (uint32_t i = 100; i < 5000; i++) TEST_ASSERT_INT16_WITHIN(1, -12345, output[i]);
+}
+
+void test_passband_tone_keeps_its_amplitude() {
+  resamplerTableBuild(table, 8000, 22050, coeffs, SAMPLE_RATE_COEFFS);
+  fillTone(8000, 1000, 20000, 8000);
+  convert(8000, 128);
+  int32_t p = peak(1000, 20000);
+  TEST_ASSERT_INT32_WITHIN(100, 20000, p);
+}
+
+void test_tone_above_the_output_nyquist_is_removed() {
+  resamplerTableBuild(table, 44100, 22050, coeffs, SAMPLE_RATE_COEFFS);
+  fillTone(44100, 15000, 30000, 44100);
+  convert(44100, 128);
+  // Por debajo de -70 dB respecto a la entrada
+  TEST_ASSERT_TRUE(peak(100, 21900) < 10);
+}
+
+void test_images_of_an_upsampled_tone_are_removed() {
+  resamplerTableBuild(table, 8000, 22050, coeffs, SAMPLE_RATE_COEFFS);
+  fillTone(8000, 2000, 20000, 8000);
+  convert(8000, 128);
+  // Resta el tono ideal: lo que queda son imágenes (6 kHz, 10 kHz...) y ruido
+  double error = 0, signal = 0;
+  for (uint32_t i = 1000; i < 21000; i++) {
+    double ideal = 20000.0 * sin(2.0 * M_PI * 2000.0 * i / 22050);
+    error += (output[i] - ideal) * (output[i] - ideal);
+    signal += ideal * ideal;
+  }
+  TEST_ASSERT_TRUE(10 * log10(error / signal) < -55);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_every_phase_has_unity_gain);
+  RUN_TEST(test_downsampling_widens_the_filter);
+  RUN_TEST(test_unsupported_or_oversized_tables_are_refused);
+  RUN_TEST(test_output_count_follows_the_ratio);
+  RUN_TEST(test_chunking_does_not_change_the_output);
+  RUN_TEST(test_impulse_lands_at_its_time);
+  RUN_TEST(test_constant_input_stays_constant);
+  RUN_TEST(test_passband_tone_keeps_its_amplitude);
+  RUN_TEST(test_tone_above_the_output_nyquist_is_removed);
+  RUN_TEST(test_images_of_an_upsampled_tone_are_removed);
+  return UNITY_END();
+}
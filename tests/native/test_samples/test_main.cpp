@@ -0,0 +1,368 @@
+/*
+ * test_samples - Pruebas nativas del banco de muestras en flash
+ * (sample_bank.h) y de la caché LRU en PSRAM (samples.h)
+ *
+ * La partición de datos es un archivo temporal proyectado con mmap
+ * (hal::sim::flashAttachFile) y la SD, un directorio temporal.
+ *
+ * Ejecutar con: pio test -e native -f test_samples
+ */
+
+#include <unity.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "samples.h"
+
+struct TestSample {
+  const char *name;
+  uint32_t frames;
+  SampleSource source;
+  uint32_t rate;
+};
+
+static char root[] = "/tmp/test_samples_XXXXXX";
+static char flashPath[128];
+static char created[SAMPLE_MAX][192];   // Para borrarlos al terminar
+static uint8_t createdCount = 0;
+
+// Valor de la muestra id en la posición i
+static int16_t pcmValue(uint16_t id, uint32_t i) {
+  return (int16_t)(((i * 37 + id * 1000) % 20000) - 10000);
+}
+
+static void writeFile(const char *path, const void *data, uint32_t size) {
+  FILE *f = fopen(path, "wb");
+  fwrite(data, 1, size, f);
+  fclose(f);
+  for (uint8_t i = 0; i < createdCount; i++) {
+    if (strcmp(created[i], path) == 0) return;
+  }
+  if (createdCount < SAMPLE_MAX) snprintf(created[createdCount++], sizeof(created[0]), "%s", path);
+}
+
+// Banco en la "flash" (archivo) y WAV de las muestras de la SD
+static void buildBank(const TestSample *list, uint16_t count) {
+  static uint8_t image[512 * 1024];
+  memset(image, 0xFF, sizeof(image));
+  uint8_t *bank = image + SAMPLE_BANK_OFFSET;
+  uint32_t dataStart = sizeof(SampleBankHeader) + count * sizeof(SampleBankEntry);
+  uint32_t offset = dataStart;
+  SampleBankEntry *entries = (SampleBankEntry *)(bank + sizeof(SampleBankHeader));
+  static int16_t pcm[SAMPLE_CACHE_SLOT_FRAMES + 16];
+
+  for (uint16_t id = 0; id < count; id++) {
+    SampleBankEntry &e = entries[id];
+    memset(&e, 0, sizeof(e));
+    strncpy(e.name, list[id].name, SAMPLE_NAME_SIZE - 1);
+    e.frames = list[id].frames;
+    e.sampleRate = list[id].rate;
+    e.source = list[id].source;
+    for (uint32_t i = 0; i < e.frames; i++) pcm[i] = pcmValue(id, i);
+    if (e.source == SAMPLE_IN_FLASH) {
+      e.offset = offset;
+      memcpy(bank + offset, pcm, e.frames * 2);
+      offset += (e.frames * 2 + 3) & ~3u;
+    } else {
+      snprintf(e.path, SAMPLE_PATH_SIZE, "/%s.wav", list[id].name);
+      e.offset = 44;
+      char path[192];
+      snprintf(path, sizeof(path), "%s%s", root, e.path);
+      static uint8_t wav[44 + sizeof(pcm)];
+      memset(wav, 0, 44);
+      memcpy(wav + 44, pcm, e.frames * 2);
+      writeFile(path, wav, 44 + e.frames * 2);
+    }
+  }
+  SampleBankHeader header = {SAMPLE_BANK_MAGIC, SAMPLE_BANK_VERSION, count, offset,
+                             crc32(entries, dataStart - sizeof(SampleBankHeader))};
+  memcpy(bank, &header, sizeof(header));
+  writeFile(flashPath, image, SAMPLE_BANK_OFFSET + ((offset + 4095) & ~4095u));
+  TEST_ASSERT_TRUE(hal::sim::flashAttachFile(flashPath));
+}
+
+static const TestSample DEFAULT_BANK[] = {
+  {"gota", 2000, SAMPLE_IN_FLASH, SYNTH_SAMPLE_RATE},
+  {"crujido", 3001, SAMPLE_IN_FLASH, SYNTH_SAMPLE_RATE},
+  {"lluvia", 11025, SAMPLE_ON_SD, SYNTH_SAMPLE_RATE},
+};
+
+// Ejecuta la tarea de muestras hasta terminar la carga en curso
+static void finishLoads() {
+  for (int i = 0; i < 10000 && samplesLoading(); i++) samplesTask(hal::millis());
+}
+
+void setUp() {
+  hal::sim::reset(1);
+  hal::sim::setSdRoot(root);
+  synthInit();
+  logClear();
+}
+
+void tearDown() {}
+
+void test_bank_is_read_in_place() {
+  buildBank(DEFAULT_BANK, 3);
+  TEST_ASSERT_TRUE(sampleBankBegin(sampleBank));
+  TEST_ASSERT_EQUAL_UINT16(3, sampleBank.count);
+  TEST_ASSERT_EQUAL_UINT16(2, sampleBank.flashCount);
+  TEST_ASSERT_EQUAL_UINT16(1, sampleBank.sdCount);
+  TEST_ASSERT_EQUAL_INT16(1, sampleFind(sampleBank, "crujido"));
+  TEST_ASSERT_EQUAL_INT16(-1, sampleFind(sampleBank, "trueno"));
+
+  // El PCM es el de la flash proyectada, no una copia
+  const int16_t *data = sampleBankData(sampleBank, 1);
+  TEST_ASSERT_TRUE((const uint8_t *)data == hal::sim::flashData() + SAMPLE_BANK_OFFSET + sampleBank.entries[1].offset);
+  for (uint32_t i = 0; i < 3001; i++) TEST_ASSERT_EQUAL_INT16(pcmValue(1, i), data[i]);
+}
+
+void test_missing_or_corrupt_bank_is_rejected() {
+  // Flash en RAM sin banco
+  TEST_ASSERT_FALSE(sampleBankBegin(sampleBank));
+  TEST_ASSERT_EQUAL_UINT8(SAMPLE_BANK_EMPTY, sampleBank.error);
+  TEST_ASSERT_NULL(sampleBank.base);
+
+  // Un bit del directorio cambiado
+  buildBank(DEFAULT_BANK, 3);
+  uint8_t zero = 0;
+  TEST_ASSERT_TRUE(hal::flashWrite(SAMPLE_BANK_OFFSET + sizeof(SampleBankHeader) + 1, &zero, 1));
+  TEST_ASSERT_FALSE(sampleBankBegin(sampleBank));
+  TEST_ASSERT_EQUAL_UINT8(SAMPLE_BANK_BAD_CRC, sampleBank.error);
+  TEST_ASSERT_EQUAL_UINT16(0, sampleBank.count);
+}
+
+void test_flash_sample_plays_from_the_mapping() {
+  buildBank(DEFAULT_BANK, 3);
+  samplesBegin(0, false);
+  TEST_ASSERT_TRUE(samplePlayByName("gota", 16384, 0));
+  TEST_ASSERT_EQUAL_UINT32(1, samples.flashPlays);
+
+  static int16_t block[SYNTH_BLOCK_FRAMES * 2];
+  synthRender(block, SYNTH_BLOCK_FRAMES);
+  TEST_ASSERT_TRUE(synth.sampleData[0] == sampleBankData(sampleBank, 0));
+  for (uint16_t i = 0; i < SYNTH_BLOCK_FRAMES; i++) {
+    TEST_ASSERT_EQUAL_INT16((pcmValue(0, i) * 16384) >> 15, block[2 * i]);
+  }
+  // 2000 muestras: se apaga sola tras 16 bloques
+  for (int b = 0; b < 15; b++) synthRender(block, SYNTH_BLOCK_FRAMES);
+  TEST_ASSERT_EQUAL_UINT8(0, synth.sampleMask);
+  TEST_ASSERT_EQUAL_UINT32(0, hal::sim::state().sdOpens);
+}
+
+void test_sd_sample_misses_once_then_plays_from_psram() {
+  buildBank(DEFAULT_BANK, 3);
+  samplesBegin(0, true);
+  TEST_ASSERT_EQUAL_UINT8(SAMPLE_CACHE_SLOTS, samples.slots);
+
+  // Primer disparo: fallo, se carga y suena al terminar
+  TEST_ASSERT_FALSE(samplePlay(2, 32767, hal::millis()));
+  TEST_ASSERT_TRUE(samplesLoading());
+  finishLoads();
+  TEST_ASSERT_EQUAL_UINT32(1, samples.misses);
+  TEST_ASSERT_EQUAL_UINT32(1, samples.loads);
+  TEST_ASSERT_EQUAL_UINT32(0, samples.late);
+  synthDrainEvents();
+  TEST_ASSERT_EQUAL_UINT8(1, synth.sampleMask);
+  TEST_ASSERT_EQUAL_INT16(pcmValue(2, 11024), synth.sampleData[0][11024]);
+
+  // Segundo: acierto, sin tocar la SD
+  uint32_t opens = hal::sim::state().sdOpens;
+  uint64_t bytes = hal::sim::state().sdBytesRead;
+  TEST_ASSERT_TRUE(samplePlay(2, 32767, hal::millis()));
+  TEST_ASSERT_EQUAL_UINT32(1, samples.hits);
+  TEST_ASSERT_EQUAL_UINT32(opens, hal::sim::state().sdOpens);
+  TEST_ASSERT_TRUE(bytes == hal::sim::state().sdBytesRead);
+  TEST_ASSERT_EQUAL_UINT8(50, sampleCacheHitPercent());
+}
+
+void test_least_recently_used_slot_is_evicted() {
+  TestSample list[SAMPLE_CACHE_SLOTS + 1];
+  static char names[SAMPLE_CACHE_SLOTS + 1][8];
+  for (uint8_t i = 0; i <= SAMPLE_CACHE_SLOTS; i++) {
+    snprintf(names[i], sizeof(names[i]), "s%u", i);
+    list[i] = {names[i], 2205, SAMPLE_ON_SD, SYNTH_SAMPLE_RATE};
+  }
+  buildBank(list, SAMPLE_CACHE_SLOTS + 1);
+  samplesBegin(0, true);
+  for (uint8_t i = 0; i < SAMPLE_CACHE_SLOTS; i++) {
+    TEST_ASSERT_TRUE(samplePreload(i, hal::millis()));
+    finishLoads();
+  }
+  // s0 es la más antigua, pero acaba de sonar
+  TEST_ASSERT_TRUE(samplePlay(0, 32767, hal::millis()));
+  hal::sim::advance(1000);
+
+  TEST_ASSERT_TRUE(samplePreload(SAMPLE_CACHE_SLOTS, hal::millis()));
+  finishLoads();
+  TEST_ASSERT_EQUAL_UINT32(1, samples.evictions);
+  TEST_ASSERT_TRUE(sampleCached(0));
+  TEST_ASSERT_FALSE(sampleCached(1));
+  TEST_ASSERT_TRUE(sampleCached(SAMPLE_CACHE_SLOTS));
+}
+
+void test_playing_slots_are_never_evicted() {
+  TestSample list[SAMPLE_CACHE_SLOTS + 1];
+  static char names[SAMPLE_CACHE_SLOTS + 1][8];
+  for (uint8_t i = 0; i <= SAMPLE_CACHE_SLOTS; i++) {
+    snprintf(names[i], sizeof(names[i]), "s%u", i);
+    list[i] = {names[i], 22050, SAMPLE_ON_SD, SYNTH_SAMPLE_RATE};
+  }
+  buildBank(list, SAMPLE_CACHE_SLOTS + 1);
+  samplesBegin(0, true);
+  for (uint8_t i = 0; i < SAMPLE_CACHE_SLOTS; i++) {
+    samplePreload(i, hal::millis());
+    finishLoads();
+  }
+  for (uint8_t i = 0; i < SAMPLE_CACHE_SLOTS; i++) samplePlay(i, 32767, hal::millis());
+
+  // Todas suenan durante 1 s: la nueva no tiene sitio
+  TEST_ASSERT_FALSE(samplePlay(SAMPLE_CACHE_SLOTS, 32767, hal::millis()));
+  TEST_ASSERT_FALSE(samplesLoading());
+  TEST_ASSERT_EQUAL_UINT32(1, samples.failures);
+  TEST_ASSERT_EQUAL_UINT32(0, samples.evictions);
+  for (uint8_t i = 0; i < SAMPLE_CACHE_SLOTS; i++) TEST_ASSERT_TRUE(sampleCached(i));
+}
+
+void test_idle_slots_and_voices_are_free_past_2_31_ms() {
+  // Dos en flash y una más en la SD de las que caben en la caché
+  const uint8_t count = SAMPLE_CACHE_SLOTS + 3;
+  TestSample list[count];
+  static char names[count][8];
+  for (uint8_t i = 0; i < count; i++) {
+    snprintf(names[i], sizeof(names[i]), "s%u", i);
+    list[i] = {names[i], 2205, i < 2 ? SAMPLE_IN_FLASH : SAMPLE_ON_SD, SYNTH_SAMPLE_RATE};
+  }
+  buildBank(list, count);
+  // millis() ya pasó 2^31: una marca a 0 queda "en el futuro"
+  hal::sim::setMillis(0x80000000u + 1000);
+  samplesBegin(hal::millis(), true);
+
+  // Dos disparos seguidos suenan en dos voces, sin quitarse la primera
+  TEST_ASSERT_TRUE(samplePlay(0, 32767, hal::millis()));
+  TEST_ASSERT_TRUE(samplePlay(1, 32767, hal::millis()));
+  synthDrainEvents();
+  TEST_ASSERT_EQUAL_UINT8(3, synth.sampleMask);
+
+  // Huecos cargados que nunca han sonado: se pueden expulsar
+  for (uint8_t i = 2; i < count; i++) {
+    TEST_ASSERT_TRUE(samplePreload(i, hal::millis()));
+    finishLoads();
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, samples.failures);
+  TEST_ASSERT_EQUAL_UINT32(1, samples.evictions);
+  TEST_ASSERT_TRUE(sampleCached(count - 1));
+}
+
+void test_late_load_does_not_play() {
+  buildBank(DEFAULT_BANK, 3);
+  samplesBegin(0, true);
+  hal::sim::state().sdReadUsPerKb = 20000;   // Tarjeta muy lenta: 22 KB tardan 430 ms
+  samplePlay(2, 32767, hal::millis());
+  finishLoads();
+  TEST_ASSERT_EQUAL_UINT32(1, samples.late);
+  synthDrainEvents();
+  TEST_ASSERT_EQUAL_UINT8(0, synth.sampleMask);
+  TEST_ASSERT_TRUE(sampleCached(2));
+}
+
+void test_other_rates_are_resampled() {
+  const TestSample list[] = {
+    {"grave", 2000, SAMPLE_IN_FLASH, 11025},
+    {"aguda", 2000, SAMPLE_IN_FLASH, 44100},
+    {"otra", 2000, SAMPLE_IN_FLASH, 11025},
+  };
+  buildBank(list, 3);
+  samplesBegin(0, false);
+  TEST_ASSERT_EQUAL_UINT8(2, samples.rateTableCount);
+  // Las dos muestras a 11025 Hz comparten tabla, distinta de la de 44,1 kHz
+  const ResamplerTable *table = sampleRateTable(sampleBank.entries[0].sampleRate);
+  TEST_ASSERT_NOT_NULL(table);
+  TEST_ASSERT_TRUE(table == sampleRateTable(sampleBank.entries[2].sampleRate));
+  TEST_ASSERT_TRUE(table != sampleRateTable(44100));
+  TEST_ASSERT_NOT_NULL(sampleRateTable(44100));
+  TEST_ASSERT_NULL(sampleRateTable(SYNTH_SAMPLE_RATE));
+
+  // 2000 muestras a 11025 Hz son 4000 a la salida: 32 bloques y la cola
+  TEST_ASSERT_TRUE(samplePlay(0, 32767, 0));
+  TEST_ASSERT_EQUAL_UINT32(181 + SAMPLE_BUSY_MARGIN_MS, samples.voiceBusyUntil[0]);
+  static int16_t block[SYNTH_BLOCK_FRAMES * 2];
+  int32_t peak = 0;
+  for (int b = 0; b < 31; b++) {
+    synthRender(block, SYNTH_BLOCK_FRAMES);
+    for (uint16_t i = 0; i < SYNTH_BLOCK_FRAMES; i++) {
+      if (block[2 * i] > peak) peak = block[2 * i];
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT8(1, synth.sampleMask);
+  TEST_ASSERT_TRUE(peak > 1000);
+  synthRender(block, SYNTH_BLOCK_FRAMES);
+  synthRender(block, SYNTH_BLOCK_FRAMES);
+  TEST_ASSERT_EQUAL_UINT8(0, synth.sampleMask);
+
+  // A 44,1 kHz, la mitad de salidas que de muestras (en la voz 1: la 0 aún cuenta como ocupada)
+  TEST_ASSERT_TRUE(samplePlay(1, 32767, 0));
+  for (int b = 0; b < 7; b++) synthRender(block, SYNTH_BLOCK_FRAMES);
+  TEST_ASSERT_EQUAL_UINT8(2, synth.sampleMask);
+  synthRender(block, SYNTH_BLOCK_FRAMES);
+  TEST_ASSERT_EQUAL_UINT8(0, synth.sampleMask);
+}
+
+void test_unplayable_samples_are_refused() {
+  const TestSample list[] = {
+    {"rapida", 1000, SAMPLE_IN_FLASH, 96000},
+    {"larga", SAMPLE_CACHE_SLOT_FRAMES + 1, SAMPLE_ON_SD, SYNTH_SAMPLE_RATE},
+  };
+  buildBank(list, 2);
+  samplesBegin(0, true);
+  TEST_ASSERT_FALSE(samplePlay(0, 32767, 0));
+  TEST_ASSERT_FALSE(samplePlay(1, 32767, 0));
+  TEST_ASSERT_FALSE(samplesLoading());
+  TEST_ASSERT_EQUAL_UINT32(0, hal::sim::state().sdOpens);
+}
+
+void test_report_logs_hit_rate() {
+  buildBank(DEFAULT_BANK, 3);
+  samplesBegin(0, true);
+  samplePlay(2, 32767, hal::millis());
+  finishLoads();
+  for (int i = 0; i < 3; i++) samplePlay(2, 32767, hal::millis());
+  logClear();
+  hal::sim::setMillis(SAMPLE_REPORT_MS);
+  samplesTask(hal::millis());
+
+  TEST_ASSERT_EQUAL_UINT32(1, logPending());
+  const LogRecord &r = logRing.records[0];
+  TEST_ASSERT_EQUAL_UINT8(LOG_SAMPLE_CACHE, r.id);
+  TEST_ASSERT_EQUAL_INT16(3, r.args[0]);
+  TEST_ASSERT_EQUAL_INT16(1, r.args[1]);
+  TEST_ASSERT_EQUAL_INT16(75, r.args[2]);
+
+  // Sin disparos nuevos, el siguiente informe no registra nada
+  hal::sim::advance(SAMPLE_REPORT_MS);
+  samplesTask(hal::millis());
+  TEST_ASSERT_EQUAL_UINT32(1, logPending());
+}
+
+int main(int argc, char **argv) {
+  if (!mkdtemp(root)) return 1;
+  snprintf(flashPath, sizeof(flashPath), "%s/flash.bin", root);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_bank_is_read_in_place);
+  RUN_TEST(test_missing_or_corrupt_bank_is_rejected);
+  RUN_TEST(test_flash_sample_plays_from_the_mapping);
+  RUN_TEST(test_sd_sample_misses_once_then_plays_from_psram);
+  RUN_TEST(test_least_recently_used_slot_is_evicted);
+  RUN_TEST(test_playing_slots_are_never_evicted);
+  RUN_TEST(test_idle_slots_and_voices_are_free_past_2_31_ms);
+  RUN_TEST(test_late_load_does_not_play);
+  RUN_TEST(test_other_rates_are_resampled);
+  RUN_TEST(test_unplayable_samples_are_refused);
+  RUN_TEST(test_report_logs_hit_rate);
+  int failures = UNITY_END();
+  hal::sim::reset();
+  for (uint8_t i = 0; i < createdCount; i++) unlink(created[i]);
+  rmdir(root);
+  return failures;
+}
@@ -0,0 +1,177 @@
+/*
+ * test_scheduler - Pruebas nativas del planificador por vencimientos
+ *
+ * Ejecutar con: pio test -e native -f test_scheduler
+ */
+
+#include <unity.h>
+
+#include "piezo_bugs.h"
+
+static uint32_t taskRuns[3];
+
+static uint32_t taskEvery5(uint32_t now) { taskRuns[0]++; return now + 5; }
+static uint32_t taskEvery7(uint32_t now) { taskRuns[1]++; return now + 7; }
+static uint32_t taskNever(uint32_t now) { taskRuns[2]++; return now + 100000; }
+
+// Ejecuta el loop de la aplicación durante ms de tiempo virtual
+static void runFor(uint32_t ms) {
+  const uint32_t endTime = hal::millis() + ms;
+  while (deadlineBefore(hal::millis(), endTime)) {
+    piezoBugsLoop();
+  }
+}
+
+void setUp() {
+  hal::sim::reset(1);
+  memset(taskRuns, 0, sizeof(taskRuns));
+  schedulerClear();
+}
+
+void tearDown() {}
+
+void test_sleep_window_is_none_when_deadline_passed() {
+  SleepWindow w = computeSleepWindow(1000, 1000, true);
+  TEST_ASSERT_EQUAL(SLEEP_NONE, w.mode);
+  w = computeSleepWindow(1000, 990, true);
+  TEST_ASSERT_EQUAL(SLEEP_NONE, w.mode);
+}
+
+void test_short_gap_uses_delay() {
+  SleepWindow w = computeSleepWindow(1000, 1000 + LIGHT_SLEEP_MIN_MS - 1, true);
+  TEST_ASSERT_EQUAL(SLEEP_IDLE, w.mode);
+  TEST_ASSERT_EQUAL_UINT32(LIGHT_SLEEP_MIN_MS - 1, w.ms);
+}
+
+void test_long_gap_uses_light_sleep_with_guard() {
+  SleepWindow w = computeSleepWindow(1000, 1020, true);
+  TEST_ASSERT_EQUAL(SLEEP_LIGHT, w.mode);
+  TEST_ASSERT_EQUAL_UINT32(20 - LIGHT_SLEEP_GUARD_MS, w.ms);
+}
+
+void test_sounding_piezo_prevents_light_sleep() {
+  SleepWindow w = computeSleepWindow(1000, 1020, false);
+  TEST_ASSERT_EQUAL(SLEEP_IDLE, w.mode);
+  TEST_ASSERT_EQUAL_UINT32(20, w.ms);
+}
+
+void test_sleep_window_is_capped() {
+  // Pausa entre secuencias en FREQ_EXTREMELY_SLOW: 58000 * 7 ms
+  SleepWindow w = computeSleepWindow(0, 58000UL * 7, true);
+  TEST_ASSERT_EQUAL(SLEEP_LIGHT, w.mode);
+  TEST_ASSERT_EQUAL_UINT32(MAX_SLEEP_MS - LIGHT_SLEEP_GUARD_MS, w.ms);
+}
+
+void test_sleep_window_across_millis_wraparound() {
+  SleepWindow w = computeSleepWindow(0xFFFFFFF0UL, 0x00000010UL, true);
+  TEST_ASSERT_EQUAL(SLEEP_LIGHT, w.mode);
+  TEST_ASSERT_EQUAL_UINT32(0x20 - LIGHT_SLEEP_GUARD_MS, w.ms);
+}
+
+void test_tasks_run_in_deadline_order() {
+  schedulerAdd("c", taskNever, 50);
+  schedulerAdd("a", taskEvery5, 10);
+  schedulerAdd("b", taskEvery7, 20);
+  TEST_ASSERT_EQUAL_UINT32(10, schedulerNextDeadline());
+
+  schedulerRunDue(20);
+  TEST_ASSERT_EQUAL_UINT32(1, taskRuns[0]);
+  TEST_ASSERT_EQUAL_UINT32(1, taskRuns[1]);
+  TEST_ASSERT_EQUAL_UINT32(0, taskRuns[2]);
+  TEST_ASSERT_EQUAL_UINT32(10, scheduler.tasks[1].maxLateMs);
+  TEST_ASSERT_EQUAL_UINT32(25, schedulerNextDeadline());
+}
+
+void test_set_deadline_moves_task_to_front() {
+  int id = schedulerAdd("c", taskNever, 50);
+  schedulerAdd("a", taskEvery5, 10);
+  schedulerSetDeadline(id, 3);
+  TEST_ASSERT_EQUAL_UINT32(3, schedulerNextDeadline());
+  schedulerRunDue(3);
+  TEST_ASSERT_EQUAL_UINT32(1, taskRuns[2]);
+  TEST_ASSERT_EQUAL_UINT32(0, taskRuns[0]);
+}
+
+void test_app_sleeps_until_deadlines() {
+  piezoBugsSetup();
+  runFor(600000);
+
+  // El loop de sondeo original despertaba cada 10 ms
+  TEST_ASSERT_TRUE(scheduler.wakeups < 600000 / 10);
+  TEST_ASSERT_TRUE(scheduler.lightSleeps > 0);
+  TEST_ASSERT_TRUE(scheduler.lightSleepMs > 0);
+
+  // Las notas salen en su vencimiento, no en el siguiente tick de 10 ms
+  TEST_ASSERT_TRUE(scheduler.tasks[voicesTaskId].runs > 0);
+  TEST_ASSERT_EQUAL_UINT32(0, scheduler.tasks[voicesTaskId].maxLateMs);
+  TEST_ASSERT_TRUE(hal::sim::piezo(PIEZO_1_PIN).toneCount > 0);
+}
+
+// Todas las tareas vencen dentro de ms
+static void deferTasks(uint32_t ms) {
+  schedulerSetDeadline(neopixelTaskId, hal::millis() + ms);
+  schedulerSetDeadline(buttonsTaskId, hal::millis() + ms);
+  schedulerSetDeadline(voicesTaskId, hal::millis() + ms);
+  schedulerSetDeadline(controlTaskId, hal::millis() + ms);
+  schedulerSetDeadline(bootTaskId, hal::millis() + ms);
+}
+
+void test_no_light_sleep_while_a_piezo_sounds() {
+  piezoBugsSetup();
+  hal::tone(PIEZO_1_PIN, 1000, 0);
+  uint32_t before = scheduler.lightSleeps;
+  schedulerSleep(hal::millis());
+  TEST_ASSERT_EQUAL_UINT32(before, scheduler.lightSleeps);
+  TEST_ASSERT_EQUAL_UINT32(0, hal::sim::state().lightSleepCount);
+
+  hal::noTone(PIEZO_1_PIN);
+  hal::sim::advance(1);   // Que termine de salir el frame del arranque
+  deferTasks(50);
+  schedulerSleep(hal::millis());
+  TEST_ASSERT_EQUAL_UINT32(1, hal::sim::state().lightSleepCount);
+}
+
+void test_light_sleep_starts_after_a_pending_show() {
+  piezoBugsSetup();
+  hal::sim::advance(1);
+  TEST_ASSERT_FALSE(hal::pixelsBusy());
+  TEST_ASSERT_TRUE(pixels.show());
+  TEST_ASSERT_TRUE(hal::pixelsBusy());
+  uint64_t doneAt = hal::sim::state().nowMicros + (uint64_t)NEOPIXEL_COUNT * 30 + 50;
+  deferTasks(50);
+  schedulerSleep(hal::millis());
+
+  // Espera al final del frame y duerme el resto de la pausa
+  TEST_ASSERT_EQUAL_UINT32(1, hal::sim::state().lightSleepCount);
+  TEST_ASSERT_FALSE(hal::pixelsBusy());
+  uint64_t sleptFrom = hal::sim::state().nowMicros - hal::sim::state().lightSleepMs * 1000;
+  TEST_ASSERT_TRUE(sleptFrom >= doneAt);
+  TEST_ASSERT_TRUE(hal::sim::state().lightSleepMs >= 50 - 1 - LIGHT_SLEEP_GUARD_MS);
+}
+
+void test_light_sleep_share_with_the_ring_running() {
+  piezoBugsSetup();
+  runFor(60000);
+
+  // Un show() cada 20 ms, y aun así casi toda la pausa es sueño ligero
+  // (un 70 % con la semilla 1; el resto son las notas de los piezos)
+  TEST_ASSERT_TRUE(scheduler.tasks[neopixelTaskId].runs >= 60000 / NEOPIXEL_FRAME_MS - 1);
+  TEST_ASSERT_TRUE(scheduler.lightSleepMs > 60000 * 65 / 100);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_sleep_window_is_none_when_deadline_passed);
+  RUN_TEST(test_short_gap_uses_delay);
+  RUN_TEST(test_long_gap_uses_light_sleep_with_guard);
+  RUN_TEST(test_sounding_piezo_prevents_light_sleep);
+  RUN_TEST(test_sleep_window_is_capped);
+  RUN_TEST(test_sleep_window_across_millis_wraparound);
+  RUN_TEST(test_tasks_run_in_deadline_order);
+  RUN_TEST(test_set_deadline_moves_task_to_front);
+  RUN_TEST(test_app_sleeps_until_deadlines);
+  RUN_TEST(test_no_light_sleep_while_a_piezo_sounds);
+  RUN_TEST(test_light_sleep_starts_after_a_pending_show);
+  RUN_TEST(test_light_sleep_share_with_the_ring_running);
+  return UNITY_END();
+}
@@ -0,0 +1,182 @@
+/*
+ * test_sequences - Pruebas nativas de los flujos PCG32 (prng.h), el
+ * generador de Markov y las reservas de secuencias (sequences.h)
+ *
+ * Ejecutar con: pio test -e native -f test_sequences
+ */
+
+#include <unity.h>
+
+#include "piezo_bugs.h"
+
+static void runFor(uint32_t ms) {
+  uint32_t end = hal::millis() + ms;
+  while (deadlineBefore(hal::millis(), end)) piezoBugsLoop();
+}
+
+void setUp() {
+  hal::sim::reset(11);
+  rootNoteOffset = 0;
+  currentScale = SCALE_INSECT_PENTATONIC;
+}
+
+void tearDown() {}
+
+void test_streams_repeat_and_stay_apart() {
+  Prng a, b, c;
+  prngSeed(a, 42, 0);
+  prngSeed(b, 42, 0);
+  prngSeed(c, 42, 1);
+  uint32_t same = 0;
+  for (int i = 0; i < 1000; i++) {
+    uint32_t x = prngNext(a);
+    TEST_ASSERT_EQUAL_UINT32(x, prngNext(b));
+    if (x == prngNext(c)) same++;
+  }
+  TEST_ASSERT_TRUE(same < 2);
+
+  // Rango como random(): [min, max), y llega a los dos extremos
+  bool low = false, high = false;
+  for (int i = 0; i < 10000; i++) {
+    int32_t r = prngRange(a, 3, 17);
+    TEST_ASSERT_TRUE(r >= 3 && r < 17);
+    low |= (r == 3);
+    high |= (r == 16);
+  }
+  TEST_ASSERT_TRUE(low && high);
+}
+
+void test_profiles_keep_octaves_and_lengths() {
+  Prng rng;
+  prngSeed(rng, 5, 0);
+  uint8_t positions[MAX_SEQUENCE_LENGTH];
+  NoteIndex notes[MAX_SEQUENCE_LENGTH];
+  uint8_t length;
+  for (uint8_t scale = 0; scale < SCALE_COUNT; scale++) {
+    for (uint8_t t = 0; t < INSECT_TYPE_COUNT; t++) {
+      const MarkovProfile &profile = MARKOV_PROFILES[t];
+      for (int n = 0; n < 200; n++) {
+        sequenceGenerate(rng, (InsectType)t, (ScaleId)scale, positions, length);
+        TEST_ASSERT_TRUE(length >= profile.minLength && length <= profile.maxLength);
+        sequenceToNotes(positions, length, (ScaleId)scale, 0, notes);
+        for (uint8_t i = 0; i < length; i++) {
+          TEST_ASSERT_TRUE(noteOctave(notes[i]) >= profile.firstOctave);
+          TEST_ASSERT_TRUE(noteOctave(notes[i]) <= profile.lastOctave);
+          if (profile.rootOnly) TEST_ASSERT_EQUAL_STRING("Do", noteName(notes[i]));
+        }
+      }
+    }
+  }
+}
+
+void test_cricket_moves_to_neighbour_notes() {
+  Prng rng;
+  prngSeed(rng, 9, 0);
+  uint8_t positions[MAX_SEQUENCE_LENGTH];
+  uint8_t length;
+  uint32_t repeats = 0, steps = 0;
+  for (int n = 0; n < 500; n++) {
+    sequenceGenerate(rng, CRICKET, SCALE_INSECT_PENTATONIC, positions, length);
+    for (uint8_t i = 1; i < length; i++) {
+      int jump = abs((int)positions[i] - (int)positions[i - 1]);
+      TEST_ASSERT_TRUE(jump <= 3);
+      if (jump == 0) repeats++;
+      steps++;
+    }
+  }
+  // Peso 3 de 10 para repetir
+  TEST_ASSERT_TRUE(repeats > steps / 5 && repeats < steps * 2 / 5);
+}
+
+void test_pool_take_copies_without_generating() {
+  sequencePoolsBegin(3);
+  for (uint8_t s = 0; s < SEQUENCE_POOL_SIZE; s++) sequencePoolFill(0, SPIDER);
+  TEST_ASSERT_FALSE(sequencePools.needMask & 1);
+
+  // Lo que saldrá de la reserva, generado con el mismo flujo
+  Prng copy;
+  prngSeed(copy, 3, 0);
+  uint8_t positions[MAX_SEQUENCE_LENGTH];
+  uint8_t expectedLength;
+  sequenceGenerate(copy, SPIDER, currentScale, positions, expectedLength);
+
+  NoteIndex notes[MAX_SEQUENCE_LENGTH];
+  uint8_t length;
+  uint32_t generated = sequencePools.generated;
+  sequencePoolTake(0, SPIDER, notes, length);
+  TEST_ASSERT_EQUAL_UINT32(generated, sequencePools.generated);
+  TEST_ASSERT_EQUAL_UINT32(0, sequencePools.misses);
+  TEST_ASSERT_EQUAL_UINT8(expectedLength, length);
+  TEST_ASSERT_EQUAL_UINT8(scaleNote(currentScale, 0, positions[0]), notes[0]);
+  TEST_ASSERT_TRUE(sequencePools.needMask & 1);
+
+  // Otra raíz: la reserva sigue valiendo, transportada
+  rootNoteOffset = 4;
+  sequenceGenerate(copy, SPIDER, currentScale, positions, expectedLength);
+  sequencePoolTake(0, SPIDER, notes, length);
+  TEST_ASSERT_EQUAL_UINT32(0, sequencePools.misses);
+  for (uint8_t i = 0; i < length; i++) {
+    TEST_ASSERT_EQUAL_UINT8(scaleNote(currentScale, 4, positions[i]), notes[i]);
+  }
+
+  // Otro tipo: la reserva no vale
+  sequencePoolTake(0, BEETLE, notes, length);
+  TEST_ASSERT_EQUAL_UINT32(1, sequencePools.misses);
+  TEST_ASSERT_EQUAL_UINT8(0, sequencePools.count[0]);
+}
+
+void test_loop_keeps_pools_full() {
+  piezoBugsSetup();
+  runFor(1000);
+  for (uint8_t v = 0; v < voices.count; v++) {
+    TEST_ASSERT_EQUAL_UINT8(SEQUENCE_POOL_SIZE, sequencePools.count[v]);
+  }
+  uint32_t misses = sequencePools.misses;
+
+  // Cambios de secuencia y de nota raíz durante 10 minutos: todo de la reserva
+  runFor(5 * 60000);
+  changeRootNote();
+  runFor(5 * 60000);
+  TEST_ASSERT_EQUAL_UINT32(misses, sequencePools.misses);
+  TEST_ASSERT_TRUE(sequencePools.taken > 15);
+}
+
+void test_voices_do_not_share_a_stream() {
+  // Las secuencias de la voz 0 no dependen de cuántas pida la voz 1
+  NoteIndex notes[MAX_SEQUENCE_LENGTH];
+  NoteIndex first[4][MAX_SEQUENCE_LENGTH];
+  uint8_t length;
+  sequencePoolsBegin(8);
+  for (int n = 0; n < 4; n++) sequencePoolTake(0, SPIDER, first[n], length);
+
+  sequencePoolsBegin(8);
+  for (int n = 0; n < 4; n++) {
+    for (int k = 0; k < 3; k++) sequencePoolTake(1, CRICKET, notes, length);
+    sequencePoolTake(0, SPIDER, notes, length);
+    TEST_ASSERT_EQUAL_MEMORY(first[n], notes, length);
+  }
+}
+
+void test_same_seed_same_sequences() {
+  piezoBugsSetup();
+  NoteIndex notes[MAX_SEQUENCE_LENGTH];
+  memcpy(notes, voices.notes[0], sizeof(notes));
+  uint8_t length = voices.sequenceLength[0];
+
+  hal::sim::reset(11);
+  piezoBugsSetup();
+  TEST_ASSERT_EQUAL_UINT8(length, voices.sequenceLength[0]);
+  TEST_ASSERT_EQUAL_MEMORY(notes, voices.notes[0], length);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_streams_repeat_and_stay_apart);
+  RUN_TEST(test_profiles_keep_octaves_and_lengths);
+  RUN_TEST(test_cricket_moves_to_neighbour_notes);
+  RUN_TEST(test_pool_take_copies_without_generating);
+  RUN_TEST(test_loop_keeps_pools_full);
+  RUN_TEST(test_voices_do_not_share_a_stream);
+  RUN_TEST(test_same_seed_same_sequences);
+  return UNITY_END();
+}
@@ -0,0 +1,97 @@
+/*
+ * test_soak - Pruebas nativas del simulador de larga duración (soak.h)
+ *
+ * Unas horas simuladas con pulsaciones y datos del árbol más frecuentes que
+ * en "program soak", pasando por el desborde de millis().
+ *
+ * Ejecutar con: pio test -e native -f test_soak
+ */
+
+#include <unity.h>
+
+#include "soak.h"
+
+static SoakConfig shortSoak(uint32_t seed) {
+  SoakConfig config = {};
+  config.seed = seed;
+  config.durationMs = 2 * 3600000ULL;
+  config.startMs = SOAK_DEFAULT_START_MS;
+  config.pressMeanMs = 60000;
+  config.treeMeanMs = 120000;
+  return config;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_hours_across_the_wrap_are_clean() {
+  soakBegin(shortSoak(1));
+  while (!soakDone()) soakStep();
+  TEST_ASSERT_EQUAL_UINT32(1, soak.wraps);
+  TEST_ASSERT_TRUE(buttonInput.events > 50);
+  TEST_ASSERT_TRUE(soak.events > 1000);
+  for (uint8_t c = 0; c < SOAK_CHECK_COUNT; c++) {
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(0, soak.checkCount[c], SOAK_CHECK_NAMES[c]);
+  }
+}
+
+void test_same_seed_gives_the_same_trace() {
+  soakBegin(shortSoak(5));
+  soakRunFor(1800000);
+  uint32_t digest = soak.digest;
+  uint32_t events = soak.events;
+
+  soakBegin(shortSoak(5));
+  soakRunFor(1800000);
+  TEST_ASSERT_EQUAL_UINT32(events, soak.events);
+  TEST_ASSERT_EQUAL_HEX32(digest, soak.digest);
+
+  soakBegin(shortSoak(6));
+  soakRunFor(1800000);
+  TEST_ASSERT_TRUE(soak.digest != digest);
+}
+
+void test_corrupted_voice_is_flagged() {
+  SoakConfig config = shortSoak(2);
+  config.pressMeanMs = 0;   // Que ningún botón mutee la voz
+  soakBegin(config);
+  soakRunFor(60000);
+  TEST_ASSERT_EQUAL_UINT32(0, soak.violations);
+
+  voices.type[1] = 7;
+  soakStep();
+  TEST_ASSERT_TRUE(soak.checkCount[SOAK_CHECK_TYPE] > 0);
+
+  // voiceValidate lo repara cuando la voz vence, y eso también cuenta
+  soakRunFor(60000);
+  TEST_ASSERT_TRUE(soak.checkCount[SOAK_CHECK_LOG_ERROR] > 0);
+  TEST_ASSERT_TRUE(voices.type[1] < INSECT_TYPE_COUNT);
+
+  bool traced = false;
+  for (uint32_t i = 0; i < soak.events && i < SOAK_TRACE_SIZE; i++) {
+    const SoakEvent &e = soak.trace[i];
+    if (e.type == SOAK_EV_VIOLATION && e.a == SOAK_CHECK_TYPE && e.b == 1) traced = true;
+  }
+  TEST_ASSERT_TRUE(traced);
+}
+
+void test_far_deadline_is_flagged() {
+  soakBegin(shortSoak(3));
+  soakRunFor(1000);
+  // Un intervalo desbordado: la voz no volvería a cantar en días
+  voices.noteDeadline[0] = hal::millis() + 3 * SOAK_DAY_MS;
+  voices.sequenceDeadline[0] = voices.noteDeadline[0];
+  voiceRefreshDeadline(0);
+  soakStep();
+  TEST_ASSERT_TRUE(soak.checkCount[SOAK_CHECK_VOICE_HORIZON] > 0);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_hours_across_the_wrap_are_clean);
+  RUN_TEST(test_same_seed_gives_the_same_trace);
+  RUN_TEST(test_corrupted_voice_is_flagged);
+  RUN_TEST(test_far_deadline_is_flagged);
+  return UNITY_END();
+}
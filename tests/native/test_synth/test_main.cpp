@@ -0,0 +1,117 @@
+/*
+ * test_synth - Pruebas nativas del sintetizador polifónico I2S
+ *
+ * Ejecutar con: pio test -e native -f test_synth
+ */
+
+#include <unity.h>
+
+#include "synth.h"
+
+static int16_t block[SYNTH_BLOCK_FRAMES * 2];
+static uint32_t stereoMismatches;
+
+// Renderiza ms de audio; devuelve el pico absoluto y cuenta cruces por cero
+static int32_t renderMs(uint32_t ms, uint32_t *zeroCrossings = nullptr) {
+  uint32_t blocks = ms * SYNTH_SAMPLE_RATE / 1000 / SYNTH_BLOCK_FRAMES;
+  int32_t peak = 0;
+  int16_t previous = 0;
+  for (uint32_t b = 0; b < blocks; b++) {
+    synthRender(block, SYNTH_BLOCK_FRAMES);
+    for (uint16_t i = 0; i < SYNTH_BLOCK_FRAMES; i++) {
+      int16_t s = block[2 * i];
+      if (s != block[2 * i + 1]) stereoMismatches++;
+      int32_t a = s < 0 ? -(int32_t)s : s;
+      if (a > peak) peak = a;
+      if (zeroCrossings && ((previous < 0 && s >= 0) || (previous >= 0 && s < 0))) (*zeroCrossings)++;
+      previous = s;
+    }
+  }
+  return peak;
+}
+
+void setUp() {
+  hal::sim::reset(1);
+  synthInit();
+  stereoMismatches = 0;
+}
+
+void tearDown() {}
+
+void test_silence_without_notes() {
+  TEST_ASSERT_EQUAL_INT32(0, renderMs(100));
+  TEST_ASSERT_EQUAL_UINT32(0, synth.activeMask);
+}
+
+void test_sine_note_has_expected_pitch() {
+  synthNoteOn(0, SPIDER, 1000, 2000);
+  uint32_t crossings = 0;
+  int32_t peak = renderMs(1000, &crossings);
+  TEST_ASSERT_TRUE(peak > SYNTH_VOICE_LEVEL / 2 && peak <= SYNTH_VOICE_LEVEL);
+  // 1000 Hz: dos cruces por ciclo
+  TEST_ASSERT_INT_WITHIN(20, 2000, crossings);
+  TEST_ASSERT_EQUAL_UINT32(0, stereoMismatches);
+}
+
+void test_note_releases_to_silence() {
+  synthNoteOn(3, CRICKET, 440, 50);
+  TEST_ASSERT_TRUE(renderMs(40) > 0);
+  // Duración + release del grillo
+  renderMs(50 + synthPatches[CRICKET].releaseMs);
+  TEST_ASSERT_EQUAL_UINT32(0, synth.activeMask);
+  TEST_ASSERT_EQUAL_INT32(0, renderMs(20));
+}
+
+void test_note_off_starts_release() {
+  synthNoteOn(1, BEETLE, 110, 10000);
+  renderMs(100);
+  TEST_ASSERT_EQUAL(STAGE_SUSTAIN, synth.stage[1]);
+  synthNoteOff(1);
+  renderMs(synthPatches[BEETLE].releaseMs + 20);
+  TEST_ASSERT_EQUAL(STAGE_OFF, synth.stage[1]);
+}
+
+void test_sixteen_voices_saturate_without_wrapping() {
+  // 16 pulsos en fase: la suma supera el fondo de escala
+  for (uint8_t v = 0; v < 16; v++) {
+    synthNoteOn(v, CRICKET, 1000, 1000);
+  }
+  renderMs(20);
+  TEST_ASSERT_EQUAL_HEX32(0xFFFF, synth.activeMask);
+  TEST_ASSERT_TRUE(synth.clippedSamples > 0);
+  // Las voces están en fase: la mezcla pasa del fondo de escala y la
+  // salida se queda en el límite con el mismo signo, sin dar la vuelta
+  synthRender(block, SYNTH_BLOCK_FRAMES);
+  uint32_t saturated = 0;
+  for (uint16_t i = 0; i < SYNTH_BLOCK_FRAMES; i++) {
+    if (synth.mix[i] > 32767) {
+      TEST_ASSERT_EQUAL_INT16(32767, block[2 * i]);
+      saturated++;
+    } else if (synth.mix[i] < -32768) {
+      TEST_ASSERT_EQUAL_INT16(-32768, block[2 * i]);
+      saturated++;
+    }
+  }
+  TEST_ASSERT_TRUE(saturated > 0);
+}
+
+void test_event_queue_overflow_is_counted() {
+  for (uint8_t i = 0; i < SYNTH_EVENT_QUEUE_SIZE + 4; i++) {
+    synthNoteOn(i % SYNTH_MAX_VOICES, SPIDER, 2000, 100);
+  }
+  // Un hueco siempre queda libre para distinguir lleno de vacío
+  TEST_ASSERT_EQUAL_UINT32(5, synth.droppedEvents);
+  synthRender(block, SYNTH_BLOCK_FRAMES);
+  TEST_ASSERT_TRUE(synthPushEvent({0, SPIDER, 1000, 10}));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_silence_without_notes);
+  RUN_TEST(test_sine_note_has_expected_pitch);
+  RUN_TEST(test_note_releases_to_silence);
+  RUN_TEST(test_note_off_starts_release);
+  RUN_TEST(test_sixteen_voices_saturate_without_wrapping);
+  RUN_TEST(test_event_queue_overflow_is_counted);
+  return UNITY_END();
+}
@@ -0,0 +1,230 @@
+/*
+ * test_tree_cache - Pruebas nativas del anillo de TreeData en flash
+ *
+ * La flash simulada es NOR (solo pasa bits de 1 a 0) y se le puede cortar
+ * la alimentación a mitad de una escritura o de un borrado. "Reiniciar"
+ * es volver a llamar a treeCacheBegin() sobre la misma flash.
+ *
+ * Ejecutar con: pio test -e native -f test_tree_cache
+ */
+
+#include <unity.h>
+
+#include "piezo_bugs.h"
+#include "net_task.h"
+
+// Lectura cuyos campos salen todos de k: un registro mezclado se nota
+static TreeData sample(uint32_t k) {
+  TreeData d;
+  d.humidity = 40.0f + (k % 50);
+  d.temperature = 10.0f + (k % 20) * 0.5f;
+  d.bioelectrical_activity = 0.002f + (k % 60) * 0.0001f;
+  d.light_level = (float)(k % 2000);
+  d.timestamp = k;
+  d.data_valid = true;
+  return d;
+}
+
+static bool matches(const TreeData &d) {
+  TreeData e = sample((uint32_t)d.timestamp);
+  return d.data_valid && d.humidity == e.humidity && d.temperature == e.temperature &&
+         d.bioelectrical_activity == e.bioelectrical_activity && d.light_level == e.light_level;
+}
+
+static bool reboot() {
+  hal::sim::flashPowerOn();
+  return treeCacheBegin(treeCache);
+}
+
+void setUp() {
+  hal::sim::reset(5);
+  treeCacheBegin(treeCache);
+}
+
+void tearDown() {}
+
+void test_empty_flash_then_survives_reboot() {
+  TreeData out;
+  TEST_ASSERT_TRUE(treeCache.ready);
+  TEST_ASSERT_FALSE(treeCacheLatest(treeCache, out));
+
+  for (uint32_t k = 1; k <= 3; k++) TEST_ASSERT_TRUE(treeCacheAppend(treeCache, sample(k)));
+  TEST_ASSERT_TRUE(reboot());
+  TEST_ASSERT_TRUE(treeCacheLatest(treeCache, out));
+  TEST_ASSERT_EQUAL_UINT32(3, out.timestamp);
+  TEST_ASSERT_TRUE(matches(out));
+  TEST_ASSERT_EQUAL_UINT32(3, treeCache.recovered);
+  TEST_ASSERT_EQUAL_UINT32(3, treeCache.nextSequence);
+
+  // Tras reiniciar se sigue escribiendo detrás, sin borrar
+  uint32_t erases = hal::sim::state().flashErases[0];
+  TEST_ASSERT_TRUE(treeCacheAppend(treeCache, sample(4)));
+  TEST_ASSERT_EQUAL_UINT32(erases, hal::sim::state().flashErases[0]);
+  TreeData recent[4];
+  TEST_ASSERT_EQUAL_UINT16(4, treeCacheRecent(treeCache, recent, 4));
+  for (uint32_t i = 0; i < 4; i++) TEST_ASSERT_EQUAL_UINT32(4 - i, recent[i].timestamp);
+}
+
+void test_ring_wraps_and_levels_wear() {
+  const uint32_t count = TREE_CACHE_SLOTS * TREE_CACHE_SECTORS * 6 + 17;
+  for (uint32_t k = 1; k <= count; k++) TEST_ASSERT_TRUE(treeCacheAppend(treeCache, sample(k)));
+  TEST_ASSERT_EQUAL_UINT32(0, treeCache.failures);
+
+  // Todos los sectores se borran por turno
+  uint32_t least = 0xFFFFFFFF;
+  uint32_t most = 0;
+  for (uint8_t s = 0; s < TREE_CACHE_SECTORS; s++) {
+    uint32_t e = hal::sim::state().flashErases[s];
+    if (e < least) least = e;
+    if (e > most) most = e;
+  }
+  TEST_ASSERT_TRUE(least >= 6);
+  TEST_ASSERT_TRUE(most - least <= 1);
+  // Fuera de la región no se toca nada
+  TEST_ASSERT_EQUAL_UINT32(0, hal::sim::state().flashErases[TREE_CACHE_SECTORS]);
+
+  // Siempre quedan al menos TREE_CACHE_CAPACITY lecturas, en orden
+  reboot();
+  static TreeData recent[TREE_CACHE_CAPACITY + 1];
+  uint16_t got = treeCacheRecent(treeCache, recent, TREE_CACHE_CAPACITY + 1);
+  TEST_ASSERT_TRUE(got >= TREE_CACHE_CAPACITY);
+  for (uint16_t i = 0; i < got; i++) {
+    TEST_ASSERT_EQUAL_UINT32(count - i, recent[i].timestamp);
+    TEST_ASSERT_TRUE(matches(recent[i]));
+  }
+}
+
+void test_power_loss_during_record_write() {
+  for (uint32_t k = 1; k <= 10; k++) treeCacheAppend(treeCache, sample(k));
+  uint32_t last = 10;
+
+  // Corte en cada byte posible del registro siguiente
+  for (uint32_t cut = 0; cut <= sizeof(TreeCacheRecord); cut++) {
+    reboot();
+    uint32_t before = treeCache.nextSequence;
+    hal::sim::flashPowerCut(cut);
+    bool written = treeCacheAppend(treeCache, sample(100 + cut));
+    TEST_ASSERT_EQUAL(cut == sizeof(TreeCacheRecord), written);
+
+    TreeData out;
+    TEST_ASSERT_TRUE(reboot());
+    TEST_ASSERT_TRUE(treeCacheLatest(treeCache, out));
+    TEST_ASSERT_TRUE(matches(out));
+    if (written) {
+      TEST_ASSERT_EQUAL_UINT32(100 + cut, out.timestamp);
+    } else {
+      TEST_ASSERT_EQUAL_UINT32(last, out.timestamp);
+      TEST_ASSERT_EQUAL_UINT32(before, treeCache.nextSequence);
+    }
+
+    // Después del corte se sigue guardando con normalidad
+    TEST_ASSERT_TRUE(treeCacheAppend(treeCache, sample(200 + cut)));
+    reboot();
+    TEST_ASSERT_TRUE(treeCacheLatest(treeCache, out));
+    TEST_ASSERT_EQUAL_UINT32(200 + cut, out.timestamp);
+    last = 200 + cut;
+  }
+}
+
+void test_power_loss_while_opening_a_sector() {
+  // Sector 0 lleno: el siguiente registro borra y abre el sector 1
+  for (uint32_t k = 1; k <= TREE_CACHE_SLOTS; k++) treeCacheAppend(treeCache, sample(k));
+  const uint32_t cuts[] = {0, 1, 15, 2048, hal::FLASH_SECTOR_SIZE - 1, hal::FLASH_SECTOR_SIZE,
+                           hal::FLASH_SECTOR_SIZE + 8, hal::FLASH_SECTOR_SIZE + sizeof(TreeCacheHeader)};
+  for (uint32_t cut : cuts) {
+    // Sector 1 con restos de otra vida, como tras dar la vuelta al anillo
+    uint8_t junk[64];
+    memset(junk, 0x5A, sizeof(junk));
+    hal::flashWrite(hal::FLASH_SECTOR_SIZE + 100, junk, sizeof(junk));
+
+    reboot();
+    TEST_ASSERT_EQUAL(0, treeCache.head);
+    hal::sim::flashPowerCut(cut);
+    TEST_ASSERT_FALSE(treeCacheAppend(treeCache, sample(1000)));
+
+    TreeData out;
+    TEST_ASSERT_TRUE(reboot());
+    TEST_ASSERT_TRUE(treeCacheLatest(treeCache, out));
+    TEST_ASSERT_EQUAL_UINT32(TREE_CACHE_SLOTS, out.timestamp);
+    // Solo con la cabecera entera cuenta el sector nuevo (vacío)
+    TEST_ASSERT_EQUAL(cut >= hal::FLASH_SECTOR_SIZE + sizeof(TreeCacheHeader) ? 1 : 0, treeCache.head);
+
+    // Vuelve a borrar el sector 1 y sigue
+    TEST_ASSERT_TRUE(treeCacheAppend(treeCache, sample(2000)));
+    TEST_ASSERT_EQUAL(1, treeCache.head);
+    reboot();
+    TEST_ASSERT_TRUE(treeCacheLatest(treeCache, out));
+    TEST_ASSERT_EQUAL_UINT32(2000, out.timestamp);
+    TEST_ASSERT_EQUAL_UINT32(TREE_CACHE_SLOTS + 1, treeCache.nextSequence);
+
+    // Deja el sector 0 como único válido para el siguiente corte
+    hal::flashErase(hal::FLASH_SECTOR_SIZE);
+    reboot();
+  }
+}
+
+void test_random_power_cuts_never_lose_committed_data() {
+  uint32_t committed = 0;   // Última lectura escrita entera
+  uint32_t k = 0;
+  for (int round = 0; round < 400; round++) {
+    uint32_t cut = (uint32_t)hal::random(0, 8000);   // El borrado de un sector cuenta 4096
+    hal::sim::flashPowerCut(cut);
+    while (hal::sim::flashPowered()) {
+      if (treeCacheAppend(treeCache, sample(++k))) committed = k;
+    }
+
+    TreeData out;
+    TEST_ASSERT_EQUAL(committed > 0, reboot());
+    TEST_ASSERT_EQUAL(committed > 0, treeCacheLatest(treeCache, out));
+    if (committed == 0) continue;
+    TEST_ASSERT_TRUE(matches(out));
+    TEST_ASSERT_EQUAL_UINT32(committed, out.timestamp);
+
+    // Las anteriores siguen en orden y sin mezclar
+    TreeData recent[32];
+    uint16_t got = treeCacheRecent(treeCache, recent, 32);
+    for (uint16_t i = 0; i < got; i++) {
+      TEST_ASSERT_TRUE(matches(recent[i]));
+      if (i > 0) TEST_ASSERT_TRUE(recent[i].timestamp < recent[i - 1].timestamp);
+    }
+  }
+  TEST_ASSERT_TRUE(k > TREE_CACHE_SLOTS * TREE_CACHE_SECTORS);
+}
+
+void test_boot_plays_cached_state_at_once() {
+  // Ritmo de escritura limitado
+  TEST_ASSERT_TRUE(treeCacheStore(treeCache, sample(1), 0));
+  TEST_ASSERT_FALSE(treeCacheStore(treeCache, sample(2), TREE_CACHE_MIN_INTERVAL_MS - 1));
+  TEST_ASSERT_FALSE(treeCacheStore(treeCache, TreeData(), TREE_CACHE_MIN_INTERVAL_MS));
+  TreeData wet = sample(3);
+  wet.humidity = 90.0f;
+  wet.bioelectrical_activity = 0.008f;
+  TEST_ASSERT_TRUE(treeCacheStore(treeCache, wet, TREE_CACHE_MIN_INTERVAL_MS));
+  TEST_ASSERT_EQUAL_UINT32(2, treeCache.appends);
+
+  // Arranque sin WiFi: los parámetros ya valen lo de la última lectura
+  hal::sim::setWifi(false);
+  piezoBugsSetup();
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, -5.0f, paramValue(PARAM_TRANSPOSE));
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 2.5f, paramValue(PARAM_DENSITY));
+
+  // La tarea de red la publica antes de la primera consulta y las
+  // consultas incrementales parten de ella
+  influxClientBegin(netTask.client, "db.example.org", 443, "bosque", "secreto", nullptr, nullptr, 0);
+  netTaskBegin("biodata");
+  TreeData out;
+  TEST_ASSERT_TRUE(treeSlotRead(netTask.slot, out));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 90.0f, out.humidity);
+  TEST_ASSERT_TRUE(netTask.data.data_valid);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_flash_then_survives_reboot);
+  RUN_TEST(test_ring_wraps_and_levels_wear);
+  RUN_TEST(test_power_loss_during_record_write);
+  RUN_TEST(test_power_loss_while_opening_a_sector);
+  RUN_TEST(test_random_power_cuts_never_lose_committed_data);
+  RUN_TEST(test_boot_plays_cached_state_at_once);
+  return UNITY_END();
+}
@@ -0,0 +1,124 @@
+/*
+ * test_tuning - Pruebas nativas de las tablas de afinación
+ *
+ * Ejecutar con: pio test -e native -f test_tuning
+ */
+
+#include <unity.h>
+
+#include "piezo_bugs.h"
+
+// Escala original de insects.h (Hz redondeados a mano), octavas 2-8
+static const int originalPentatonicScale[35] = {
+  65, 73, 82, 92, 110,
+  131, 147, 165, 185, 220,
+  262, 294, 330, 370, 440,
+  523, 587, 659, 740, 880,
+  1047, 1175, 1319, 1480, 1760,
+  2093, 2349, 2637, 2960, 3520,
+  4186, 4699, 5274, 5920, 7040
+};
+
+// Escala de 12 notas de bugTypesTest a partir de una posición de la tabla
+static void assertScaleMatches(ScaleId scale, uint8_t root, uint8_t octave, const int expected[12]) {
+  uint8_t start = (octave - SCALE_FIRST_OCTAVE) * scaleSize(scale);
+  for (uint8_t i = 0; i < 12; i++) {
+    TEST_ASSERT_EQUAL_INT(expected[i], noteFrequency(scaleNote(scale, root, start + i)));
+  }
+}
+
+void setUp() {
+  hal::sim::reset(1);
+  rootNoteOffset = 0;
+  currentScale = SCALE_INSECT_PENTATONIC;
+}
+
+void tearDown() {}
+
+void test_insect_scale_matches_original_table() {
+  TEST_ASSERT_EQUAL_UINT8(35, scalePositions(SCALE_INSECT_PENTATONIC));
+  for (uint8_t i = 0; i < 35; i++) {
+    TEST_ASSERT_EQUAL_INT(originalPentatonicScale[i], noteFrequency(scaleNote(SCALE_INSECT_PENTATONIC, 0, i)));
+  }
+}
+
+void test_modes_match_bug_types_test_tables() {
+  const int phrygianC4[12] = {262, 277, 311, 349, 392, 415, 466, 523, 554, 622, 698, 784};
+  const int aeolianA3[12] = {220, 247, 262, 294, 330, 349, 392, 440, 494, 523, 587, 659};
+  const int dorianD3[12] = {147, 165, 175, 196, 220, 247, 262, 294, 330, 349, 392, 440};
+  const int mixolydianG3[12] = {196, 220, 247, 262, 294, 330, 349, 392, 440, 494, 523, 587};
+  const int lydianF3[12] = {175, 196, 220, 247, 262, 294, 330, 349, 392, 440, 494, 523};
+  const int harmonicMinorA3[12] = {220, 247, 262, 294, 330, 349, 415, 440, 494, 523, 587, 659};
+  assertScaleMatches(SCALE_PHRYGIAN, 0, 4, phrygianC4);
+  assertScaleMatches(SCALE_AEOLIAN, 9, 3, aeolianA3);
+  assertScaleMatches(SCALE_DORIAN, 2, 3, dorianD3);
+  assertScaleMatches(SCALE_MIXOLYDIAN, 7, 3, mixolydianG3);
+  assertScaleMatches(SCALE_LYDIAN, 5, 3, lydianF3);
+  assertScaleMatches(SCALE_HARMONIC_MINOR, 9, 3, harmonicMinorA3);
+}
+
+void test_root_transposes_by_semitones() {
+  for (uint8_t root = 0; root < SEMITONES; root++) {
+    for (uint8_t p = 0; p < 25; p++) {
+      TEST_ASSERT_EQUAL_UINT8(scaleNote(SCALE_INSECT_PENTATONIC, 0, p) + root,
+                              scaleNote(SCALE_INSECT_PENTATONIC, root, p));
+    }
+  }
+}
+
+void test_transposed_notes_stay_below_8000_hz() {
+  for (uint8_t s = 0; s < SCALE_COUNT; s++) {
+    for (uint8_t root = 0; root < SEMITONES; root++) {
+      for (uint8_t p = 0; p < scalePositions((ScaleId)s); p++) {
+        NoteIndex note = scaleNote((ScaleId)s, root, p);
+        TEST_ASSERT_TRUE(note <= NOTE_MAX_PLAYABLE);
+        TEST_ASSERT_TRUE(noteFrequency(note) >= 20 && noteFrequency(note) < 8000);
+      }
+    }
+  }
+  // La8 + 11 semitonos (Sol#9) baja una octava: Sol#8
+  NoteIndex top = scaleNote(SCALE_INSECT_PENTATONIC, 11, 34);
+  TEST_ASSERT_EQUAL_STRING("Sol#", noteName(top));
+  TEST_ASSERT_EQUAL_UINT8(8, noteOctave(top));
+}
+
+void test_note_name_and_octave() {
+  TEST_ASSERT_EQUAL_STRING("La", noteName(NOTE_A4));
+  TEST_ASSERT_EQUAL_UINT8(4, noteOctave(NOTE_A4));
+  TEST_ASSERT_EQUAL_UINT16(440, noteFrequency(NOTE_A4));
+  TEST_ASSERT_EQUAL_STRING("Fa#", noteName(scaleNote(SCALE_INSECT_PENTATONIC, 0, 33)));
+  TEST_ASSERT_EQUAL_UINT8(8, noteOctave(scaleNote(SCALE_INSECT_PENTATONIC, 0, 33)));
+}
+
+void test_sequences_follow_root_and_octave_ranges() {
+  rootNoteOffset = 3;
+  Prng rng;
+  prngSeed(rng, 1, 0);
+  uint8_t positions[MAX_SEQUENCE_LENGTH];
+  NoteIndex sequence[MAX_SEQUENCE_LENGTH];
+  uint8_t length = 0;
+  for (int n = 0; n < 50; n++) {
+    sequenceGenerate(rng, SPIDER, currentScale, positions, length);
+    sequenceToNotes(positions, length, currentScale, rootNoteOffset, sequence);
+    for (uint8_t i = 0; i < length; i++) {
+      TEST_ASSERT_TRUE(noteOctave(sequence[i]) >= 5);
+    }
+    sequenceGenerate(rng, BEETLE, currentScale, positions, length);
+    sequenceToNotes(positions, length, currentScale, rootNoteOffset, sequence);
+    for (uint8_t i = 0; i < length; i++) {
+      TEST_ASSERT_EQUAL_STRING("Re#", noteName(sequence[i]));
+      TEST_ASSERT_TRUE(noteOctave(sequence[i]) >= 2 && noteOctave(sequence[i]) <= 4);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_insect_scale_matches_original_table);
+  RUN_TEST(test_modes_match_bug_types_test_tables);
+  RUN_TEST(test_root_transposes_by_semitones);
+  RUN_TEST(test_transposed_notes_stay_below_8000_hz);
+  RUN_TEST(test_note_name_and_octave);
+  RUN_TEST(test_sequences_follow_root_and_octave_ranges);
+  return UNITY_END();
+}
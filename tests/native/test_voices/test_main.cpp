@@ -0,0 +1,148 @@
+/*
+ * test_voices - Pruebas nativas de la tabla de voces (voices.h)
+ *
+ * Ejecutar con: pio test -e native -f test_voices
+ */
+
+#include <unity.h>
+
+#include "voices.h"
+
+// Un pin distinto por voz para poder contar notas por voz
+const uint8_t FIRST_TEST_PIN = 30;
+
+static void addVoices(uint8_t count) {
+  for (uint8_t v = 0; v < count; v++) {
+    voiceAdd(defaultVoiceType(v), FIRST_TEST_PIN + v);
+  }
+}
+
+static void runFor(uint32_t ms) {
+  for (uint32_t t = 0; t < ms; t++) {
+    voicesUpdate(hal::millis());
+    hal::sim::advance(1);
+  }
+}
+
+void setUp() {
+  hal::sim::reset(7);
+  rootNoteOffset = 0;
+  currentState = FREQ_NORMAL;
+  voicesClear();
+}
+
+void tearDown() {}
+
+void test_heap_keeps_earliest_deadline_on_top() {
+  addVoices(MAX_VOICES);
+  TEST_ASSERT_EQUAL(MAX_VOICES, voices.heapSize);
+  for (uint8_t i = 1; i < voices.heapSize; i++) {
+    uint8_t parent = (i - 1) / 2;
+    TEST_ASSERT_FALSE(deadlineBefore(voices.deadline[voices.heap[i]], voices.deadline[voices.heap[parent]]));
+    TEST_ASSERT_EQUAL(i, voices.heapPos[voices.heap[i]]);
+  }
+}
+
+void test_update_touches_only_due_voices() {
+  addVoices(MAX_VOICES);
+  uint32_t earliest = voices.deadline[voices.heap[0]];
+
+  voicesUpdate(earliest - 1);
+  TEST_ASSERT_EQUAL_UINT32(0, voices.processed);
+
+  uint8_t due = 0;
+  for (uint8_t v = 0; v < voices.count; v++) {
+    if (deadlineReached(voices.deadline[v], earliest)) due++;
+  }
+  voicesUpdate(earliest);
+  TEST_ASSERT_EQUAL_UINT32(due, voices.processed);
+}
+
+void test_sixteen_voices_all_sound() {
+  addVoices(MAX_VOICES);
+  runFor(120000);
+  for (uint8_t v = 0; v < MAX_VOICES; v++) {
+    TEST_ASSERT_TRUE(hal::sim::piezo(FIRST_TEST_PIN + v).toneCount > 0);
+  }
+}
+
+void test_muted_voice_is_not_scheduled() {
+  addVoices(4);
+  voiceToggleMute(2);
+  TEST_ASSERT_EQUAL(3, voices.heapSize);
+  runFor(60000);
+  TEST_ASSERT_EQUAL_UINT32(0, hal::sim::piezo(FIRST_TEST_PIN + 2).toneCount);
+  TEST_ASSERT_TRUE(hal::sim::piezo(FIRST_TEST_PIN + 1).toneCount > 0);
+
+  voiceToggleMute(2);
+  TEST_ASSERT_EQUAL(4, voices.heapSize);
+  runFor(60000);
+  TEST_ASSERT_TRUE(hal::sim::piezo(FIRST_TEST_PIN + 2).toneCount > 0);
+}
+
+void test_unmuted_voice_sings_after_a_long_mute() {
+  addVoices(1);
+  voiceToggleMute(0);
+  // Más de 24,8 días: el vencimiento viejo parecería futuro
+  hal::sim::advance(30UL * 86400000UL);
+  voiceToggleMute(0);
+  TEST_ASSERT_EQUAL_UINT32(hal::millis(), voicesNextDeadline(hal::millis(), MAX_SLEEP_MS));
+  runFor(2000);
+  TEST_ASSERT_TRUE(hal::sim::piezo(FIRST_TEST_PIN).toneCount > 0);
+}
+
+void test_regenerated_sequence_keeps_index_in_range() {
+  addVoices(1);
+  for (uint8_t i = 0; i < 50; i++) {
+    voiceSetActive(0, true);
+    voices.sequenceIndex[0] = voices.sequenceLength[0] - 1;   // Última nota
+    voiceGenerateSequence(0);
+    TEST_ASSERT_TRUE(voices.sequenceIndex[0] < voices.sequenceLength[0]);
+  }
+}
+
+void test_sequences_use_compact_notes_in_range() {
+  addVoices(MAX_VOICES);
+  for (uint8_t v = 0; v < voices.count; v++) {
+    uint8_t length = voices.sequenceLength[v];
+    TEST_ASSERT_TRUE(length >= 3 && length <= getMaxSequenceLength(voiceType(v)));
+    for (uint8_t i = 0; i < length; i++) {
+      uint16_t hz = noteFrequency(voices.notes[v][i]);
+      TEST_ASSERT_TRUE(hz >= 20 && hz <= 8000);
+    }
+  }
+}
+
+void test_type_mask_tracks_spider_playing() {
+  addVoices(2);
+  TEST_ASSERT_FALSE(voicesTypePlaying(SPIDER));
+  voiceSetActive(0, true);
+  TEST_ASSERT_TRUE(voicesTypePlaying(SPIDER));
+  voiceSetType(0, BEETLE);
+  TEST_ASSERT_FALSE(voicesTypePlaying(SPIDER));
+}
+
+void test_deadlines_survive_millis_wraparound() {
+  hal::sim::setMillis(0xFFFFFFFFUL - 20000);
+  addVoices(2);
+  runFor(30000);
+  uint32_t before = hal::sim::piezo(FIRST_TEST_PIN).toneCount + hal::sim::piezo(FIRST_TEST_PIN + 1).toneCount;
+  TEST_ASSERT_TRUE(hal::millis() < 20000); // Ya ha desbordado
+  runFor(60000);
+  uint32_t after = hal::sim::piezo(FIRST_TEST_PIN).toneCount + hal::sim::piezo(FIRST_TEST_PIN + 1).toneCount;
+  TEST_ASSERT_TRUE(after > before);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_heap_keeps_earliest_deadline_on_top);
+  RUN_TEST(test_update_touches_only_due_voices);
+  RUN_TEST(test_sixteen_voices_all_sound);
+  RUN_TEST(test_muted_voice_is_not_scheduled);
+  RUN_TEST(test_unmuted_voice_sings_after_a_long_mute);
+  RUN_TEST(test_regenerated_sequence_keeps_index_in_range);
+  RUN_TEST(test_sequences_use_compact_notes_in_range);
+  RUN_TEST(test_type_mask_tracks_spider_playing);
+  RUN_TEST(test_deadlines_survive_millis_wraparound);
+  return UNITY_END();
+}
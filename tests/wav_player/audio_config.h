@@ -77,12 +77,26 @@
 // Configuración de buffer de audio
 #define AUDIO_BUFFER_SIZE 1024  // Tamaño del buffer en bytes
 
+// Lectura anticipada de la SD (wav_prefetch.h): bloques de 4 KB alineados
+// con el archivo hacia un anillo de 64 KB, unos 370 ms de estéreo de 16 bits
+// a 44,1 kHz, más que las pausas de 250 ms que hacen algunas tarjetas al
+// reorganizar su flash (bench-prefetch). Ajustar con el informe de cada tarjeta
+#define PREFETCH_BLOCK_SIZE   (4 * AUDIO_BUFFER_SIZE)
+#define PREFETCH_BUFFER_SIZE  (64 * AUDIO_BUFFER_SIZE)
+#define PREFETCH_IDLE_MS      2       // Espera de la tarea con el anillo lleno
+#define PREFETCH_REPORT_MS    10000   // Informe de vacíos, llenado y latencia
+
 // Frecuencias de muestreo soportadas
 #define SAMPLE_RATE_8K    8000
 #define SAMPLE_RATE_16K   16000
 #define SAMPLE_RATE_22K   22050
 #define SAMPLE_RATE_44K   44100
 
+// El I2S va siempre a esta frecuencia, fijada en setup(); las pistas a otra
+// se convierten con el resampler de piezoBugs (resampler.h)
+#define OUTPUT_SAMPLE_RATE  SAMPLE_RATE_44K
+#define RESAMPLE_BLOCK      128     // Muestras por canal convertidas de una vez
+
 // ===============================================
 // CONFIGURACIÓN DE ARCHIVOS SOPORTADOS
 // ===============================================
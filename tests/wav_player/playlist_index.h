@@ -0,0 +1,370 @@
+/*
+ * playlist_index.h - Índice persistente de la lista de reproducción en la SD
+ *
+ * Antes cada arranque recorría la raíz de la SD con openNextFile() (que abre
+ * cada entrada), guardaba como mucho 5 rutas y AudioGeneratorWAV volvía a
+ * leer la cabecera del WAV al empezar cada pista. Ahora las pistas de
+ * PLAYLIST_DIR se describen en un archivo de índice en la propia tarjeta,
+ * con una entrada de tamaño fijo por pista: ruta, posición y longitud del
+ * PCM, frecuencia y formato. Al arrancar solo se compara la fecha de
+ * modificación de la carpeta con la guardada en el índice; si no se ha
+ * movido, arrancar es un stat() y leer 24 bytes, tenga la carpeta 5 pistas
+ * o 5000. Las entradas se leen del archivo al cambiar de pista (en RAM solo
+ * está la actual) y la reproducción salta directamente al PCM.
+ *
+ * El índice se regenera si la fecha de la carpeta cambia, si falta o no es
+ * válido, o si una pista ya no se puede abrir o no es la que se indexó
+ * (stale): cada entrada guarda el tamaño y la fecha del archivo, y al
+ * abrir la pista se comparan. Así una pista sustituida en su sitio (mismo
+ * nombre, la carpeta no cambia de fecha) no se reproduce con la posición
+ * y el formato de la anterior. Los PC actualizan la fecha de la carpeta al
+ * copiar archivos; si un sistema no lo hace, basta con borrar
+ * PLAYLIST_INDEX de la tarjeta.
+ *
+ * Usa la API POSIX: en el ESP32 la SD está montada en "/sd" (SD.begin) y en
+ * el host la raíz es una carpeta cualquiera (tests y bench-playlist).
+ */
+
+#ifndef PLAYLIST_INDEX_H
+#define PLAYLIST_INDEX_H
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ===============================================
+// FORMATO
+// ===============================================
+
+const char PLAYLIST_DIR[] = "/musica";             // Pistas (la raíz de FAT no tiene fecha)
+const char PLAYLIST_INDEX[] = "/playlist.idx";     // Fuera de la carpeta: escribirlo no mueve su fecha
+const char PLAYLIST_INDEX_TMP[] = "/playlist.tmp";
+const uint32_t PLAYLIST_MAGIC = 0x4C504250;        // "PBPL"
+const uint16_t PLAYLIST_VERSION = 2;
+const uint8_t PLAYLIST_PATH_MAX = 64;              // Ruta desde la raíz de la SD, con el 0
+const uint8_t PLAYLIST_ROOT_MAX = 96;
+const uint16_t PLAYLIST_FULL_PATH_MAX = PLAYLIST_ROOT_MAX + PLAYLIST_PATH_MAX;
+const uint8_t WAV_MAX_CHUNKS = 16;                 // Bloques antes de "data" que se recorren
+
+struct PlaylistHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t entrySize;
+  uint32_t count;
+  uint32_t reserved;
+  int64_t stamp;         // Fecha de modificación de PLAYLIST_DIR en ns
+};
+
+struct PlaylistEntry {
+  char path[PLAYLIST_PATH_MAX];
+  int64_t stamp;         // Fecha de modificación del archivo en ns
+  uint32_t fileSize;
+  uint32_t dataOffset;   // Primer byte del PCM dentro del WAV
+  uint32_t dataBytes;
+  uint32_t sampleRate;
+  uint16_t format;       // 1 = PCM
+  uint16_t channels;
+  uint16_t bitsPerSample;
+  uint16_t blockAlign;   // Bytes por muestra con todos los canales
+};
+
+static_assert(sizeof(PlaylistHeader) == 24, "Cabecera de 24 bytes");
+static_assert(sizeof(PlaylistEntry) == 96, "Entrada de 96 bytes");
+
+// ===============================================
+// ESTADO
+// ===============================================
+
+struct Playlist {
+  char root[PLAYLIST_ROOT_MAX];  // Punto de montaje de la SD ("/sd" en el ESP32)
+  int indexFd;                   // Índice abierto para leer entradas; -1 = no hay
+  uint32_t count;
+  uint32_t skipped;              // WAV descartados en la última reconstrucción
+  int64_t stamp;
+  bool rebuilt;                  // El último playlistBegin tuvo que reconstruir
+  bool stale;                    // Una pista del índice ya no se pudo abrir o cambió
+};
+
+// Operaciones de archivo, para comparar arranques y cambios de pista
+struct PlaylistStats {
+  uint32_t opens;
+  uint32_t reads;
+  uint32_t bytesRead;
+  uint32_t seeks;
+  uint32_t writes;
+  uint32_t bytesWritten;
+  uint32_t dirEntries;
+};
+
+PlaylistStats playlistStats;
+
+// ===============================================
+// ARCHIVOS
+// ===============================================
+
+int playlistOpenFile(const char *path, int flags) {
+  playlistStats.opens++;
+  return open(path, flags, 0644);
+}
+
+int32_t playlistReadFile(int fd, void *buffer, uint32_t bytes) {
+  playlistStats.reads++;
+  ssize_t n = read(fd, buffer, bytes);
+  if (n > 0) playlistStats.bytesRead += n;
+  return (int32_t)n;
+}
+
+bool playlistSeekFile(int fd, uint32_t position) {
+  playlistStats.seeks++;
+  return lseek(fd, position, SEEK_SET) == (off_t)position;
+}
+
+bool playlistWriteFile(int fd, const void *data, uint32_t bytes) {
+  playlistStats.writes++;
+  playlistStats.bytesWritten += bytes;
+  return write(fd, data, bytes) == (ssize_t)bytes;
+}
+
+// root + path en out; false si no cabe
+bool playlistJoin(char *out, uint16_t size, const char *root, const char *path) {
+  size_t rootLength = strlen(root);
+  size_t pathLength = strlen(path);
+  if (rootLength + pathLength >= size) return false;
+  memcpy(out, root, rootLength);
+  memcpy(out + rootLength, path, pathLength + 1);
+  return true;
+}
+
+bool playlistIsWavName(const char *name) {
+  size_t length = strlen(name);
+  // Los "._x.wav" que deja macOS no son audio
+  return name[0] != '.' && length >= 4 && strcasecmp(name + length - 4, ".wav") == 0;
+}
+
+// ===============================================
+// CABECERA WAV
+// ===============================================
+
+inline uint16_t wavU16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+inline uint32_t wavU32(const uint8_t *p) { return wavU16(p) | ((uint32_t)wavU16(p + 2) << 16); }
+
+// Recorre los bloques RIFF hasta "data" y rellena formato y posición del PCM
+bool wavReadInfo(int fd, uint32_t fileSize, PlaylistEntry &e) {
+  uint8_t chunk[16];
+  if (playlistReadFile(fd, chunk, 12) != 12 || memcmp(chunk, "RIFF", 4) || memcmp(chunk + 8, "WAVE", 4)) {
+    return false;
+  }
+  uint32_t position = 12;
+  bool haveFormat = false;
+  for (uint8_t i = 0; i < WAV_MAX_CHUNKS && position + 8 <= fileSize; i++) {
+    if (playlistReadFile(fd, chunk, 8) != 8) return false;
+    uint32_t size = wavU32(chunk + 4);
+    position += 8;
+    if (memcmp(chunk, "data", 4) == 0) {
+      if (!haveFormat) return false;
+      e.dataOffset = position;
+      e.dataBytes = size < fileSize - position ? size : fileSize - position;
+      e.dataBytes -= e.dataBytes % e.blockAlign;
+      return true;
+    }
+    if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+      if (playlistReadFile(fd, chunk, 16) != 16) return false;
+      e.format = wavU16(chunk);
+      e.channels = wavU16(chunk + 2);
+      e.sampleRate = wavU32(chunk + 4);
+      e.blockAlign = wavU16(chunk + 12);
+      e.bitsPerSample = wavU16(chunk + 14);
+      haveFormat = e.blockAlign != 0;
+      position += 16;
+      size -= 16;
+    }
+    if (size > fileSize - position) return false;
+    position += size + (size & 1);   // Los bloques van alineados a 2
+    if (!playlistSeekFile(fd, position)) return false;
+  }
+  return false;
+}
+
+// Lo que sabe reproducir el wav_player: PCM de 8 o 16 bits, mono o estéreo
+bool playlistEntrySupported(const PlaylistEntry &e) {
+  return e.format == 1 && (e.channels == 1 || e.channels == 2) &&
+         (e.bitsPerSample == 8 || e.bitsPerSample == 16) &&
+         e.blockAlign == e.channels * e.bitsPerSample / 8 &&
+         e.sampleRate >= 8000 && e.sampleRate <= 48000 && e.dataBytes > 0;
+}
+
+// Una muestra de la pista (blockAlign bytes) como estéreo de 16 bits
+inline void wavFrameToStereo(const PlaylistEntry &e, const uint8_t *frame, int16_t out[2]) {
+  if (e.bitsPerSample == 8) {
+    out[0] = (int16_t)((frame[0] - 128) << 8);
+    out[1] = e.channels == 2 ? (int16_t)((frame[1] - 128) << 8) : out[0];
+  } else {
+    out[0] = (int16_t)wavU16(frame);
+    out[1] = e.channels == 2 ? (int16_t)wavU16(frame + 2) : out[0];
+  }
+}
+
+// ===============================================
+// ÍNDICE
+// ===============================================
+
+inline int64_t playlistStatStamp(const struct stat &st) {
+  return (int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+}
+
+bool playlistStamp(const Playlist &list, int64_t &stamp) {
+  char path[PLAYLIST_FULL_PATH_MAX];
+  struct stat st;
+  if (!playlistJoin(path, sizeof(path), list.root, PLAYLIST_DIR) || stat(path, &st) != 0) return false;
+  stamp = playlistStatStamp(st);
+  return true;
+}
+
+// Un Playlist a cero no tiene índice abierto: el descriptor 0 no es suyo
+void playlistEnd(Playlist &list) {
+  if (list.indexFd > 0) close(list.indexFd);
+  list.indexFd = -1;
+  list.count = 0;
+}
+
+// Describe un WAV de la carpeta; false si no se puede reproducir
+bool playlistDescribe(const Playlist &list, const char *name, PlaylistEntry &e) {
+  memset(&e, 0, sizeof(e));
+  size_t dirLength = strlen(PLAYLIST_DIR);
+  size_t nameLength = strlen(name);
+  if (dirLength + 1 + nameLength >= PLAYLIST_PATH_MAX) return false;
+  memcpy(e.path, PLAYLIST_DIR, dirLength);
+  e.path[dirLength] = '/';
+  memcpy(e.path + dirLength + 1, name, nameLength + 1);
+
+  char path[PLAYLIST_FULL_PATH_MAX];
+  if (!playlistJoin(path, sizeof(path), list.root, e.path)) return false;
+  int fd = playlistOpenFile(path, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  bool ok = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size <= UINT32_MAX &&
+            wavReadInfo(fd, st.st_size, e) && playlistEntrySupported(e);
+  if (ok) {
+    e.stamp = playlistStatStamp(st);
+    e.fileSize = (uint32_t)st.st_size;
+  }
+  close(fd);
+  return ok;
+}
+
+// Recorre PLAYLIST_DIR, escribe el índice en un temporal y lo cambia por el
+// anterior. La fecha se toma antes de recorrer: si la carpeta cambia durante
+// el recorrido, el siguiente arranque vuelve a reconstruir
+bool playlistRebuild(Playlist &list) {
+  playlistEnd(list);
+  list.rebuilt = true;
+  list.stale = false;
+  list.skipped = 0;
+  char dirPath[PLAYLIST_FULL_PATH_MAX], tmpPath[PLAYLIST_FULL_PATH_MAX], indexPath[PLAYLIST_FULL_PATH_MAX];
+  if (!playlistStamp(list, list.stamp) ||
+      !playlistJoin(dirPath, sizeof(dirPath), list.root, PLAYLIST_DIR) ||
+      !playlistJoin(tmpPath, sizeof(tmpPath), list.root, PLAYLIST_INDEX_TMP) ||
+      !playlistJoin(indexPath, sizeof(indexPath), list.root, PLAYLIST_INDEX)) {
+    return false;
+  }
+  DIR *dir = opendir(dirPath);
+  if (!dir) return false;
+  int fd = playlistOpenFile(tmpPath, O_WRONLY | O_CREAT | O_TRUNC);
+  if (fd < 0) {
+    closedir(dir);
+    return false;
+  }
+
+  PlaylistHeader header = {PLAYLIST_MAGIC, PLAYLIST_VERSION, sizeof(PlaylistEntry), 0, 0, list.stamp};
+  bool ok = playlistWriteFile(fd, &header, sizeof(header));
+  PlaylistEntry e;
+  while (struct dirent *entry = readdir(dir)) {
+    playlistStats.dirEntries++;
+    if (!playlistIsWavName(entry->d_name)) continue;
+    if (!playlistDescribe(list, entry->d_name, e)) {
+      list.skipped++;
+      continue;
+    }
+    ok = ok && playlistWriteFile(fd, &e, sizeof(e));
+    header.count++;
+  }
+  closedir(dir);
+  ok = ok && playlistSeekFile(fd, 0) && playlistWriteFile(fd, &header, sizeof(header));
+  ok = close(fd) == 0 && ok;
+  // FAT no renombra sobre un archivo existente
+  unlink(indexPath);
+  if (!ok || rename(tmpPath, indexPath) != 0) {
+    unlink(tmpPath);
+    return false;
+  }
+  list.indexFd = playlistOpenFile(indexPath, O_RDONLY);
+  list.count = list.indexFd >= 0 ? header.count : 0;
+  return list.indexFd >= 0;
+}
+
+// Abre el índice de root; lo reconstruye si no vale o la carpeta ha cambiado
+bool playlistBegin(Playlist &list, const char *root) {
+  bool stale = list.stale;
+  playlistEnd(list);
+  memset(&list, 0, sizeof(list));
+  list.indexFd = -1;
+  if (strlen(root) >= PLAYLIST_ROOT_MAX) return false;
+  strcpy(list.root, root);
+
+  char indexPath[PLAYLIST_FULL_PATH_MAX];
+  int64_t stamp;
+  if (stale || !playlistStamp(list, stamp) ||
+      !playlistJoin(indexPath, sizeof(indexPath), list.root, PLAYLIST_INDEX)) {
+    return playlistRebuild(list);
+  }
+  int fd = playlistOpenFile(indexPath, O_RDONLY);
+  if (fd < 0) return playlistRebuild(list);
+  PlaylistHeader header;
+  struct stat st;
+  bool valid = playlistReadFile(fd, &header, sizeof(header)) == sizeof(header) &&
+               header.magic == PLAYLIST_MAGIC && header.version == PLAYLIST_VERSION &&
+               header.entrySize == sizeof(PlaylistEntry) && header.stamp == stamp &&
+               fstat(fd, &st) == 0 &&
+               (uint64_t)st.st_size == sizeof(header) + (uint64_t)header.count * sizeof(PlaylistEntry);
+  if (!valid) {
+    close(fd);
+    return playlistRebuild(list);
+  }
+  list.indexFd = fd;
+  list.count = header.count;
+  list.stamp = stamp;
+  return true;
+}
+
+// Entrada i del índice, leída del archivo
+bool playlistGet(Playlist &list, uint32_t i, PlaylistEntry &e) {
+  if (list.indexFd < 0 || i >= list.count) return false;
+  uint32_t position = sizeof(PlaylistHeader) + i * sizeof(PlaylistEntry);
+  return playlistSeekFile(list.indexFd, position) &&
+         playlistReadFile(list.indexFd, &e, sizeof(e)) == sizeof(e) &&
+         e.path[PLAYLIST_PATH_MAX - 1] == 0 && playlistEntrySupported(e);
+}
+
+// Abre la pista y la deja en el primer byte del PCM. Si ya no se puede, o
+// el archivo no es el que se indexó (otro tamaño o fecha, o el PCM no cabe
+// en él), el índice queda marcado para reconstruirse en el siguiente
+// playlistBegin
+int playlistOpenTrack(Playlist &list, const PlaylistEntry &e) {
+  char path[PLAYLIST_FULL_PATH_MAX];
+  int fd = playlistJoin(path, sizeof(path), list.root, e.path) ? playlistOpenFile(path, O_RDONLY) : -1;
+  struct stat st;
+  if (fd >= 0 && fstat(fd, &st) == 0 && (uint64_t)st.st_size == e.fileSize &&
+      playlistStatStamp(st) == e.stamp && (uint64_t)e.dataOffset + e.dataBytes <= (uint64_t)st.st_size &&
+      playlistSeekFile(fd, e.dataOffset)) {
+    return fd;
+  }
+  if (fd >= 0) close(fd);
+  list.stale = true;
+  return -1;
+}
+
+#endif // PLAYLIST_INDEX_H
@@ -8,48 +8,70 @@
  * 2. Buscar: "ESP8266Audio"
  * 3. Instalar: "ESP8266Audio by Earle F. Philhower"
  * 
- * Busca: example.wav en la raíz de la SD
- * 
+ * Reproduce los WAV de /musica en la SD, descritos en /playlist.idx
+ * (playlist_index.h): el índice solo se regenera cuando cambia la carpeta,
+ * así que arrancar no depende del número de pistas, y cada pista empieza
+ * leyendo directamente su PCM, sin volver a interpretar la cabecera.
+ * Una tarea del núcleo 0 lee la pista por adelantado a un anillo en RAM
+ * (wav_prefetch.h) y el loop solo copia de RAM: una lectura lenta de la SD
+ * ya no corta el audio mientras quede anillo.
+ *
  * Hardware:
  * - ESP32 AudioKit v2.2 
- * - Tarjeta microSD con example.wav
+ * - Tarjeta microSD con WAV (PCM de 8 o 16 bits) en /musica
  * - Auriculares en jack 3.5mm
  * 
  * Controles básicos:
  * - Botón 1 (GPIO36): Play/Pause
  * - Botón 4 (GPIO16): Siguiente archivo
+ *
+ * La salida I2S se crea una vez en setup() a OUTPUT_SAMPLE_RATE y su reloj
+ * no cambia nunca: las pistas a otra frecuencia pasan por el resampler
+ * polifásico de piezoBugs (resampler.h), un filtro por canal. Al cambiar
+ * de archivo solo se abre la pista nueva, sin new/delete ni String en el
+ * loop
  */
 
-#include "AudioFileSourceSD.h"
-#include "AudioGeneratorWAV.h"
 #include "AudioOutputI2S.h"
 #include "SD.h"
+#include "resampler.h"      // Antes que audio_config.h: sus #define chocan con config.h de piezoBugs
+#include "audio_config.h"   // Pines, AUDIO_BUFFER_SIZE y tamaños de la lectura anticipada
+#include "playlist_index.h"
+#include "wav_prefetch.h"
 
-// Pines I2S 
-#define I2S_DOUT      25
-#define I2S_BCLK      27
-#define I2S_LRC       26
+// Salida I2S de ESP8266Audio; el PCM se le pasa muestra a muestra
+AudioOutputI2S *out;
 
-// SD
-#define SD_CS         5
+// Lista de reproducción (índice en la SD) y pista actual
+Playlist playlist;
+PlaylistEntry track;
 
-// Botones
-#define BUTTON_1      36    // Play/Pause
-#define BUTTON_4      16    // Siguiente
+// Lectura anticipada: la tarea llena el anillo, el loop copia a pcm
+Prefetch prefetch;
+uint8_t prefetchRing[PREFETCH_BUFFER_SIZE];
+unsigned long lastReport = 0;
 
-// LEDs
-#define LED_SYSTEM    2
+#define PCM_BUFFER AUDIO_BUFFER_SIZE
+uint8_t pcm[PCM_BUFFER];
+uint16_t pcmLength = 0;
+uint16_t pcmPos = 0;
 
-// Objetos de audio ESP8266Audio
-AudioGeneratorWAV *wav;
-AudioFileSourceSD *file;
-AudioOutputI2S *out;
+// Conversión a OUTPUT_SAMPLE_RATE: la tabla se recalcula solo cuando cambia
+// la frecuencia de la pista. Entradas pendientes y salidas por canal
+int16_t resamplerCoeffs[(RESAMPLER_PHASES + 1) * RESAMPLER_MAX_TAPS];
+ResamplerTable resamplerTable = {};
+Resampler resampler[2];
+bool resampling = false;
+int16_t resampleIn[2][RESAMPLE_BLOCK];
+int16_t resampleOut[2][RESAMPLE_BLOCK];
+uint16_t resampleInLength = 0;
+uint16_t resampleOutLength = 0;
+uint16_t resampleOutPos = 0;
+uint16_t resampleTail = 0;   // Ceros que faltan para sacar la cola del filtro
 
 // Estado simple
 bool isPlaying = false;
-int fileIndex = 0;
-String files[5];  // Máximo 5 archivos
-int numFiles = 0;
+uint32_t fileIndex = 0;
 
 // Timing
 unsigned long lastButton = 0;
@@ -72,35 +94,43 @@ void setup() {
     return;
   }
   
-  // Buscar archivos
-  findFiles();
+  // Lista de reproducción: leer el índice o reconstruirlo si la carpeta cambió
+  uint32_t start = micros();
+  if (!playlistBegin(playlist, "/sd")) {
+    Serial.println("No hay carpeta /musica");
+  }
+  Serial.printf("Índice %s en %lu us: %lu pistas, %lu descartadas\n",
+                playlist.rebuilt ? "reconstruido" : "leído", (unsigned long)(micros() - start),
+                (unsigned long)playlist.count, (unsigned long)playlist.skipped);
+  
+  // Lectura anticipada en el núcleo 0; el loop va en el 1
+  prefetchBegin(prefetch, prefetchRing, sizeof(prefetchRing), playlistReadFile, prefetchClock);
+  xTaskCreatePinnedToCore(prefetchTask, "prefetch", 4096, nullptr, 2, nullptr, 0);
   
   // Configurar audio I2S
   out = new AudioOutputI2S();
   out->SetPinout(I2S_BCLK, I2S_LRC, I2S_DOUT);
   out->SetGain(0.1);  // Volumen bajo inicial
-  
-  wav = new AudioGeneratorWAV();
+  out->SetRate(OUTPUT_SAMPLE_RATE);
+  out->SetBitsPerSample(16);
+  out->SetChannels(2);
+  out->begin();
   
   Serial.println("Listo!");
-  Serial.println("Archivos: " + String(numFiles));
   Serial.println("Botón 1: Play/Pause");
   Serial.println("Botón 4: Siguiente");
 }
 
 void loop() {
   // Mantener audio corriendo
-  if (wav->isRunning()) {
-    if (!wav->loop()) {
-      wav->stop();
-      if (file) {
-        file->close();
-        delete file;
-        file = nullptr;
-      }
-      isPlaying = false;
-      Serial.println("Archivo terminado");
-    }
+  if (isPlaying && !pumpAudio()) {
+    stopCurrentFile();
+    Serial.println("Archivo terminado");
+    printPrefetchReport();
+  }
+  if (isPlaying && millis() - lastReport > PREFETCH_REPORT_MS) {
+    printPrefetchReport();
+    lastReport = millis();
   }
   
   // Botones simples
@@ -115,88 +145,178 @@ void loop() {
     }
   }
   
-  delay(10);
+  delay(MAIN_LOOP_DELAY_MS);
 }
 
-void findFiles() {
-  numFiles = 0;
-  
-  // Buscar solo archivos WAV (ESP8266Audio solo soporta WAV bien)
-  if (SD.exists("/example.wav")) {
-    files[numFiles++] = "/example.wav";
-    Serial.println("Encontrado: example.wav");
+uint32_t prefetchClock() {
+  return micros();
+}
+
+// Un bloque cada vez que cabe en el anillo; con el anillo lleno, espera
+void prefetchTask(void *) {
+  while (true) {
+    if (!prefetchService(prefetch)) vTaskDelay(pdMS_TO_TICKS(PREFETCH_IDLE_MS));
   }
-  
-  // Si no hay archivos específicos, buscar otros WAV
-  if (numFiles == 0) {
-    File root = SD.open("/");
-    File file = root.openNextFile();
-    while (file && numFiles < 5) {
-      String name = file.name();
-      if (name.endsWith(".wav") || name.endsWith(".WAV")) {
-        files[numFiles++] = "/" + name;
-        Serial.println("Encontrado: " + name);
-      }
-      file = root.openNextFile();
+}
+
+// Vacíos, nivel del anillo y latencia de la SD desde el arranque
+void printPrefetchReport() {
+  const PrefetchStats &s = prefetch.stats;
+  Serial.printf("SD: %lu bloques, media %lu us, máx %lu us; vacíos %lu, anillo mín %lu%%\n",
+                (unsigned long)s.blocks, (unsigned long)(s.blocks ? s.readUsTotal / s.blocks : 0),
+                (unsigned long)s.readUsMax, (unsigned long)s.underruns,
+                (unsigned long)((uint64_t)s.fillMin * 100 / prefetch.size));
+  Serial.print("  latencia (<1,2,5,10,20,50,100 ms, más):");
+  for (uint8_t i = 0; i < PREFETCH_LATENCY_BUCKETS; i++) Serial.printf(" %lu", (unsigned long)s.readHistogram[i]);
+  Serial.print("\n  anillo por octavos:");
+  for (uint8_t i = 0; i < PREFETCH_FILL_BUCKETS; i++) Serial.printf(" %lu", (unsigned long)s.fillHistogram[i]);
+  Serial.println();
+}
+
+// Siguiente muestra de la pista tal cual, del anillo; false si está vacío
+bool nextTrackFrame(int16_t sample[2]) {
+  if (pcmPos >= pcmLength) {
+    uint32_t n = prefetchRead(prefetch, pcm, PCM_BUFFER, track.blockAlign);
+    if (n == 0) return false;
+    pcmLength = n;
+    pcmPos = 0;
+  }
+  wavFrameToStereo(track, pcm + pcmPos, sample);
+  pcmPos += track.blockAlign;
+  return true;
+}
+
+// Convierte el siguiente bloque a OUTPUT_SAMPLE_RATE en resampleOut; false
+// si no hay nada que convertir (anillo vacío o pista y cola terminadas)
+bool resampleBlock() {
+  int16_t sample[2];
+  while (resampleInLength < RESAMPLE_BLOCK && nextTrackFrame(sample)) {
+    resampleIn[0][resampleInLength] = sample[0];
+    resampleIn[1][resampleInLength] = sample[1];
+    resampleInLength++;
+  }
+  uint32_t used;
+  if (resampleInLength > 0) {
+    // Los dos canales llevan la misma tabla: consumen y producen igual
+    resampleOutLength = resamplerProcess(resampler[0], resampleIn[0], resampleInLength, resampleOut[0],
+                                         RESAMPLE_BLOCK, used);
+    resamplerProcess(resampler[1], resampleIn[1], resampleInLength, resampleOut[1], RESAMPLE_BLOCK, used);
+    resampleInLength -= used;
+    memmove(resampleIn[0], resampleIn[0] + used, resampleInLength * 2);
+    memmove(resampleIn[1], resampleIn[1] + used, resampleInLength * 2);
+  } else if (resampleTail > 0 && prefetchFinished(prefetch)) {
+    // Fin de la pista: las últimas entradas salen pasando ceros
+    resampleOutLength = resamplerProcess(resampler[0], nullptr, resampleTail, resampleOut[0], RESAMPLE_BLOCK, used);
+    resamplerProcess(resampler[1], nullptr, resampleTail, resampleOut[1], RESAMPLE_BLOCK, used);
+    resampleTail -= used;
+  } else {
+    return false;
+  }
+  resampleOutPos = 0;
+  return true;
+}
+
+// Pasa la pista convertida al I2S hasta llenar su DMA; false al terminar
+bool pumpResampled() {
+  while (true) {
+    if (resampleOutPos >= resampleOutLength) {
+      if (!resampleBlock()) return resampleTail > 0 || !prefetchFinished(prefetch);
+      continue;
+    }
+    int16_t sample[2] = {resampleOut[0][resampleOutPos], resampleOut[1][resampleOutPos]};
+    if (!out->ConsumeSample(sample)) return true;
+    resampleOutPos++;
+  }
+}
+
+// Pasa PCM del anillo al I2S hasta llenar su DMA; false al terminar
+bool pumpAudio() {
+  if (resampling) return pumpResampled();
+  while (true) {
+    if (pcmPos >= pcmLength) {
+      uint32_t n = prefetchRead(prefetch, pcm, PCM_BUFFER, track.blockAlign);
+      // Anillo vacío: si la pista no ha terminado, el DMA sigue sonando
+      // lo que tenga y se vuelve a intentar en la siguiente vuelta
+      if (n == 0) return !prefetchFinished(prefetch);
+      pcmLength = n;
+      pcmPos = 0;
     }
-    root.close();
+    int16_t sample[2];
+    wavFrameToStereo(track, pcm + pcmPos, sample);
+    if (!out->ConsumeSample(sample)) return true;
+    pcmPos += track.blockAlign;
+  }
+}
+
+// Abre la pista fileIndex del índice, ya colocada en su PCM
+bool startCurrentFile() {
+  uint32_t start = micros();
+  if (!playlistGet(playlist, fileIndex, track)) return false;
+  // Misma frecuencia que el I2S: la pista sale tal cual
+  resampling = track.sampleRate != OUTPUT_SAMPLE_RATE;
+  if (resampling && resamplerTable.inRate != track.sampleRate &&
+      !resamplerTableBuild(resamplerTable, track.sampleRate, OUTPUT_SAMPLE_RATE, resamplerCoeffs,
+                           sizeof(resamplerCoeffs) / sizeof(resamplerCoeffs[0]))) {
+    resamplerTable.inRate = 0;
+    Serial.printf("%s: %lu Hz no se puede convertir\n", track.path, (unsigned long)track.sampleRate);
+    return false;
+  }
+  if (resampling) {
+    resamplerReset(resampler[0], &resamplerTable);
+    resamplerReset(resampler[1], &resamplerTable);
+    resampleTail = resamplerTable.taps / 2;
+  }
+  resampleInLength = resampleOutLength = resampleOutPos = 0;
+  int fd = playlistOpenTrack(playlist, track);
+  if (fd < 0) {
+    // La tarjeta cambió sin mover la fecha de la carpeta
+    Serial.println("Índice desactualizado, reconstruyendo");
+    playlistBegin(playlist, "/sd");
+    fileIndex = 0;
+    return false;
   }
+  // La tarea se queda el archivo; espera a que suelte la pista anterior
+  while (!prefetchStart(prefetch, fd, track.dataOffset, track.dataBytes)) delay(1);
+  pcmLength = pcmPos = 0;
+  isPlaying = true;
+  Serial.printf("%s (%lu Hz, %u canales) en %lu us\n", track.path, (unsigned long)track.sampleRate,
+                track.channels, (unsigned long)(micros() - start));
+  return true;
+}
+
+// La tarea cierra el archivo al atender la parada
+void stopCurrentFile() {
+  out->stop();
+  while (!prefetchStop(prefetch)) delay(1);
+  isPlaying = false;
 }
 
 void togglePlay() {
-  if (numFiles == 0) {
+  if (playlist.count == 0) {
     Serial.println("No hay archivos");
     return;
   }
   
   if (isPlaying) {
-    wav->stop();
-    if (file) {
-      file->close();
-      delete file;
-      file = nullptr;
-    }
-    isPlaying = false;
+    stopCurrentFile();
     Serial.println("Stop");
-  } else {
-    String filename = files[fileIndex];
-    Serial.println("Play: " + filename);
-    
-    file = new AudioFileSourceSD(filename.c_str());
-    if (wav->begin(file, out)) {
-      isPlaying = true;
-    } else {
-      Serial.println("Error al reproducir");
-      delete file;
-      file = nullptr;
-    }
+  } else if (!startCurrentFile()) {
+    Serial.println("Error al reproducir");
   }
 }
 
 void nextFile() {
-  if (numFiles == 0) return;
+  if (playlist.count == 0) return;
   
-  fileIndex = (fileIndex + 1) % numFiles;
-  Serial.println("Siguiente: " + files[fileIndex]);
+  fileIndex = (fileIndex + 1) % playlist.count;
+  Serial.print("Siguiente: ");
+  Serial.println(fileIndex);
   
   if (isPlaying) {
-    // Detener archivo actual
-    wav->stop();
-    if (file) {
-      file->close();
-      delete file;
-    }
-    
-    // Reproducir nuevo archivo
-    String filename = files[fileIndex];
-    file = new AudioFileSourceSD(filename.c_str());
-    if (wav->begin(file, out)) {
-      Serial.println("Reproduciendo: " + filename);
-    } else {
+    // Detener archivo actual y reproducir el nuevo
+    stopCurrentFile();
+    if (!startCurrentFile()) {
       Serial.println("Error al cambiar archivo");
-      isPlaying = false;
-      delete file;
-      file = nullptr;
     }
   }
-}
\ No newline at end of file
+}
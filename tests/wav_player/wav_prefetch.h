@@ -0,0 +1,236 @@
+/*
+ * wav_prefetch.h - Lectura anticipada del PCM de la SD
+ *
+ * El loop del wav_player pedía los datos a la SD justo cuando el I2S los
+ * necesitaba, en el mismo loop que los botones y el delay(10): cualquier
+ * lectura lenta de la tarjeta (las hay de cientos de ms cuando la SD
+ * reorganiza su flash) se oía como un corte. Ahora una tarea del núcleo 0
+ * lee la pista por adelantado, en bloques de PREFETCH_BLOCK_SIZE alineados
+ * con el archivo, a un anillo en RAM (PREFETCH_BUFFER_SIZE; los dos salen
+ * de AUDIO_BUFFER_SIZE en audio_config.h) y el loop solo copia de RAM.
+ *
+ * El anillo tiene un productor (la tarea) y un consumidor (el loop) y no
+ * usa bloqueos. Cambiar de pista es una petición que la tarea atiende entre
+ * dos bloques; hasta entonces el loop no lee. La tarea es la dueña del
+ * archivo abierto y lo cierra al pasar a otra pista o al parar.
+ *
+ * Cuenta los vacíos del anillo (underruns), el nivel del anillo en cada
+ * lectura del loop y la latencia de cada bloque, para ajustar los tamaños
+ * a cada tarjeta. La lectura y el reloj se pasan como funciones: en el
+ * ESP32, playlistReadFile y micros(); en los tests y bench-prefetch, una SD
+ * simulada.
+ */
+
+#ifndef WAV_PREFETCH_H
+#define WAV_PREFETCH_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "audio_config.h"
+
+static_assert((PREFETCH_BLOCK_SIZE & (PREFETCH_BLOCK_SIZE - 1)) == 0, "Bloque potencia de 2");
+static_assert(PREFETCH_BUFFER_SIZE % PREFETCH_BLOCK_SIZE == 0, "Anillo de bloques enteros");
+
+typedef int32_t (*PrefetchReadFn)(int fd, void *buffer, uint32_t bytes);
+typedef uint32_t (*PrefetchClockFn)();   // Microsegundos
+
+// Límites superiores de los cubos de latencia; el último cubo es el resto
+const uint8_t PREFETCH_LATENCY_BUCKETS = 8;
+const uint32_t PREFETCH_LATENCY_LIMITS_US[PREFETCH_LATENCY_BUCKETS - 1] = {
+    1000, 2000, 5000, 10000, 20000, 50000, 100000};
+const uint8_t PREFETCH_FILL_BUCKETS = 8;         // Octavos del anillo
+
+struct PrefetchStats {
+  uint32_t underruns;        // El loop encontró el anillo vacío con la pista sin terminar
+  uint32_t blocks;
+  uint32_t bytes;
+  uint32_t readErrors;
+  uint32_t readUsMax;
+  uint64_t readUsTotal;
+  uint32_t readHistogram[PREFETCH_LATENCY_BUCKETS];
+  uint32_t fillMin;          // Menor nivel del anillo visto por el loop, en bytes
+  uint32_t fillHistogram[PREFETCH_FILL_BUCKETS];   // Lecturas del loop por nivel
+};
+
+struct Prefetch {
+  uint8_t *ring;
+  uint32_t size;             // Potencia de 2, múltiplo de PREFETCH_BLOCK_SIZE
+  PrefetchReadFn read;
+  PrefetchClockFn clock;
+
+  // Petición del loop: se escribe antes de subir requestSeq
+  std::atomic<uint32_t> requestSeq;
+  int requestFd;
+  uint32_t requestOffset;
+  uint32_t requestBytes;
+
+  // Pista de la tarea
+  std::atomic<uint32_t> activeSeq;
+  int fd;
+  uint32_t filePos;
+  uint32_t fileLeft;
+  std::atomic<bool> fileDone;     // No queda nada por leer de la pista activa
+
+  // Anillo: head lo sube la tarea, tail el loop (contadores de bytes)
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> tail;
+  bool dry;                       // El loop ya contó el vacío actual
+  bool primed;                    // Ya llegó PCM de esta pista: desde aquí cuentan vacíos y niveles
+
+  PrefetchStats stats;
+};
+
+// ===============================================
+// INICIALIZACIÓN
+// ===============================================
+
+void prefetchStatsReset(Prefetch &p) {
+  memset(&p.stats, 0, sizeof(p.stats));
+  p.stats.fillMin = p.size;
+}
+
+bool prefetchBegin(Prefetch &p, uint8_t *ring, uint32_t size, PrefetchReadFn read, PrefetchClockFn clock) {
+  if ((size & (size - 1)) || size % PREFETCH_BLOCK_SIZE) return false;
+  p.ring = ring;
+  p.size = size;
+  p.read = read;
+  p.clock = clock;
+  p.requestSeq.store(0);
+  p.activeSeq.store(0);
+  p.requestFd = p.fd = -1;
+  p.filePos = p.fileLeft = 0;
+  p.fileDone.store(true);
+  p.head.store(0);
+  p.tail.store(0);
+  p.dry = false;
+  p.primed = false;
+  prefetchStatsReset(p);
+  return true;
+}
+
+// ===============================================
+// LOOP (CONSUMIDOR)
+// ===============================================
+
+// Hay un cambio de pista que la tarea aún no ha atendido
+inline bool prefetchPending(const Prefetch &p) {
+  return p.requestSeq.load(std::memory_order_relaxed) != p.activeSeq.load(std::memory_order_acquire);
+}
+
+// Pasa a la tarea la pista abierta en fd (ya en su PCM, en offset) o, con
+// fd = -1, la parada. false si la petición anterior sigue pendiente
+bool prefetchStart(Prefetch &p, int fd, uint32_t offset, uint32_t bytes) {
+  if (prefetchPending(p)) return false;
+  p.requestFd = fd;
+  p.requestOffset = offset;
+  p.requestBytes = bytes;
+  p.dry = false;
+  p.primed = false;
+  p.requestSeq.store(p.requestSeq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  return true;
+}
+
+inline bool prefetchStop(Prefetch &p) { return prefetchStart(p, -1, 0, 0); }
+
+// Copia hasta max bytes del anillo (múltiplo de align). 0 si está vacío; si
+// la pista no había terminado cuenta un vacío, una vez por racha. La espera
+// al primer bloque de cada pista no cuenta: aún no sonaba nada
+uint32_t prefetchRead(Prefetch &p, uint8_t *out, uint32_t max, uint32_t align) {
+  if (prefetchPending(p)) return 0;
+  bool done = p.fileDone.load(std::memory_order_acquire);
+  uint32_t tail = p.tail.load(std::memory_order_relaxed);
+  uint32_t available = p.head.load(std::memory_order_acquire) - tail;
+  if (!p.primed) {
+    if (available < align) return 0;
+    p.primed = true;
+  }
+
+  PrefetchStats &s = p.stats;
+  if (available < s.fillMin) s.fillMin = available;
+  uint32_t bucket = (uint64_t)available * PREFETCH_FILL_BUCKETS / p.size;
+  s.fillHistogram[bucket < PREFETCH_FILL_BUCKETS ? bucket : PREFETCH_FILL_BUCKETS - 1]++;
+
+  uint32_t n = available < max ? available : max;
+  n -= n % align;
+  if (n == 0) {
+    if (!done && !p.dry) s.underruns++;
+    p.dry = true;
+    return 0;
+  }
+  p.dry = false;
+  uint32_t start = tail & (p.size - 1);
+  uint32_t first = p.size - start < n ? p.size - start : n;
+  memcpy(out, p.ring + start, first);
+  memcpy(out + first, p.ring, n - first);
+  p.tail.store(tail + n, std::memory_order_release);
+  return n;
+}
+
+// La pista activa se ha leído y consumido entera
+inline bool prefetchFinished(const Prefetch &p) {
+  return !prefetchPending(p) && p.fileDone.load(std::memory_order_acquire) &&
+         p.head.load(std::memory_order_acquire) == p.tail.load(std::memory_order_relaxed);
+}
+
+// ===============================================
+// TAREA (PRODUCTOR)
+// ===============================================
+
+void prefetchRecordRead(PrefetchStats &s, uint32_t bytes, uint32_t us) {
+  s.blocks++;
+  s.bytes += bytes;
+  s.readUsTotal += us;
+  if (us > s.readUsMax) s.readUsMax = us;
+  uint8_t bucket = 0;
+  while (bucket < PREFETCH_LATENCY_BUCKETS - 1 && us >= PREFETCH_LATENCY_LIMITS_US[bucket]) bucket++;
+  s.readHistogram[bucket]++;
+}
+
+// Atiende un cambio de pista o lee un bloque si cabe. false si no había
+// nada que hacer (anillo lleno o pista terminada): la tarea puede esperar
+bool prefetchService(Prefetch &p) {
+  uint32_t seq = p.requestSeq.load(std::memory_order_acquire);
+  if (seq != p.activeSeq.load(std::memory_order_relaxed)) {
+    if (p.fd >= 0) close(p.fd);
+    p.fd = p.requestFd;
+    p.filePos = p.requestOffset;
+    p.fileLeft = p.fd >= 0 ? p.requestBytes : 0;
+    // El anillo arranca en la misma posición del bloque que el archivo:
+    // así cada lectura alineada cae entera sin dar la vuelta
+    uint32_t start = p.filePos % PREFETCH_BLOCK_SIZE;
+    p.head.store(start, std::memory_order_relaxed);
+    p.tail.store(start, std::memory_order_relaxed);
+    p.fileDone.store(p.fileLeft == 0, std::memory_order_relaxed);
+    p.activeSeq.store(seq, std::memory_order_release);
+    return true;
+  }
+  if (p.fileLeft == 0) return false;
+
+  uint32_t head = p.head.load(std::memory_order_relaxed);
+  uint32_t space = p.size - (head - p.tail.load(std::memory_order_acquire));
+  uint32_t contiguous = p.size - (head & (p.size - 1));
+  uint32_t want = PREFETCH_BLOCK_SIZE - p.filePos % PREFETCH_BLOCK_SIZE;
+  if (want > p.fileLeft) want = p.fileLeft;
+  if (want > contiguous) want = contiguous;
+  if (space < want) return false;
+
+  uint32_t start = p.clock();
+  int32_t n = p.read(p.fd, p.ring + (head & (p.size - 1)), want);
+  uint32_t us = p.clock() - start;
+  if (n <= 0) {
+    p.stats.readErrors++;
+    p.fileLeft = 0;
+    p.fileDone.store(true, std::memory_order_release);
+    return false;
+  }
+  prefetchRecordRead(p.stats, n, us);
+  p.filePos += n;
+  p.fileLeft -= n;
+  p.head.store(head + n, std::memory_order_release);
+  if (p.fileLeft == 0) p.fileDone.store(true, std::memory_order_release);
+  return true;
+}
+
+#endif // WAV_PREFETCH_H
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""
+log_decode.py - Convierte los registros binarios de piezoBugs/log.h en texto
+
+La consola serie mezcla texto normal con registros de 17 bytes (0x1E y un
+LogRecord de 16). El texto pasa tal cual y cada registro se sustituye por
+su mensaje en castellano. Los textos, los nombres de los insectos y de las
+notas se leen de piezoBugs/log.h y piezoBugs/tuning.h, así que el
+decodificador siempre va a juego con el firmware del mismo commit.
+
+Uso: python3 tools/log_decode.py [-t] [log.bin]
+     pio device monitor --raw | python3 tools/log_decode.py
+     .pio/build/native/program 60 1 -v | python3 tools/log_decode.py
+  -t: anteponer los ms de cada registro
+"""
+
+import os
+import re
+import struct
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SOURCES = os.path.join(HERE, "..", "piezoBugs")
+
+FRAME_START = 0x1E
+RECORD = struct.Struct("<IBB5h")   # ms, id, nivel, 5 argumentos
+LEVELS = {1: "ERROR", 2: "AVISO", 3: "INFO", 4: "DEBUG"}
+
+
+def load_catalog():
+    with open(os.path.join(SOURCES, "log.h"), encoding="utf-8") as f:
+        log_h = f.read()
+    with open(os.path.join(SOURCES, "tuning.h"), encoding="utf-8") as f:
+        tuning_h = f.read()
+    texts = [text for _, text in re.findall(r'X\((LOG_\w+),\s*LOG_LEVEL_\w+,\s*"((?:[^"\\]|\\.)*)"\)', log_h)]
+    insects = re.findall(r'"([^"]*)"', re.search(r"INSECT_TYPE_NAMES\[\]\s*=\s*\{([^}]*)\}", log_h).group(1))
+    notes = re.findall(r'"([^"]*)"', re.search(r"NOTE_NAMES\[SEMITONES\]\s*=\s*\{([^}]*)\}", tuning_h).group(1))
+    return texts, insects, notes
+
+
+def format_record(record, catalog):
+    texts, insects, notes = catalog
+    ms, ident, level, *args = record
+    if ident >= len(texts):
+        return f"Log: mensaje {ident} desconocido"
+    values = iter(args)
+
+    def argument(match):
+        kind = match.group(1)
+        if kind == "%":
+            return "%"
+        value = next(values, 0)
+        if kind == "t":
+            return insects[value] if 0 <= value < len(insects) else "Desconocido"
+        if kind == "r":
+            return notes[value % 12]
+        if kind == "n":
+            return f"{notes[value % 12]}{value // 12}"
+        return str(value)
+
+    return re.sub(r"%([dtrn%])", argument, texts[ident])
+
+
+def decode(data, catalog, timestamps, out):
+    i = 0
+    text = bytearray()
+    while i < len(data):
+        if data[i] == FRAME_START and i + 1 + RECORD.size <= len(data):
+            if text:
+                out.write(text.decode("utf-8", errors="replace"))
+                text.clear()
+            record = RECORD.unpack_from(data, i + 1)
+            line = format_record(record, catalog)
+            if timestamps:
+                line = f"[{record[0]:>9} ms] {line}"
+            out.write(line + "\n")
+            i += 1 + RECORD.size
+        else:
+            text.append(data[i])
+            i += 1
+    if text:
+        out.write(text.decode("utf-8", errors="replace"))
+
+
+def main():
+    args = [a for a in sys.argv[1:] if a != "-t"]
+    timestamps = "-t" in sys.argv[1:]
+    source = open(args[0], "rb") if args else sys.stdin.buffer
+    decode(source.read(), load_catalog(), timestamps, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+"""
+profile_decode.py - Tabla legible del volcado del perfilador (piezoBugs/profile.h)
+
+Lee las líneas "prof,..." de un log del monitor serie (o de la salida del
+ejecutable nativo) y muestra, por zona, número de muestras y mínimo, media,
+p50, p90, p99 y máximo en microsegundos. Los percentiles se recalculan a
+partir de las cubetas del histograma.
+
+Uso: python3 tools/profile_decode.py log.txt
+     pio device monitor | python3 tools/profile_decode.py
+Con varios volcados en el mismo log se usa el último.
+"""
+
+import sys
+
+
+def bucket_top(bucket):
+    # Mayor valor de la cubeta: mismo esquema log-lineal que profile.h
+    if bucket < 8:
+        return bucket
+    octave = bucket // 4 + 1
+    width = 1 << (octave - 2)
+    return (4 + bucket % 4) * width + width - 1
+
+
+def percentile(buckets, count, fraction, low, high):
+    rank = max(1, int(fraction * count + 0.5))
+    seen = 0
+    for bucket, n in sorted(buckets.items()):
+        seen += n
+        if seen >= rank:
+            return min(max(bucket_top(bucket), low), high)
+    return high
+
+
+def parse(lines):
+    mhz = None
+    zones = {}
+    for line in lines:
+        fields = line.strip().split(",")
+        if len(fields) < 3 or fields[0] != "prof":
+            continue
+        if fields[1] == "mhz":
+            # Un volcado nuevo sustituye al anterior
+            mhz = int(fields[2])
+            zones = {}
+            continue
+        if len(fields) < 8:
+            continue
+        name = fields[1]
+        count, low, mean, p99, high = (int(x) for x in fields[2:7])
+        buckets = {}
+        for pair in filter(None, fields[7].split(";")):
+            bucket, n = pair.split(":")
+            buckets[int(bucket)] = int(n)
+        zones[name] = (count, low, mean, p99, high, buckets)
+    return mhz, zones
+
+
+def main():
+    source = open(sys.argv[1], errors="replace") if len(sys.argv) > 1 else sys.stdin
+    mhz, zones = parse(source)
+    if not mhz:
+        sys.exit("No hay ningún volcado 'prof,mhz,...' en la entrada")
+
+    print(f"{'zona':<10} {'n':>9} {'mín':>9} {'media':>9} {'p50':>9} {'p90':>9} {'p99':>9} {'máx':>9}  (us)")
+    for name, (count, low, mean, p99, high, buckets) in zones.items():
+        if count == 0:
+            print(f"{name:<10} {0:>9}")
+            continue
+        p50 = percentile(buckets, count, 0.50, low, high)
+        p90 = percentile(buckets, count, 0.90, low, high)
+        values = [v / mhz for v in (low, mean, p50, p90, p99, high)]
+        print(f"{name:<10} {count:>9} " + " ".join(f"{v:>9.2f}" for v in values))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+"""
+sample_bank.py - Genera el banco de muestras de piezoBugs/sample_bank.h
+
+Convierte cada WAV (PCM de 8, 16 o 24 bits, mono o estéreo) a mono de 16
+bits. Las muestras de hasta --max-flash-kb van dentro del banco, que se graba
+en la partición de datos; las más largas se escriben como WAV mono en
+--sd-dir (copiar su contenido a la raíz de la tarjeta) y el banco solo guarda
+su ruta, la posición del PCM y su longitud. El nombre de cada muestra es el
+del archivo sin extensión (hasta 15 caracteres).
+
+Las muestras a otra frecuencia que la del sintetizador (22050 Hz) se
+guardan tal cual y el firmware las convierte al reproducirlas
+(piezoBugs/resampler.h), con una tabla por frecuencia distinta: caben
+SAMPLE_RATE_TABLES y no se admiten las de más de RESAMPLER_MAX_RATIO veces
+la del sintetizador.
+
+Uso: python3 tools/sample_bank.py [-o banco.bin] [--sd-dir sd] [--max-flash-kb 64]
+                                  [--partition 0x310000] archivo.wav...
+Grabar: esptool.py write_flash <dirección que se imprime> banco.bin
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+import wave
+import zlib
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SOURCES = os.path.join(HERE, "..", "piezoBugs")
+
+MAGIC = 0x42534250          # "PBSB"
+VERSION = 1
+HEADER = struct.Struct("<IHHII")
+ENTRY = struct.Struct("<16s32sIIII")
+IN_FLASH, ON_SD = 0, 1
+SD_DIR = "/samples"
+PARTITION_SIZE = 0xE0000    # "spiffs" de huge_app.csv
+
+
+def config_value(name):
+    """Constante de config.h (SAMPLE_BANK_OFFSET, SYNTH_SAMPLE_RATE...)"""
+    with open(os.path.join(SOURCES, "config.h"), encoding="utf-8") as f:
+        match = re.search(rf"{name}\s*=\s*(0x[0-9A-Fa-f]+|\d+)", f.read())
+    return int(match.group(1), 0)
+
+
+def read_mono16(path):
+    with wave.open(path, "rb") as w:
+        channels, width, rate = w.getnchannels(), w.getsampwidth(), w.getframerate()
+        raw = w.readframes(w.getnframes())
+    if width == 1:
+        values = [(b - 128) << 8 for b in raw]
+    elif width == 2:
+        values = list(struct.unpack(f"<{len(raw) // 2}h", raw))
+    elif width == 3:
+        values = [struct.unpack("<h", raw[i + 1:i + 3])[0] for i in range(0, len(raw), 3)]
+    else:
+        sys.exit(f"{path}: {width * 8} bits no soportado")
+    if channels > 1:
+        values = [sum(values[i:i + channels]) // channels for i in range(0, len(values), channels)]
+    return struct.pack(f"<{len(values)}h", *values), rate
+
+
+def write_wav(path, pcm, rate):
+    with wave.open(path, "wb") as w:
+        w.setnchannels(1)
+        w.setsampwidth(2)
+        w.setframerate(rate)
+        w.writeframes(pcm)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("wavs", nargs="+")
+    parser.add_argument("-o", "--output", default="banco.bin")
+    parser.add_argument("--sd-dir", default="sd", help="destino de las muestras largas (raíz de la SD)")
+    parser.add_argument("--max-flash-kb", type=int, default=64, help="muestras mayores van a la SD")
+    parser.add_argument("--partition", type=lambda v: int(v, 0), default=0x310000,
+                        help="dirección de la partición de datos en la flash")
+    args = parser.parse_args()
+
+    bank_offset = config_value("SAMPLE_BANK_OFFSET")
+    synth_rate = config_value("SYNTH_SAMPLE_RATE")
+    max_rate = synth_rate * config_value("RESAMPLER_MAX_RATIO")
+    rate_tables = config_value("SAMPLE_RATE_TABLES")
+    other_rates = set()
+    data_start = HEADER.size + ENTRY.size * len(args.wavs)
+    entries = []
+    data = bytearray()
+    names = set()
+
+    for path in args.wavs:
+        name = os.path.splitext(os.path.basename(path))[0][:15]
+        if name in names:
+            sys.exit(f"{path}: nombre repetido '{name}'")
+        names.add(name)
+        pcm, rate = read_mono16(path)
+        frames = len(pcm) // 2
+        if rate > max_rate:
+            print(f"Aviso: {name} está a {rate} Hz; el sintetizador no convierte más de {max_rate} Hz y no la reproducirá")
+        elif rate != synth_rate:
+            other_rates.add(rate)
+
+        if len(pcm) <= args.max_flash_kb * 1024:
+            offset = data_start + len(data)
+            data += pcm + b"\0" * (-len(pcm) % 4)
+            entries.append(ENTRY.pack(name.encode(), b"", offset, frames, rate, IN_FLASH))
+            where = "flash"
+        else:
+            sd_path = f"{SD_DIR}/{name}.wav"
+            if len(sd_path) >= 32:
+                sys.exit(f"{path}: ruta demasiado larga para el banco ({sd_path})")
+            target = os.path.join(args.sd_dir, SD_DIR.lstrip("/"))
+            os.makedirs(target, exist_ok=True)
+            write_wav(os.path.join(target, f"{name}.wav"), pcm, rate)
+            # wave escribe una cabecera de 44 bytes: el PCM empieza ahí
+            entries.append(ENTRY.pack(name.encode(), sd_path.encode(), 44, frames, rate, ON_SD))
+            where = f"SD {sd_path}"
+        print(f"{name:<16} {frames / rate:6.2f} s  {len(pcm) // 1024:5} KB  {where}")
+
+    if len(other_rates) > rate_tables:
+        print(f"Aviso: {len(other_rates)} frecuencias distintas de {synth_rate} Hz; el firmware solo convierte "
+              f"{rate_tables} (las primeras del banco)")
+
+    directory = b"".join(entries)
+    size = data_start + len(data)
+    if size > PARTITION_SIZE - bank_offset:
+        sys.exit(f"El banco ocupa {size // 1024} KB y solo caben {(PARTITION_SIZE - bank_offset) // 1024} KB")
+    with open(args.output, "wb") as f:
+        f.write(HEADER.pack(MAGIC, VERSION, len(entries), size, zlib.crc32(directory)))
+        f.write(directory)
+        f.write(data)
+    print(f"{args.output}: {len(entries)} muestras, {size // 1024} KB")
+    print(f"Grabar con: esptool.py write_flash 0x{args.partition + bank_offset:X} {args.output}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""
+soak_decode.py - Traza legible de la prueba de larga duración (piezoBugs/soak.h)
+
+Lee la traza binaria de "program soak ... -t traza.bin": cabecera "PBSOAK01",
+semilla y millis() inicial, y eventos de 8 bytes. Cada evento sale con el
+tiempo desde el arranque (días y hora, con millis() ya desenrollado) y el
+valor de millis() que veía el firmware. Los nombres de los invariantes, de
+los insectos y de las notas se leen de piezoBugs/, como en log_decode.py.
+
+Uso: python3 tools/soak_decode.py [-q] traza.bin
+  -q: sin inicios ni finales de secuencia (solo entradas, cambios y fallos)
+"""
+
+import os
+import re
+import struct
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SOURCES = os.path.join(HERE, "..", "piezoBugs")
+
+MAGIC = b"PBSOAK01"
+HEADER = struct.Struct("<8sII")   # magic, semilla, millis() inicial
+EVENT = struct.Struct("<IBBH")    # ms, tipo, a, b
+
+# Mismo orden que SoakEventType
+BUTTON, SEQUENCE, SEQUENCE_END, TYPE, MUTE, FREQ, ROOT, TREE, WRAP, DAY, VIOLATION = range(11)
+PRESSES = {1: "corta", 2: "larga", 3: "doble"}
+STATES = {0: "apagado", 1: "normal (x1)", 2: "lenta (x3)", 3: "muy lenta (x5)", 4: "extremadamente lenta (x7)"}
+
+
+def load_names():
+    with open(os.path.join(SOURCES, "soak.h"), encoding="utf-8") as f:
+        soak_h = f.read()
+    with open(os.path.join(SOURCES, "log.h"), encoding="utf-8") as f:
+        log_h = f.read()
+    with open(os.path.join(SOURCES, "tuning.h"), encoding="utf-8") as f:
+        tuning_h = f.read()
+    checks = re.findall(r'X\(SOAK_CHECK_\w+,\s*"([^"]*)"\)', soak_h)
+    insects = re.findall(r'"([^"]*)"', re.search(r"INSECT_TYPE_NAMES\[\]\s*=\s*\{([^}]*)\}", log_h).group(1))
+    notes = re.findall(r'"([^"]*)"', re.search(r"NOTE_NAMES\[SEMITONES\]\s*=\s*\{([^}]*)\}", tuning_h).group(1))
+    return checks, insects, notes
+
+
+def describe(kind, a, b, names):
+    checks, insects, notes = names
+    if kind == BUTTON:
+        return f"botón {a + 1}: {PRESSES.get(b, b)}"
+    if kind == SEQUENCE:
+        return f"insecto {a + 1}: secuencia de {b} notas"
+    if kind == SEQUENCE_END:
+        return f"insecto {a + 1}: fin de secuencia"
+    if kind == TYPE:
+        return f"insecto {a + 1}: {insects[b] if b < len(insects) else f'tipo {b}'}"
+    if kind == MUTE:
+        return f"insecto {a + 1}: {'muteado' if b else 'activo'}"
+    if kind == FREQ:
+        return f"frecuencia {STATES.get(b, b)}"
+    if kind == ROOT:
+        return f"nota raíz {notes[b % 12]}"
+    if kind == TREE:
+        return f"datos del árbol: densidad {b / 100:.2f}"
+    if kind == WRAP:
+        return f"millis() desbordado ({b})"
+    if kind == DAY:
+        return f"día {b}"
+    if kind == VIOLATION:
+        check = checks[a] if a < len(checks) else f"invariante {a}"
+        return f"VIOLACIÓN {check} ({b})"
+    return f"evento {kind} ({a}, {b})"
+
+
+def clock(elapsed_ms):
+    days, rest = divmod(elapsed_ms, 86400000)
+    hours, rest = divmod(rest, 3600000)
+    minutes, rest = divmod(rest, 60000)
+    return f"{days:>3}d {hours:02}:{minutes:02}:{rest // 1000:02}.{rest % 1000:03}"
+
+
+def decode(data, names, quiet, out):
+    magic, seed, start = HEADER.unpack_from(data, 0)
+    if magic != MAGIC:
+        sys.exit("No es una traza de soak.h")
+    out.write(f"Semilla {seed}, millis() inicial {start}\n")
+    wraps = 0
+    last = start
+    violations = 0
+    for offset in range(HEADER.size, len(data) - EVENT.size + 1, EVENT.size):
+        ms, kind, a, b = EVENT.unpack_from(data, offset)
+        if ms < last:
+            wraps += 1
+        last = ms
+        if kind == VIOLATION:
+            violations += 1
+        if quiet and kind in (SEQUENCE, SEQUENCE_END):
+            continue
+        elapsed = ms + (wraps << 32) - start
+        out.write(f"{clock(elapsed)} [{ms:>10}] {describe(kind, a, b, names)}\n")
+    out.write(f"Violaciones en la traza: {violations}\n")
+
+
+def main():
+    args = [a for a in sys.argv[1:] if a != "-q"]
+    if not args:
+        sys.exit(__doc__)
+    with open(args[0], "rb") as f:
+        decode(f.read(), load_names(), "-q" in sys.argv[1:], sys.stdout)
+
+
+if __name__ == "__main__":
+    main()